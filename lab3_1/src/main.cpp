@@ -54,8 +54,11 @@ void setup() {
 
 void loop() {
     if (static_cast<int>(mode & Mode::STA)) {
-        Serial.print("[STA]: ");
-        sta::get_signal_strength();
+        if (sta::connected()) {
+            Serial.printf("[STA]: Signal strength: %.2f%%\n", sta::get_signal_strength());
+        } else {
+            Serial.println("[STA]: Not connected to WiFi.");
+        }
     }
     if (static_cast<int>(mode & Mode::AP)) {
         Serial.print("[AP]: ");
@@ -1,21 +1,249 @@
+#ifndef DHT_HPP
+#define DHT_HPP
+
+#include <atomic>
 #include "DHT.h"
 
+/**
+ * DHT22 sampling.
+ *
+ * A dedicated task runs exactly one sensor transaction per period (the library
+ * validates the checksum), filters it and stores the result in a lock-free slot.
+ * loop() only copies the last good reading with latest(), so it never waits out
+ * a read or its timeout, and NaNs from failed reads are never published. The
+ * task outranks loop() on core 1, so a read may still preempt mqtt::loop() for
+ * the ~5 ms the bit-banged transaction keeps interrupts off; that only delays
+ * loop(), and the Wi-Fi stack on core 0 keeps running.
+ *
+ * Filtering: a median over the last filterLength good readings. A reading that
+ * jumps further than maxStep from the median is dropped as an outlier, unless
+ * several in a row agree with each other within maxStep (then it is a real
+ * change and the window restarts). Scattered glitches never add up to a step.
+ */
 namespace dht {
 
 const uint8_t DHT_PIN = 4;
 const uint8_t DHT_TYPE = DHT22;
 
+// --- Configuration ---
+const unsigned long minPeriodMillis = 2000;  // DHT22 cannot be read faster
+const size_t filterLength = 5;               // Odd, so the median is a sample
+const float maxTemperatureStep = 5.0f;       // C from the median
+const float maxHumidityStep = 15.0f;         // % from the median
+const uint8_t outliersToAccept = 3;          // Consecutive agreeing outliers = real step
+
+struct Reading {
+    float temperature;
+    float humidity;
+    float heatIndex;
+    unsigned long sampleMillis; // millis() of the transaction behind this value
+};
+
+struct Stats {
+    uint32_t transactions;
+    uint32_t failedReads;   // Timeout or checksum mismatch
+    uint32_t outliers;
+};
+
+/**
+ * @brief Single-writer slot (seqlock): the writer never waits, readers retry on a torn copy.
+ */
+class Slot {
+public:
+    void store(const Reading& reading) {
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed); // Odd: write in progress
+        std::atomic_thread_fence(std::memory_order_release);
+        value = reading;
+        std::atomic_thread_fence(std::memory_order_release);
+        sequence.store(seq + 2, std::memory_order_relaxed);
+    }
+
+    /**
+     * @return false until the first reading has been stored.
+     */
+    bool load(Reading& out) const {
+        uint32_t before, after;
+        do {
+            before = sequence.load(std::memory_order_acquire);
+            out = value;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        } while (before != after || (before & 1));
+        return before != 0;
+    }
+
+private:
+    std::atomic<uint32_t> sequence{0};
+    Reading value = {};
+};
+
 DHT dht(DHT_PIN, DHT_TYPE);
 
+Slot slot;
+Stats stats = {};
+TaskHandle_t taskHandle = NULL;
+volatile unsigned long periodMillis = minPeriodMillis;
+
+float temperatureWindow[filterLength];
+float humidityWindow[filterLength];
+size_t windowCount = 0;
+size_t windowNext = 0;
+uint8_t pendingOutliers = 0;
+float candidateTemperature = 0; // First of the pending outliers: the level they have to agree on
+float candidateHumidity = 0;
+
+float median(const float* values, size_t count) {
+    float sorted[filterLength];
+    memcpy(sorted, values, count * sizeof(float));
+    // Insertion sort: at most filterLength elements
+    for (size_t i = 1; i < count; i++) {
+        float v = sorted[i];
+        size_t j = i;
+        for (; j > 0 && sorted[j - 1] > v; j--) {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = v;
+    }
+    return count % 2 ? sorted[count / 2] : (sorted[count / 2 - 1] + sorted[count / 2]) / 2;
+}
+
+/**
+ * @brief Runs one sensor transaction.
+ * @return false on timeout/checksum error or a physically impossible value.
+ */
+bool transaction(float& temperature, float& humidity) {
+    stats.transactions++;
+    if (!dht.read(true)) {
+        stats.failedReads++;
+        return false;
+    }
+    // Both getters reuse the data of the read above instead of starting new transactions
+    temperature = dht.readTemperature(false, false);
+    humidity = dht.readHumidity(false);
+    if (isnan(temperature) || isnan(humidity) || temperature < -40 || temperature > 80 ||
+        humidity < 0 || humidity > 100) {
+        stats.failedReads++;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Adds a valid reading to the median window.
+ * @return false if it was dropped as an outlier.
+ */
+bool filter(float temperature, float humidity) {
+    if (windowCount >= filterLength / 2 + 1) {
+        bool jump = fabsf(temperature - median(temperatureWindow, windowCount)) > maxTemperatureStep ||
+                    fabsf(humidity - median(humidityWindow, windowCount)) > maxHumidityStep;
+        if (jump) {
+            bool agrees = pendingOutliers > 0 &&
+                          fabsf(temperature - candidateTemperature) <= maxTemperatureStep &&
+                          fabsf(humidity - candidateHumidity) <= maxHumidityStep;
+            if (!agrees) {
+                pendingOutliers = 0;
+                candidateTemperature = temperature;
+                candidateHumidity = humidity;
+            }
+            if (++pendingOutliers < outliersToAccept) {
+                stats.outliers++;
+                return false;
+            }
+        }
+        if (jump) {
+            // The level really changed, don't let old samples drag it back
+            windowCount = 0;
+            windowNext = 0;
+        }
+    }
+    pendingOutliers = 0;
+    temperatureWindow[windowNext] = temperature;
+    humidityWindow[windowNext] = humidity;
+    windowNext = (windowNext + 1) % filterLength;
+    if (windowCount < filterLength) windowCount++;
+    return true;
+}
+
+void sample() {
+    float temperature, humidity;
+    if (!transaction(temperature, humidity) || !filter(temperature, humidity)) {
+        return;
+    }
+    // Until the ring is full its valid entries are the first windowCount ones
+    Reading reading;
+    reading.temperature = median(temperatureWindow, windowCount);
+    reading.humidity = median(humidityWindow, windowCount);
+    reading.heatIndex = dht.computeHeatIndex(reading.temperature, reading.humidity, false);
+    reading.sampleMillis = millis();
+    slot.store(reading);
+}
+
+void samplingTask(void* parameter) {
+    TickType_t lastWake = xTaskGetTickCount();
+    while (true) {
+        sample();
+        // Sleeps for the period; setPeriod() wakes the task early to apply a new one
+        TickType_t period = pdMS_TO_TICKS(periodMillis);
+        TickType_t elapsed = xTaskGetTickCount() - lastWake;
+        if (ulTaskNotifyTake(pdTRUE, elapsed < period ? period - elapsed : 0) > 0) {
+            // New period: keep the sensor's minimum spacing from the last transaction
+            elapsed = xTaskGetTickCount() - lastWake;
+            if (elapsed < pdMS_TO_TICKS(minPeriodMillis)) {
+                vTaskDelay(pdMS_TO_TICKS(minPeriodMillis) - elapsed);
+            }
+        }
+        lastWake = xTaskGetTickCount();
+    }
+}
+
 void setupDHT() {
     dht.begin();
     Serial.println("[DHT] Sensor initialized.");
 }
 
+/**
+ * @brief Starts the background sampling task.
+ * Same core as loop(): the read's interrupt-off window then never touches the Wi-Fi core.
+ */
+bool begin(unsigned long period) {
+    setupDHT();
+    periodMillis = max(period, minPeriodMillis);
+    BaseType_t created = xTaskCreatePinnedToCore(samplingTask, "DHT_Task", 3072, NULL, 2, &taskHandle, 1);
+    if (created != pdPASS) {
+        Serial.println("[DHT] Error creating sampling task!");
+        return false;
+    }
+    return true;
+}
+
+void setPeriod(unsigned long period) {
+    periodMillis = max(period, minPeriodMillis);
+    if (taskHandle != NULL) {
+        xTaskNotifyGive(taskHandle);
+    }
+}
+
+/**
+ * @brief Last filtered reading; never blocks.
+ * @return false until the first good reading.
+ */
+bool latest(Reading& reading) {
+    return slot.load(reading);
+}
+
+/**
+ * @brief One synchronous, unfiltered transaction (duty-cycled mode: one reading per wake).
+ * Values are NaN if the read failed.
+ */
 void readData(float& temperature, float& humidity, float& heatIndex) {
-    temperature = dht.readTemperature();
-    humidity = dht.readHumidity();
+    if (!transaction(temperature, humidity)) {
+        temperature = humidity = heatIndex = NAN;
+        return;
+    }
     heatIndex = dht.computeHeatIndex(temperature, humidity, false);
 }
 
-} // namespace dht
\ No newline at end of file
+} // namespace dht
+
+#endif // DHT_HPP
@@ -0,0 +1,280 @@
+#ifndef DUTY_CYCLE_HPP
+#define DUTY_CYCLE_HPP
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <sys/time.h>
+#include "esp_sleep.h"
+
+/**
+ * Duty-cycled mode for battery nodes (build with -D DUTY_CYCLE=1, see platformio.ini).
+ *
+ * Every wake from deep sleep takes one DHT22 reading and appends it to a batch in
+ * RTC slow memory; Wi-Fi and MQTT are brought up only every publishEvery wakes to
+ * send the whole batch at QoS 1. Readings carry their capture time, so they are
+ * published in the "temp:hum:hi:epochMillis" format the service already accepts.
+ *
+ * Energy proxies (awake time per sample, radio-on time) are accumulated across
+ * wakes and published to metricsTopic on every radio session.
+ *
+ * Uses sta, mqtt, dht, payload and commands, which main.cpp includes first.
+ */
+
+#ifndef DUTY_CYCLE
+#define DUTY_CYCLE 0
+#endif
+
+namespace duty {
+
+// --- Configuration ---
+const size_t batchCapacity = 48;                    // Oldest reading is dropped when full
+const uint32_t defaultSleepMillis = 60000;
+const uint16_t defaultPublishEvery = 10;            // Wakes per radio session
+const unsigned long connectTimeoutMillis = 10000;   // Broker session budget per radio session
+const unsigned long ackTimeoutMillis = 5000;        // Wait for PUBACKs before powering down
+const unsigned long timeSyncTimeoutMillis = 3000;   // Only spent while the clock is unset
+const uint64_t minValidEpochMillis = 1600000000000ULL;
+const char* metricsTopic = "esp32/0ad3/power";
+const uint32_t rtcMagic = 0x44435932;               // "DCY2", invalidates RTC state after a cold boot
+
+struct Reading {
+    float temperature;
+    float humidity;
+    float heatIndex;
+    uint64_t timestampMs; // 0 while the clock is not synced
+};
+
+// Survives deep sleep (RTC slow memory), lost on power-up and reset
+struct RtcState {
+    uint32_t magic;
+    uint32_t sleepMillis;    // Wake period, set by the "sample" command
+    uint32_t publishMillis;  // Set by the "publish" command
+    uint16_t publishEvery;   // publishMillis in wakes, kept in step with sleepMillis
+    uint16_t head;
+    uint16_t count;
+    uint32_t wakes;
+    uint32_t failedReads;    // Wakes whose reading was NaN, not batched
+    uint32_t dropped;
+    uint32_t sessions;
+    uint32_t failedSessions;
+    uint64_t awakeMicros;    // Total time spent awake, all wakes
+    uint64_t radioMicros;    // Total time with Wi-Fi on
+    uint32_t lastRadioMillis;
+    Reading batch[batchCapacity];
+};
+
+RTC_DATA_ATTR RtcState rtc;
+
+void resetState() {
+    memset(&rtc, 0, sizeof(rtc));
+    rtc.magic = rtcMagic;
+    rtc.sleepMillis = defaultSleepMillis;
+    rtc.publishMillis = defaultPublishEvery * defaultSleepMillis;
+    rtc.publishEvery = defaultPublishEvery;
+}
+
+/**
+ * @brief Converts the publish interval into wakes; called whenever either period changes.
+ */
+void updatePublishEvery() {
+    rtc.publishEvery = constrain(rtc.publishMillis / rtc.sleepMillis, 1, batchCapacity);
+    Serial.printf("[DUTY] Publishing every %u wakes\n", rtc.publishEvery);
+}
+
+uint64_t epochMillis() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    uint64_t ms = (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+    return ms >= minValidEpochMillis ? ms : 0;
+}
+
+void record(const Reading& reading) {
+    if (rtc.count == batchCapacity) {
+        rtc.head = (rtc.head + 1) % batchCapacity;
+        rtc.count--;
+        rtc.dropped++;
+    }
+    rtc.batch[(rtc.head + rtc.count) % batchCapacity] = reading;
+    rtc.count++;
+}
+
+void formatReading(const Reading& r, char* buffer, size_t size) {
+    if (r.timestampMs) {
+        payload::formatDht(buffer, size, r.temperature, r.humidity, r.heatIndex, r.timestampMs);
+    } else {
+        // Captured before the first time sync: the service falls back to arrival time
+        payload::formatDht(buffer, size, r.temperature, r.humidity, r.heatIndex);
+    }
+}
+
+/**
+ * @brief Sends the batch through the QoS 1 window and waits for every PUBACK.
+ * @return true if the broker acknowledged the whole batch (it is then cleared).
+ */
+bool publishBatch() {
+    unsigned long start = millis();
+    size_t sent = 0;
+    char message[64];
+    while (sent < rtc.count && millis() - start < ackTimeoutMillis) {
+        mqtt::loop();
+        formatReading(rtc.batch[(rtc.head + sent) % batchCapacity], message, sizeof(message));
+        // trySend fails while the window is full; loop() frees slots as PUBACKs arrive
+        if (mqtt::trySend(mqtt::txTopic, message, 1)) {
+            sent++;
+        } else {
+            delay(5);
+        }
+    }
+    while (mqtt::inflightCount() > 0 && millis() - start < ackTimeoutMillis) {
+        mqtt::loop();
+        delay(5);
+    }
+    if (sent < rtc.count || mqtt::inflightCount() > 0) {
+        // Keep everything: at-least-once may duplicate, but never loses a reading
+        Serial.printf("[DUTY] Batch not fully acknowledged (%u/%u sent), kept for next session.\n",
+                      (unsigned)sent, rtc.count);
+        return false;
+    }
+    Serial.printf("[DUTY] Published %u readings.\n", rtc.count);
+    rtc.head = 0;
+    rtc.count = 0;
+    return true;
+}
+
+/**
+ * @brief Publishes the energy proxies: awake and radio-on milliseconds per sample.
+ */
+void publishMetrics() {
+    float samples = rtc.wakes ? (float)rtc.wakes : 1.0f;
+    char json[128];
+    snprintf(json, sizeof(json),
+             "{\"wakes\": %u, \"failed_reads\": %u, \"dropped\": %u, \"failed\": %u, \"awake_ms\": %.1f, \"radio_ms\": %.1f, \"radio_last_ms\": %u}",
+             rtc.wakes, rtc.failedReads, rtc.dropped, rtc.failedSessions, rtc.awakeMicros / 1000.0f / samples,
+             rtc.radioMicros / 1000.0f / samples, rtc.lastRadioMillis);
+    Serial.printf("[DUTY] Metrics: %s\n", json);
+    mqtt::trySend(metricsTopic, json, 0);
+}
+
+/**
+ * @brief Applies commands received during the session to the next cycles.
+ * Commands sent while the node sleeps are lost (clean session, QoS 0 subscription).
+ */
+void applyCommands() {
+    commands::Command command;
+    while (commands::poll(command)) {
+        switch (command.type) {
+            case commands::Type::SampleInterval:
+                rtc.sleepMillis = command.value;
+                Serial.printf("[DUTY] Wake period: %u ms\n", rtc.sleepMillis);
+                updatePublishEvery();
+                break;
+            case commands::Type::PublishInterval:
+                rtc.publishMillis = command.value;
+                updatePublishEvery();
+                break;
+            case commands::Type::RateLimit:
+                break; // Every reading in the batch is published
+            case commands::Type::BatchSize:
+                mqtt::flushPerLoop = command.value;
+                break;
+            case commands::Type::Snapshot:
+                break; // Every session already sends the latest readings
+            case commands::Type::Reboot:
+                rtc.magic = 0;
+                Serial.println("[DUTY] Rebooting...");
+                Serial.flush();
+                ESP.restart();
+                break;
+        }
+    }
+}
+
+/**
+ * @brief Brings the radio up, publishes the batch and metrics, then powers Wi-Fi down.
+ */
+void session() {
+    unsigned long radioStart = micros();
+    bool ok = sta::connect_to_wifi();
+    if (ok) {
+        configTime(0, 0, "pool.ntp.org");
+        // The RTC keeps time through deep sleep; only the first session waits for SNTP
+        unsigned long syncStart = millis();
+        while (epochMillis() == 0 && millis() - syncStart < timeSyncTimeoutMillis) {
+            delay(50);
+        }
+
+        commands::init();
+        mqtt::setupMqtt();
+        mqtt::setCallback(commands::onMessage);
+        unsigned long connectStart = millis();
+        while (!mqtt::connected() && millis() - connectStart < connectTimeoutMillis) {
+            mqtt::loop();
+            delay(10);
+        }
+        ok = mqtt::connected() && publishBatch();
+        if (ok) {
+            Serial.printf("[TIME] Boot to first publish: %lu ms (WiFi connect %lu ms)\n",
+                          millis(), sta::lastConnectMillis);
+        }
+        if (mqtt::connected()) {
+            publishMetrics();
+            mqtt::loop();
+            applyCommands();
+            mqtt::client.disconnect();
+        }
+    }
+    sta::stop();
+
+    uint32_t radioMicros = micros() - radioStart;
+    rtc.radioMicros += radioMicros;
+    rtc.lastRadioMillis = radioMicros / 1000;
+    rtc.sessions++;
+    if (!ok) rtc.failedSessions++;
+}
+
+/**
+ * @brief One duty cycle: read, batch, publish when due, deep sleep. Never returns.
+ */
+void cycle() {
+    bool coldBoot = rtc.magic != rtcMagic || esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TIMER;
+    if (coldBoot) {
+        resetState();
+    }
+    rtc.wakes++;
+
+    dht::setupDHT();
+    Reading reading;
+    dht::readData(reading.temperature, reading.humidity, reading.heatIndex);
+    if (isnan(reading.temperature)) {
+        // A failed read is counted, never batched: the service would get "nan:nan:nan"
+        rtc.failedReads++;
+        Serial.printf("[DUTY] Wake %u: sensor read failed (%u so far), %u/%u batched\n", rtc.wakes,
+                      rtc.failedReads, rtc.count, rtc.publishEvery);
+    } else {
+        reading.timestampMs = epochMillis();
+        record(reading);
+        Serial.printf("[DUTY] Wake %u: %.2f C, %.2f %%, %u/%u batched\n", rtc.wakes,
+                      reading.temperature, reading.humidity, rtc.count, rtc.publishEvery);
+    }
+
+    // A cold boot opens a session right away so the clock is synced before readings pile up
+    if (coldBoot || rtc.count >= rtc.publishEvery || rtc.count == batchCapacity) {
+        session();
+    }
+
+    // micros() restarts on every wake, so it is this wake's awake time
+    uint32_t awakeMicros = micros();
+    rtc.awakeMicros += awakeMicros;
+    uint64_t periodMicros = (uint64_t)rtc.sleepMillis * 1000;
+    uint64_t sleepMicros = periodMicros > awakeMicros ? periodMicros - awakeMicros : 1000;
+    Serial.printf("[DUTY] Awake %u ms, sleeping %llu ms\n", awakeMicros / 1000,
+                  (unsigned long long)(sleepMicros / 1000));
+    Serial.flush();
+
+    esp_sleep_enable_timer_wakeup(sleepMicros);
+    esp_deep_sleep_start();
+}
+
+} // namespace duty
+
+#endif // DUTY_CYCLE_HPP
@@ -2,23 +2,73 @@
 #include "sta.hpp"
 #include "mqtt.hpp"
 #include "dht.hpp"
+#include "deadband.hpp"
+#include "payload.hpp"
+#include "spool.hpp"
+#include "commands.hpp"
+#include "duty_cycle.hpp"
 
 unsigned long fullLoopEndTime = 0, loopStartTime = 0;
-constexpr unsigned long publishIntervalMillis = 2000;
-
-void mqttCallback(char* topic, byte* payload, unsigned int length) {
-  Serial.print("MSG [");
-  Serial.print(topic);
-  Serial.print("]: ");
-  for (unsigned int i = 0; i < length; i++) {
-    Serial.print((char)payload[i]);
+constexpr uint8_t publishQos = 1;
+
+// Report by exception: temperature (C), humidity (%), heat index (C)
+const float deadbands[] = {0.2f, 1.0f, 0.3f};
+
+// Runtime-tunable over rxTopic (see commands.hpp)
+unsigned long sampleIntervalMillis = 2000;
+deadband::Reporter<3> reporter(deadbands, {60000, 2000}); // Heartbeat, rate limit
+bool snapshotRequested = false;
+bool firstPublishLogged = false;
+
+void handleCommands() {
+  commands::Command command;
+  while (commands::poll(command)) {
+    switch (command.type) {
+      case commands::Type::SampleInterval:
+        sampleIntervalMillis = max<unsigned long>(command.value, dht::minPeriodMillis);
+        dht::setPeriod(sampleIntervalMillis);
+        Serial.printf("[CMD] Sample interval: %lu ms\n", sampleIntervalMillis);
+        break;
+      case commands::Type::PublishInterval:
+        reporter.policy.heartbeatMillis = command.value;
+        Serial.printf("[CMD] Heartbeat interval: %u ms\n", command.value);
+        break;
+      case commands::Type::RateLimit:
+        reporter.policy.minIntervalMillis = command.value;
+        Serial.printf("[CMD] Min publish interval: %u ms\n", command.value);
+        break;
+      case commands::Type::BatchSize:
+        mqtt::flushPerLoop = command.value;
+        spool::replayBurst = command.value;
+        Serial.printf("[CMD] Backlog batch size: %u\n", command.value);
+        break;
+      case commands::Type::Snapshot:
+        snapshotRequested = true;
+        break;
+      case commands::Type::Reboot:
+        Serial.println("[CMD] Rebooting...");
+        Serial.flush();
+        ESP.restart();
+        break;
+    }
   }
-  Serial.println();
+}
+
+// Replayed readings carry their capture time as a fourth field: "temp:hum:hi:epochMillis"
+bool publishSpooled(uint64_t timestampMs, const char* payload, size_t length) {
+  char message[spool::maxPayloadLength + 24];
+  snprintf(message, sizeof(message), "%s:%llu", payload, (unsigned long long)timestampMs);
+  return mqtt::trySend(mqtt::txTopic, message, publishQos);
 }
 
 void setup() {
   Serial.begin(115200);
 
+#if DUTY_CYCLE
+  // Battery mode: read, batch in RTC memory, publish every few wakes, deep sleep
+  duty::cycle();
+#endif
+
   if (!sta::connect_to_wifi()) {
     Serial.println("Failed to connect to WiFi. Halting execution.");
     while (true) {
@@ -26,10 +76,17 @@ void setup() {
     }
   }
 
+  // Wall-clock time for spooled readings; syncs in the background
+  configTime(0, 0, "pool.ntp.org");
+  if (!spool::init()) {
+    Serial.println("Spool unavailable, readings are only buffered in RAM while offline.");
+  }
+
+  commands::init();
   mqtt::setupMqtt();
-  mqtt::setCallback(mqttCallback);
+  mqtt::setCallback(commands::onMessage);
 
-  dht::setupDHT();
+  dht::begin(sampleIntervalMillis);
 }
 
 void loop() {
@@ -37,28 +94,58 @@ void loop() {
   // Serial.printf("[TIME] Full loop time: %lu microseconds\n", fullLoopEndTime - loopStartTime);
   loopStartTime = micros();
 
-  if (!mqtt::client.connected()) {
-    mqtt::connect();
-  }
-  mqtt::client.loop();
+  mqtt::loop();
+
+  handleCommands();
 
-  static unsigned long lastPublishTime = 0;
+  static unsigned long lastSampleMillis = 0;
   unsigned long currentTime = millis();
 
-  // Publish every publishIntervalMillis milliseconds
-  if (currentTime - lastPublishTime >= publishIntervalMillis) {
-    float temperature, humidity, heatIndex;
-    dht::readData(temperature, humidity, heatIndex);
-
-    if (mqtt::client.connected()) {
-      String message = String(temperature) + ":" + String(humidity) + ":" + String(heatIndex);
-      Serial.printf("[MQTT] Publishing to topic %s: %s\n", mqtt::txTopic, message.c_str());
-      if (mqtt::client.publish(mqtt::txTopic, message.c_str())) {
-        lastPublishTime = currentTime;
-      } else {
+  // The sampling task keeps the last filtered reading; nothing is published before the first one
+  dht::Reading reading;
+  deadband::Reason reason = deadband::Reason::None;
+  if (dht::latest(reading)) {
+    if (reading.sampleMillis != lastSampleMillis) {
+      lastSampleMillis = reading.sampleMillis;
+      const float values[] = {reading.temperature, reading.humidity, reading.heatIndex};
+      reason = reporter.offer(values, currentTime, snapshotRequested);
+    } else {
+      reason = reporter.poll(currentTime, snapshotRequested);
+    }
+  }
+
+  // Publish on change, heartbeat or snapshot (buffered while the broker is unreachable)
+  if (reason != deadband::Reason::None) {
+    snapshotRequested = false;
+    const float* values = reporter.current();
+    char text[payload::maxDhtLength];
+    int length = payload::formatDht(text, sizeof(text), values[0], values[1], values[2]);
+    bool accepted = false;
+    if (!mqtt::connected() && spool::append(text, length)) {
+      Serial.printf("[SPOOL] Broker unreachable, spooled: %s\n", text);
+      accepted = true;
+    } else {
+      Serial.printf("[MQTT] Publishing to topic %s (%s): %s\n", mqtt::txTopic,
+                    deadband::reasonName(reason), text);
+      accepted = mqtt::publish(mqtt::txTopic, text, publishQos);
+      if (!accepted) {
         Serial.println("[MQTT] Failed to publish message");
+      } else if (!firstPublishLogged && mqtt::connected()) {
+        // Dominated by the WiFi connect; see sta.hpp for the cached fast path
+        firstPublishLogged = true;
+        Serial.printf("[TIME] Boot to first publish: %lu ms (WiFi connect %lu ms)\n",
+                      millis(), sta::lastConnectMillis);
       }
     }
+    // A rejected record stays pending and is retried on the next loop
+    if (accepted) {
+      reporter.sent(currentTime);
+    }
+  }
+
+  // Drain readings stored during an outage, throttled so live data keeps priority
+  if (mqtt::connected()) {
+    spool::replay(publishSpooled);
   }
 
   unsigned long userLoopFinishTime = micros();
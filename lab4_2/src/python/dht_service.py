@@ -4,53 +4,322 @@ dht_service.py
 
 Subscribe to an MQTT topic and plot real-time graphs for DHT sensor data.
 Expected payload format: "temp:humidity:heatindex" where each value is a float.
+Readings replayed from the device spool after an outage carry their capture time
+as a fourth field: "temp:humidity:heatindex:epoch_ms".
+The tagged binary form (lib/telemetry/src/payload.hpp, tools/loadgen --binary) is accepted too.
+
+Messages are only queued by the MQTT thread; the plot timer decodes them in batches
+(numpy) into a preallocated column ring per device. With a wildcard topic every
+device gets its own line.
 
 Usage:
     python dht_service.py --host test.mosquitto.org --port 1883 --topic esp32/0ad3/tx
+    python dht_service.py --host 127.0.0.1 --topic 'esp32/+/tx' --buffer 20000
+    python dht_service.py --host 127.0.0.1 --topic 'esp32/+/tx' --store ~/sensor-history   # persistent history (tools/tsdb)
+
+Consumer benchmark (no plotting), e.g. against tools/loadgen:
+    python dht_service.py --host 127.0.0.1 --topic 'esp32/+/tx' --throughput
 
-The script uses paho-mqtt for MQTT and matplotlib for plotting.
+Offline decode benchmark (no broker):
+    python dht_service.py --bench 200000 --bench-devices 500
+
+The script uses paho-mqtt for MQTT, numpy for ingestion and matplotlib for plotting.
 """
 
 import argparse
+import os
+import sys
 import threading
-from collections import deque
+import time
+import warnings
 from datetime import datetime
 
+import numpy as np
 import matplotlib.pyplot as plt
 import matplotlib.dates as mdates
 from matplotlib.animation import FuncAnimation
 import paho.mqtt.client as mqtt
 
+# Stored columns (tools/tsdb history)
+FIELDS = ('temperature', 'humidity', 'heat_index')
+
+# Binary payloads: tag byte, little-endian float32 fields, optional uint64 capture time
+BINARY_FORMATS = {
+    (0xD1, 13): np.dtype([('tag', 'u1'), ('v', '<f4', 3)]),
+    (0xD2, 21): np.dtype([('tag', 'u1'), ('v', '<f4', 3), ('ts', '<u8')]),
+}
+
 
 def parse_payload(payload: str):
-    """Parse payload like 'x:y:z' into tuple of floats (temp, hum, heatindex).
+    """Parse payload like 'x:y:z[:ts]' into tuple (temp, hum, heatindex, time).
+    time is the capture datetime for replayed readings, None for live ones.
     Returns None on parse error.
     """
     try:
         parts = payload.strip().split(":")
-        if len(parts) != 3:
+        if len(parts) not in (3, 4):
             return None
-        t, h, hi = map(float, parts)
-        return t, h, hi
+        t, h, hi = map(float, parts[:3])
+        ts = datetime.fromtimestamp(int(parts[3]) / 1000.0) if len(parts) == 4 else None
+        return t, h, hi, ts
     except Exception:
         return None
 
 
+def decode_batch(payloads):
+    """Decode a list of raw payloads at once.
+
+    Returns (values, ts, ok): values is float32 (n, 3) temp/hum/heatindex, ts the capture time
+    in epoch seconds (NaN for live readings), ok marks the payloads that decoded.
+    Payloads are classified with array operations on their concatenation (binary tag and size,
+    or text field count), then each format is converted by a single numpy call; a text group
+    that fails falls back to parse_payload().
+    """
+    n = len(payloads)
+    values = np.full((n, 3), np.nan, dtype=np.float32)
+    ts = np.full(n, np.nan)
+    ok = np.zeros(n, dtype=bool)
+
+    lengths = np.fromiter(map(len, payloads), dtype=np.int64, count=n)
+    joined = b':'.join(payloads)
+    buf = np.frombuffer(joined, dtype=np.uint8)
+    starts = np.cumsum(lengths + 1) - lengths - 1
+    colons = np.concatenate(([0], np.cumsum(buf == ord(':'))))
+    fields = colons[starts + lengths] - colons[starts] + 1
+    first = np.zeros(n, dtype=np.int64)
+    nonempty = lengths > 0
+    first[nonempty] = buf[starts[nonempty]]
+    # Binary: key tag * 256 + size; text: key -(field count)
+    kinds = np.where(first >= 0x80, first * 256 + lengths, -fields)
+    keys = np.unique(kinds)
+
+    for key in keys:
+        idx = np.flatnonzero(kinds == key) if len(keys) > 1 else slice(None)
+        group = payloads if len(keys) == 1 else [payloads[i] for i in idx]
+        if key > 0:
+            dtype = BINARY_FORMATS.get((key >> 8, key & 0xFF))
+            if dtype is None:
+                continue
+            rows = np.frombuffer(b''.join(group), dtype=dtype)
+            values[idx] = rows['v']
+            if 'ts' in dtype.names:
+                ts[idx] = rows['ts'] / 1000.0
+            ok[idx] = True
+        elif -key in (3, 4):
+            text = joined if len(keys) == 1 else b':'.join(group)
+            try:
+                # Text-mode fromstring: C parser; it warns (future: raises) on unparsable fields
+                with warnings.catch_warnings():
+                    warnings.simplefilter('error', DeprecationWarning)
+                    parsed = np.fromstring(text, sep=':')
+                parsed = parsed.reshape(-1, -key)
+                if len(parsed) != len(group):
+                    raise ValueError
+            except (ValueError, DeprecationWarning):
+                for i in np.arange(n)[idx]:
+                    single = parse_payload(payloads[i].decode(errors='ignore'))
+                    if single is not None:
+                        values[i] = single[:3]
+                        ts[i] = single[3].timestamp() if single[3] is not None else np.nan
+                        ok[i] = True
+                continue
+            values[idx] = parsed[:, :3]
+            if key == -4:
+                ts[idx] = parsed[:, 3] / 1000.0
+            ok[idx] = True
+    return values, ts, ok
+
+
+class RingStore:
+    """Preallocated per-device ring buffers, column by column: times[device, row] (epoch s) and
+    values[device, row, column] (float32).
+
+    append() writes a whole decoded batch, for all devices at once, with one fancy-index store.
+    Each ring keeps the most recently received rows; view() returns them in capture-time order,
+    so readings replayed from the spool land where they belong.
+    """
+
+    def __init__(self, capacity, columns, devices=16):
+        self.capacity = capacity
+        self.columns = columns
+        self.slots = {}
+        self.topics = []
+        self._allocate(devices)
+
+    def _allocate(self, devices):
+        """(Re)allocates the columns for `devices` rings, keeping the existing ones."""
+        times = np.zeros((devices, self.capacity), dtype=np.float64)
+        values = np.zeros((devices, self.capacity, self.columns), dtype=np.float32)
+        head, count, ordered = np.zeros(devices, np.int64), np.zeros(devices, np.int64), np.ones(devices, bool)
+        if hasattr(self, 'times'):
+            used = len(self.head)
+            times[:used], values[:used] = self.times, self.values
+            head[:used], count[:used], ordered[:used] = self.head, self.count, self.ordered
+        self.times, self.values = times, values
+        self.head, self.count, self.ordered = head, count, ordered
+
+    def slot(self, topic):
+        slot = self.slots.get(topic)
+        if slot is None:
+            slot = self.slots[topic] = len(self.topics)
+            self.topics.append(topic)
+            if slot == len(self.head):
+                self._allocate(2 * slot)
+        return slot
+
+    def append(self, slots, times, values):
+        """Store rows; slots, times and values are parallel arrays. Returns the updated slots."""
+        order = np.argsort(slots, kind='stable')
+        slots, times, values = slots[order], times[order], values[order]
+        counts = np.bincount(slots, minlength=len(self.head))
+        starts = np.cumsum(counts) - counts
+        rank = np.arange(len(slots)) - starts[slots]
+        # Only the last `capacity` rows of a device survive the batch
+        keep = rank >= counts[slots] - self.capacity
+        slots, times, values, rank = slots[keep], times[keep], values[keep], rank[keep]
+
+        # Rows older than their predecessor (spool replay) mark the ring for sorting in view()
+        previous = np.where(rank == 0, self.times[slots, (self.head[slots] - 1) % self.capacity],
+                            np.roll(times, 1))
+        late = times < previous
+        late &= (rank > 0) | (self.count[slots] > 0)
+        self.ordered[slots[late]] = False
+
+        rows = (self.head[slots] + rank) % self.capacity
+        self.times[slots, rows] = times
+        self.values[slots, rows] = values
+        updated = np.flatnonzero(counts)
+        self.head[updated] = (self.head[updated] + counts[updated]) % self.capacity
+        self.count[updated] = np.minimum(self.count[updated] + counts[updated], self.capacity)
+        return updated
+
+    def view(self, slot):
+        """Chronological copies (times, values) of one device's rows."""
+        idx = (self.head[slot] - self.count[slot] + np.arange(self.count[slot])) % self.capacity
+        t, v = self.times[slot, idx], self.values[slot, idx]
+        if not self.ordered[slot]:
+            order = np.argsort(t, kind='stable')
+            t, v = t[order], v[order]
+            # Store back sorted, so the next view is a plain copy
+            self.times[slot, idx], self.values[slot, idx] = t, v
+            self.ordered[slot] = True
+        return t, v
+
+    def span(self, slot):
+        """(oldest, newest) time of an ordered ring."""
+        return (self.times[slot, (self.head[slot] - self.count[slot]) % self.capacity],
+                self.times[slot, (self.head[slot] - 1) % self.capacity])
+
+
+class Ingest:
+    """Queue filled by the MQTT thread, decoded in batches into the ring store by drain().
+
+    With a history store (--store) every decoded row is also appended there, and preload()
+    refills the rings from it after a restart.
+    """
+
+    def __init__(self, capacity, history=None):
+        self.lock = threading.Lock()
+        self.pending = []
+        self.history = history
+        self.store = RingStore(capacity, 3)
+
+    def push(self, topic, payload):
+        with self.lock:
+            self.pending.append((topic, payload, time.time()))
+
+    def drain(self):
+        """Decode everything queued so far.
+
+        Returns (received, malformed, latencies_ms, updated slots); latency is measured for
+        payloads that carry their capture time.
+        """
+        with self.lock:
+            batch, self.pending = self.pending, []
+        if self.history is not None:
+            self.history.flush_stale()
+        if not batch:
+            return 0, 0, np.empty(0), []
+        topics, payloads, arrivals = zip(*batch)
+        values, ts, ok = decode_batch(payloads)
+        arrivals = np.array(arrivals)
+        stamped = ok & ~np.isnan(ts)
+        latencies = (arrivals[stamped] - ts[stamped]) * 1000.0
+        times = np.where(stamped, ts, arrivals)
+        slots = np.fromiter(map(self.store.slot, topics), dtype=np.int64, count=len(topics))
+        updated = self.store.append(slots[ok], times[ok], values[ok])
+        if self.history is not None:
+            self.history.append_rows(self.store.topics, slots[ok], times[ok], values[ok], FIELDS)
+        return len(batch), int(np.count_nonzero(~ok)), latencies, updated.tolist()
+
+    def preload(self, topic_filter):
+        """Fill the rings with the newest stored rows of every device matching the subscription."""
+        rows = devices = 0
+        for device in self.history.devices():
+            if not mqtt.topic_matches_sub(topic_filter, device) or self.history.fields(device) != FIELDS:
+                continue
+            t, v = self.history.tail(device, self.store.capacity)
+            if len(t):
+                self.store.append(np.full(len(t), self.store.slot(device)), t / 1000.0, v)
+                rows += len(t)
+                devices += 1
+        print(f"Loaded {rows} stored rows of {devices} device(s)")
+
+    def close(self):
+        self.drain()
+        if self.history is not None:
+            self.history.close()
+
+
+def open_history(path):
+    """The persistent store of --store (tools/tsdb/tsdb.py in this repository)."""
+    sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', '..', 'tools', 'tsdb'))
+    from tsdb import TimeSeriesStore
+    return TimeSeriesStore(path)
+
+
+def decimate(t, y, max_points):
+    """Min/max decimation for display: two points per bucket keep spikes visible."""
+    n = len(t)
+    if n <= max_points:
+        return t, y
+    per = -(-n // (max_points // 2))
+    body = (n // per) * per
+    blocks = y[:body].reshape(-1, per)
+    base = np.arange(0, body, per)
+    picks = np.concatenate([base + blocks.argmin(axis=1), base + blocks.argmax(axis=1), np.arange(body, n)])
+    picks.sort()
+    return t[picks], y[picks]
+
+
+def to_datetime64(t):
+    """Epoch seconds -> local-time datetime64 for matplotlib's date axis."""
+    offset = datetime.now().astimezone().utcoffset().total_seconds()
+    return ((t + offset) * 1000.0).astype('datetime64[ms]')
+
+
+def device_label(topic):
+    """'esp32/0ad3/tx' -> '0ad3'."""
+    parts = topic.split('/')
+    return parts[1] if len(parts) == 3 else topic
+
+
 class DHTPlotter:
-    def __init__(self, host, port, topic, bufsize=300, user: str = None, password: str = None):
+    def __init__(self, host, port, topic, bufsize=300, user: str = None, password: str = None,
+                 max_points=1000, max_lines=8, history=None):
         self.host = host
         self.port = port
         self.topic = topic
         self.user = user
         self.password = password
 
-        # Buffers
-        self.times = deque(maxlen=bufsize)
-        self.temps = deque(maxlen=bufsize)
-        self.humids = deque(maxlen=bufsize)
-        self.heatidx = deque(maxlen=bufsize)
-
-        self.lock = threading.Lock()
+        # Buffers: one column ring per device, refilled from the history store if there is one
+        self.ingest = Ingest(bufsize, history)
+        if history is not None:
+            self.ingest.preload(topic)
+        self.max_points = max_points
+        self.max_lines = max_lines
+        self.lines = {}
 
         # MQTT client
         self.client = mqtt.Client()
@@ -65,17 +334,15 @@ class DHTPlotter:
                 break
         self.fig, (self.ax_t, self.ax_h, self.ax_hi) = plt.subplots(3, 1, sharex=True, figsize=(10, 8))
 
-        self.line_t, = self.ax_t.plot([], [], label='Temperature (°C)', color='tab:red')
-        self.line_h, = self.ax_h.plot([], [], label='Humidity (%)', color='tab:blue')
-        self.line_hi, = self.ax_hi.plot([], [], label='Heat Index (°C)', color='tab:orange')
-
+        self.ax_t.set_title('Temperature (°C)')
+        self.ax_h.set_title('Humidity (%)')
+        self.ax_hi.set_title('Heat Index (°C)')
         self.ax_t.set_ylabel('°C')
         self.ax_h.set_ylabel('%')
         self.ax_hi.set_ylabel('°C')
         self.ax_hi.set_xlabel('Time')
 
         for ax in (self.ax_t, self.ax_h, self.ax_hi):
-            ax.legend(loc='upper left')
             ax.grid(True)
 
         # Date formatting on x axis
@@ -92,20 +359,8 @@ class DHTPlotter:
             print(f"Failed to connect to MQTT broker, rc={rc}")
 
     def on_message(self, client, userdata, msg):
-        payload = msg.payload.decode(errors='ignore')
-        parsed = parse_payload(payload)
-        if parsed is None:
-            print(f"Received malformed payload on {msg.topic}: {payload!r}")
-            return
-        t, h, hi = parsed
-        now = datetime.now()
-        with self.lock:
-            self.times.append(now)
-            self.temps.append(t)
-            self.humids.append(h)
-            self.heatidx.append(hi)
-        # Also print a short log
-        print(f"{now.strftime('%H:%M:%S')} - T={t:.2f}°C H={h:.2f}% HI={hi:.2f}°C")
+        # Decoding happens in batches on the plot timer
+        self.ingest.push(msg.topic, msg.payload)
 
     def start_mqtt(self):
         try:
@@ -128,44 +383,58 @@ class DHTPlotter:
         except Exception:
             pass
 
-    def _update_plot(self, frame):
-        with self.lock:
-            if len(self.times) == 0:
-                return self.line_t, self.line_h, self.line_hi
+    def _lines_for(self, slot):
+        """Lines of one device, created on its first data; None past max_lines devices."""
+        if slot not in self.lines:
+            if len(self.lines) >= self.max_lines:
+                return None
+            label = device_label(self.ingest.store.topics[slot])
+            self.lines[slot] = tuple(ax.plot([], [], label=label)[0] for ax in (self.ax_t, self.ax_h, self.ax_hi))
+            for ax in (self.ax_t, self.ax_h, self.ax_hi):
+                ax.legend(loc='upper left')
+        return self.lines[slot]
 
-            xs = list(self.times)
-            ys_t = list(self.temps)
-            ys_h = list(self.humids)
-            ys_hi = list(self.heatidx)
-
-        # Update data
-        self.line_t.set_data(xs, ys_t)
-        self.line_h.set_data(xs, ys_h)
-        self.line_hi.set_data(xs, ys_hi)
-
-        # Adjust x limits
-        self.ax_t.relim()
-        self.ax_h.relim()
-        self.ax_hi.relim()
+    def _update_plot(self, frame):
+        store = self.ingest.store
+        received, malformed, _, updated = self.ingest.drain()
+        if malformed:
+            print(f"Received {malformed} malformed payload(s)")
+
+        artists = []
+        for slot in updated:
+            lines = self._lines_for(slot)
+            if lines is None:
+                continue
+            t, v = store.view(slot)
+            for column, line in enumerate(lines):
+                xs, ys = decimate(t, v[:, column], self.max_points)
+                line.set_data(to_datetime64(xs), ys)
+            artists.extend(lines)
+            # Short log: the newest reading of each plotted device that reported since the last frame
+            stamp = datetime.fromtimestamp(t[-1]).strftime('%H:%M:%S')
+            print(f"{stamp} {device_label(store.topics[slot])} - "
+                  f"T={v[-1, 0]:.2f}°C H={v[-1, 1]:.2f}% HI={v[-1, 2]:.2f}°C")
+        if len(updated) > len(artists) // 3:
+            print(f"{len(updated) - len(artists) // 3} more device(s) reported ({received} messages)")
+        if not self.lines:
+            return artists
 
-        self.ax_t.autoscale_view()
-        self.ax_h.autoscale_view()
-        self.ax_hi.autoscale_view()
+        for ax in (self.ax_t, self.ax_h, self.ax_hi):
+            ax.relim()
+            ax.autoscale_view()
 
-        # Improve x-axis range: show last N seconds based on data
-        try:
-            xmin = xs[0]
-            xmax = xs[-1]
-            self.ax_hi.set_xlim(xmin, xmax)
-        except Exception:
-            pass
+        # x-axis spans the buffered data of all plotted devices
+        spans = np.array([store.span(slot) for slot in self.lines])
+        xmin, xmax = spans[:, 0].min(), spans[:, 1].max()
+        if xmax > xmin:
+            self.ax_hi.set_xlim(to_datetime64(np.array([xmin, xmax])))
 
         # Rotate and redraw date labels
         for label in self.ax_hi.get_xticklabels():
             label.set_rotation(30)
             label.set_ha('right')
 
-        return self.line_t, self.line_h, self.line_hi
+        return artists
 
     def run(self, interval_ms=1000):
         self.start_mqtt()
@@ -179,22 +448,151 @@ class DHTPlotter:
             print('Interrupted by user')
         finally:
             self.stop_mqtt()
+            self.ingest.close()
+
+
+class ThroughputMeter:
+    """Consumer-side benchmark: the plotter's ingest path (queue + batch decode into the rings), no drawing.
+
+    Reports messages/s, decode time per message, malformed payloads, devices seen and, for payloads
+    carrying a capture time (replayed readings, tools/loadgen), the publish-to-consume latency.
+    """
+
+    def __init__(self, host, port, topic, report_s=1.0, bufsize=300, user: str = None, password: str = None,
+                 history=None):
+        self.host = host
+        self.port = port
+        self.topic = topic
+        self.report_s = report_s
+        self.ingest = Ingest(bufsize, history)
+        self.total = 0
+        self.client = mqtt.Client()
+        if user is not None:
+            self.client.username_pw_set(user, password)
+        self.client.on_connect = lambda client, userdata, flags, rc: client.subscribe(self.topic)
+        self.client.on_message = lambda client, userdata, msg: self.ingest.push(msg.topic, msg.payload)
+
+    def run(self):
+        self.client.connect(self.host, self.port, keepalive=60)
+        self.client.loop_start()
+        print(f"Measuring consumer throughput on {self.topic} (Ctrl+C to stop)")
+        start = last = time.monotonic()
+        try:
+            while True:
+                time.sleep(self.report_s)
+                decode_start = time.perf_counter()
+                count, malformed, latencies, _ = self.ingest.drain()
+                decode_us = (time.perf_counter() - decode_start) * 1e6
+                now = time.monotonic()
+                self.total += count
+                rate = count / (now - last)
+                last = now
+                line = (f"{rate:9.0f} msg/s  decode {decode_us / max(count, 1):5.1f} us/msg  "
+                        f"devices {len(self.ingest.store.topics):5d}  malformed {malformed}")
+                if len(latencies):
+                    p50, p99 = np.percentile(latencies, [50, 99])
+                    line += f"  latency ms p50 {p50:.1f} p99 {p99:.1f}"
+                print(line)
+        except KeyboardInterrupt:
+            elapsed = time.monotonic() - start
+            print(f"Total {self.total} messages in {elapsed:.1f} s ({self.total / elapsed:.0f} msg/s)")
+        finally:
+            self.client.loop_stop()
+            self.client.disconnect()
+            self.ingest.close()
+
+
+def benchmark(messages, devices, batch, bufsize):
+    """Offline messages/s of the ingest paths, on synthetic payloads from `devices` devices.
+
+    'per-message' is the previous on_message work (parse, deque appends, a log line per message);
+    the batch rows are Ingest.push() for every message plus drain() every `batch` messages (one
+    plot frame).
+    """
+    from collections import deque
+    rng = np.random.default_rng(1)
+    topics = [f"esp32/{i:04x}/tx" for i in range(devices)]
+    temps = 22.0 + rng.normal(0, 1, messages)
+    hums = 45.0 + rng.normal(0, 3, messages)
+    stamp = int(time.time() * 1000)
+    formats = {
+        'text': [f"{t:.2f}:{h:.2f}:{t + 0.4:.2f}".encode() for t, h in zip(temps, hums)],
+        'text+ts': [f"{t:.2f}:{h:.2f}:{t + 0.4:.2f}:{stamp + i}".encode()
+                    for i, (t, h) in enumerate(zip(temps, hums))],
+        'binary+ts': [np.array([(0xD2, (t, h, t + 0.4), stamp + i)], dtype=BINARY_FORMATS[(0xD2, 21)]).tobytes()
+                      for i, (t, h) in enumerate(zip(temps, hums))],
+    }
+    print(f"{messages} messages from {devices} devices, drain every {batch}, {bufsize} rows per device")
+
+    # Previous on_message: parse, lock, deque appends, one log line per message (to /dev/null here)
+    buffers = {topic: [deque(maxlen=bufsize) for _ in range(4)] for topic in topics}
+    lock = threading.Lock()
+    with open(os.devnull, 'w') as sink:
+        start = time.perf_counter()
+        for i, payload in enumerate(formats['text']):
+            t, h, hi, _ = parse_payload(payload.decode(errors='ignore'))
+            now = datetime.now()
+            times, temps, humids, heatidx = buffers[topics[i % devices]]
+            with lock:
+                times.append(now)
+                temps.append(t)
+                humids.append(h)
+                heatidx.append(hi)
+            print(f"{now.strftime('%H:%M:%S')} - T={t:.2f}°C H={h:.2f}% HI={hi:.2f}°C", file=sink)
+        elapsed = time.perf_counter() - start
+    print(f"  {'per-message (text)':22s} {messages / elapsed:10.0f} msg/s")
+
+    for name, payloads in formats.items():
+        ingest = Ingest(bufsize)
+        start = time.perf_counter()
+        for i, payload in enumerate(payloads):
+            ingest.push(topics[i % devices], payload)
+            if (i + 1) % batch == 0:
+                ingest.drain()
+        ingest.drain()
+        elapsed = time.perf_counter() - start
+        print(f"  {'batch (' + name + ')':22s} {messages / elapsed:10.0f} msg/s")
 
 
 def main():
     parser = argparse.ArgumentParser(description='DHT MQTT real-time plotter')
-    parser.add_argument('--host', required=True, help='MQTT broker hostname')
+    parser.add_argument('--host', help='MQTT broker hostname')
     parser.add_argument('--port', type=int, default=1883, help='MQTT broker port (default: 1883)')
-    parser.add_argument('--topic', required=True, help='MQTT topic to subscribe to')
-    parser.add_argument('--buffer', type=int, default=300, help='Number of points to keep in graph')
+    parser.add_argument('--topic', help='MQTT topic to subscribe to (wildcards allowed, e.g. esp32/+/tx)')
+    parser.add_argument('--buffer', type=int, default=300, help='Number of points to keep per device')
+    parser.add_argument('--max-points', type=int, default=1000, help='Points drawn per line (min/max decimation)')
+    parser.add_argument('--max-lines', type=int, default=8, help='Devices plotted (all are ingested)')
     parser.add_argument('--interval', type=int, default=1000, help='Plot update interval in milliseconds')
     parser.add_argument('--user', help='MQTT username (optional)')
     parser.add_argument('--password', help='MQTT password (optional)')
+    parser.add_argument('--throughput', action='store_true',
+                        help='Benchmark mode: count and parse messages without plotting (e.g. with tools/loadgen)')
+    parser.add_argument('--store', metavar='DIR',
+                        help='Persist every reading in a history store (tools/tsdb) and reload it on start')
+    parser.add_argument('--report', type=float, default=1.0, help='Throughput report period in seconds')
+    parser.add_argument('--bench', type=int, metavar='MESSAGES',
+                        help='Offline ingest benchmark on synthetic payloads (no broker needed)')
+    parser.add_argument('--bench-devices', type=int, default=100, help='Devices simulated by --bench')
+    parser.add_argument('--bench-batch', type=int, default=5000, help='Messages per drain in --bench')
 
     args = parser.parse_args()
 
+    if args.bench:
+        benchmark(args.bench, args.bench_devices, args.bench_batch, args.buffer)
+        return
+    if args.host is None or args.topic is None:
+        parser.error('--host and --topic are required')
+
+    history = open_history(args.store) if args.store else None
+
+    if args.throughput:
+        ThroughputMeter(args.host, args.port, args.topic, report_s=args.report, bufsize=args.buffer,
+                        user=args.user, password=args.password, history=history).run()
+        return
+
     plotter = DHTPlotter(args.host, args.port, args.topic, bufsize=args.buffer,
-                         user=args.user, password=args.password)
+                         user=args.user, password=args.password,
+                         max_points=args.max_points, max_lines=args.max_lines, history=history)
     try:
         plotter.run(interval_ms=args.interval)
     except Exception as e:
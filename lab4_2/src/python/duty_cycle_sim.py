@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""
+duty_cycle_sim.py
+
+Host simulation of the firmware's duty-cycled mode (duty_cycle.hpp, build flag DUTY_CYCLE=1):
+wake from deep sleep, read the DHT22, append to the RTC batch, and bring Wi-Fi/MQTT up every
+N wakes to publish the batch. It follows the same rules as the firmware:
+- the first (cold boot) wake always opens a radio session
+- a full batch opens a session even before N wakes, and drops its oldest reading if that fails
+- a failed session keeps the batch for the next one
+
+It reports the same energy proxies the device publishes, plus an average current and battery
+life estimate from a simple per-state current model. The always-on mode (Wi-Fi and MQTT
+permanently up) is shown for comparison.
+
+Usage:
+    python duty_cycle_sim.py --period 60 --publish-every 10 --hours 24
+    python duty_cycle_sim.py --sweep 1 2 5 10 20 40
+
+No third-party dependencies.
+"""
+
+import argparse
+import random
+
+
+def simulate(period_s, publish_every, hours, capacity=48, awake_ms=40.0, session_ms=2500.0,
+             per_message_ms=15.0, failure_rate=0.0, seed=1):
+    """Run the wake/batch/publish cycle; returns a dict of counters and time totals (ms)."""
+    rng = random.Random(seed)
+    wakes = int(hours * 3600 / period_s)
+    batch = 0
+    stats = dict(wakes=0, published=0, dropped=0, sessions=0, failed=0,
+                 awake_ms=0.0, radio_ms=0.0, max_latency_s=0.0)
+    oldest_wake = None  # Wake index of the oldest unpublished reading
+
+    for wake in range(wakes):
+        stats['wakes'] += 1
+        awake = awake_ms
+        if batch == capacity:
+            stats['dropped'] += 1
+            batch -= 1
+            oldest_wake += 1
+        batch += 1
+        if oldest_wake is None:
+            oldest_wake = wake
+
+        if wake == 0 or batch >= publish_every or batch == capacity:
+            radio = session_ms + per_message_ms * batch
+            stats['sessions'] += 1
+            stats['radio_ms'] += radio
+            awake += radio
+            if rng.random() < failure_rate:
+                stats['failed'] += 1
+            else:
+                stats['published'] += batch
+                latency = (wake - oldest_wake) * period_s
+                stats['max_latency_s'] = max(stats['max_latency_s'], latency)
+                batch = 0
+                oldest_wake = None
+        stats['awake_ms'] += awake
+
+    stats['sleep_ms'] = wakes * period_s * 1000.0 - stats['awake_ms']
+    return stats
+
+
+def average_current_ma(stats, total_ms, cpu_ma, radio_ma, sleep_ua):
+    """Charge-weighted average current over the simulated time."""
+    cpu_only_ms = stats['awake_ms'] - stats['radio_ms']
+    charge = cpu_only_ms * cpu_ma + stats['radio_ms'] * radio_ma + stats['sleep_ms'] * sleep_ua / 1000.0
+    return charge / total_ms
+
+
+def report(args, publish_every):
+    stats = simulate(args.period, publish_every, args.hours, capacity=args.capacity,
+                     awake_ms=args.awake_ms, session_ms=args.session_ms,
+                     per_message_ms=args.per_message_ms, failure_rate=args.failure_rate, seed=args.seed)
+    total_ms = args.hours * 3600 * 1000.0
+    avg_ma = average_current_ma(stats, total_ms, args.cpu_ma, args.radio_ma, args.sleep_ua)
+    wakes = max(stats['wakes'], 1)
+    print(f"publish every {publish_every:3d} wakes: "
+          f"awake {stats['awake_ms'] / wakes:7.1f} ms/sample, "
+          f"radio {stats['radio_ms'] / wakes:7.1f} ms/sample, "
+          f"sessions {stats['sessions']:5d} (failed {stats['failed']}), "
+          f"dropped {stats['dropped']}, "
+          f"max latency {stats['max_latency_s']:6.0f} s, "
+          f"avg {avg_ma:6.3f} mA, "
+          f"battery {args.battery_mah / avg_ma / 24:7.1f} days")
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Duty-cycled DHT node simulation (energy proxies)')
+    parser.add_argument('--period', type=float, default=60, help='Wake period in seconds (default: 60)')
+    parser.add_argument('--publish-every', type=int, default=10, help='Wakes per radio session (default: 10)')
+    parser.add_argument('--sweep', type=int, nargs='+', help='Compare several publish-every values')
+    parser.add_argument('--hours', type=float, default=24, help='Simulated time in hours (default: 24)')
+    parser.add_argument('--capacity', type=int, default=48, help='RTC batch capacity (default: 48)')
+    parser.add_argument('--awake-ms', type=float, default=40.0, help='Boot + DHT read time per wake')
+    parser.add_argument('--session-ms', type=float, default=2500.0, help='Wi-Fi + MQTT connect time per session')
+    parser.add_argument('--per-message-ms', type=float, default=15.0, help='Publish + PUBACK time per reading')
+    parser.add_argument('--failure-rate', type=float, default=0.0, help='Probability that a session fails')
+    parser.add_argument('--cpu-ma', type=float, default=40.0, help='Current while awake, radio off (mA)')
+    parser.add_argument('--radio-ma', type=float, default=120.0, help='Current with Wi-Fi on (mA)')
+    parser.add_argument('--sleep-ua', type=float, default=10.0, help='Deep sleep current (uA)')
+    parser.add_argument('--battery-mah', type=float, default=2500.0, help='Battery capacity (mAh)')
+    parser.add_argument('--seed', type=int, default=1, help='Random seed for session failures')
+    args = parser.parse_args()
+
+    for publish_every in (args.sweep or [args.publish_every]):
+        report(args, publish_every)
+
+    always_on_ma = args.radio_ma
+    print(f"always-on (Wi-Fi and MQTT up):  avg {always_on_ma:6.3f} mA, "
+          f"battery {args.battery_mah / always_on_ma / 24:7.1f} days")
+
+
+if __name__ == '__main__':
+    main()
\ No newline at end of file
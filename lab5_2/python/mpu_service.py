@@ -2,56 +2,368 @@
 """
 mpu_service.py
 
-Subscribe to an MQTT topic and plot real-time graphs for MPU accelerometer data.
-Expected payload format: JSON string like: {"ax": -10.00, "ay": 3.90, "az": -9.50}
+Subscribe to an MQTT topic and plot real-time graphs for the MPU orientation estimate.
+The device fuses accelerometer and gyroscope data on board (Madgwick filter) and publishes
+the orientation quaternion.
+Expected payload format: JSON string like: {"qw": 0.9990, "qx": 0.0120, "qy": -0.0400, "qz": 0.0010}
+Samples replayed from the device spool after an outage add "ts" (capture time, ms since epoch).
+The tagged binary form (lib/telemetry/src/payload.hpp, tools/loadgen --binary) is accepted too.
+
+Messages are only queued by the MQTT thread; the plot timer decodes them in batches
+(numpy) into a preallocated column ring per device. With a wildcard topic every
+device gets its own roll/pitch/yaw lines; the 3D view follows the first device.
 
 Usage:
     python mpu_service.py --host test.mosquitto.org --port 1883 --topic esp32/0ad3/tx
+    python mpu_service.py --host 127.0.0.1 --topic 'esp32/+/tx' --buffer 20000
+    python mpu_service.py --host 127.0.0.1 --topic 'esp32/+/tx' --store ~/sensor-history   # persistent history (tools/tsdb)
+
+Consumer benchmark (no plotting), e.g. against tools/loadgen:
+    python mpu_service.py --host 127.0.0.1 --topic 'esp32/+/tx' --throughput
 
-The script uses paho-mqtt for MQTT and matplotlib for plotting.
+Offline decode benchmark (no broker):
+    python mpu_service.py --bench 200000 --bench-devices 500
+
+The script uses paho-mqtt for MQTT, numpy for ingestion and matplotlib for plotting.
 """
 
 import argparse
+import os
+import sys
 import threading
-from collections import deque
+import time
+import warnings
 from datetime import datetime
 import json
 import math
 
+import numpy as np
 import matplotlib.pyplot as plt
 import matplotlib.dates as mdates
 from matplotlib.animation import FuncAnimation
 import paho.mqtt.client as mqtt
 from mpl_toolkits.mplot3d import Axes3D  # noqa: F401 (needed for 3D projection)
 
+# Binary payloads: tag byte, little-endian float32 fields, optional uint64 capture time
+BINARY_FORMATS = {
+    (0xD3, 17): np.dtype([('tag', 'u1'), ('q', '<f4', 4)]),
+    (0xD4, 25): np.dtype([('tag', 'u1'), ('q', '<f4', 4), ('ts', '<u8')]),
+}
+
+# JSON fast path: the firmware's key layout, seen through its non-numeric characters
+JSON_NUMERIC = b'0123456789.-+eE:, '
+JSON_LAYOUTS = {b'{"qw""qx""qy""qz"}': 4, b'{"qw""qx""qy""qz""ts"}': 5}
+JSON_SYNTAX = b'{}"qwxyzts: '
+
+# Ring columns
+COLUMNS = ('qw', 'qx', 'qy', 'qz', 'roll', 'pitch', 'yaw')
+
 
 def parse_payload_json(payload: str):
-    """Parse JSON payload with keys ax, ay, az -> return tuple(ax, ay, az) or None."""
+    """Parse JSON payload with keys qw, qx, qy, qz and optional ts -> return tuple(quat, time) or None.
+    quat is normalized (w, x, y, z); time is the capture datetime for replayed samples, None for live ones.
+    """
     try:
         obj = json.loads(payload)
-        ax = float(obj.get("ax"))
-        ay = float(obj.get("ay"))
-        az = float(obj.get("az"))
-        return ax, ay, az
+        q = tuple(float(obj[k]) for k in ("qw", "qx", "qy", "qz"))
+        norm = math.sqrt(sum(c * c for c in q))
+        if norm == 0.0:
+            return None
+        q = tuple(c / norm for c in q)
+        ts = datetime.fromtimestamp(int(obj["ts"]) / 1000.0) if "ts" in obj else None
+        return q, ts
     except Exception:
         return None
 
 
+def quat_to_euler_deg(q):
+    """Quaternion (w, x, y, z) -> (roll, pitch, yaw) in degrees, Z-Y-X order (same as the firmware)."""
+    w, x, y, z = q
+    roll = math.atan2(2.0 * (w * x + y * z), 1.0 - 2.0 * (x * x + y * y))
+    pitch = math.asin(max(-1.0, min(1.0, 2.0 * (w * y - z * x))))
+    yaw = math.atan2(2.0 * (w * z + x * y), 1.0 - 2.0 * (y * y + z * z))
+    return math.degrees(roll), math.degrees(pitch), math.degrees(yaw)
+
+
+def quat_to_axes(q):
+    """Columns of the rotation matrix: the device X, Y, Z axes expressed in the world frame."""
+    w, x, y, z = q
+    return (
+        (1 - 2 * (y * y + z * z), 2 * (x * y + w * z), 2 * (x * z - w * y)),
+        (2 * (x * y - w * z), 1 - 2 * (x * x + z * z), 2 * (y * z + w * x)),
+        (2 * (x * z + w * y), 2 * (y * z - w * x), 1 - 2 * (x * x + y * y)),
+    )
+
+
+def decode_batch(payloads):
+    """Decode a list of raw payloads at once.
+
+    Returns (values, ts, ok): values is float32 (n, 7) with the normalized quaternion and
+    roll/pitch/yaw in degrees (COLUMNS), ts the capture time in epoch seconds (NaN for live
+    samples), ok marks the payloads that decoded.
+    Binary payloads are classified by tag and size; JSON in the firmware's key layout is
+    reduced to its numbers and converted by one numpy call per layout. Anything else goes
+    through parse_payload_json().
+    """
+    n = len(payloads)
+    quats = np.full((n, 4), np.nan)
+    ts = np.full(n, np.nan)
+    ok = np.zeros(n, dtype=bool)
+
+    lengths = np.fromiter(map(len, payloads), dtype=np.int64, count=n)
+    joined = b'\n'.join(payloads)
+    buf = np.frombuffer(joined, dtype=np.uint8)
+    starts = np.cumsum(lengths + 1) - lengths - 1
+    first = np.zeros(n, dtype=np.int64)
+    nonempty = lengths > 0
+    first[nonempty] = buf[starts[nonempty]]
+    # Binary: key tag * 256 + size; JSON: key -(field count), -1 for the slow path
+    binary = first >= 0x80
+    kinds = np.where(binary, first * 256 + lengths, -1)
+    text = np.flatnonzero(~binary)
+    if len(text):
+        blob = joined if len(text) == n else b'\n'.join([payloads[i] for i in text])
+        layouts = blob.translate(None, JSON_NUMERIC).split(b'\n')
+        if len(layouts) != len(text):  # Newlines inside payloads
+            layouts = [payloads[i].translate(None, JSON_NUMERIC) for i in text]
+        kinds[text] = [-JSON_LAYOUTS.get(layout, 1) for layout in layouts]
+
+    keys = np.unique(kinds)
+    for key in keys:
+        idx = np.flatnonzero(kinds == key)
+        group = payloads if len(keys) == 1 else [payloads[i] for i in idx]
+        if key > 0:
+            dtype = BINARY_FORMATS.get((key >> 8, key & 0xFF))
+            if dtype is None:
+                continue
+            rows = np.frombuffer(b''.join(group), dtype=dtype)
+            quats[idx] = rows['q']
+            if 'ts' in dtype.names:
+                ts[idx] = rows['ts'] / 1000.0
+            ok[idx] = True
+            continue
+        if key < -1:
+            numbers = b','.join(group).translate(None, JSON_SYNTAX)
+            with warnings.catch_warnings():
+                warnings.simplefilter('ignore', DeprecationWarning)
+                fields = np.fromstring(numbers, sep=',')
+            if len(fields) == len(group) * -key:
+                fields = fields.reshape(-1, -key)
+                quats[idx] = fields[:, :4]
+                if key == -5:
+                    ts[idx] = fields[:, 4] / 1000.0
+                ok[idx] = True
+                continue
+        for i in idx:
+            parsed = parse_payload_json(payloads[i].decode(errors='ignore'))
+            if parsed is not None:
+                quats[i] = parsed[0]
+                ts[i] = parsed[1].timestamp() if parsed[1] is not None else np.nan
+                ok[i] = True
+
+    norm = np.linalg.norm(quats, axis=1)
+    ok &= norm > 0
+    quats[ok] /= norm[ok, None]
+    w, x, y, z = quats.T
+    values = np.empty((n, len(COLUMNS)), dtype=np.float32)
+    values[:, :4] = quats
+    # Same as quat_to_euler_deg(), for the whole batch
+    values[:, 4] = np.degrees(np.arctan2(2.0 * (w * x + y * z), 1.0 - 2.0 * (x * x + y * y)))
+    values[:, 5] = np.degrees(np.arcsin(np.clip(2.0 * (w * y - z * x), -1.0, 1.0)))
+    values[:, 6] = np.degrees(np.arctan2(2.0 * (w * z + x * y), 1.0 - 2.0 * (y * y + z * z)))
+    return values, ts, ok
+
+
+class RingStore:
+    """Preallocated per-device ring buffers, column by column: times[device, row] (epoch s) and
+    values[device, row, column] (float32).
+
+    append() writes a whole decoded batch, for all devices at once, with one fancy-index store.
+    Each ring keeps the most recently received rows; view() returns them in capture-time order,
+    so readings replayed from the spool land where they belong.
+    """
+
+    def __init__(self, capacity, columns, devices=16):
+        self.capacity = capacity
+        self.columns = columns
+        self.slots = {}
+        self.topics = []
+        self._allocate(devices)
+
+    def _allocate(self, devices):
+        """(Re)allocates the columns for `devices` rings, keeping the existing ones."""
+        times = np.zeros((devices, self.capacity), dtype=np.float64)
+        values = np.zeros((devices, self.capacity, self.columns), dtype=np.float32)
+        head, count, ordered = np.zeros(devices, np.int64), np.zeros(devices, np.int64), np.ones(devices, bool)
+        if hasattr(self, 'times'):
+            used = len(self.head)
+            times[:used], values[:used] = self.times, self.values
+            head[:used], count[:used], ordered[:used] = self.head, self.count, self.ordered
+        self.times, self.values = times, values
+        self.head, self.count, self.ordered = head, count, ordered
+
+    def slot(self, topic):
+        slot = self.slots.get(topic)
+        if slot is None:
+            slot = self.slots[topic] = len(self.topics)
+            self.topics.append(topic)
+            if slot == len(self.head):
+                self._allocate(2 * slot)
+        return slot
+
+    def append(self, slots, times, values):
+        """Store rows; slots, times and values are parallel arrays. Returns the updated slots."""
+        order = np.argsort(slots, kind='stable')
+        slots, times, values = slots[order], times[order], values[order]
+        counts = np.bincount(slots, minlength=len(self.head))
+        starts = np.cumsum(counts) - counts
+        rank = np.arange(len(slots)) - starts[slots]
+        # Only the last `capacity` rows of a device survive the batch
+        keep = rank >= counts[slots] - self.capacity
+        slots, times, values, rank = slots[keep], times[keep], values[keep], rank[keep]
+
+        # Rows older than their predecessor (spool replay) mark the ring for sorting in view()
+        previous = np.where(rank == 0, self.times[slots, (self.head[slots] - 1) % self.capacity],
+                            np.roll(times, 1))
+        late = times < previous
+        late &= (rank > 0) | (self.count[slots] > 0)
+        self.ordered[slots[late]] = False
+
+        rows = (self.head[slots] + rank) % self.capacity
+        self.times[slots, rows] = times
+        self.values[slots, rows] = values
+        updated = np.flatnonzero(counts)
+        self.head[updated] = (self.head[updated] + counts[updated]) % self.capacity
+        self.count[updated] = np.minimum(self.count[updated] + counts[updated], self.capacity)
+        return updated
+
+    def view(self, slot):
+        """Chronological copies (times, values) of one device's rows."""
+        idx = (self.head[slot] - self.count[slot] + np.arange(self.count[slot])) % self.capacity
+        t, v = self.times[slot, idx], self.values[slot, idx]
+        if not self.ordered[slot]:
+            order = np.argsort(t, kind='stable')
+            t, v = t[order], v[order]
+            # Store back sorted, so the next view is a plain copy
+            self.times[slot, idx], self.values[slot, idx] = t, v
+            self.ordered[slot] = True
+        return t, v
+
+    def span(self, slot):
+        """(oldest, newest) time of an ordered ring."""
+        return (self.times[slot, (self.head[slot] - self.count[slot]) % self.capacity],
+                self.times[slot, (self.head[slot] - 1) % self.capacity])
+
+
+class Ingest:
+    """Queue filled by the MQTT thread, decoded in batches into the ring store by drain().
+
+    With a history store (--store) every decoded row is also appended there, and preload()
+    refills the rings from it after a restart.
+    """
+
+    def __init__(self, capacity, history=None):
+        self.lock = threading.Lock()
+        self.pending = []
+        self.history = history
+        self.store = RingStore(capacity, len(COLUMNS))
+
+    def push(self, topic, payload):
+        with self.lock:
+            self.pending.append((topic, payload, time.time()))
+
+    def drain(self):
+        """Decode everything queued so far.
+
+        Returns (received, malformed, latencies_ms, updated slots); latency is measured for
+        payloads that carry their capture time.
+        """
+        with self.lock:
+            batch, self.pending = self.pending, []
+        if self.history is not None:
+            self.history.flush_stale()
+        if not batch:
+            return 0, 0, np.empty(0), []
+        topics, payloads, arrivals = zip(*batch)
+        values, ts, ok = decode_batch(payloads)
+        arrivals = np.array(arrivals)
+        stamped = ok & ~np.isnan(ts)
+        latencies = (arrivals[stamped] - ts[stamped]) * 1000.0
+        times = np.where(stamped, ts, arrivals)
+        slots = np.fromiter(map(self.store.slot, topics), dtype=np.int64, count=len(topics))
+        updated = self.store.append(slots[ok], times[ok], values[ok])
+        if self.history is not None:
+            self.history.append_rows(self.store.topics, slots[ok], times[ok], values[ok], COLUMNS)
+        return len(batch), int(np.count_nonzero(~ok)), latencies, updated.tolist()
+
+    def preload(self, topic_filter):
+        """Fill the rings with the newest stored rows of every device matching the subscription."""
+        rows = devices = 0
+        for device in self.history.devices():
+            if not mqtt.topic_matches_sub(topic_filter, device) or self.history.fields(device) != COLUMNS:
+                continue
+            t, v = self.history.tail(device, self.store.capacity)
+            if len(t):
+                self.store.append(np.full(len(t), self.store.slot(device)), t / 1000.0, v)
+                rows += len(t)
+                devices += 1
+        print(f"Loaded {rows} stored rows of {devices} device(s)")
+
+    def close(self):
+        self.drain()
+        if self.history is not None:
+            self.history.close()
+
+
+def open_history(path):
+    """The persistent store of --store (tools/tsdb/tsdb.py in this repository)."""
+    sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', 'tools', 'tsdb'))
+    from tsdb import TimeSeriesStore
+    return TimeSeriesStore(path)
+
+
+def decimate(t, y, max_points):
+    """Min/max decimation for display: two points per bucket keep spikes visible."""
+    n = len(t)
+    if n <= max_points:
+        return t, y
+    per = -(-n // (max_points // 2))
+    body = (n // per) * per
+    blocks = y[:body].reshape(-1, per)
+    base = np.arange(0, body, per)
+    picks = np.concatenate([base + blocks.argmin(axis=1), base + blocks.argmax(axis=1), np.arange(body, n)])
+    picks.sort()
+    return t[picks], y[picks]
+
+
+def to_datetime64(t):
+    """Epoch seconds -> local-time datetime64 for matplotlib's date axis."""
+    offset = datetime.now().astimezone().utcoffset().total_seconds()
+    return ((t + offset) * 1000.0).astype('datetime64[ms]')
+
+
+def device_label(topic):
+    """'esp32/0ad3/tx' -> '0ad3'."""
+    parts = topic.split('/')
+    return parts[1] if len(parts) == 3 else topic
+
+
 class MPUPlotter:
-    def __init__(self, host, port, topic, bufsize=500, user: str = None, password: str = None):
+    def __init__(self, host, port, topic, bufsize=500, user: str = None, password: str = None,
+                 max_points=1000, max_lines=8, history=None):
         self.host = host
         self.port = port
         self.topic = topic
         self.user = user
         self.password = password
 
-        # Buffers
-        self.times = deque(maxlen=bufsize)
-        self.axs = deque(maxlen=bufsize)
-        self.ays = deque(maxlen=bufsize)
-        self.azs = deque(maxlen=bufsize)
-
-        self.lock = threading.Lock()
+        # Buffers: one column ring per device, refilled from the history store if there is one
+        self.ingest = Ingest(bufsize, history)
+        if history is not None:
+            self.ingest.preload(topic)
+        self.max_points = max_points
+        self.max_lines = max_lines
+        self.lines = {}
 
         # MQTT client
         self.client = mqtt.Client()
@@ -65,39 +377,44 @@ class MPUPlotter:
                 plt.style.use(s)
                 break
 
-        # 2x2 grid: 3D trajectory top-left (large), three time-series on right or below
+        # 2x2 grid: 3D device orientation top-left, roll/pitch/yaw time-series in the other cells
         self.fig = plt.figure(figsize=(12, 8))
-        # 3D trajectory
+        # 3D orientation: device axes rotated into the world frame
         self.ax3d = self.fig.add_subplot(2, 2, 1, projection='3d')
-        self.ax3d.set_title('3D Acceleration Trajectory (ax, ay, az)')
-        self.line3d, = self.ax3d.plot([], [], [], lw=1, marker='o', markersize=2, alpha=0.7)
-
-        # Time series for ax, ay, az
-        self.ax_ax = self.fig.add_subplot(2, 2, 2)
-        self.ax_ay = self.fig.add_subplot(2, 2, 3, sharex=self.ax_ax)
-        self.ax_az = self.fig.add_subplot(2, 2, 4, sharex=self.ax_ax)
-
-        self.line_ax, = self.ax_ax.plot([], [], label='ax (m/s²)', color='tab:red')
-        self.line_ay, = self.ax_ay.plot([], [], label='ay (m/s²)', color='tab:blue')
-        self.line_az, = self.ax_az.plot([], [], label='az (m/s²)', color='tab:orange')
-
-        self.ax_ax.set_ylabel('ax')
-        self.ax_ay.set_ylabel('ay')
-        self.ax_az.set_ylabel('az')
-        self.ax_az.set_xlabel('Time')
-
-        for ax in (self.ax_ax, self.ax_ay, self.ax_az):
-            ax.legend(loc='upper left')
+        self.ax3d.set_title('Device orientation')
+        self.axis_lines = [
+            self.ax3d.plot([0, 1], [0, 0], [0, 0], lw=3, color=color, label=name)[0]
+            for name, color in (('X', 'tab:red'), ('Y', 'tab:green'), ('Z', 'tab:blue'))
+        ]
+        self.ax3d.set_xlim(-1, 1)
+        self.ax3d.set_ylim(-1, 1)
+        self.ax3d.set_zlim(-1, 1)
+        self.ax3d.legend(loc='upper left')
+
+        # Time series for roll, pitch, yaw
+        self.ax_roll = self.fig.add_subplot(2, 2, 2)
+        self.ax_pitch = self.fig.add_subplot(2, 2, 3, sharex=self.ax_roll)
+        self.ax_yaw = self.fig.add_subplot(2, 2, 4, sharex=self.ax_roll)
+
+        self.ax_roll.set_title('roll (°)')
+        self.ax_pitch.set_title('pitch (°)')
+        self.ax_yaw.set_title('yaw (°, drifts without magnetometer)')
+        self.ax_roll.set_ylabel('roll')
+        self.ax_pitch.set_ylabel('pitch')
+        self.ax_yaw.set_ylabel('yaw')
+        self.ax_yaw.set_xlabel('Time')
+
+        for ax in (self.ax_roll, self.ax_pitch, self.ax_yaw):
             ax.grid(True)
 
         # Date formatting on x axis
         self.xfmt = mdates.DateFormatter('%H:%M:%S')
-        self.ax_az.xaxis.set_major_formatter(self.xfmt)
+        self.ax_yaw.xaxis.set_major_formatter(self.xfmt)
 
-        # 3D axis labels
-        self.ax3d.set_xlabel('ax')
-        self.ax3d.set_ylabel('ay')
-        self.ax3d.set_zlabel('az')
+        # 3D axis labels (world frame)
+        self.ax3d.set_xlabel('x')
+        self.ax3d.set_ylabel('y')
+        self.ax3d.set_zlabel('z')
 
     # MQTT callbacks
     def on_connect(self, client, userdata, flags, rc):
@@ -109,20 +426,8 @@ class MPUPlotter:
             print(f"Failed to connect to MQTT broker, rc={rc}")
 
     def on_message(self, client, userdata, msg):
-        payload = msg.payload.decode(errors='ignore')
-        parsed = parse_payload_json(payload)
-        if parsed is None:
-            print(f"Received malformed payload on {msg.topic}: {payload!r}")
-            return
-        axv, ayv, azv = parsed
-        now = datetime.now()
-        with self.lock:
-            self.times.append(now)
-            self.axs.append(axv)
-            self.ays.append(ayv)
-            self.azs.append(azv)
-        # concise log
-        print(f"{now.strftime('%H:%M:%S')} - ax={axv:.2f} ay={ayv:.2f} az={azv:.2f}")
+        # Decoding happens in batches on the plot timer
+        self.ingest.push(msg.topic, msg.payload)
 
     def start_mqtt(self):
         try:
@@ -141,77 +446,71 @@ class MPUPlotter:
         except Exception:
             pass
 
+    def _lines_for(self, slot):
+        """Lines of one device, created on its first data; None past max_lines devices."""
+        if slot not in self.lines:
+            if len(self.lines) >= self.max_lines:
+                return None
+            label = device_label(self.ingest.store.topics[slot])
+            self.lines[slot] = tuple(ax.plot([], [], label=label)[0]
+                                     for ax in (self.ax_roll, self.ax_pitch, self.ax_yaw))
+            for ax in (self.ax_roll, self.ax_pitch, self.ax_yaw):
+                ax.legend(loc='upper left')
+            if len(self.lines) == 1:
+                self.ax3d.set_title(f'Device orientation ({label})')
+        return self.lines[slot]
+
     def _update_plot(self, frame):
-        with self.lock:
-            if len(self.times) == 0:
-                return (self.line3d, self.line_ax, self.line_ay, self.line_az)
-            xs_time = list(self.times)
-            ys_ax = list(self.axs)
-            ys_ay = list(self.ays)
-            ys_az = list(self.azs)
-
-        # Update time-series
-        self.line_ax.set_data(xs_time, ys_ax)
-        self.line_ay.set_data(xs_time, ys_ay)
-        self.line_az.set_data(xs_time, ys_az)
+        store = self.ingest.store
+        received, malformed, _, updated = self.ingest.drain()
+        if malformed:
+            print(f"Received {malformed} malformed payload(s)")
+
+        artists = list(self.axis_lines)
+        plotted = 0
+        for slot in updated:
+            lines = self._lines_for(slot)
+            if lines is None:
+                continue
+            plotted += 1
+            t, v = store.view(slot)
+            for column, line in zip((4, 5, 6), lines):
+                xs, ys = decimate(t, v[:, column], self.max_points)
+                line.set_data(to_datetime64(xs), ys)
+            artists.extend(lines)
+            # Concise log: the newest sample of each plotted device that reported since the last frame
+            stamp = datetime.fromtimestamp(t[-1]).strftime('%H:%M:%S')
+            print(f"{stamp} {device_label(store.topics[slot])} - "
+                  f"roll={v[-1, 4]:.1f} pitch={v[-1, 5]:.1f} yaw={v[-1, 6]:.1f}")
+        if len(updated) > plotted:
+            print(f"{len(updated) - plotted} more device(s) reported ({received} messages)")
+        if not self.lines:
+            return artists
 
         # Autoscale time-series axes
-        for ax in (self.ax_ax, self.ax_ay, self.ax_az):
+        for ax in (self.ax_roll, self.ax_pitch, self.ax_yaw):
             ax.relim()
             ax.autoscale_view()
 
-        # Set x-axis limits to show latest interval (if enough points)
-        try:
-            xmin = xs_time[0]
-            xmax = xs_time[-1]
-            self.ax_az.set_xlim(xmin, xmax)
-        except Exception:
-            pass
-
-        # 3D trajectory: use ax, ay, az as X,Y,Z
-        # For better visual stability, downsample if too many points
-        max_points_3d = 1000
-        if len(ys_ax) > max_points_3d:
-            step = max(1, len(ys_ax) // max_points_3d)
-            xs3 = ys_ax[::step]
-            ys3 = ys_ay[::step]
-            zs3 = ys_az[::step]
-        else:
-            xs3 = ys_ax
-            ys3 = ys_ay
-            zs3 = ys_az
-
-        # Update 3D line
-        self.line3d.set_data(xs3, ys3)
-        self.line3d.set_3d_properties(zs3)
+        # x-axis spans the buffered data of all plotted devices
+        spans = np.array([store.span(slot) for slot in self.lines])
+        xmin, xmax = spans[:, 0].min(), spans[:, 1].max()
+        if xmax > xmin:
+            self.ax_yaw.set_xlim(to_datetime64(np.array([xmin, xmax])))
 
-        # Adjust 3D axes limits with a small margin
-        try:
-            def _range_with_margin(data):
-                if not data:
-                    return (-1, 1)
-                mn = min(data)
-                mx = max(data)
-                if math.isclose(mn, mx):
-                    return (mn - 0.5, mx + 0.5)
-                margin = (mx - mn) * 0.1
-                return (mn - margin, mx + margin)
-
-            xlim = _range_with_margin(xs3)
-            ylim = _range_with_margin(ys3)
-            zlim = _range_with_margin(zs3)
-            self.ax3d.set_xlim(*xlim)
-            self.ax3d.set_ylim(*ylim)
-            self.ax3d.set_zlim(*zlim)
-        except Exception:
-            pass
+        # 3D: draw the device axes for the latest orientation of the first device
+        first = next(iter(self.lines))
+        _, v = store.view(first)
+        for line, axis in zip(self.axis_lines, quat_to_axes(v[-1, :4])):
+            line.set_data([0, axis[0]], [0, axis[1]])
+            line.set_3d_properties([0, axis[2]])
 
         # Rotate x-tick labels for readability
-        for label in self.ax_az.get_xticklabels():
+        for label in self.ax_yaw.get_xticklabels():
             label.set_rotation(30)
             label.set_ha('right')
 
-        return (self.line3d, self.line_ax, self.line_ay, self.line_az)
+        return artists
 
     def run(self, interval_ms=1000):
         self.start_mqtt()
@@ -224,22 +523,153 @@ class MPUPlotter:
             print('Interrupted by user')
         finally:
             self.stop_mqtt()
+            self.ingest.close()
+
+
+class ThroughputMeter:
+    """Consumer-side benchmark: the plotter's ingest path (queue + batch decode into the rings), no drawing.
+
+    Reports messages/s, decode time per message, malformed payloads, devices seen and, for payloads
+    carrying a capture time (replayed readings, tools/loadgen), the publish-to-consume latency.
+    """
+
+    def __init__(self, host, port, topic, report_s=1.0, bufsize=300, user: str = None, password: str = None,
+                 history=None):
+        self.host = host
+        self.port = port
+        self.topic = topic
+        self.report_s = report_s
+        self.ingest = Ingest(bufsize, history)
+        self.total = 0
+        self.client = mqtt.Client()
+        if user is not None:
+            self.client.username_pw_set(user, password)
+        self.client.on_connect = lambda client, userdata, flags, rc: client.subscribe(self.topic)
+        self.client.on_message = lambda client, userdata, msg: self.ingest.push(msg.topic, msg.payload)
+
+    def run(self):
+        self.client.connect(self.host, self.port, keepalive=60)
+        self.client.loop_start()
+        print(f"Measuring consumer throughput on {self.topic} (Ctrl+C to stop)")
+        start = last = time.monotonic()
+        try:
+            while True:
+                time.sleep(self.report_s)
+                decode_start = time.perf_counter()
+                count, malformed, latencies, _ = self.ingest.drain()
+                decode_us = (time.perf_counter() - decode_start) * 1e6
+                now = time.monotonic()
+                self.total += count
+                rate = count / (now - last)
+                last = now
+                line = (f"{rate:9.0f} msg/s  decode {decode_us / max(count, 1):5.1f} us/msg  "
+                        f"devices {len(self.ingest.store.topics):5d}  malformed {malformed}")
+                if len(latencies):
+                    p50, p99 = np.percentile(latencies, [50, 99])
+                    line += f"  latency ms p50 {p50:.1f} p99 {p99:.1f}"
+                print(line)
+        except KeyboardInterrupt:
+            elapsed = time.monotonic() - start
+            print(f"Total {self.total} messages in {elapsed:.1f} s ({self.total / elapsed:.0f} msg/s)")
+        finally:
+            self.client.loop_stop()
+            self.client.disconnect()
+            self.ingest.close()
+
+
+def benchmark(messages, devices, batch, bufsize):
+    """Offline messages/s of the ingest paths, on synthetic payloads from `devices` devices.
+
+    'per-message' is the previous on_message work (JSON parse, Euler angles, deque appends, a log
+    line per message); the batch rows are Ingest.push() for every message plus drain() every
+    `batch` messages (one plot frame).
+    """
+    from collections import deque
+    rng = np.random.default_rng(1)
+    topics = [f"esp32/{i:04x}/tx" for i in range(devices)]
+    quats = np.column_stack([np.ones(messages), rng.normal(0, 0.05, (messages, 3))])
+    quats /= np.linalg.norm(quats, axis=1)[:, None]
+    stamp = int(time.time() * 1000)
+    text = '{{"qw": {:.4f}, "qx": {:.4f}, "qy": {:.4f}, "qz": {:.4f}}}'
+    text_ts = '{{"qw": {:.4f}, "qx": {:.4f}, "qy": {:.4f}, "qz": {:.4f}, "ts": {}}}'
+    formats = {
+        'json': [text.format(*q).encode() for q in quats],
+        'json+ts': [text_ts.format(*q, stamp + i).encode() for i, q in enumerate(quats)],
+        'binary+ts': [np.array([(0xD4, q, stamp + i)], dtype=BINARY_FORMATS[(0xD4, 25)]).tobytes()
+                      for i, q in enumerate(quats)],
+    }
+    print(f"{messages} messages from {devices} devices, drain every {batch}, {bufsize} rows per device")
+
+    # Previous on_message: parse, lock, deque appends, one log line per message (to /dev/null here)
+    buffers = {topic: [deque(maxlen=bufsize) for _ in range(4)] for topic in topics}
+    lock = threading.Lock()
+    with open(os.devnull, 'w') as sink:
+        start = time.perf_counter()
+        for i, payload in enumerate(formats['json']):
+            q, _ = parse_payload_json(payload.decode(errors='ignore'))
+            roll, pitch, yaw = quat_to_euler_deg(q)
+            now = datetime.now()
+            times, rolls, pitches, yaws = buffers[topics[i % devices]]
+            with lock:
+                times.append(now)
+                rolls.append(roll)
+                pitches.append(pitch)
+                yaws.append(yaw)
+            print(f"{now.strftime('%H:%M:%S')} - roll={roll:.1f} pitch={pitch:.1f} yaw={yaw:.1f}", file=sink)
+        elapsed = time.perf_counter() - start
+    print(f"  {'per-message (json)':22s} {messages / elapsed:10.0f} msg/s")
+
+    for name, payloads in formats.items():
+        ingest = Ingest(bufsize)
+        start = time.perf_counter()
+        for i, payload in enumerate(payloads):
+            ingest.push(topics[i % devices], payload)
+            if (i + 1) % batch == 0:
+                ingest.drain()
+        ingest.drain()
+        elapsed = time.perf_counter() - start
+        print(f"  {'batch (' + name + ')':22s} {messages / elapsed:10.0f} msg/s")
 
 
 def main():
-    parser = argparse.ArgumentParser(description='MPU MQTT real-time plotter (ax/ay/az)')
-    parser.add_argument('--host', required=True, help='MQTT broker hostname')
+    parser = argparse.ArgumentParser(description='MPU MQTT real-time plotter (orientation)')
+    parser.add_argument('--host', help='MQTT broker hostname')
     parser.add_argument('--port', type=int, default=1883, help='MQTT broker port (default: 1883)')
-    parser.add_argument('--topic', required=True, help='MQTT topic to subscribe to')
-    parser.add_argument('--buffer', type=int, default=500, help='Number of points to keep in graph')
+    parser.add_argument('--topic', help='MQTT topic to subscribe to (wildcards allowed, e.g. esp32/+/tx)')
+    parser.add_argument('--buffer', type=int, default=500, help='Number of points to keep per device')
+    parser.add_argument('--max-points', type=int, default=1000, help='Points drawn per line (min/max decimation)')
+    parser.add_argument('--max-lines', type=int, default=8, help='Devices plotted (all are ingested)')
     parser.add_argument('--interval', type=int, default=500, help='Plot update interval in milliseconds')
     parser.add_argument('--user', help='MQTT username (optional)')
     parser.add_argument('--password', help='MQTT password (optional)')
+    parser.add_argument('--throughput', action='store_true',
+                        help='Benchmark mode: count and parse messages without plotting (e.g. with tools/loadgen)')
+    parser.add_argument('--store', metavar='DIR',
+                        help='Persist every reading in a history store (tools/tsdb) and reload it on start')
+    parser.add_argument('--report', type=float, default=1.0, help='Throughput report period in seconds')
+    parser.add_argument('--bench', type=int, metavar='MESSAGES',
+                        help='Offline ingest benchmark on synthetic payloads (no broker needed)')
+    parser.add_argument('--bench-devices', type=int, default=100, help='Devices simulated by --bench')
+    parser.add_argument('--bench-batch', type=int, default=5000, help='Messages per drain in --bench')
 
     args = parser.parse_args()
 
+    if args.bench:
+        benchmark(args.bench, args.bench_devices, args.bench_batch, args.buffer)
+        return
+    if args.host is None or args.topic is None:
+        parser.error('--host and --topic are required')
+
+    history = open_history(args.store) if args.store else None
+
+    if args.throughput:
+        ThroughputMeter(args.host, args.port, args.topic, report_s=args.report, bufsize=args.buffer,
+                        user=args.user, password=args.password, history=history).run()
+        return
+
     plotter = MPUPlotter(args.host, args.port, args.topic, bufsize=args.buffer,
-                         user=args.user, password=args.password)
+                         user=args.user, password=args.password,
+                         max_points=args.max_points, max_lines=args.max_lines, history=history)
     try:
         plotter.run(interval_ms=args.interval)
     except Exception as e:
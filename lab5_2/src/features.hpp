@@ -0,0 +1,245 @@
+#ifndef FEATURES_HPP
+#define FEATURES_HPP
+
+#include <math.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * Оконные признаки вибрации: для каждой оси акселерометра по окну из windowSize
+ * отсчётов считаются RMS и пик (без постоянной составляющей, т.е. без гравитации),
+ * пик-фактор и энергия в bandCount полосах спектра (БПФ с окном Ханна).
+ *
+ * Ядра не зависят от Arduino и собираются на хосте для бенчмарков.
+ */
+namespace features {
+
+// --- Configuration ---
+const size_t windowSize = 128;   // Степень двойки (БПФ); 1.28 с при 100 Гц
+const size_t axisCount = 3;
+const size_t bandCount = 4;      // Равные полосы от 0 до Найквиста
+const size_t snapshotSize = 2 * windowSize; // Предыдущее окно + окно с событием
+const uint8_t holdoffWindows = 4; // Окна после события, в которых повторные триггеры подавляются
+
+struct Thresholds {
+    float rms;      // м/с², порог RMS по любой оси
+    float peak;     // м/с², порог пика
+    float rmsRatio; // Рост RMS относительно предыдущего окна (скорость изменения)
+    float rmsFloor; // Ниже этого RMS рост не считается (шум датчика)
+};
+
+Thresholds thresholds = {1.0f, 3.0f, 3.0f, 0.2f};
+
+enum Trigger : uint8_t {
+    TriggerNone = 0,
+    TriggerRms = 1 << 0,
+    TriggerPeak = 1 << 1,
+    TriggerRmsJump = 1 << 2
+};
+
+struct AxisFeatures {
+    float mean;
+    float rms;
+    float peak;
+    float crest;
+    float bands[bandCount];
+};
+
+struct WindowFeatures {
+    uint32_t index;
+    AxisFeatures axes[axisCount];
+    uint8_t triggers;    // Маска Trigger
+    uint8_t triggerAxis; // Ось, на которой сработал первый триггер
+};
+
+// Таблицы поворотных множителей и окна Ханна считаются один раз
+float cosTable[windowSize / 2];
+float sinTable[windowSize / 2];
+float hannTable[windowSize];
+bool tablesReady = false;
+
+void initTables() {
+    const float twoPi = 6.28318530718f;
+    for (size_t i = 0; i < windowSize / 2; i++) {
+        cosTable[i] = cosf(twoPi * i / windowSize);
+        sinTable[i] = sinf(twoPi * i / windowSize);
+    }
+    for (size_t i = 0; i < windowSize; i++) {
+        hannTable[i] = 0.5f - 0.5f * cosf(twoPi * i / (windowSize - 1));
+    }
+    tablesReady = true;
+}
+
+/**
+ * @brief БПФ по основанию 2 на месте (windowSize точек, прореживание по времени).
+ */
+void fft(float* re, float* im) {
+    // Бит-реверсная перестановка
+    for (size_t i = 1, j = 0; i < windowSize; i++) {
+        size_t bit = windowSize >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            float t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+    for (size_t len = 2; len <= windowSize; len <<= 1) {
+        size_t half = len >> 1;
+        size_t step = windowSize / len;
+        for (size_t start = 0; start < windowSize; start += len) {
+            for (size_t k = 0; k < half; k++) {
+                float wr = cosTable[k * step];
+                float wi = -sinTable[k * step];
+                size_t a = start + k, b = a + half;
+                float tr = re[b] * wr - im[b] * wi;
+                float ti = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - tr; im[b] = im[a] - ti;
+                re[a] += tr; im[a] += ti;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Признаки одной оси по окну отсчётов.
+ * @param stride Шаг между отсчётами оси в samples (данные хранятся по строкам x,y,z).
+ * @param re, im Рабочие массивы БПФ на windowSize точек (не на стеке задачи).
+ */
+void computeAxis(const float* samples, size_t stride, AxisFeatures& out, float* re, float* im) {
+    if (!tablesReady) {
+        initTables();
+    }
+
+    float sum = 0.0f;
+    for (size_t i = 0; i < windowSize; i++) {
+        sum += samples[i * stride];
+    }
+    float mean = sum / windowSize;
+
+    float sumSq = 0.0f, peak = 0.0f;
+    for (size_t i = 0; i < windowSize; i++) {
+        float v = samples[i * stride] - mean;
+        sumSq += v * v;
+        float a = fabsf(v);
+        if (a > peak) peak = a;
+        re[i] = v * hannTable[i];
+        im[i] = 0.0f;
+    }
+    out.mean = mean;
+    out.rms = sqrtf(sumSq / windowSize);
+    out.peak = peak;
+    out.crest = out.rms > 0.0f ? peak / out.rms : 0.0f;
+
+    fft(re, im);
+
+    // Односторонний спектр: бины 1..N/2 делятся на равные полосы.
+    // Нормировка с поправкой на мощность окна Ханна (3/8): сумма полос ~ rms².
+    const size_t binsPerBand = (windowSize / 2) / bandCount;
+    const float scale = 2.0f / (0.375f * windowSize * windowSize);
+    for (size_t band = 0; band < bandCount; band++) {
+        float energy = 0.0f;
+        for (size_t k = band * binsPerBand + 1; k <= (band + 1) * binsPerBand; k++) {
+            energy += re[k] * re[k] + im[k] * im[k];
+        }
+        out.bands[band] = energy * scale;
+    }
+}
+
+/**
+ * @brief Нижняя граница полосы в Гц при заданной частоте дискретизации.
+ */
+float bandStartHz(size_t band, float sampleRateHz) {
+    return sampleRateHz * 0.5f * band / bandCount;
+}
+
+/**
+ * @brief Потоковый экстрактор: копит отсчёты, по заполнении окна считает признаки и триггеры.
+ *
+ * Хранит два последних окна, чтобы к событию приложить и данные перед ним.
+ * Весит ~4 КБ (история и массивы БПФ): объявлять глобально, а не на стеке задачи.
+ */
+class Extractor {
+public:
+    /**
+     * @brief Добавляет отсчёт.
+     * @return true, если окно завершено и latest() обновлён.
+     */
+    bool add(float x, float y, float z) {
+        float* row = history[(windowStart + filled) % snapshotSize];
+        row[0] = x; row[1] = y; row[2] = z;
+        if (++filled < windowSize) {
+            return false;
+        }
+        filled = 0;
+
+        WindowFeatures next = {};
+        next.index = windowIndex++;
+        for (size_t axis = 0; axis < axisCount; axis++) {
+            computeAxis(&history[windowStart][axis], axisCount, next.axes[axis], re, im);
+        }
+        detect(next);
+        current = next;
+        windowStart = (windowStart + windowSize) % snapshotSize;
+        return true;
+    }
+
+    const WindowFeatures& latest() const {
+        return current;
+    }
+
+    /**
+     * @brief Копирует два последних окна в хронологическом порядке (snapshotSize строк x,y,z).
+     * Вызывать сразу после того, как add() вернул true: следующий отсчёт начнёт затирать старое окно.
+     */
+    void copySnapshot(float (*out)[axisCount]) const {
+        // windowStart уже указывает на самое старое окно кольца
+        for (size_t i = 0; i < snapshotSize; i++) {
+            memcpy(out[i], history[(windowStart + i) % snapshotSize], sizeof(out[i]));
+        }
+    }
+
+private:
+    void detect(WindowFeatures& next) {
+        next.triggers = TriggerNone;
+        next.triggerAxis = 0;
+        if (holdoff > 0) {
+            holdoff--;
+            return;
+        }
+        for (size_t axis = 0; axis < axisCount; axis++) {
+            const AxisFeatures& now = next.axes[axis];
+            const AxisFeatures& before = current.axes[axis];
+            uint8_t hit = TriggerNone;
+            if (now.rms > thresholds.rms) hit |= TriggerRms;
+            if (now.peak > thresholds.peak) hit |= TriggerPeak;
+            // Без предыдущего окна скорость изменения не определена
+            if (windowIndex > 1 && now.rms > thresholds.rmsFloor &&
+                now.rms > before.rms * thresholds.rmsRatio) {
+                hit |= TriggerRmsJump;
+            }
+            if (hit != TriggerNone && next.triggers == TriggerNone) {
+                next.triggerAxis = axis;
+            }
+            next.triggers |= hit;
+        }
+        if (next.triggers != TriggerNone) {
+            holdoff = holdoffWindows;
+        }
+    }
+
+    float history[snapshotSize][axisCount] = {};
+    float re[windowSize], im[windowSize];   // Рабочие массивы БПФ
+    size_t windowStart = 0; // Начало заполняемого окна в кольце
+    size_t filled = 0;
+    uint32_t windowIndex = 0;
+    uint8_t holdoff = 0;
+    WindowFeatures current = {};
+};
+
+} // namespace features
+
+#endif // FEATURES_HPP
\ No newline at end of file
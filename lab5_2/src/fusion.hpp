@@ -0,0 +1,128 @@
+#ifndef FUSION_HPP
+#define FUSION_HPP
+
+#include <math.h>
+
+namespace fusion {
+
+/**
+ * @brief Ориентация в виде единичного кватерниона (w, x, y, z), поворот из связанной СК в мировую.
+ */
+struct Quaternion {
+    float w, x, y, z;
+};
+
+/**
+ * @brief Углы Эйлера (радианы), порядок Z-Y-X (yaw-pitch-roll).
+ */
+struct Euler {
+    float roll, pitch, yaw;
+};
+
+/**
+ * @brief Фильтр Мэджвика для 6-осевого IMU (акселерометр + гироскоп, без магнитометра).
+ *
+ * Реализация во float: на ESP32 есть аппаратный FPU одинарной точности, поэтому все
+ * константы заданы с суффиксом f, чтобы не скатываться в программный double.
+ * Рыскание (yaw) без магнитометра не наблюдаемо и медленно дрейфует.
+ */
+class Madgwick {
+public:
+    explicit Madgwick(float beta = 0.1f) : beta(beta) {}
+
+    /**
+     * @brief Начальная ориентация по вектору гравитации, чтобы не ждать сходимости фильтра.
+     */
+    void initFromAccel(float ax, float ay, float az) {
+        float roll = atan2f(ay, az);
+        float pitch = atan2f(-ax, sqrtf(ay * ay + az * az));
+        float cr = cosf(roll * 0.5f), sr = sinf(roll * 0.5f);
+        float cp = cosf(pitch * 0.5f), sp = sinf(pitch * 0.5f);
+        q = {cr * cp, sr * cp, cr * sp, -sr * sp};
+        initialized = true;
+    }
+
+    /**
+     * @brief Шаг фильтра.
+     * @param gx,gy,gz Угловая скорость, рад/с.
+     * @param ax,ay,az Ускорение в любых единицах (нормируется).
+     * @param dt Шаг по времени, с.
+     */
+    void update(float gx, float gy, float gz, float ax, float ay, float az, float dt) {
+        if (!initialized) {
+            initFromAccel(ax, ay, az);
+            return;
+        }
+        float q0 = q.w, q1 = q.x, q2 = q.y, q3 = q.z;
+
+        // Скорость изменения кватерниона по гироскопу
+        float qDot0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+        float qDot1 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+        float qDot2 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+        float qDot3 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+        // Коррекция градиентным спуском по направлению гравитации (если ускорение валидно)
+        float norm = ax * ax + ay * ay + az * az;
+        if (norm > 0.0f) {
+            float recipNorm = 1.0f / sqrtf(norm);
+            ax *= recipNorm; ay *= recipNorm; az *= recipNorm;
+
+            float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+            float _4q0 = 4.0f * q0, _4q1 = 4.0f * q1, _4q2 = 4.0f * q2;
+            float _8q1 = 8.0f * q1, _8q2 = 8.0f * q2;
+            float q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+
+            float s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+            float s1 = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * q1 - _2q0 * ay - _4q1
+                       + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+            float s2 = 4.0f * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2
+                       + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+            float s3 = 4.0f * q1q1 * q3 - _2q1 * ax + 4.0f * q2q2 * q3 - _2q2 * ay;
+
+            float sNorm = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+            if (sNorm > 0.0f) {
+                recipNorm = 1.0f / sqrtf(sNorm);
+                qDot0 -= beta * s0 * recipNorm;
+                qDot1 -= beta * s1 * recipNorm;
+                qDot2 -= beta * s2 * recipNorm;
+                qDot3 -= beta * s3 * recipNorm;
+            }
+        }
+
+        q0 += qDot0 * dt;
+        q1 += qDot1 * dt;
+        q2 += qDot2 * dt;
+        q3 += qDot3 * dt;
+
+        float recipNorm = 1.0f / sqrtf(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+        q = {q0 * recipNorm, q1 * recipNorm, q2 * recipNorm, q3 * recipNorm};
+    }
+
+    Quaternion orientation() const {
+        return q;
+    }
+
+    Euler euler() const {
+        return toEuler(q);
+    }
+
+    static Euler toEuler(const Quaternion& q) {
+        float sinPitch = 2.0f * (q.w * q.y - q.z * q.x);
+        if (sinPitch > 1.0f) sinPitch = 1.0f;
+        if (sinPitch < -1.0f) sinPitch = -1.0f;
+        return {
+            atan2f(2.0f * (q.w * q.x + q.y * q.z), 1.0f - 2.0f * (q.x * q.x + q.y * q.y)),
+            asinf(sinPitch),
+            atan2f(2.0f * (q.w * q.z + q.x * q.y), 1.0f - 2.0f * (q.y * q.y + q.z * q.z))
+        };
+    }
+
+private:
+    float beta;                 // Вес коррекции по акселерометру
+    Quaternion q = {1.0f, 0.0f, 0.0f, 0.0f};
+    bool initialized = false;
+};
+
+} // namespace fusion
+
+#endif // FUSION_HPP
\ No newline at end of file
@@ -2,6 +2,8 @@
 #include "sta.hpp" 
 #include "mqtt.hpp"
 #include "mpu.hpp"
+#include "spool.hpp"
+#include "commands.hpp"
 #include "rtos.hpp"
 
 void setup() {
@@ -17,9 +19,16 @@ void setup() {
         while (true) { delay(1000); }
     }
 
+    // Время для меток в спуле (синхронизируется в фоне)
+    configTime(0, 0, "pool.ntp.org");
+    if (!spool::init()) {
+        Serial.println("[MAIN] Spool unavailable, offline data is buffered in RAM only.");
+    }
+
     // 2. Настройка MQTT
     mqtt::setupMqtt();
-    mqtt::setCallback(rtos::mqttCallback);
+    commands::init();
+    mqtt::setCallback(commands::onMessage);
 
     // 3. Инициализация датчика MPU6050
     if (!mpu::setupMpu()) {
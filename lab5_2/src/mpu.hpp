@@ -62,13 +62,16 @@ bool readData(MpuData& data) {
     return true;
 }
 
+/**
+ * @brief Имитация неподвижного датчика: гравитация по Z и шум акселерометра/гироскопа.
+ */
 bool readMockData(MpuData& data) {
-    data.ax = (float)random(-100, 100) / 10.0f;
-    data.ay = (float)random(-100, 100) / 10.0f;
-    data.az = (float)random(-100, 100) / 10.0f;
-    data.gx = 0.0f;
-    data.gy = 0.0f;
-    data.gz = 0.0f;
+    data.ax = (float)random(-20, 20) / 100.0f;
+    data.ay = (float)random(-20, 20) / 100.0f;
+    data.az = 9.81f + (float)random(-20, 20) / 100.0f;
+    data.gx = (float)random(-10, 10) / 1000.0f;
+    data.gy = (float)random(-10, 10) / 1000.0f;
+    data.gz = (float)random(-10, 10) / 1000.0f;
     data.temp = 25.0f;
     return true;
 }
@@ -2,165 +2,470 @@
 #define RTOS_HPP
 
 #include <Arduino.h>
+#include "esp_timer.h"
+#include "esp_vfs_eventfd.h"
 #include "mpu.hpp"
+#include "fusion.hpp"
+#include "features.hpp"
+#include "sta.hpp"
 #include "mqtt.hpp"
+#include "spool.hpp"
+#include "commands.hpp"
+#include "profiler.hpp"
+#include "deadband.hpp"
+#include "payload.hpp"
 
 namespace rtos {
 
 mpu::MpuData sharedBuffer; // Буфер для данных с акселерометра
+fusion::Quaternion sharedOrientation = {1.0f, 0.0f, 0.0f, 0.0f}; // Ориентация (под тем же мьютексом)
 SemaphoreHandle_t bufferMutex; // Мьютекс для защиты буфера
 
+// Признаки вибрации: MPU -> MQTT через очередь, снимок окна события - через один слот
+QueueHandle_t featureQueue;
+float eventSnapshot[features::snapshotSize][features::axisCount];
+features::WindowFeatures eventFeatures;
+volatile bool snapshotReady = false; // Слот занят: MPU не пишет, пока MQTT не отправит снимок
+features::Extractor extractor; // Только задача MPU; ~4 КБ, поэтому не на её стеке
+
 TaskHandle_t mqttTaskHandle; // Дескриптор задачи MQTT (Ядро 0)
 TaskHandle_t mpuTaskHandle;  // Дескриптор задачи MPU (Ядро 1)
 
-const TickType_t PUBLISH_INTERVAL = pdMS_TO_TICKS(2000);
+// Задачи спят, пока нет работы: MPU будит периодический таймер, MQTT - сокет,
+// eventfd (сигнал от других задач) или ближайший дедлайн.
+esp_timer_handle_t sampleTimer;
+int mqttWakeFd = -1;
+volatile uint32_t mqttWakeups = 0; // Пробуждения за окно отчёта профилировщика
+volatile uint32_t mpuWakeups = 0;
+
+const TickType_t PROFILE_REPORT_INTERVAL = pdMS_TO_TICKS(10000);
+const char* PROFILE_TOPIC = "esp32/0ad3/profile";
+const char* FEATURES_TOPIC = "esp32/0ad3/features";
+const char* EVENT_TOPIC = "esp32/0ad3/event";
+const char* SNAPSHOT_TOPIC = "esp32/0ad3/snapshot";
+const size_t FEATURE_QUEUE_LENGTH = 4;
+const uint8_t PUBLISH_QOS = 1; // Доставка "хотя бы один раз" через окно неподтверждённых сообщений
+
+// Ориентация публикуется по выходу из зоны нечувствительности (~1° на компоненту кватерниона)
+// или по heartbeat; проверяется с периодом ограничения частоты публикаций.
+const float ORIENTATION_DEADBANDS[] = {0.01f, 0.01f, 0.01f, 0.01f};
+deadband::Reporter<4> orientationReporter(ORIENTATION_DEADBANDS, {30000, 500}); // Heartbeat, ограничение частоты
+const uint32_t MIN_CHECK_INTERVAL_MS = 50; // При rate=0 задача MQTT всё равно не крутится вхолостую
+
+// Интервалы меняются командами из rxTopic (см. commands.hpp).
+// Пишет только задача MQTT; 32-битные чтения атомарны, поэтому задача MPU читает без мьютекса.
+volatile TickType_t sampleInterval = pdMS_TO_TICKS(10); // Фильтр ориентации работает на полной частоте IMU
+
+const uint32_t MPU_LOG_EVERY = 100; // Лог сырых данных раз в N отсчётов, чтобы не забивать Serial
+
+/**
+ * @brief Callback таймера опроса (задача esp_timer): будит задачу MPU.
+ */
+void onSampleTimer(void*) {
+    xTaskNotifyGive(mpuTaskHandle);
+}
+
+/**
+ * @brief (Пере)запускает таймер опроса с текущим sampleInterval.
+ */
+void startSampleTimer() {
+    esp_timer_stop(sampleTimer); // Ошибка, если таймер ещё не запущен, не важна
+    esp_timer_start_periodic(sampleTimer, (uint64_t)pdTICKS_TO_MS(sampleInterval) * 1000);
+}
+
+/**
+ * @brief Будит задачу MQTT, ждущую в waitForWork() (вызывать из других задач).
+ */
+void wakeMqttTask() {
+    uint64_t one = 1;
+    if (mqttWakeFd >= 0) {
+        write(mqttWakeFd, &one, sizeof(one));
+    }
+}
+
+/**
+ * @brief Спит до активности на сокете MQTT, сигнала wakeMqttTask() или истечения timeoutMs.
+ */
+void waitForWork(uint32_t timeoutMs) {
+    fd_set readSet, writeSet;
+    FD_ZERO(&readSet);
+    FD_ZERO(&writeSet);
+    int maxFd = -1;
+    if (mqttWakeFd >= 0) {
+        FD_SET(mqttWakeFd, &readSet);
+        maxFd = mqttWakeFd;
+    }
+    int socket = mqtt::socketFd();
+    if (socket >= 0) {
+        // Пока идёт TCP connect, его завершение видно по готовности к записи
+        FD_SET(socket, mqtt::waitingForConnect() ? &writeSet : &readSet);
+        if (socket > maxFd) maxFd = socket;
+    }
+    if (maxFd < 0) {
+        vTaskDelay(pdMS_TO_TICKS(timeoutMs));
+        return;
+    }
+    struct timeval timeout = {(time_t)(timeoutMs / 1000), (suseconds_t)((timeoutMs % 1000) * 1000)};
+    if (select(maxFd + 1, &readSet, &writeSet, NULL, &timeout) > 0 &&
+        mqttWakeFd >= 0 && FD_ISSET(mqttWakeFd, &readSet)) {
+        uint64_t count;
+        read(mqttWakeFd, &count, sizeof(count)); // Сбрасываем счётчик eventfd
+    }
+}
 
 /**
- * @brief Callback для входящих MQTT сообщений.
- * Вызывается из mqtt::client.loop() в задаче taskCore0_MQTT.
+ * @brief Остаток интервала до дедлайна в мс (0, если уже прошёл).
  */
-void mqttCallback(char* topic, byte* payload, unsigned int length) {
-    Serial.print("[RTOS-MQTT] Message received[");
-    Serial.print(topic);
-    Serial.print("]: ");
-    
-    // Здесь может быть обработка команды
-    // Например, изменение режима работы MPU
-    for (unsigned int i = 0; i < length; i++) {
-        Serial.print((char)payload[i]);
+uint32_t remainingMs(TickType_t since, TickType_t interval) {
+    TickType_t elapsed = xTaskGetTickCount() - since;
+    return elapsed >= interval ? 0 : pdTICKS_TO_MS(interval - elapsed);
+}
+
+/**
+ * @brief Применяет команды, накопленные callback'ом commands::onMessage.
+ * Вызывается из задачи taskCore0_MQTT, поэтому client.loop() никогда не блокируется обработкой.
+ * @return true, если запрошена немедленная публикация (snapshot).
+ */
+bool handleCommands() {
+    bool snapshot = false;
+    commands::Command command;
+    while (commands::poll(command)) {
+        switch (command.type) {
+        case commands::Type::SampleInterval:
+            sampleInterval = pdMS_TO_TICKS(command.value);
+            startSampleTimer();
+            Serial.printf("[RTOS-CMD] Sample interval: %u ms\n", command.value);
+            break;
+        case commands::Type::PublishInterval:
+            orientationReporter.policy.heartbeatMillis = command.value;
+            Serial.printf("[RTOS-CMD] Heartbeat interval: %u ms\n", command.value);
+            break;
+        case commands::Type::RateLimit:
+            orientationReporter.policy.minIntervalMillis = command.value;
+            Serial.printf("[RTOS-CMD] Min publish interval: %u ms\n", command.value);
+            break;
+        case commands::Type::BatchSize:
+            mqtt::flushPerLoop = command.value;
+            spool::replayBurst = command.value;
+            Serial.printf("[RTOS-CMD] Backlog batch size: %u\n", command.value);
+            break;
+        case commands::Type::Snapshot:
+            snapshot = true;
+            break;
+        case commands::Type::Reboot:
+            Serial.println("[RTOS-CMD] Rebooting...");
+            Serial.flush();
+            ESP.restart();
+            break;
+        }
+    }
+    return snapshot;
+}
+
+/**
+ * @brief Публикует запись из спула, добавляя в JSON исходное время измерения ("ts", мс от эпохи).
+ */
+bool publishSpooled(uint64_t timestampMs, const char* payload, size_t length) {
+    char message[spool::maxPayloadLength + 24];
+    snprintf(message, sizeof(message), "%.*s, \"ts\": %llu}", (int)length - 1, payload,
+             (unsigned long long)timestampMs);
+    return mqtt::trySend(mqtt::txTopic, message, PUBLISH_QOS);
+}
+
+/**
+ * @brief Период проверки ориентации на выход из зоны нечувствительности.
+ */
+TickType_t orientationCheckInterval() {
+    uint32_t ms = orientationReporter.policy.minIntervalMillis;
+    return pdMS_TO_TICKS(ms > MIN_CHECK_INTERVAL_MS ? ms : MIN_CHECK_INTERVAL_MS);
+}
+
+/**
+ * @brief Частота дискретизации в Гц для текущего sampleInterval.
+ */
+float sampleRateHz() {
+    uint32_t periodMs = pdTICKS_TO_MS(sampleInterval);
+    return periodMs ? 1000.0f / periodMs : 0.0f;
+}
+
+/**
+ * @brief Публикует большой JSON потоком (минуя буфер PubSubClient), QoS 0.
+ */
+bool publishLarge(const char* topic, const char* json, size_t length) {
+    if (!mqtt::connected() || !mqtt::client.beginPublish(topic, length, false)) {
+        return false;
+    }
+    mqtt::client.write((const uint8_t*)json, length);
+    return mqtt::client.endPublish();
+}
+
+/**
+ * @brief Публикует сводку признаков последнего окна в FEATURES_TOPIC.
+ */
+void publishFeatures(const features::WindowFeatures& f) {
+    static char json[640];
+    size_t size = sizeof(json);
+    size_t pos = snprintf(json, size, "{\"window\": %u, \"rate\": %.1f, \"axes\": [",
+                          f.index, sampleRateHz());
+    for (size_t axis = 0; axis < features::axisCount && pos < size; axis++) {
+        const features::AxisFeatures& a = f.axes[axis];
+        pos += snprintf(json + pos, size - pos,
+                        "%s{\"rms\": %.3f, \"peak\": %.3f, \"crest\": %.2f, \"bands\": [",
+                        axis ? ", " : "", a.rms, a.peak, a.crest);
+        for (size_t band = 0; band < features::bandCount && pos < size; band++) {
+            pos += snprintf(json + pos, size - pos, "%s%.4f", band ? ", " : "", a.bands[band]);
+        }
+        if (pos < size) pos += snprintf(json + pos, size - pos, "]}");
+    }
+    if (pos < size) pos += snprintf(json + pos, size - pos, "]}");
+    if (pos >= size) {
+        Serial.println("[RTOS-MQTT] Features report truncated, not published.");
+        return;
     }
-    Serial.println();
+    publishLarge(FEATURES_TOPIC, json, pos);
+}
+
+/**
+ * @brief Публикует событие (QoS 1, в очередь при отсутствии связи).
+ */
+void publishEvent(const features::WindowFeatures& f) {
+    const features::AxisFeatures& a = f.axes[f.triggerAxis];
+    char json[mqtt::maxPayloadLength];
+    snprintf(json, sizeof(json),
+             "{\"window\": %u, \"axis\": \"%c\", \"triggers\": %u, \"rms\": %.3f, \"peak\": %.3f, \"crest\": %.2f}",
+             f.index, "xyz"[f.triggerAxis], f.triggers, a.rms, a.peak, a.crest);
+    Serial.printf("[RTOS-MQTT] Vibration event: %s\n", json);
+    mqtt::publish(EVENT_TOPIC, json, PUBLISH_QOS);
+}
+
+/**
+ * @brief Публикует сырые данные вокруг события (два окна) в SNAPSHOT_TOPIC и освобождает слот.
+ */
+void publishSnapshot() {
+    static char json[6144];
+    size_t size = sizeof(json);
+    size_t pos = snprintf(json, size, "{\"window\": %u, \"rate\": %.1f",
+                          eventFeatures.index, sampleRateHz());
+    for (size_t axis = 0; axis < features::axisCount && pos < size; axis++) {
+        pos += snprintf(json + pos, size - pos, ", \"a%c\": [", "xyz"[axis]);
+        for (size_t i = 0; i < features::snapshotSize && pos < size; i++) {
+            pos += snprintf(json + pos, size - pos, "%s%.2f", i ? "," : "", eventSnapshot[i][axis]);
+        }
+        if (pos < size) pos += snprintf(json + pos, size - pos, "]");
+    }
+    if (pos < size) pos += snprintf(json + pos, size - pos, "}");
+    snapshotReady = false;
+
+    if (pos >= size) {
+        Serial.println("[RTOS-MQTT] Snapshot truncated, not published.");
+    } else if (!publishLarge(SNAPSHOT_TOPIC, json, pos)) {
+        Serial.println("[RTOS-MQTT] Snapshot dropped: broker unreachable.");
+    }
+}
+
+/**
+ * @brief Выводит отчёт профилировщика в Serial и публикует его в PROFILE_TOPIC (JSON).
+ */
+void reportProfile() {
+    Serial.printf("[RTOS-MQTT] QoS1: published=%u acked=%u retransmitted=%u in-flight=%u queued=%u\n",
+                  mqtt::stats.published, mqtt::stats.acked, mqtt::stats.retransmitted,
+                  (unsigned)mqtt::inflightCount(), (unsigned)mqtt::queuedCount());
+    float seconds = pdTICKS_TO_MS(PROFILE_REPORT_INTERVAL) / 1000.0f;
+    Serial.printf("[RTOS] Wakeups/s: mqtt=%.1f mpu=%.1f\n", mqttWakeups / seconds, mpuWakeups / seconds);
+    Serial.printf("[RTOS] Stack free (bytes): mqtt=%u mpu=%u\n",
+                  (unsigned)uxTaskGetStackHighWaterMark(mqttTaskHandle),
+                  (unsigned)uxTaskGetStackHighWaterMark(mpuTaskHandle));
+    const deadband::Stats& orientation = orientationReporter.stats();
+    Serial.printf("[RTOS-MQTT] Orientation: %u checked, %u published, %u rate-limited\n",
+                  orientation.samples, orientation.published, orientation.rateLimited);
+    mqttWakeups = 0;
+    mpuWakeups = 0;
+    profiler::printReport(false);
+
+    static char json[768];
+    size_t length = profiler::toJson(json, sizeof(json));
+    // Отчёт больше буфера PubSubClient, поэтому отправляем потоком
+    publishLarge(PROFILE_TOPIC, json, length);
 }
 
 /**
  * @brief Задача для Ядра 0: Управление MQTT.
  * - Поддерживает соединение с брокером.
- * - Принимает команды (через callback).
+ * - Применяет команды, принятые через callback.
  * - Публикует данные из общего буфера.
+ * - Публикует признаки вибрации, события и снимки окон.
  */
 void taskCore0_MQTT(void *pvParameters) {
     Serial.println("[RTOS] RTOS task on Core 0 started.");
     delay(10);
-    TickType_t lastPublishTime = xTaskGetTickCount();
-
-    // Измерение времени выполнения (микросекунды)
-    uint64_t totalExecMicros = 0;
-    uint32_t maxExecMicros = 0;
-    uint32_t iterCount = 0;
-    const uint32_t REPORT_EVERY = 100;
+    TickType_t lastCheckTime = xTaskGetTickCount();
+    TickType_t lastReportTime = lastCheckTime;
+    const int profileScope = profiler::registerScope("mqtt");
+    features::WindowFeatures latestFeatures = {};
+    bool firstPublishLogged = false;
+    bool haveFeatures = false;
 
     for (;;) {
+        mqttWakeups++;
         // Запуск таймера активной работы
-        uint32_t start = micros();
+        uint32_t start = profiler::nowMicros();
 
-        if (!mqtt::client.connected()) {
-            mqtt::connect();
+        mqtt::loop();
+        bool snapshot = handleCommands();
+
+        // События публикуются сразу, сводка признаков - вместе с ориентацией
+        features::WindowFeatures windowFeatures;
+        while (xQueueReceive(featureQueue, &windowFeatures, 0) == pdTRUE) {
+            latestFeatures = windowFeatures;
+            haveFeatures = true;
+            if (windowFeatures.triggers != features::TriggerNone) {
+                publishEvent(windowFeatures);
+            }
+        }
+        if (snapshotReady) {
+            publishSnapshot();
         }
-        mqtt::client.loop();
 
-        if ((xTaskGetTickCount() - lastPublishTime) >= PUBLISH_INTERVAL) {
-            
-            if (mqtt::client.connected()) {
-                mpu::MpuData localCopy;
+        // Ориентация меняется непрерывно, поэтому проверяется с периодом ограничения частоты
+        TickType_t checkInterval = orientationCheckInterval();
+        if (snapshot || (xTaskGetTickCount() - lastCheckTime) >= checkInterval) {
+            lastCheckTime = xTaskGetTickCount();
+            fusion::Quaternion localCopy = {1.0f, 0.0f, 0.0f, 0.0f};
 
-                // Блокируем мьютекс для безопасного чтения
-                if (xSemaphoreTake(bufferMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-                    localCopy = sharedBuffer; // Копируем данные
-                    xSemaphoreGive(bufferMutex); // Освобождаем мьютекс
-                } else {
-                    Serial.println("[RTOS-MQTT] Error acquiring mutex for reading.");
-                }
+            // Блокируем мьютекс для безопасного чтения
+            if (xSemaphoreTake(bufferMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+                localCopy = sharedOrientation; // Копируем данные
+                xSemaphoreGive(bufferMutex); // Освобождаем мьютекс
+            } else {
+                Serial.println("[RTOS-MQTT] Error acquiring mutex for reading.");
+            }
 
-                // Формируем сообщение в JSON
-                String message = "{\"ax\": " + String(localCopy.ax) + 
-                                 ", \"ay\": " + String(localCopy.ay) + 
-                                 ", \"az\": " + String(localCopy.az) + "}";
+            const float values[] = {localCopy.w, localCopy.x, localCopy.y, localCopy.z};
+            deadband::Reason reason = orientationReporter.offer(values, millis(), snapshot);
+            if (reason != deadband::Reason::None) {
+                // Формируем сообщение в JSON: вместо потока сырых данных - 4 числа ориентации
+                char json[payload::maxOrientationLength];
+                payload::formatOrientation(json, sizeof(json), localCopy.w, localCopy.x, localCopy.y, localCopy.z);
 
-                // Публикуем
-                Serial.printf("[RTOS-MQTT] Publishing to topic %s: %s\n", mqtt::txTopic, message.c_str());
-                if (mqtt::client.publish(mqtt::txTopic, message.c_str())) {
-                    lastPublishTime = xTaskGetTickCount();
+                // Без связи с брокером сохраняем во flash-спул, иначе публикуем
+                bool accepted = false;
+                if (!mqtt::connected() && spool::append(json, strlen(json))) {
+                    Serial.printf("[RTOS-MQTT] Broker unreachable, spooled: %s\n", json);
+                    accepted = true;
                 } else {
-                    Serial.println("[RTOS-MQTT] Error publishing.");
+                    Serial.printf("[RTOS-MQTT] Publishing to topic %s (%s): %s\n", mqtt::txTopic,
+                                  deadband::reasonName(reason), json);
+                    accepted = mqtt::publish(mqtt::txTopic, json, PUBLISH_QOS);
+                    if (!accepted) {
+                        Serial.println("[RTOS-MQTT] Error publishing.");
+                    } else if (!firstPublishLogged && mqtt::connected()) {
+                        firstPublishLogged = true;
+                        Serial.printf("[TIME] Boot to first publish: %lu ms (WiFi connect %lu ms)\n",
+                                      millis(), sta::lastConnectMillis);
+                    }
+                }
+                // Неотправленная запись остаётся в ожидании и уйдёт при следующей проверке
+                if (accepted) {
+                    orientationReporter.sent(millis());
+                }
+                if (haveFeatures) {
+                    publishFeatures(latestFeatures);
                 }
             }
         }
 
+        // Досылаем накопленные данные с ограничением скорости
+        if (mqtt::connected()) {
+            spool::replay(publishSpooled);
+        }
+
         // Измеряем время выполнения
-        uint32_t elapsed = micros() - start;
-        totalExecMicros += elapsed;
-        if (elapsed > maxExecMicros) maxExecMicros = elapsed;
-        iterCount++;
-
-        if (iterCount >= REPORT_EVERY) {
-            uint64_t avg = (iterCount > 0) ? (totalExecMicros / iterCount) : 0;
-            Serial.printf("[RTOS-MQTT] Core0 task execution time: avg=%llu us max=%u us (over %u iters)\n",
-                          (unsigned long long)avg, maxExecMicros, iterCount);
-            // сброс статистики
-            totalExecMicros = 0;
-            maxExecMicros = 0;
-            iterCount = 0;
+        profiler::record(profileScope, profiler::nowMicros() - start);
+
+        if ((xTaskGetTickCount() - lastReportTime) >= PROFILE_REPORT_INTERVAL) {
+            lastReportTime = xTaskGetTickCount();
+            reportProfile();
         }
-        
-        vTaskDelay(pdMS_TO_TICKS(10)); // Даем поработать другим процессам
+
+        // Спим до ближайшего дедлайна вместо опроса каждые 10 мс
+        uint32_t timeout = mqtt::nextDeadlineMillis();
+        uint32_t publishIn = remainingMs(lastCheckTime, orientationCheckInterval());
+        uint32_t reportIn = remainingMs(lastReportTime, PROFILE_REPORT_INTERVAL);
+        if (publishIn < timeout) timeout = publishIn;
+        if (reportIn < timeout) timeout = reportIn;
+        if (mqtt::connected() && spool::pending() && spool::replayIntervalMillis < timeout) {
+            timeout = spool::replayIntervalMillis;
+        }
+        waitForWork(timeout);
     }
 }
 
 /**
- * @brief Задача для Ядра 1: Чтение данных с MPU6050.
- * - Считывает данные с датчика.
- * - Записывает их в общий буфер под мьютексом.
+ * @brief Задача для Ядра 1: Чтение данных с MPU6050 и оценка ориентации.
+ * - Просыпается по уведомлению таймера опроса (период sampleInterval).
+ * - Обновляет фильтр Мэджвика на каждом отсчёте.
+ * - Считает признаки вибрации по окнам и передаёт их задаче MQTT.
+ * - Записывает сырые данные и ориентацию в общий буфер под мьютексом.
  */
 void taskCore1_MPU(void *pvParameters) {
     Serial.println("[RTOS] RTOS task on Core 1 started.");
     delay(10);
 
     mpu::MpuData tempData; // Локальный буфер для чтения
-
-    // Измерение времени выполнения (микросекунды)
-    uint64_t totalExecMicros = 0;
-    uint32_t maxExecMicros = 0;
-    uint32_t iterCount = 0;
-    const uint32_t REPORT_EVERY = 100;
+    fusion::Madgwick filter;
+    const int profileScope = profiler::registerScope("mpu");
+    uint32_t lastSampleMicros = micros();
+    uint32_t sampleCount = 0;
 
     for (;;) {
+        // Ждём тика таймера опроса; пропущенные тики сливаются в один
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        mpuWakeups++;
         // Запуск таймера активной работы
-        uint32_t start = micros();
+        uint32_t start = profiler::nowMicros();
 
         // 1. Чтение данных с датчика
         if (mpu::readMockData(tempData)) {
-            Serial.printf("[RTOS-MPU] Read: ax=%.2f, ay=%.2f, az=%.2f\n", 
-                          tempData.ax, tempData.ay, tempData.az);
-            
-            // 2. Запись в общий буфер с блокировкой
-            if (xSemaphoreTake(bufferMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+            // 2. Шаг фильтра по фактическому интервалу между отсчётами
+            uint32_t now = micros();
+            float dt = (now - lastSampleMicros) * 1e-6f;
+            lastSampleMicros = now;
+            filter.update(tempData.gx, tempData.gy, tempData.gz, tempData.ax, tempData.ay, tempData.az, dt);
+            fusion::Quaternion orientation = filter.orientation();
+
+            if (++sampleCount % MPU_LOG_EVERY == 0) {
+                fusion::Euler e = filter.euler();
+                Serial.printf("[RTOS-MPU] Read: ax=%.2f, ay=%.2f, az=%.2f | roll=%.1f pitch=%.1f yaw=%.1f\n",
+                              tempData.ax, tempData.ay, tempData.az,
+                              e.roll * RAD_TO_DEG, e.pitch * RAD_TO_DEG, e.yaw * RAD_TO_DEG);
+            }
+
+            // 3. Признаки вибрации по завершении окна
+            if (extractor.add(tempData.ax, tempData.ay, tempData.az)) {
+                const features::WindowFeatures& f = extractor.latest();
+                if (f.triggers != features::TriggerNone && !snapshotReady) {
+                    extractor.copySnapshot(eventSnapshot);
+                    eventFeatures = f;
+                    snapshotReady = true;
+                }
+                if (xQueueSend(featureQueue, &f, 0) != pdTRUE) {
+                    Serial.println("[RTOS-MPU] Feature queue full, window dropped.");
+                }
+                wakeMqttTask();
+            }
+
+            // 4. Запись в общий буфер с блокировкой (не ждём: следующий отсчёт через sampleInterval)
+            if (xSemaphoreTake(bufferMutex, 0) == pdTRUE) {
                 sharedBuffer = tempData; // Обновляем общие данные
+                sharedOrientation = orientation;
                 xSemaphoreGive(bufferMutex); // Освобождаем
-            } else {
-                 Serial.println("[RTOS-MPU] Error acquiring mutex for writing.");
             }
         } else {
             Serial.println("[RTOS-MPU] Error reading MPU data.");
         }
 
         // Измерение времени выполнения
-        uint32_t elapsed = micros() - start;
-        totalExecMicros += elapsed;
-        if (elapsed > maxExecMicros) maxExecMicros = elapsed;
-        iterCount++;
-
-        if (iterCount >= REPORT_EVERY) {
-            uint64_t avg = (iterCount > 0) ? (totalExecMicros / iterCount) : 0;
-            Serial.printf("[RTOS-MPU] Core1 task execution time: avg=%llu us max=%u us (over %u iters)\n",
-                          (unsigned long long)avg, maxExecMicros, iterCount);
-            // сброс статистики
-            totalExecMicros = 0;
-            maxExecMicros = 0;
-            iterCount = 0;
-        }
-
-        // Опрашиваем датчик с заданным интервалом
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        profiler::record(profileScope, profiler::nowMicros() - start);
     }
 }
 
@@ -169,6 +474,7 @@ void taskCore1_MPU(void *pvParameters) {
  */
 void setupRtos() {
     Serial.println("[RTOS] RTOS setup started.");
+    profiler::init();
 
     // Создаем мьютекс
     bufferMutex = xSemaphoreCreateMutex();
@@ -178,6 +484,33 @@ void setupRtos() {
         while(true);
     }
 
+    featureQueue = xQueueCreate(FEATURE_QUEUE_LENGTH, sizeof(features::WindowFeatures));
+    if (featureQueue == NULL) {
+        Serial.println("[RTOS] Error creating feature queue!");
+        while(true);
+    }
+
+    // eventfd для пробуждения задачи MQTT; без него она просыпается только по сокету и дедлайнам
+    esp_vfs_eventfd_config_t eventfdConfig = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+    if (esp_vfs_eventfd_register(&eventfdConfig) != ESP_OK || (mqttWakeFd = eventfd(0, 0)) < 0) {
+        Serial.println("[RTOS] Error creating eventfd, MQTT task falls back to deadlines.");
+        mqttWakeFd = -1;
+    }
+    // Смена состояния Wi-Fi обрабатывается в mqtt::loop() сразу, а не по дедлайну
+    sta::onLinkChange([](bool) { wakeMqttTask(); });
+
+    // Таймер опроса MPU: точный период без дрейфа, задача спит между тиками
+    const esp_timer_create_args_t timerArgs = {
+        .callback = onSampleTimer,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "mpu_sample"
+    };
+    if (esp_timer_create(&timerArgs, &sampleTimer) != ESP_OK) {
+        Serial.println("[RTOS] Error creating sample timer!");
+        while(true);
+    }
+
     // Создаем задачу MQTT на Ядре 0
     xTaskCreatePinnedToCore(
         taskCore0_MQTT,   // Функция задачи
@@ -199,6 +532,9 @@ void setupRtos() {
         &mpuTaskHandle,   
         1                 // Ядро 1
     );
+
+    // Запускаем только теперь: callback будит уже созданную задачу MPU
+    startSampleTimer();
 }
 
 } // namespace rtos
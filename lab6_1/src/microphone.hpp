@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include "driver/i2s.h"
+#include "profiler.hpp"
 
 namespace mic {
 
@@ -20,9 +21,16 @@ constexpr int RAM_REC_DURATION_S = 2;
 // --- CORRECTED: Buffer size now correctly accounts for 2 channels ---
 constexpr int RAM_BUFFER_SIZE = RAM_REC_DURATION_S * SAMPLE_RATE * (BITS_PER_SAMPLE / 8) * NUM_CHANNELS;
 
+// --- Plotter ---
+constexpr int DMA_BUF_LEN = 256;     // Frames per DMA buffer, one I2S_EVENT_RX_DONE each
+constexpr int PLOT_DECIMATION = 8;   // 8 kHz / 8 = 1 kHz, about what Serial at 115200 can carry
+
 static uint8_t ram_recording_buffer[RAM_BUFFER_SIZE];
 size_t ram_data_size = 0;
 volatile bool is_plotting = false;
+QueueHandle_t i2s_event_queue = NULL;
+TaskHandle_t plotter_task = NULL; // Woken by startPlotting()
+int plot_scope = -1;              // Profiler scope, registered by the plotter task
 
 bool setupMic() {
     Serial.println("[MIC] Initializing microphone...");
@@ -33,9 +41,9 @@ bool setupMic() {
         .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT, // This is required for ADC mode
         .communication_format = I2S_COMM_FORMAT_STAND_MSB,
         .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
-        .dma_buf_count = 8, .dma_buf_len = 256, .use_apll = false, .tx_desc_auto_clear = false, .fixed_mclk = 0
+        .dma_buf_count = 8, .dma_buf_len = DMA_BUF_LEN, .use_apll = false, .tx_desc_auto_clear = false, .fixed_mclk = 0
     };
-    if (i2s_driver_install(I2S_PORT, &i2s_config, 0, NULL) != ESP_OK) { return false; }
+    if (i2s_driver_install(I2S_PORT, &i2s_config, 4, &i2s_event_queue) != ESP_OK) { return false; }
     if (i2s_set_adc_mode(ADC_UNIT_1, ADC_CHANNEL) != ESP_OK) { return false; }
     if (i2s_adc_enable(I2S_PORT) != ESP_OK) { return false; }
     Serial.println("[MIC] Microphone initialized successfully.");
@@ -43,24 +51,42 @@ bool setupMic() {
 }
 
 // --- Plotting Functions ---
-void startPlotting() { is_plotting = true; Serial.println("[MIC] Plotter enabled."); }
+void startPlotting() {
+    if (i2s_event_queue != NULL) {
+        xQueueReset(i2s_event_queue); // Start from fresh buffers, not the backlog of old events
+    }
+    is_plotting = true;
+    Serial.println("[MIC] Plotter enabled.");
+    if (plotter_task != NULL) xTaskNotifyGive(plotter_task);
+}
 void stopPlotting() { is_plotting = false; Serial.println("[MIC] Plotter disabled."); }
 
 /**
- * @brief Reads a full stereo frame and prints only the left channel.
+ * @brief Waits for the next filled DMA buffer and prints its left channel, decimated.
+ * Blocks on the I2S event queue, so the caller wakes once per buffer instead of per frame.
  */
 void readAndPrintSignal() {
     if (!is_plotting) {
         return;
     }
-    uint16_t sample_buffer[2]; // Buffer for one full stereo frame (L+R = 4 bytes)
+    i2s_event_t event;
+    if (i2s_event_queue == NULL) {
+        vTaskDelay(pdMS_TO_TICKS(100)); // setupMic() failed: nothing will ever arrive
+        return;
+    }
+    if (xQueueReceive(i2s_event_queue, &event, pdMS_TO_TICKS(100)) != pdTRUE || event.type != I2S_EVENT_RX_DONE) {
+        return;
+    }
+    PROFILE_SCOPE(plot_scope); // One wakeup per DMA buffer
+    static uint16_t sample_buffer[DMA_BUF_LEN * NUM_CHANNELS]; // One DMA buffer of stereo frames
     size_t bytes_read = 0;
-    i2s_read(I2S_PORT, sample_buffer, sizeof(sample_buffer), &bytes_read, pdMS_TO_TICKS(100));
+    i2s_read(I2S_PORT, sample_buffer, sizeof(sample_buffer), &bytes_read, 0);
 
-    if (bytes_read > 0) {
+    size_t frames = bytes_read / (sizeof(uint16_t) * NUM_CHANNELS);
+    for (size_t i = 0; i < frames; i += PLOT_DECIMATION) {
         // Print the 12 bits of left channel sample
         Serial.print(">signal:");
-        Serial.println(sample_buffer[0] & 0x0FFF);
+        Serial.println(sample_buffer[i * NUM_CHANNELS] & 0x0FFF);
     }
 }
 
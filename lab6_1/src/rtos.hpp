@@ -4,36 +4,44 @@
 #include <Arduino.h>
 #include "web_server.hpp"
 #include "microphone.hpp"
+#include "profiler.hpp"
 
 namespace rtos {
 
 /**
- * @brief Task for Core 0: Web Server Request Handling.
- * This task continuously checks for incoming HTTP clients.
+ * @brief Task for Core 0: RAM recordings requested over HTTP.
+ * Requests themselves are served by the AsyncTCP task; this one sleeps until
+ * /record wakes it, so an idle server costs no wakeups at all.
  */
-void taskCore0_WebServer(void *pvParameters) {
+void taskCore0_Recorder(void*) {
     delay(10);
-    Serial.println("[RTOS] Web Server task on Core 0 started.");
+    Serial.println("[RTOS] Recorder task on Core 0 started.");
+    const int profileScope = profiler::registerScope("record");
     for (;;) {
-        web_server::handleClient();
-        // Give a small delay to prevent starving other low-priority tasks
-        vTaskDelay(pdMS_TO_TICKS(5)); 
+        // Woken by web_server::handleRecord()
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        PROFILE_SCOPE(profileScope); // One wakeup per recording
+        web_server::record();
     }
 }
 
 /**
  * @brief Task for Core 1: Real-time Microphone Plotting.
- * This task reads from the microphone and prints to Serial when plotting is enabled.
+ * Sleeps until plotting is enabled, then wakes once per filled I2S DMA buffer
+ * instead of polling every millisecond.
  */
 void taskCore1_MicPlotter(void *pvParameters) {
     delay(20);
     Serial.println("[RTOS] Mic Plotter task on Core 1 started.");
+    mic::plot_scope = profiler::registerScope("plot");
     for (;;) {
-        // This function will only read and print if the plotting flag is true
+        if (!mic::is_plotting) {
+            // Woken by mic::startPlotting()
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        // Blocks on the I2S event queue, which also lets the watchdog run
         mic::readAndPrintSignal();
-        
-        // A tiny delay is crucial to allow the watchdog timer to reset
-        vTaskDelay(pdMS_TO_TICKS(1));
     }
 }
 
@@ -43,15 +51,16 @@ void taskCore1_MicPlotter(void *pvParameters) {
  */
 void setupRtos() {
     Serial.println("[RTOS] RTOS setup started.");
+    profiler::init();
 
-    // Create and pin the Web Server task to Core 0
+    // Create and pin the Recorder task to Core 0
     xTaskCreatePinnedToCore(
-        taskCore0_WebServer,
-        "WebServer_Task",
-        8192,           // Stack size in words
+        taskCore0_Recorder,
+        "Recorder_Task",
+        4096,           // Stack size
         NULL,
         1,              // Priority
-        NULL,
+        &web_server::recorder_task,
         0               // Core ID
     );
 
@@ -62,7 +71,7 @@ void setupRtos() {
         4096,           // Stack size
         NULL,
         1,              // Priority
-        NULL,
+        &mic::plotter_task,
         1               // Core ID
     );
 }
@@ -1,16 +1,47 @@
 #ifndef WEB_SERVER_HPP
 #define WEB_SERVER_HPP
 
-#include <WebServer.h>
+#include <ESPAsyncWebServer.h>
 #include "microphone.hpp"
+#include "profiler.hpp"
 
+/**
+ * HTTP interface. Requests are handled in the AsyncTCP task as lwIP delivers
+ * them, so nothing polls for clients. A recording takes seconds of blocking
+ * I2S reads, which the AsyncTCP task must not do: /record only wakes
+ * Recorder_Task (see rtos.hpp) and redirects at once.
+ */
 namespace web_server {
 
-WebServer server(80);
+AsyncWebServer server(80);
+TaskHandle_t recorder_task = NULL; // Woken by /record
+volatile bool recording = false;   // From /record until Recorder_Task is done
+volatile bool record_mock = false;
+uint8_t downloads = 0;             // Responses still reading the RAM buffer (AsyncTCP task only)
+int web_scope = -1;                // Profiler scope of the request handlers
+
+/**
+ * @brief Times one request; the scope is registered by the AsyncTCP task, which owns it.
+ */
+int scope() {
+    if (web_scope < 0) web_scope = profiler::registerScope("web");
+    return web_scope;
+}
 
 // --- Plotter Handlers ---
-void handlePlotStart() { mic::startPlotting(); server.sendHeader("Location", "/", true); server.send(302, "text/plain", ""); }
-void handlePlotStop() { mic::stopPlotting(); server.sendHeader("Location", "/", true); server.send(302, "text/plain", ""); }
+void handlePlotStart(AsyncWebServerRequest* request) { PROFILE_SCOPE(scope()); mic::startPlotting(); request->redirect("/"); }
+void handlePlotStop(AsyncWebServerRequest* request) { PROFILE_SCOPE(scope()); mic::stopPlotting(); request->redirect("/"); }
+
+/**
+ * @brief Profiler report since the previous request: requests ("n" of web), recordings,
+ * DMA buffers plotted, time per wakeup, and the load of each core.
+ */
+void handleProfile(AsyncWebServerRequest* request) {
+    PROFILE_SCOPE(scope());
+    static char json[512];
+    profiler::toJson(json, sizeof(json));
+    request->send(200, "application/json", json);
+}
 
 // --- CORRECTED, FULLY COMPLIANT WAV HEADER GENERATION ---
 void createWavHeader(byte* header, uint32_t sampleRate, uint16_t bitsPerSample, uint16_t numChannels, uint32_t dataSize) {
@@ -32,46 +63,78 @@ void createWavHeader(byte* header, uint32_t sampleRate, uint16_t bitsPerSample,
     header[40] = (byte)(dataSize); header[41] = (byte)(dataSize >> 8); header[42] = (byte)(dataSize >> 16); header[43] = (byte)(dataSize >> 24);
 }
 
-void handleRecord() {
-    String mock = server.arg("mock");
-    if (mock == "1") mic::generateMockData();
+/**
+ * @brief Starts a recording in Recorder_Task, unless one is running or being downloaded.
+ */
+void handleRecord(AsyncWebServerRequest* request) {
+    PROFILE_SCOPE(scope());
+    if (!recording && downloads == 0 && recorder_task != NULL) {
+        record_mock = request->hasParam("mock") && request->getParam("mock")->value() == "1";
+        recording = true;
+        xTaskNotifyGive(recorder_task);
+    }
+    request->redirect("/");
+}
+
+/**
+ * @brief Fills the RAM buffer; runs in Recorder_Task.
+ */
+void record() {
+    if (record_mock) mic::generateMockData();
     else mic::recordToMemory();
-    server.sendHeader("Location", "/", true);
-    server.send(302, "text/plain", "");
+    recording = false;
 }
 
-void handleDownload() {
-    const uint8_t* buffer = mic::getRamBuffer();
+void handleDownload(AsyncWebServerRequest* request) {
+    PROFILE_SCOPE(scope());
     size_t size = mic::getRamBufferSize();
-    if (buffer && size > 0) {
-        byte header[44];
-        // --- CORRECTED: Pass the correct number of channels (2) to the header function ---
-        createWavHeader(header, mic::SAMPLE_RATE, mic::BITS_PER_SAMPLE, mic::NUM_CHANNELS, size);
-        
-        server.sendHeader("Content-Disposition", "attachment; filename=ram_recording.wav");
-        server.setContentLength(sizeof(header) + size);
-        server.send(200, "audio/wav", "");
-        server.sendContent((const char*)header, sizeof(header));
-        server.sendContent((const char*)buffer, size);
-    } else {
-        server.send(404, "text/plain", "No RAM recording found.");
+    if (recording || size == 0) {
+        request->send(404, "text/plain", "No RAM recording found.");
+        return;
     }
+    // Same for every download of this recording; the response streams it from here
+    static byte header[44];
+    // --- CORRECTED: Pass the correct number of channels (2) to the header function ---
+    createWavHeader(header, mic::SAMPLE_RATE, mic::BITS_PER_SAMPLE, mic::NUM_CHANNELS, size);
+
+    // Sent as the TCP window allows, straight from the RAM buffer
+    AsyncWebServerResponse* response = request->beginResponse("audio/wav", sizeof(header) + size,
+        [size](uint8_t* out, size_t maxLen, size_t index) -> size_t {
+            size_t n = 0;
+            if (index < sizeof(header)) {
+                n = min(maxLen, sizeof(header) - index);
+                memcpy(out, header + index, n);
+                if (n == maxLen) return n;
+            }
+            size_t offset = index + n - sizeof(header);
+            size_t rest = min(maxLen - n, size - offset);
+            memcpy(out + n, mic::getRamBuffer() + offset, rest);
+            return n + rest;
+        });
+    response->addHeader("Content-Disposition", "attachment; filename=ram_recording.wav");
+    downloads++;
+    request->onDisconnect([]() { downloads--; });
+    request->send(response);
 }
 
-void handleRoot() {
+void handleRoot(AsyncWebServerRequest* request) {
+    PROFILE_SCOPE(scope());
     String html = "<html><head><title>ESP32 Mic Control</title></head><body>";
     html += "<h1>ESP32 Microphone Interface</h1>";
     html += "<h3>RAM Recording</h3>";
     html += "<p><a href='/record?mock=0'>Record " + String(mic::RAM_REC_DURATION_S) + "s to RAM</a></p>";
     html += "<p><a href='/record?mock=1'>Generate Mock Data (Sine Wave 440 Hz)</a></p>";
-    if (mic::getRamBufferSize() > 0) {
+    if (recording) {
+        html += "<p><b>Recording...</b> Reload in a few seconds.</p>";
+    } else if (mic::getRamBufferSize() > 0) {
         html += "<p><b>RAM buffer has data!</b> <a href='/download'>Download RAM recording</a></p>";
     }
     html += "<hr><h3>Real-time Plotting</h3><p>Use Arduino IDE Serial Plotter (115200 baud).</p>";
     html += "<p><a href='/plot/start'>START Plotting</a></p>";
     html += "<p><a href='/plot/stop'>STOP Plotting</a></p>";
+    html += "<hr><p><a href='/profile'>Task profile</a> (wakeups and core load since the last visit)</p>";
     html += "</body></html>";
-    server.send(200, "text/html", html);
+    request->send(200, "text/html", html);
 }
 
 void setupServer() {
@@ -80,12 +143,11 @@ void setupServer() {
     server.on("/download", HTTP_GET, handleDownload);
     server.on("/plot/start", HTTP_GET, handlePlotStart);
     server.on("/plot/stop", HTTP_GET, handlePlotStop);
-    server.onNotFound([](){ server.send(404, "text/plain", "Not Found"); });
+    server.on("/profile", HTTP_GET, handleProfile);
+    server.onNotFound([](AsyncWebServerRequest* request) { request->send(404, "text/plain", "Not Found"); });
     server.begin();
     Serial.println("[WEB] Web server started.");
 }
 
-void handleClient() { server.handleClient(); }
-
 } // namespace web_server
 #endif // WEB_SERVER_HPP
\ No newline at end of file
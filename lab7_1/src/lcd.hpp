@@ -4,6 +4,7 @@
 #include <Arduino.h>
 #include <Wire.h>
 #include <LiquidCrystal_I2C.h>
+#include "frame_buffer.hpp"
 
 namespace lcd {
 
@@ -14,6 +15,9 @@ const bool print_to_serial = true;
 // Adjust 0x27 to 0x3F if your screen doesn't work
 LiquidCrystal_I2C lcd(0x27, 16, 2);
 
+// Everything is drawn here; flush() sends only the characters that changed
+display::FrameBuffer<16, 2> frame(lcd);
+
 // Custom char: Hourglass / Clock icon
 byte clockChar[] = {
   0x1F, 0x11, 0x0A, 0x04, 0x04, 0x0A, 0x1F, 0x00
@@ -22,23 +26,27 @@ byte clockChar[] = {
 void init() {
     if (print_to_serial) Serial.println("[LCD] Initializing Display (Hardware)...");
     
-    lcd.init();
+    lcd.init(); // Also clears the panel
     lcd.backlight();
     lcd.createChar(0, clockChar);
-    
-    lcd.setCursor(0, 0);
-    lcd.print("Booting System..");
+    frame.blank();
+
+    frame.setLine(0, "Booting System..");
+    frame.flush();
     
     if (print_to_serial) Serial.println("[LCD SIM] Booting System...");
 }
 
+void clear() {
+    frame.clear();
+    frame.flush();
+}
+
 void printStatus(String line1, String line2) {
-    // Hardware
-    lcd.clear();
-    lcd.setCursor(0, 0);
-    lcd.print(line1);
-    lcd.setCursor(0, 1);
-    lcd.print(line2);
+    // Hardware: no clear(), unchanged characters are not resent
+    frame.setLine(0, line1.c_str());
+    frame.setLine(1, line2.c_str());
+    frame.flush();
 
     // Serial Simulation
     if (print_to_serial) {
@@ -54,24 +62,22 @@ void printStatus(String line1, String line2) {
  */
 void updateCountdown(int days, int hours, int minutes, int seconds, int targetYear) {
     // Hardware
-    lcd.setCursor(0, 0);
-    lcd.write(0); // Clock icon
-    lcd.print(" ");
-    lcd.print(targetYear);
-    lcd.print(" in ");
-    lcd.setCursor(0, 1);
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "  %d in", targetYear);
+    frame.setLine(0, buffer);
+    frame.put(0, 0, 0); // Clock icon
 
     if (days >= 1000) {
-        lcd.print("too far away :)");
+        frame.setLine(1, "too far away :)");
+        frame.flush();
         if (print_to_serial) {
             Serial.printf(" New Year %d is too far away :)\r", targetYear);
         }
         return;
     }
-    char buffer[17]; 
     snprintf(buffer, sizeof(buffer), "%3dd %02d:%02d:%02d", days, hours, minutes, seconds);
-
-    lcd.print(buffer);
+    frame.setLine(1, buffer);
+    frame.flush(); // Usually just the seconds digits
 
     // Serial Simulation
     if (print_to_serial) {
@@ -82,12 +88,12 @@ void updateCountdown(int days, int hours, int minutes, int seconds, int targetYe
 
 void showHappyNewYear(int year) {
     // Hardware
-    lcd.clear();
-    lcd.setCursor(2, 0);
-    lcd.print("HAPPY  NEW");
-    lcd.setCursor(4, 1);
-    lcd.print("YEAR ");
-    lcd.print(year);
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "YEAR %d", year);
+    frame.clear();
+    frame.print(2, 0, "HAPPY  NEW");
+    frame.print(4, 1, buffer);
+    frame.flush();
 
     // Serial Simulation
     if (print_to_serial) {
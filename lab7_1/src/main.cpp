@@ -12,40 +12,36 @@ void setup() {
     // 1. Init LCD
     lcd::init();
 
-    // 2. Connect WiFi
+    // 2. Connect WiFi (sta keeps retrying in the background if this times out)
     lcd::printStatus("Connecting to", "WiFi Network");
     if (!sta::connect_to_wifi()) {
-        lcd::printStatus("WiFi Failed", "Check Credentials");
-        while(1) delay(1000);
+        lcd::printStatus("WiFi Failed", "Retrying...");
+        delay(2000);
     }
 
-    // 3. Sync Time
+    // 3. Sync Time: in the background, the countdown starts once the clock is set
     lcd::printStatus("Syncing Time on", "NTP Server");
     ntp::init();
-    
-    // Wait for time sync
-    int retry = 0;
-    while (!ntp::isTimeSet() && retry < 20) {
+}
+
+bool time_shown = false;
+
+void loop() {
+    // 0. Wait for the clock without blocking setup(): NTP, or the time saved before a reboot
+    if (!ntp::isTimeSet()) {
         delay(500);
-        Serial.print(".");
-        retry++;
+        return;
     }
-    
-    if (ntp::isTimeSet()) {
-        Serial.println("\n[MAIN] Time synchronized.");
+    if (!time_shown) {
+        time_shown = true;
         struct tm current_tm = ntp::getCurrentTime();
-        Serial.printf("[MAIN] Current Local Time: %04d-%02d-%02d %02d:%02d:%02d\n", 
+        Serial.printf("[MAIN] Current Local Time: %04d-%02d-%02d %02d:%02d:%02d (%s)\n", 
                         current_tm.tm_year + 1900, current_tm.tm_mon + 1, current_tm.tm_mday,
-                        current_tm.tm_hour, current_tm.tm_min, current_tm.tm_sec);
-        lcd::printStatus("Ready!", "Starting Timer");
-        delay(2000);
-        lcd::lcd.clear();
-    } else {
-        lcd::printStatus("NTP Error", "Retrying...");
+                        current_tm.tm_hour, current_tm.tm_min, current_tm.tm_sec,
+                        timesync::stateName(timesync::quality().state));
+        lcd::clear();
     }
-}
 
-void loop() {
     // 1. Get current time
     time_t now;
     time(&now); // Get current timestamp (seconds since epoch)
@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include <time.h>
+#include "timesync.hpp"
 
 namespace ntp {
 
@@ -13,24 +14,20 @@ const char* timeZone = "MSK-3";
 
 void init() {
     Serial.println("[NTP] Setting up time...");
-    // Config time with specific timezone string
-    configTzTime(timeZone, ntpServer);
+    // Sets the timezone and syncs in the background (lib/timesync); returns at once
+    timesync::begin(ntpServer, timeZone);
 }
 
 bool isTimeSet() {
-    struct tm timeinfo;
-    if (!getLocalTime(&timeinfo)) {
-        return false;
-    }
-    // Simple check: if year is less than 2020, time hasn't synced
-    return (timeinfo.tm_year + 1900) > 2020;
+    // Synced, in holdover, or restored from before the reboot
+    return timesync::valid();
 }
 
 struct tm getCurrentTime() {
     struct tm timeinfo;
-    getLocalTime(&timeinfo);
+    getLocalTime(&timeinfo, 0);
     return timeinfo;
 }
 
 } // namespace ntp
-#endif // NTP_HPP
\ No newline at end of file
+#endif // NTP_HPP
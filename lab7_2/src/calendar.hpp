@@ -0,0 +1,363 @@
+#ifndef CALENDAR_HPP
+#define CALENDAR_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+
+/**
+ * Recurring events and their upcoming order.
+ *
+ * An Event is a fixed 32-byte record (events.hpp stores them as is) with a
+ * recurrence rule: once, yearly, monthly, weekly or the nth/last weekday of a
+ * month. Dates are searched with day-number arithmetic; only the chosen date
+ * goes through mktime() for its local midnight.
+ *
+ * Schedule keeps the next occurrence of every event and the events sorted by
+ * it, so the next upcoming one is the first entry. Only an event whose
+ * occurrence has passed is recomputed and moved back into place; everything
+ * is recomputed after a TZ change or when the clock was set back. No Arduino
+ * calls: it also builds on a PC (see tools/calendarbench).
+ */
+namespace calendar {
+
+const size_t max_events = 250;  // Event indices are uint8_t in tags (0xFF: no event)
+const size_t name_length = 23;
+const int8_t last = -1;         // nth: the last such weekday of the month
+const long no_date = -2147483647L;
+
+enum class Repeat : uint8_t {
+    Unused,      // Free slot
+    Once,        // day.month.year
+    Yearly,      // day.month; 29.02 only in leap years
+    Monthly,     // day, clamped to the last day of shorter months
+    Weekly,      // weekday
+    NthWeekday   // nth (or last) weekday of month, or of every month if month is 0
+};
+
+struct Event {
+    char name[name_length + 1];
+    Repeat repeat;
+    uint8_t day;       // Once, Yearly, Monthly: 1-31
+    uint8_t month;     // Once, Yearly: 1-12; NthWeekday: 0-12
+    uint8_t weekday;   // Weekly, NthWeekday: 0 = Sunday
+    int8_t nth;        // NthWeekday: 1-5, or last
+    uint8_t reserved;
+    uint16_t year;     // Once
+};
+static_assert(sizeof(Event) == 32, "Event is a 32-byte file record");
+
+const char* repeat_names[] = {"unused", "once", "yearly", "monthly", "weekly", "nth"};
+
+const char* repeatName(Repeat repeat) {
+    return (size_t)repeat < sizeof(repeat_names) / sizeof(repeat_names[0]) ? repeat_names[(size_t)repeat] : "?";
+}
+
+/**
+ * @return false for unknown names (and "unused").
+ */
+bool parseRepeat(const char* text, Repeat& out) {
+    for (size_t i = 1; i < sizeof(repeat_names) / sizeof(repeat_names[0]); i++) {
+        if (strcmp(text, repeat_names[i]) == 0) {
+            out = (Repeat)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// --- Day numbers: days since 1970-01-01 in the proleptic Gregorian calendar ---
+struct Date {
+    int year;
+    int month;  // 1-12
+    int day;    // 1-31
+};
+
+bool isLeap(int year) {
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+int daysInMonth(int year, int month) {
+    static const uint8_t days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    return month == 2 && isLeap(year) ? 29 : days[month - 1];
+}
+
+long daysFromCivil(int year, int month, int day) {
+    year -= month <= 2;
+    long era = (year >= 0 ? year : year - 399) / 400;
+    unsigned year_of_era = (unsigned)(year - era * 400);
+    unsigned day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    unsigned day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + (long)day_of_era - 719468;
+}
+
+Date civilFromDays(long days) {
+    days += 719468;
+    long era = (days >= 0 ? days : days - 146096) / 146097;
+    unsigned day_of_era = (unsigned)(days - era * 146097);
+    unsigned year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    unsigned day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    unsigned mp = (5 * day_of_year + 2) / 153;
+    Date date;
+    date.day = day_of_year - (153 * mp + 2) / 5 + 1;
+    date.month = mp < 10 ? mp + 3 : mp - 9;
+    date.year = (int)(year_of_era + era * 400) + (date.month <= 2);
+    return date;
+}
+
+/**
+ * @return 0 = Sunday (1970-01-01 was a Thursday).
+ */
+int weekdayOf(long days) {
+    return days >= -4 ? (days + 4) % 7 : (days + 5) % 7 + 6;
+}
+
+/**
+ * @return The nth (or last) weekday of the month, or no_date if the month has no such day.
+ */
+long nthWeekday(int year, int month, int weekday, int nth) {
+    if (nth == last) {
+        long last_day = daysFromCivil(year, month, daysInMonth(year, month));
+        return last_day - (weekdayOf(last_day) - weekday + 7) % 7;
+    }
+    long first = daysFromCivil(year, month, 1);
+    long offset = (weekday - weekdayOf(first) + 7) % 7 + 7 * (nth - 1);
+    return offset < daysInMonth(year, month) ? first + offset : no_date;
+}
+
+bool validate(const Event& event) {
+    if (event.name[0] == '\0' || memchr(event.name, '\0', sizeof(event.name)) == NULL) return false;
+    switch (event.repeat) {
+    case Repeat::Once:
+        return event.year >= 1970 && event.year <= 2099 && event.month >= 1 && event.month <= 12 &&
+               event.day >= 1 && event.day <= daysInMonth(event.year, event.month);
+    case Repeat::Yearly:
+        return event.month >= 1 && event.month <= 12 && event.day >= 1 && event.day <= daysInMonth(2000, event.month);
+    case Repeat::Monthly:
+        return event.day >= 1 && event.day <= 31;
+    case Repeat::Weekly:
+        return event.weekday <= 6;
+    case Repeat::NthWeekday:
+        return event.weekday <= 6 && event.month <= 12 && (event.nth == last || (event.nth >= 1 && event.nth <= 5));
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief First day (a day number) on or after from that matches the rule.
+ * @return no_date if there is none (a date in the past, an unused slot).
+ */
+long nextDate(const Event& event, long from) {
+    Date today = civilFromDays(from);
+    switch (event.repeat) {
+    case Repeat::Once: {
+        long day = daysFromCivil(event.year, event.month, event.day);
+        return day >= from ? day : no_date;
+    }
+    case Repeat::Yearly:
+        // 29.02 may be 8 years away (2096 -> 2104)
+        for (int year = today.year; year <= today.year + 8; year++) {
+            if (event.day > daysInMonth(year, event.month)) continue;
+            long day = daysFromCivil(year, event.month, event.day);
+            if (day >= from) return day;
+        }
+        return no_date;
+    case Repeat::Monthly:
+        for (int i = 0; i < 2; i++) {
+            int year = today.year + (today.month - 1 + i) / 12;
+            int month = (today.month - 1 + i) % 12 + 1;
+            long day = daysFromCivil(year, month, std::min<int>(event.day, daysInMonth(year, month)));
+            if (day >= from) return day;
+        }
+        return no_date;
+    case Repeat::Weekly:
+        return from + (event.weekday - weekdayOf(from) + 7) % 7;
+    case Repeat::NthWeekday:
+        // A fifth weekday in February can be 40 years away (across 2100)
+        for (int i = 0; i < 12 * 41; i++) {
+            int year = today.year + (today.month - 1 + i) / 12;
+            int month = (today.month - 1 + i) % 12 + 1;
+            if (event.month != 0 && month != event.month) continue;
+            long day = nthWeekday(year, month, event.weekday, event.nth);
+            if (day != no_date && day >= from) return day;
+        }
+        return no_date;
+    default:
+        return no_date;
+    }
+}
+
+/**
+ * @brief Next occurrence at local midnight; today's counts until it has passed.
+ * @return false if the event has no occurrence left.
+ */
+bool nextOccurrence(const Event& event, time_t now, time_t* at, int* year) {
+    struct tm local;
+    localtime_r(&now, &local);
+    long from = daysFromCivil(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday);
+    for (int i = 0; i < 2; i++) {
+        long day = nextDate(event, from);
+        if (day == no_date) return false;
+        Date date = civilFromDays(day);
+        struct tm target = {};
+        target.tm_mday = date.day;
+        target.tm_mon = date.month - 1;
+        target.tm_year = date.year - 1900;
+        target.tm_isdst = -1; // Auto-detect DST
+        time_t timestamp = mktime(&target);
+        if (timestamp >= now) {
+            *at = timestamp;
+            *year = date.year;
+            return true;
+        }
+        from = day + 1; // Today's midnight has passed
+    }
+    return false;
+}
+
+/**
+ * @brief Next occurrences of up to N events, kept in upcoming order.
+ */
+template <size_t N>
+class Schedule {
+    static_assert(N <= 0xFFFF, "order holds 16-bit indices");
+
+public:
+    struct Entry {
+        time_t at;     // Local midnight of the next occurrence
+        int16_t year;
+        bool none;     // Unused slot, or no occurrence left
+    };
+
+    uint32_t recomputed = 0; // nextOccurrence() calls, for the benchmark
+
+    /**
+     * @brief Moves the events whose occurrence has passed to their next one.
+     */
+    void update(const Event* events, time_t now) {
+        if (stale || now < valid_from) { // Also when the clock was set back
+            rebuild(events, now);
+            return;
+        }
+        while (scheduled > 0 && now > entries[order[0]].at) {
+            uint16_t index = order[0];
+            take(0);
+            compute(events, index, now);
+            insert(index);
+            valid_from = now;
+        }
+    }
+
+    /**
+     * @brief Recomputes one event after it was edited, added or removed.
+     */
+    void reschedule(const Event* events, size_t index, time_t now) {
+        if (stale || index >= N) return; // The next update() rebuilds everything
+        for (size_t i = 0; i < N; i++) {
+            if (order[i] == index) {
+                take(i);
+                break;
+            }
+        }
+        compute(events, index, now);
+        insert(index);
+    }
+
+    /**
+     * @brief Drops every occurrence if the TZ rules changed since the last call.
+     */
+    void checkZone() {
+        const char* tz = getenv("TZ");
+        if (tz == NULL) tz = "";
+        if (strncmp(tz, zone, sizeof(zone)) != 0) {
+            strncpy(zone, tz, sizeof(zone) - 1);
+            zone[sizeof(zone) - 1] = '\0';
+            stale = true;
+        }
+    }
+
+    void invalidate() { stale = true; }
+
+    /**
+     * @return The number of events with an upcoming occurrence.
+     */
+    size_t size() const { return scheduled; }
+
+    /**
+     * @return The event at rank (0: the next upcoming one), rank < size().
+     */
+    size_t next(size_t rank) const { return order[rank]; }
+
+    /**
+     * @return The rank of an event, or -1 if it has no upcoming occurrence.
+     */
+    int rankOf(size_t index) const {
+        for (size_t i = 0; i < scheduled; i++) {
+            if (order[i] == index) return i;
+        }
+        return -1;
+    }
+
+    const Entry& entry(size_t index) const { return entries[index]; }
+
+private:
+    void rebuild(const Event* events, time_t now) {
+        for (size_t i = 0; i < N; i++) {
+            compute(events, i, now);
+            order[i] = i;
+        }
+        std::sort(order, order + N, [this](uint16_t a, uint16_t b) { return earlier(a, b); });
+        scheduled = 0;
+        while (scheduled < N && !entries[order[scheduled]].none) scheduled++;
+        valid_from = now;
+        stale = false;
+    }
+
+    void compute(const Event* events, size_t index, time_t now) {
+        Entry& entry = entries[index];
+        time_t at = 0;
+        int year = 0;
+        entry.none = events[index].repeat == Repeat::Unused || !nextOccurrence(events[index], now, &at, &year);
+        entry.at = at;
+        entry.year = year;
+        if (events[index].repeat != Repeat::Unused) recomputed++;
+    }
+
+    bool earlier(uint16_t a, uint16_t b) const {
+        const Entry& x = entries[a];
+        const Entry& y = entries[b];
+        if (x.none != y.none) return y.none;
+        if (!x.none && x.at != y.at) return x.at < y.at;
+        return a < b;
+    }
+
+    /**
+     * @brief Removes order[position]; order then holds N - 1 indices.
+     */
+    void take(size_t position) {
+        if (!entries[order[position]].none) scheduled--;
+        memmove(order + position, order + position + 1, (N - 1 - position) * sizeof(order[0]));
+    }
+
+    void insert(uint16_t index) {
+        uint16_t* position = std::lower_bound(order, order + N - 1, index,
+                                              [this](uint16_t a, uint16_t b) { return earlier(a, b); });
+        memmove(position + 1, position, (order + N - 1 - position) * sizeof(order[0]));
+        *position = index;
+        if (!entries[index].none) scheduled++;
+    }
+
+    Entry entries[N] = {};
+    uint16_t order[N] = {};
+    size_t scheduled = 0;
+    time_t valid_from = 0;  // Every entry is the first occurrence at or after this time
+    bool stale = true;
+    char zone[48] = "";
+};
+
+} // namespace calendar
+#endif // CALENDAR_HPP
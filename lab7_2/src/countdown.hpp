@@ -0,0 +1,49 @@
+#ifndef COUNTDOWN_HPP
+#define COUNTDOWN_HPP
+
+#include <sys/time.h>
+#include <time.h>
+
+/**
+ * Countdown clock for event_manager, kept free of Arduino calls so it also
+ * builds on a PC (see tools/countdownbench).
+ *
+ * The current second comes from millis() anchored to the wall clock (Clock)
+ * instead of time(). The targets are kept by calendar::Schedule, which only
+ * recomputes an event's next occurrence once it has passed.
+ */
+namespace countdown {
+
+/**
+ * @brief Wall-clock seconds from millis(), re-anchored every anchor_interval_millis.
+ *
+ * Anchoring keeps the sub-second phase, so the seconds roll over together with
+ * the wall clock, and picks up NTP corrections within one interval.
+ */
+class Clock {
+public:
+    static const unsigned long anchor_interval_millis = 60000;
+
+    bool needsAnchor(unsigned long ms) const { return !anchored || ms - anchor_millis >= anchor_interval_millis; }
+
+    void anchor(const struct timeval& wall, unsigned long ms) {
+        anchor_time = wall.tv_sec;
+        anchor_millis = ms - wall.tv_usec / 1000;
+        anchored = true;
+    }
+
+    /**
+     * @brief Re-anchors on the next call, e.g. after the wall clock was stepped.
+     */
+    void reset() { anchored = false; }
+
+    time_t now(unsigned long ms) const { return anchor_time + (time_t)((ms - anchor_millis) / 1000); }
+
+private:
+    bool anchored = false;
+    time_t anchor_time = 0;
+    unsigned long anchor_millis = 0; // millis() at the start of second anchor_time
+};
+
+} // namespace countdown
+#endif // COUNTDOWN_HPP
@@ -0,0 +1,293 @@
+#ifndef DELTA_OTA_HPP
+#define DELTA_OTA_HPP
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <atomic>
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "ota_image.hpp"
+#include "update_progress.hpp"
+
+#if __has_include("credentials.h")
+#include "credentials.h"
+#endif
+#ifndef OTA_SIGNING_KEY
+#define OTA_SIGNING_KEY ""  // Empty: unsigned uploads are taken (digest still checked when there is one)
+#endif
+
+/**
+ * Delta and compressed firmware updates, next to ElegantOTA's full images.
+ *
+ * POST /delta takes a file made by tools/otadiff (multipart, as the /update
+ * page sends it):
+ *   otadiff diff old.bin new.bin patch.dlt [key]   # old.bin: the image running now
+ *   curl -F "file=@patch.dlt" http://<ip>/delta
+ * The patcher streams it as it arrives, reads the old image from the running
+ * partition and writes the new one into the other OTA slot (ota_image.hpp:
+ * whole sectors, block erases). A patch made against another image is refused
+ * before anything is written. "otadiff pack" makes a compressed full image
+ * that any running image accepts.
+ *
+ * The new image is hashed (SHA-256) on its way to flash. With OTA_SIGNING_KEY
+ * set (build flag or credentials.h) the upload must carry otadiff's trailer
+ * signed with the same key. The slot is read back and hashed again before the
+ * boot partition switches to it; esp_ota_set_boot_partition() then checks the
+ * image itself. Progress goes to update_progress.
+ *
+ * The upload handler runs in the AsyncTCP task and only copies the chunks into
+ * a queue. OTA_Task patches, erases, programs and verifies, so a 64 KB block
+ * erase never runs inside a network callback. When the queue is full, the
+ * handler waits for the writer and TCP flow control slows the sender down.
+ * handleDone() waits for the writer to verify before it answers.
+ *
+ * The board restarts restart_delay_millis after a good update, from run().
+ */
+namespace delta_ota {
+
+// --- Configuration ---
+const unsigned long restart_delay_millis = 1000;
+const char* signing_key = OTA_SIGNING_KEY;
+const size_t chunk_size = 1024;                           // Upload bytes per queue item
+const UBaseType_t queue_length = 16;                      // 16 KB between the upload and OTA_Task
+const TickType_t enqueue_wait = pdMS_TO_TICKS(5000);      // Writer stuck longer than this: give up
+const TickType_t finish_wait = pdMS_TO_TICKS(15000);      // Last sectors, read back and hash
+
+/**
+ * @brief The patcher's Old: the partition we are running from.
+ */
+class RunningImage {
+public:
+    const esp_partition_t* partition = NULL;
+
+    size_t size() const { return partition != NULL ? partition->size : 0; }
+
+    bool read(size_t offset, uint8_t* out, size_t length) {
+        return partition != NULL && esp_partition_read(partition, offset, out, length) == ESP_OK;
+    }
+};
+
+/**
+ * @brief The writer's Flash: the next OTA slot.
+ */
+class Slot {
+public:
+    const esp_partition_t* partition = NULL;
+
+    size_t size() const { return partition != NULL ? partition->size : 0; }
+
+    bool erase(size_t offset, size_t length) {
+        return esp_partition_erase_range(partition, offset, length) == ESP_OK;
+    }
+
+    bool write(size_t offset, const uint8_t* data, size_t length) {
+        return esp_partition_write(partition, offset, data, length) == ESP_OK;
+    }
+
+    bool read(size_t offset, uint8_t* out, size_t length) {
+        return esp_partition_read(partition, offset, out, length) == ESP_OK;
+    }
+};
+
+enum class Op : uint8_t { Start, Data, Finish, Cancel };
+
+struct Chunk {
+    Op op;
+    uint16_t length;
+    uint32_t upload;          // Items of an upload that already ended are dropped
+    uint8_t data[chunk_size];
+};
+
+// --- State Variables ---
+RunningImage running;
+Slot slot;
+ota_image::Receiver<RunningImage, Slot> receiver(running, slot);   // OTA_Task's own
+QueueHandle_t chunks = NULL;
+SemaphoreHandle_t finished = NULL;      // Given by OTA_Task once it handled Finish
+AsyncWebServerRequest* owner = NULL;    // The upload in progress (AsyncTCP task only)
+uint32_t last_upload = 0;
+std::atomic<uint32_t> active{0};        // Upload OTA_Task works on, 0 when it is idle
+std::atomic<bool> cancelled{false};     // Connection lost: OTA_Task drops the rest
+std::atomic<bool> succeeded{false};
+const char* const pending = "incomplete";
+const char* volatile failure = "";      // Written by OTA_Task, read once it gave `finished`
+unsigned long restart_at_millis = 0;
+bool restart_pending = false;
+
+void fail(const char* why) {
+    failure = why;
+    update_progress::end(false, why); // The head was never written: the slot cannot boot
+}
+
+/**
+ * @brief Checks the whole image and switches the boot partition to it.
+ */
+void complete() {
+    update_progress::verifying();
+    if (!receiver.finish(signing_key)) {
+        fail(receiver.failure());
+        return;
+    }
+    if (esp_ota_set_boot_partition(slot.partition) != ESP_OK) {
+        fail("not a bootable image");
+        return;
+    }
+    succeeded = true;
+    const ota_image::SectorWriter<Slot>::Stats& stats = receiver.writer.stats;
+    Serial.printf("[OTA] Delta: %s%s, %u erases, %u sectors programmed, into %s.\n",
+                  receiver.info().old_size ? "patch" : "compressed image", receiver.wasSigned() ? ", signed" : "",
+                  (unsigned)stats.erases, (unsigned)stats.programs, slot.partition->label);
+    update_progress::end(true);
+}
+
+void end(bool lost) {
+    if (failure == pending) {
+        if (lost) {
+            fail("connection lost");
+        } else {
+            complete();
+        }
+    }
+    active = 0;
+}
+
+/**
+ * @brief OTA_Task: all flash work of an upload, in the order the chunks arrived.
+ */
+void writerTask(void* parameter) {
+    static Chunk chunk; // Too big for the stack
+    uint32_t current = 0;
+    for (;;) {
+        xQueueReceive(chunks, &chunk, portMAX_DELAY);
+        if (chunk.op == Op::Start) {
+            current = chunk.upload;
+            failure = pending;
+            running.partition = esp_ota_get_running_partition();
+            slot.partition = esp_ota_get_next_update_partition(NULL);
+            receiver.reset();
+            if (slot.partition == NULL) receiver.error = ota_image::Error::Flash;
+        }
+        if (chunk.upload != current || active != current) continue;
+        switch (chunk.op) {
+            case Op::Start:
+                break;
+            case Op::Data:
+                if (failure == pending && !cancelled) {
+                    bool ok = receiver.feed(chunk.data, chunk.length);
+                    update_progress::advance(receiver.bytesReceived(), receiver.bytesWritten());
+                    if (!ok) fail(receiver.failure());
+                }
+                break;
+            case Op::Finish:
+                end(cancelled);
+                xSemaphoreGive(finished);
+                break;
+            case Op::Cancel:
+                end(true);
+                break;
+        }
+        // A lost connection whose Cancel did not fit in the queue
+        if (active == current && cancelled && uxQueueMessagesWaiting(chunks) == 0) end(true);
+    }
+}
+
+/**
+ * @brief Queues one item of the current upload for OTA_Task (AsyncTCP task only).
+ */
+bool enqueue(Op op, TickType_t wait, const uint8_t* data = NULL, size_t length = 0) {
+    static Chunk staging; // Kept off the AsyncTCP task's stack
+    staging.op = op;
+    staging.length = length;
+    staging.upload = last_upload;
+    if (length > 0) memcpy(staging.data, data, length);
+    return xQueueSend(chunks, &staging, wait) == pdTRUE;
+}
+
+/**
+ * @brief Upload chunks, in order, from the web server's task. They are copied to OTA_Task, never written here.
+ */
+void handleUpload(AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data, size_t length,
+                  bool final) {
+    if (index == 0) {
+        // One update at a time, and not while OTA_Task still works on the last one; answered in handleDone()
+        if (owner != NULL || restart_pending || active != 0 || chunks == NULL) return;
+        owner = request;
+        last_upload++;
+        active = last_upload;
+        cancelled = false;
+        succeeded = false;
+        xSemaphoreTake(finished, 0); // Given for an upload handleDone() stopped waiting for
+        update_progress::start("Delta", request->contentLength());
+        Serial.printf("[OTA] Delta update started: %s\n", filename.c_str());
+        enqueue(Op::Start, enqueue_wait);
+        request->onDisconnect([request] {
+            if (owner == request) {
+                cancelled = true;
+                enqueue(Op::Cancel, 0); // Only wakes OTA_Task; it also notices when the queue runs dry
+                owner = NULL;
+            }
+        });
+    }
+    if (owner != request || cancelled) return;
+
+    for (size_t offset = 0; offset < length; offset += chunk_size) {
+        size_t n = length - offset < chunk_size ? length - offset : chunk_size;
+        if (!enqueue(Op::Data, enqueue_wait, data + offset, n)) {
+            cancelled = true; // OTA_Task is stuck; handleDone() gives up too
+            return;
+        }
+    }
+    if (final) enqueue(Op::Finish, enqueue_wait);
+}
+
+void handleDone(AsyncWebServerRequest* request) {
+    if (owner != request) {
+        if (owner == NULL) {
+            request->send(400, "text/plain", "No update file");
+        } else {
+            request->send(409, "text/plain", "Another update is in progress");
+        }
+        return;
+    }
+    owner = NULL;
+    // OTA_Task programs the last sectors and reads the slot back; the reply needs its verdict
+    if (cancelled || xSemaphoreTake(finished, finish_wait) != pdTRUE) {
+        cancelled = true;
+        request->send(500, "text/plain", "Update failed: writer timed out");
+        return;
+    }
+    if (!succeeded) {
+        request->send(400, "text/plain", String("Update failed: ") + failure);
+        return;
+    }
+    request->send(200, "text/plain", "Update applied, restarting");
+    restart_at_millis = millis() + restart_delay_millis;
+    restart_pending = true;
+}
+
+void attach(AsyncWebServer& server) {
+    if (signing_key[0] == '\0') Serial.println("[OTA] No OTA_SIGNING_KEY: /delta takes unsigned images.");
+    chunks = xQueueCreate(queue_length, sizeof(Chunk));
+    finished = xSemaphoreCreateBinary();
+    // Core 1, next to loop(): AsyncTCP and Wi-Fi keep core 0
+    if (chunks == NULL || finished == NULL ||
+        xTaskCreatePinnedToCore(writerTask, "OTA_Task", 4096, NULL, 1, NULL, 1) != pdPASS) {
+        Serial.println("[OTA] Error creating the delta writer: /delta is off.");
+        chunks = NULL;
+    }
+    server.on("/delta", HTTP_POST, handleDone, handleUpload);
+}
+
+/**
+ * @brief Restarts into the new image once the reply has gone out.
+ */
+void run() {
+    if (restart_pending && (long)(millis() - restart_at_millis) >= 0) {
+        Serial.println("[OTA] Restarting...");
+        delay(100);
+        ESP.restart();
+    }
+}
+
+} // namespace delta_ota
+#endif // DELTA_OTA_HPP
@@ -0,0 +1,386 @@
+#ifndef DELTA_PATCH_HPP
+#define DELTA_PATCH_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef ARDUINO
+#include "esp_rom_crc.h"
+#endif
+
+/**
+ * Delta and compressed firmware images for delta_ota.hpp, kept free of Arduino
+ * calls so the host tool (tools/otadiff) makes and applies them with this code.
+ *
+ * A patch is a Header and a body. The body is a bsdiff-style list of records:
+ *
+ *   varint diff_length, varint extra_length, zigzag varint seek,
+ *   diff_length bytes, extra_length bytes
+ *
+ * The diff bytes are added to the old image from the old position on, the
+ * extra bytes are new, then seek moves the old position. Code that only moved
+ * differs from the old image in its addresses, so the diff bytes are mostly
+ * zeros. A compressed full image is a patch against an empty old image: one
+ * record of extra bytes.
+ *
+ * With flag_lzss the body is LZSS-compressed in groups of eight tokens behind
+ * a flag byte (bit set: match). A literal is one byte; a match is two, a 12-bit
+ * distance - 1 and a 4-bit length code (3 + code, 15: 18 + a varint). The
+ * 4 KB window bounds the patcher's RAM, whatever the image size.
+ */
+namespace delta {
+
+const uint32_t patch_magic = 0x31544C44; // "DLT1"
+const uint8_t flag_lzss = 0x01;
+const size_t window_bits = 12;
+const size_t window_size = 1 << window_bits;
+const size_t min_match = 3;
+const size_t long_match = 18;       // Length code 15: this plus a varint
+const size_t chunk_size = 256;      // Old image reads and new image writes
+
+struct Header {
+    uint32_t magic;
+    uint8_t flags;
+    uint8_t reserved[3];
+    uint32_t old_size;  // 0: full image
+    uint32_t old_crc;   // CRC32 of the image the patch applies to
+    uint32_t new_size;
+    uint32_t new_crc;
+};
+
+enum class Error : uint8_t {
+    None,
+    BadHeader,
+    WrongBase,    // The running image is not the one the patch was made against
+    BadRecord,    // A record reaches outside the old or the new image
+    Storage,      // Reading the old image or writing the new one failed
+    Truncated,
+    Corrupt       // The result does not match new_crc
+};
+
+inline const char* errorName(Error error) {
+    switch (error) {
+    case Error::None: return "ok";
+    case Error::BadHeader: return "not a patch";
+    case Error::WrongBase: return "made for another image";
+    case Error::BadRecord: return "bad record";
+    case Error::Storage: return "flash error";
+    case Error::Truncated: return "truncated";
+    case Error::Corrupt: return "CRC mismatch";
+    }
+    return "?";
+}
+
+inline uint32_t crc32(uint32_t crc, const uint8_t* data, size_t length) {
+#ifdef ARDUINO
+    return esp_rom_crc32_le(crc, data, length);
+#else
+    crc = ~crc; // Same as esp_rom_crc32_le() and zlib's crc32()
+    while (length--) {
+        crc ^= *data++;
+        for (int bit = 0; bit < 8; bit++) crc = crc >> 1 ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+#endif
+}
+
+/**
+ * @brief Streaming LZSS decoder: takes input as it comes, stops when out is full.
+ */
+class Lzss {
+public:
+    void reset() {
+        state = State::Flags;
+        pos = 0;
+        match_left = 0;
+    }
+
+    /**
+     * @brief Decodes from in (advanced) into out, up to capacity bytes.
+     * @return Bytes written; less than capacity only once the input is used up.
+     */
+    size_t decode(const uint8_t*& in, const uint8_t* end, uint8_t* out, size_t capacity) {
+        size_t n = 0;
+        while (n < capacity) {
+            if (match_left > 0) {
+                uint8_t b = window[(pos - distance) & (window_size - 1)];
+                window[pos++ & (window_size - 1)] = b;
+                out[n++] = b;
+                match_left--;
+                continue;
+            }
+            if (in == end) break;
+            uint8_t byte = *in++;
+            switch (state) {
+            case State::Flags:
+                flags = byte;
+                flag_bits = 8;
+                state = State::Token;
+                break;
+            case State::Token:
+                if (flags & 1) {
+                    low = byte;
+                    state = State::MatchHigh;
+                } else {
+                    window[pos++ & (window_size - 1)] = byte;
+                    out[n++] = byte;
+                    nextToken();
+                }
+                break;
+            case State::MatchHigh:
+                distance = (low | (byte & 0x0F) << 8) + 1;
+                if (byte >> 4 < 15) {
+                    match_left = min_match + (byte >> 4);
+                    nextToken();
+                } else {
+                    length = 0;
+                    shift = 0;
+                    state = State::Length;
+                }
+                break;
+            case State::Length:
+                length |= (uint32_t)(byte & 0x7F) << shift;
+                shift += 7;
+                if (!(byte & 0x80)) {
+                    match_left = long_match + length;
+                    nextToken();
+                }
+                break;
+            }
+        }
+        return n;
+    }
+
+    bool idle() const { return match_left == 0 && (state == State::Flags || state == State::Token); }
+
+private:
+    enum class State : uint8_t { Flags, Token, MatchHigh, Length };
+
+    uint8_t window[window_size];
+    State state = State::Flags;
+    uint8_t flags = 0, flag_bits = 0, low = 0, shift = 0;
+    uint32_t pos = 0;
+    uint32_t distance = 0, length = 0, match_left = 0;
+
+    void nextToken() {
+        flags >>= 1;
+        state = --flag_bits == 0 ? State::Flags : State::Token;
+    }
+};
+
+/**
+ * @brief Rebuilds the new image from the old one and a patch, streamed in any pieces.
+ *
+ * Old:  size_t size(); bool read(size_t offset, uint8_t* out, size_t length);
+ * Sink: bool begin(const Header&); bool write(const uint8_t* data, size_t length);
+ *
+ * begin() is called once the header is in and the old image checked against
+ * old_crc; the new image then goes to write() in chunk_size pieces, in order.
+ */
+template <typename Old, typename Sink>
+class Patcher {
+public:
+    Patcher(Old& old, Sink& sink) : old(old), sink(sink) {}
+
+    void reset() {
+        state = State::Header;
+        error = Error::None;
+        header_length = 0;
+        varint = 0;
+        shift = 0;
+        old_pos = 0;
+        old_buffered = 0;
+        out_length = 0;
+        written = 0;
+        crc = 0;
+        lzss.reset();
+    }
+
+    /**
+     * @return false once the patch has failed (see error).
+     */
+    bool feed(const uint8_t* data, size_t length) {
+        const uint8_t* end = data + length;
+        while (error == Error::None && state == State::Header && data < end) {
+            ((uint8_t*)&header)[header_length++] = *data++;
+            if (header_length == sizeof(header)) start();
+        }
+        if (error != Error::None) return false;
+        if (!(header.flags & flag_lzss)) return body(data, end - data);
+        uint8_t plain[chunk_size];
+        size_t n;
+        while (error == Error::None && (n = lzss.decode(data, end, plain, sizeof(plain))) > 0) body(plain, n);
+        return error == Error::None;
+    }
+
+    /**
+     * @brief Called after the last byte: flushes and checks the result.
+     */
+    bool finish() {
+        if (error != Error::None) return false;
+        bool complete = state == State::DiffLength && shift == 0 && written + out_length == header.new_size &&
+                        (!(header.flags & flag_lzss) || lzss.idle());
+        if (!complete) return fail(Error::Truncated);
+        if (!flush()) return false;
+        if (crc != header.new_crc) return fail(Error::Corrupt);
+        state = State::Done;
+        return true;
+    }
+
+    bool done() const { return state == State::Done; }
+    size_t bytesWritten() const { return written; }
+    const Header& info() const { return header; }
+
+    Error error = Error::None;
+
+private:
+    enum class State : uint8_t { Header, DiffLength, ExtraLength, Seek, Diff, Extra, Done };
+
+    Old& old;
+    Sink& sink;
+    Lzss lzss;
+    Header header = {};
+    size_t header_length = 0;
+    State state = State::Header;
+    uint32_t varint = 0;
+    uint8_t shift = 0;
+    uint32_t diff_left = 0, extra_left = 0;
+    size_t old_pos = 0;
+    size_t seek_to = 0;                       // Old position once the record is done
+    uint8_t old_buffer[chunk_size];
+    size_t old_start = 0, old_buffered = 0;   // old_buffer holds [old_start, old_start + old_buffered)
+    uint8_t out[chunk_size];
+    size_t out_length = 0;
+    size_t written = 0;
+    uint32_t crc = 0;
+
+    bool fail(Error e) {
+        error = e;
+        return false;
+    }
+
+    void start() {
+        if (header.magic != patch_magic || header.new_size == 0 || header.old_size > old.size()) {
+            fail(Error::BadHeader);
+            return;
+        }
+        // The whole old image once, before anything is written
+        uint32_t old_crc = 0;
+        for (size_t offset = 0; offset < header.old_size; offset += chunk_size) {
+            size_t n = header.old_size - offset < chunk_size ? header.old_size - offset : chunk_size;
+            if (!old.read(offset, old_buffer, n)) {
+                fail(Error::Storage);
+                return;
+            }
+            old_crc = crc32(old_crc, old_buffer, n);
+        }
+        old_buffered = 0;
+        if (old_crc != header.old_crc) {
+            fail(Error::WrongBase);
+            return;
+        }
+        if (!sink.begin(header)) {
+            fail(Error::Storage);
+            return;
+        }
+        state = State::DiffLength;
+    }
+
+    bool flush() {
+        if (out_length == 0) return true;
+        if (!sink.write(out, out_length)) return fail(Error::Storage);
+        crc = crc32(crc, out, out_length);
+        written += out_length;
+        out_length = 0;
+        return true;
+    }
+
+    bool emit(uint8_t byte) {
+        out[out_length++] = byte;
+        return out_length < sizeof(out) || flush();
+    }
+
+    bool oldByte(uint8_t& byte) {
+        if (old_pos < old_start || old_pos >= old_start + old_buffered) {
+            size_t n = header.old_size - old_pos < chunk_size ? header.old_size - old_pos : chunk_size;
+            if (!old.read(old_pos, old_buffer, n)) return fail(Error::Storage);
+            old_start = old_pos;
+            old_buffered = n;
+        }
+        byte = old_buffer[old_pos++ - old_start];
+        return true;
+    }
+
+    /**
+     * @brief Takes one varint byte.
+     * @return true when the number is complete (in varint).
+     */
+    bool varintByte(uint8_t byte) {
+        if (shift == 0) varint = 0;
+        varint |= (uint32_t)(byte & 0x7F) << shift;
+        shift += 7;
+        if (byte & 0x80) {
+            if (shift > 28) fail(Error::BadRecord);
+            return false;
+        }
+        shift = 0;
+        return true;
+    }
+
+    bool body(const uint8_t* data, size_t length) {
+        for (size_t i = 0; i < length && error == Error::None; i++) {
+            uint8_t byte = data[i];
+            switch (state) {
+            case State::DiffLength:
+                if (varintByte(byte)) {
+                    diff_left = varint;
+                    state = State::ExtraLength;
+                }
+                break;
+            case State::ExtraLength:
+                if (varintByte(byte)) {
+                    extra_left = varint;
+                    if (old_pos + diff_left > header.old_size ||
+                        written + out_length + diff_left + extra_left > header.new_size) {
+                        return fail(Error::BadRecord);
+                    }
+                    state = State::Seek;
+                }
+                break;
+            case State::Seek:
+                if (varintByte(byte)) {
+                    int64_t seek = (varint >> 1) ^ -(int64_t)(varint & 1); // Zigzag
+                    int64_t target = (int64_t)old_pos + diff_left + seek;
+                    if (target < 0 || target > (int64_t)header.old_size) return fail(Error::BadRecord);
+                    seek_to = (size_t)target;
+                    state = diff_left ? State::Diff : extra_left ? State::Extra : State::DiffLength;
+                    if (state == State::DiffLength) old_pos = seek_to;
+                }
+                break;
+            case State::Diff: {
+                uint8_t base;
+                if (!oldByte(base) || !emit(base + byte)) return false;
+                if (--diff_left == 0) {
+                    state = extra_left ? State::Extra : State::DiffLength;
+                    if (state == State::DiffLength) old_pos = seek_to;
+                }
+                break;
+            }
+            case State::Extra:
+                if (!emit(byte)) return false;
+                if (--extra_left == 0) {
+                    old_pos = seek_to;
+                    state = State::DiffLength;
+                }
+                break;
+            default:
+                return fail(Error::BadRecord); // Bytes after the end
+            }
+        }
+        return error == Error::None;
+    }
+};
+
+} // namespace delta
+#endif // DELTA_PATCH_HPP
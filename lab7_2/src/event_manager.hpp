@@ -4,70 +4,80 @@
 #include <Arduino.h>
 #include <time.h>
 #include "lcd.hpp"
+#include "ntp.hpp"
 #include "rfid.hpp"
+#include "tags.hpp"
+#include "events.hpp"
+#include "countdown.hpp"
 
 namespace event_manager {
 
 // --- Configuration ---
 const int pin_boot_button = 0; // The "BOOT" button on ESP32 boards
 const unsigned long button_delay_millis = 300;
-const unsigned long run_interval_millis = 200;
+const int follow_next = -1;    // selected: show whichever event comes next
 
 // --- State Variables ---
-unsigned long previous_run_millis = 0;
 unsigned long previous_button_millis = 0;
-
-// --- Data Structures ---
-struct Event {
-    String name;        // e.g., "New Year"
-    int target_day;     // 1-31
-    int target_month;   // 1-12
-    String assignedUID; // The RFID tag ID linked to this event
-};
+time_t previous_render_time = 0;
+int previous_render_index = -1;
 
 // --- Events ---
-// Initially, no UIDs are assigned ("").
-Event events[] = {
-    {"New Year", 1, 1, ""}, // Jan 1st
-    {"Semester end", 29, 12, ""}, // Dec 29th
-    {"Winter exams", 14, 1, ""}, // Jan 14th
-    {"My birthday", 27, 7, ""}  // July 27th
-};
+// The calendar lives in events:: (LittleFS, editable over the web server) and
+// is kept in upcoming order by events::schedule. RFID tags are linked to
+// events in tags:: (persistent), by event slot.
+int selected = follow_next;
 
-const int EVENT_COUNT = sizeof(events) / sizeof(events[0]);
-int currentEventIndex = 0; // Default to the first event
+// The current second comes from millis(); the wall clock is read once a minute,
+// and at once when NTP_Task steps it
+countdown::Clock wall_clock;
+uint32_t clock_steps = 0;
+bool time_shown = false;
 
 // --- Initialization ---
 void init() {
     // GPIO 0 usually has an external pull-up, but internal doesn't hurt
     pinMode(pin_boot_button, INPUT_PULLUP);
+    // Tag bindings and the calendar survive reboots
+    tags::init();
+    events::init();
 }
 
-// --- Helper: Calculate Target Timestamp (Handles "Next Year" logic) ---
-time_t getNextTargetTimestamp(int day, int month) {
-    time_t now;
-    time(&now);
-    struct tm* current_tm = localtime(&now);
-
-    struct tm target_tm = {0};
-    target_tm.tm_hour = 0; target_tm.tm_min = 0; target_tm.tm_sec = 0;
-    target_tm.tm_isdst = -1; // Auto-detect DST
-    
-    target_tm.tm_mday = day;
-    target_tm.tm_mon  = month - 1; // struct tm uses 0-11 for months
-    
-    // 1. Assume the event is this year
-    target_tm.tm_year = current_tm->tm_year;
-    
-    time_t target_ts = mktime(&target_tm);
-
-    // 2. If the target is in the past, move it to next year
-    if (difftime(target_ts, now) < 0) {
-        target_tm.tm_year += 1;
-        target_ts = mktime(&target_tm);
+time_t currentTime() {
+    unsigned long current_millis = millis();
+    uint32_t steps = timesync::steps();
+    if (steps != clock_steps) {
+        clock_steps = steps;
+        wall_clock.reset();
+    }
+    if (wall_clock.needsAnchor(current_millis)) {
+        struct timeval wall;
+        gettimeofday(&wall, NULL);
+        wall_clock.anchor(wall, current_millis);
+        events::schedule.checkZone();
     }
-    
-    return target_ts;
+    return wall_clock.now(current_millis);
+}
+
+/**
+ * @return The slot on screen, or -1 if there is no upcoming event.
+ */
+int shownEvent() {
+    if (selected != follow_next && events::used(selected)) return selected;
+    return events::schedule.size() > 0 ? (int)events::schedule.next(0) : -1;
+}
+
+/**
+ * @brief Selects the event after the shown one, in upcoming order.
+ * @return Its rank (0: the next event), or -1 if there are no upcoming events.
+ */
+int selectFollowing() {
+    size_t upcoming = events::schedule.size();
+    if (upcoming == 0) return -1;
+    int rank = selected == follow_next ? 0 : events::schedule.rankOf(selected);
+    rank = (rank + 1) % upcoming; // An event without a date left starts over at the first one
+    selected = rank == 0 ? follow_next : (int)events::schedule.next(rank);
+    return rank;
 }
 
 // --- Logic: Handle Button Press ---
@@ -79,11 +89,12 @@ void checkButton() {
         if (current_millis - previous_button_millis >= button_delay_millis) {
             previous_button_millis = current_millis;
             
-            // Cycle to next event
-            currentEventIndex = (currentEventIndex + 1) % EVENT_COUNT;
+            // Cycle to the next event in upcoming order
+            int rank = selectFollowing();
+            if (rank < 0) return;
             
             lcd::showMessage("Switch by button", 
-                "#" + String(currentEventIndex + 1) + ": " + events[currentEventIndex].name, 1000, false
+                "#" + String(rank + 1) + ": " + events::list[shownEvent()].name, 1000, false
             );
         }
     }
@@ -91,79 +102,88 @@ void checkButton() {
 
 // --- Logic: Handle RFID Scans ---
 void processRFID() {
-    if (millis() < lcd::ui_message_unlock_time) return;
+    // Cards presented while a message is shown wait in rfid's queue
+    if (lcd::messageActive()) return;
+
+    tag_table::Uid uid;
+    if (!rfid::scanCard(uid)) return; // No card arrived
 
-    String newUID = rfid::scanCard();
-    
-    if (newUID == "") return; // No card detected
+    char hex[2 * tag_table::max_uid_length + 1];
+    rfid::toHex(uid, hex);
+    Serial.printf("[LOGIC] Scanned Tag: %s\n", hex);
 
-    Serial.println("[LOGIC] Scanned Tag: " + newUID);
-    
     // 1. Check if this tag is already known
-    for (int i = 0; i < EVENT_COUNT; i++) {
-        if (events[i].assignedUID == newUID) {
-            currentEventIndex = i;
-            Serial.println("[LOGIC] Known tag. Switching to: " + events[i].name);
-            lcd::showMessage("Mode Switched:", events[i].name, 1500);
+    int known = tags::find(uid);
+    if (known >= 0 && events::used(known)) {
+        selected = known;
+        Serial.printf("[LOGIC] Known tag. Switching to: %s\n", events::list[known].name);
+        lcd::showMessage("Mode Switched:", events::list[known].name, 1500);
+        return;
+    }
+
+    // 2. If unknown, link it to the soonest event without a tag
+    for (size_t rank = 0; rank < events::schedule.size(); rank++) {
+        size_t i = events::schedule.next(rank);
+        if (tags::countFor(i) == 0 && tags::bind(uid, i)) {
+            selected = i;
+            Serial.printf("[LOGIC] Learned new tag for: %s\n", events::list[i].name);
+            lcd::showMessage("Tag Linked!", events::list[i].name, 1500);
             return;
         }
     }
 
-    // 2. If unknown, look for an empty slot to assign it to
-    for (int i = 0; i < EVENT_COUNT; i++) {
-        if (events[i].assignedUID == "") {
-            events[i].assignedUID = newUID;
-            currentEventIndex = i;
-            Serial.println("[LOGIC] Learned new tag for: " + events[i].name);
-            lcd::showMessage("Tag Linked!", events[i].name, 1500);
-            return;
+    // 3. If all events have tags and this one is unknown, just cycle manually
+    if (selectFollowing() < 0) return;
+    lcd::showMessage("Cycling Mode...", events::list[shownEvent()].name, 1000);
+}
+
+// --- Logic: Apply calendar edits from the web server ---
+void applyEdits(time_t now) {
+    events::Edit edit;
+    while (events::poll(edit)) {
+        int slot = events::apply(edit, now);
+        if (slot >= 0 && slot == selected && edit.kind == events::EditKind::Remove) {
+            selected = follow_next;
         }
+        previous_render_index = -1; // Redraw: the shown event may have changed
     }
-    
-    // 3. If all slots full and tag is unknown, just cycle manually
-    currentEventIndex = (currentEventIndex + 1) % EVENT_COUNT;
-    lcd::showMessage("Cycling Mode...", events[currentEventIndex].name, 1000);
 }
 
 // --- Logic: Update Display ---
-void updateDisplay() {
-    // 1. Check if the UI is "Locked" by a previous message
-    if (millis() < lcd::ui_message_unlock_time) {
-        // Do not overwrite current message with the clock yet.
-        return; 
+void updateDisplay(time_t now) {
+    events::schedule.update(events::list, now);
+    int shown = shownEvent();
+
+    // Render once per second, or right away when the event changes.
+    // A message on screen takes priority in the display task, which shows
+    // the latest countdown once the message expires.
+    if (now == previous_render_time && shown == previous_render_index) {
+        return;
     }
+    previous_render_time = now;
+    previous_render_index = shown;
 
-    // 2. Only update clock every 200ms
-    if (millis() - previous_run_millis < run_interval_millis) {
+    if (shown < 0) {
+        lcd::printStatus("No events", "Add at /events");
+        return;
+    }
+    const calendar::Event& e = events::list[shown];
+    const auto& target = events::schedule.entry(shown);
+    if (target.none) {
+        lcd::printStatus("No dates left", e.name);
         return;
     }
-    time_t now;
-    time(&now);
-    
-    Event& e = events[currentEventIndex];
-    time_t target = getNextTargetTimestamp(e.target_day, e.target_month);
-    double diff = difftime(target, now);
-    
-    // Calculate display year
-    struct tm* target_struct = localtime(&target);
-    int targetYear = target_struct->tm_year + 1900;
+    long diff = (long)(target.at - now);
 
     if (diff > 0) {
-        long rem = (long)diff;
+        long rem = diff;
         int d = rem / 86400; rem %= 86400;
         int h = rem / 3600;  rem %= 3600;
         int m = rem / 60;
         int s = rem % 60;
-        
-        char line1[21];
-        char line2[21];
-        
-        // Format: "Name       2026"
-        snprintf(line1, 20, "%-14s %d", e.name.c_str(), targetYear);
-        // Format: "in 123d 12:00:00"
-        snprintf(line2, 20, "in %3dd %02d:%02d:%02d", d, h, m, s);
-        
-        lcd::printStatus(String(line1), String(line2), true);
+
+        // Formatted by the display task
+        lcd::showCountdown(e.name, target.year, d, h, m, s);
     } else {
         lcd::printStatus("EVENT REACHED!", e.name, true);
     }
@@ -171,9 +191,24 @@ void updateDisplay() {
 
 // --- Main Public Function ---
 void run() {
+    // Until NTP (or the time saved before a reboot) sets the clock there is nothing to count down to
+    if (!ntp::isTimeSet()) {
+        lcd::printStatus("Syncing Time by NTP", ntp::server);
+        return;
+    }
+    if (!time_shown) {
+        time_shown = true;
+        struct tm current_tm = ntp::getCurrentTime();
+        Serial.printf("[MAIN] Current Local Time: %04d-%02d-%02d %02d:%02d:%02d (%s)\n",
+                      current_tm.tm_year + 1900, current_tm.tm_mon + 1, current_tm.tm_mday,
+                      current_tm.tm_hour, current_tm.tm_min, current_tm.tm_sec,
+                      timesync::stateName(timesync::quality().state));
+    }
+    time_t now = currentTime();
     checkButton();
     processRFID();
-    updateDisplay();
+    applyEdits(now);
+    updateDisplay(now);
 }
 
 } // namespace event_manager
@@ -0,0 +1,288 @@
+#ifndef EVENTS_HPP
+#define EVENTS_HPP
+
+#include <Arduino.h>
+#include "FS.h"
+#include <LittleFS.h>
+#include <ESPAsyncWebServer.h>
+#include "esp_rom_crc.h"
+#include "calendar.hpp"
+#include "tags.hpp"
+
+/**
+ * The event calendar, on LittleFS.
+ *
+ * Events live in fixed slots; the slot is the index that tags are bound to,
+ * so deleting an event frees its slot without moving the others. The file is
+ * a header, one 32-byte calendar::Event per slot up to the last one in use
+ * and a CRC32, rewritten through a temporary file and a rename on every edit.
+ * A missing or damaged file falls back to the built-in events.
+ *
+ * The web server (ota.hpp) lists the events at GET /events and queues edits
+ * from POST /events and POST /events/delete without waiting; loop() applies
+ * them with poll() and apply(), so only one task ever changes the calendar.
+ */
+namespace events {
+
+// --- Configuration ---
+const char* path = "/events.bin";
+const char* tmpPath = "/events.tmp";
+const uint32_t file_magic = 0x31545645; // "EVT1"
+const size_t queue_length = 8;
+
+const calendar::Event defaults[] = {
+    {"New Year", calendar::Repeat::Yearly, 1, 1},       // Jan 1st
+    {"Semester end", calendar::Repeat::Yearly, 29, 12}, // Dec 29th
+    {"Winter exams", calendar::Repeat::Yearly, 14, 1},  // Jan 14th
+    {"My birthday", calendar::Repeat::Yearly, 27, 7},   // July 27th
+};
+
+struct Header {
+    uint32_t magic;
+    uint16_t count;     // Records (slots) that follow
+    uint16_t reserved;
+};
+
+enum class EditKind : uint8_t {
+    Put,    // Add (slot -1: the first free one) or replace
+    Remove
+};
+
+struct Edit {
+    EditKind kind;
+    int16_t slot;
+    calendar::Event event;
+};
+
+// --- State Variables ---
+calendar::Event list[calendar::max_events] = {};
+calendar::Schedule<calendar::max_events> schedule;
+SemaphoreHandle_t lock = NULL;  // list: written by loop(), read by the web server
+QueueHandle_t queue = NULL;
+
+bool used(size_t slot) {
+    return slot < calendar::max_events && list[slot].repeat != calendar::Repeat::Unused;
+}
+
+size_t count() {
+    size_t n = 0;
+    for (size_t i = 0; i < calendar::max_events; i++) n += used(i);
+    return n;
+}
+
+size_t slotsInUse() {
+    size_t n = calendar::max_events;
+    while (n > 0 && !used(n - 1)) n--;
+    return n;
+}
+
+bool load() {
+    File file = LittleFS.open(path, FILE_READ);
+    if (!file) {
+        return false;
+    }
+    Header header;
+    uint32_t stored_crc = 0;
+    bool ok = file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) && header.magic == file_magic &&
+              header.count <= calendar::max_events;
+    if (ok) {
+        size_t bytes = header.count * sizeof(calendar::Event);
+        ok = file.read((uint8_t*)list, bytes) == bytes &&
+             file.read((uint8_t*)&stored_crc, sizeof(stored_crc)) == sizeof(stored_crc);
+    }
+    file.close();
+    if (ok) {
+        uint32_t crc = esp_rom_crc32_le(0, (const uint8_t*)&header, sizeof(header));
+        crc = esp_rom_crc32_le(crc, (const uint8_t*)list, header.count * sizeof(calendar::Event));
+        ok = crc == stored_crc;
+    }
+    if (!ok) {
+        memset(list, 0, sizeof(list));
+        return false;
+    }
+    for (size_t i = 0; i < header.count; i++) {
+        if (used(i) && !calendar::validate(list[i])) {
+            memset(&list[i], 0, sizeof(list[i])); // Drops one bad record, keeps the slot numbers
+        }
+    }
+    return true;
+}
+
+bool save() {
+    Header header = {file_magic, (uint16_t)slotsInUse(), 0};
+    size_t bytes = header.count * sizeof(calendar::Event);
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t*)&header, sizeof(header));
+    crc = esp_rom_crc32_le(crc, (const uint8_t*)list, bytes);
+
+    File file = LittleFS.open(tmpPath, FILE_WRITE);
+    if (!file) {
+        Serial.println("[EVENTS] Failed to write the calendar.");
+        return false;
+    }
+    bool ok = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+              file.write((const uint8_t*)list, bytes) == bytes &&
+              file.write((const uint8_t*)&crc, sizeof(crc)) == sizeof(crc);
+    file.close();
+    if (!ok) {
+        LittleFS.remove(tmpPath);
+        Serial.println("[EVENTS] Failed to write the calendar.");
+        return false;
+    }
+    // rename() is atomic in LittleFS: the file is either the old calendar or the new one
+    LittleFS.rename(tmpPath, path);
+    return true;
+}
+
+/**
+ * @brief Loads the calendar (LittleFS is mounted by tags::init()).
+ */
+void init() {
+    lock = xSemaphoreCreateMutex();
+    queue = xQueueCreate(queue_length, sizeof(Edit));
+    if (lock == NULL || queue == NULL) {
+        Serial.println("[EVENTS] Error creating the edit queue!");
+    }
+    if (load()) {
+        Serial.printf("[EVENTS] %u event(s) loaded.\n", (unsigned)count());
+        return;
+    }
+    memcpy(list, defaults, sizeof(defaults));
+    Serial.println("[EVENTS] No valid calendar on flash, using the built-in events.");
+    save();
+}
+
+/**
+ * @brief Applies an edit and saves the calendar.
+ * @return The slot changed, or -1 if the edit was rejected.
+ */
+int apply(const Edit& edit, time_t now) {
+    int slot = edit.slot;
+    if (edit.kind == EditKind::Put) {
+        if (!calendar::validate(edit.event)) return -1;
+        if (slot < 0) {
+            slot = 0;
+            while (slot < (int)calendar::max_events && used(slot)) slot++;
+        }
+        if (slot >= (int)calendar::max_events) return -1;
+    } else if (!used(slot)) {
+        return -1;
+    }
+
+    if (lock != NULL) xSemaphoreTake(lock, portMAX_DELAY);
+    if (edit.kind == EditKind::Put) {
+        list[slot] = edit.event;
+    } else {
+        memset(&list[slot], 0, sizeof(list[slot]));
+    }
+    if (lock != NULL) xSemaphoreGive(lock);
+
+    if (edit.kind == EditKind::Remove) {
+        tags::unbindEvent(slot);
+    }
+    save();
+    schedule.reschedule(list, slot, now);
+    Serial.printf("[EVENTS] Slot %d %s.\n", slot, edit.kind == EditKind::Put ? "saved" : "removed");
+    return slot;
+}
+
+/**
+ * @brief Takes the next pending edit, if any, without blocking.
+ */
+bool poll(Edit& out) {
+    return queue != NULL && xQueueReceive(queue, &out, 0) == pdTRUE;
+}
+
+// --- Web API ---
+void appendJsonString(String& out, const char* text) {
+    out += '"';
+    for (; *text; text++) {
+        if (*text == '"' || *text == '\\') {
+            out += '\\';
+            out += *text;
+        } else if ((uint8_t)*text < 0x20) {
+            out += ' ';
+        } else {
+            out += *text;
+        }
+    }
+    out += '"';
+}
+
+void handleList(AsyncWebServerRequest* request) {
+    String json = "[";
+    if (lock != NULL) xSemaphoreTake(lock, portMAX_DELAY);
+    for (size_t i = 0; i < calendar::max_events; i++) {
+        if (!used(i)) continue;
+        const calendar::Event& e = list[i];
+        char fields[112];
+        snprintf(fields, sizeof(fields), ",\"repeat\":\"%s\",\"day\":%u,\"month\":%u,\"weekday\":%u,\"nth\":%d,\"year\":%u}",
+                 calendar::repeatName(e.repeat), e.day, e.month, e.weekday, e.nth, e.year);
+        if (json.length() > 1) json += ',';
+        json += "{\"slot\":" + String((unsigned)i) + ",\"name\":";
+        appendJsonString(json, e.name);
+        json += fields;
+    }
+    if (lock != NULL) xSemaphoreGive(lock);
+    json += "]";
+    request->send(200, "application/json", json);
+}
+
+long param(AsyncWebServerRequest* request, const char* name, long fallback) {
+    return request->hasParam(name, true) ? request->getParam(name, true)->value().toInt() : fallback;
+}
+
+void queueEdit(AsyncWebServerRequest* request, const Edit& edit) {
+    if (queue == NULL || xQueueSend(queue, &edit, 0) != pdTRUE) {
+        request->send(503, "text/plain", "Busy, try again");
+        return;
+    }
+    request->send(202, "text/plain", "Queued");
+}
+
+/**
+ * @brief POST /events: name, repeat (once|yearly|monthly|weekly|nth) and the rule's
+ *        fields (day, month, weekday, nth with -1 for last, year); slot to replace one.
+ */
+void handlePut(AsyncWebServerRequest* request) {
+    Edit edit;
+    memset(&edit, 0, sizeof(edit));
+    edit.kind = EditKind::Put;
+    edit.slot = param(request, "slot", -1);
+    if (request->hasParam("name", true)) {
+        strncpy(edit.event.name, request->getParam("name", true)->value().c_str(), calendar::name_length);
+    }
+    bool known = request->hasParam("repeat", true) &&
+                 calendar::parseRepeat(request->getParam("repeat", true)->value().c_str(), edit.event.repeat);
+    edit.event.day = param(request, "day", 0);
+    edit.event.month = param(request, "month", 0);
+    edit.event.weekday = param(request, "weekday", 0);
+    edit.event.nth = param(request, "nth", 1);
+    edit.event.year = param(request, "year", 0);
+    if (!known || edit.slot >= (int)calendar::max_events || !calendar::validate(edit.event)) {
+        request->send(400, "text/plain", "Invalid event");
+        return;
+    }
+    queueEdit(request, edit);
+}
+
+void handleRemove(AsyncWebServerRequest* request) {
+    Edit edit;
+    memset(&edit, 0, sizeof(edit));
+    edit.kind = EditKind::Remove;
+    edit.slot = param(request, "slot", -1);
+    if (edit.slot < 0 || edit.slot >= (int)calendar::max_events) {
+        request->send(400, "text/plain", "Invalid slot");
+        return;
+    }
+    queueEdit(request, edit);
+}
+
+void attach(AsyncWebServer& server) {
+    // "/events" also matches "/events/..." and the first match wins: the longer path goes first
+    server.on("/events/delete", HTTP_POST, handleRemove);
+    server.on("/events", HTTP_GET, handleList);
+    server.on("/events", HTTP_POST, handlePut);
+}
+
+} // namespace events
+#endif // EVENTS_HPP
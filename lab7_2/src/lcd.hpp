@@ -4,64 +4,252 @@
 #include <Arduino.h>
 #include <Wire.h>
 #include <LiquidCrystal_I2C.h>
+#include "frame_buffer.hpp"
 
+/**
+ * Display service.
+ *
+ * One task owns the I2C bus and the LCD. Callers post render requests (status,
+ * timed message, countdown) to a queue and return at once, so a slow or hung
+ * bus (Wire.setTimeOut) stalls only this task, never loop().
+ *
+ * Requests draw on two layers: status and countdown on the base layer, timed
+ * messages on top of it until they expire. Base updates that arrive meanwhile
+ * are kept and shown when the message ends. Requests that arrive within one
+ * frame period collapse into a single frame, and a request identical to the
+ * previous one is not even queued.
+ */
 namespace lcd {
 
 // --- CONFIGURATION ---
 // Set to 'false' to silence the Serial Monitor simulation
-const bool print_to_serial = true; 
+const bool print_to_serial = true;
+const size_t queue_length = 8;
+const size_t line_length = 20;                // Kept for the serial view; the panel shows 16
+const TickType_t frame_period = pdMS_TO_TICKS(100); // At most 10 frames/s
 
-// --- State Variables ---
-unsigned long ui_message_unlock_time = 0;
+enum class Kind : uint8_t {
+    Status,     // Base layer
+    Countdown,  // Base layer, formatted by the task
+    Message     // Over the base layer for duration_ms
+};
+
+struct Request {
+    Kind kind;
+    bool serial_return_carriage;
+    uint32_t duration_ms;
+    char line1[line_length + 1];      // Countdown: event name
+    char line2[line_length + 1];
+    int16_t year;                     // Countdown only
+    int16_t days;
+    int8_t hours, minutes, seconds;
+};
+
+struct Stats {
+    uint32_t requests;   // Posted
+    uint32_t coalesced;  // Identical to the previous one, not posted
+    uint32_t dropped;    // Queue full
+    uint32_t frames;     // Frames that changed the panel
+    uint32_t bytes;      // Bytes sent to the panel (commands + characters)
+};
 
 // Adjust 0x27 to 0x3F if your screen doesn't work
 LiquidCrystal_I2C lcd(0x27, 16, 2);
 
+// Everything is drawn here; flush() sends only the characters that changed
+display::FrameBuffer<16, 2> frame(lcd);
+
 // Custom char: Hourglass / Clock icon
 byte clockChar[] = {
   0x1F, 0x11, 0x0A, 0x04, 0x04, 0x0A, 0x1F, 0x00
 };
 
+QueueHandle_t queue = NULL;
+TaskHandle_t taskHandle = NULL;
+Stats stats = {};
+
+// --- Caller side ---
+Request last_base = {};                        // Last posted base-layer request
+volatile unsigned long message_until_millis = 0;
+
+// --- Task side ---
+Request base = {};
+Request message = {};
+bool message_shown = false;
+TickType_t message_end = 0;
+
+void copyLine(char* out, const char* text) {
+    strncpy(out, text, line_length);
+    out[line_length] = '\0';
+}
+
+/**
+ * @brief Folds a request into the layers; drawing happens in render().
+ */
+void apply(const Request& request) {
+    if (request.kind != Kind::Message) {
+        base = request;
+        if (base.kind == Kind::Countdown) {
+            // Format: "Name       2026" / "in 123d 12:00:00"
+            char name[line_length + 1];
+            copyLine(name, request.line1);
+            snprintf(base.line1, line_length, "%-14s %d", name, request.year);
+            snprintf(base.line2, line_length, "in %3dd %02d:%02d:%02d", request.days, request.hours,
+                     request.minutes, request.seconds);
+        }
+        return;
+    }
+    message = request;
+    message_shown = true;
+    message_end = xTaskGetTickCount() + pdMS_TO_TICKS(request.duration_ms);
+}
+
+void render() {
+    if (message_shown && (int32_t)(xTaskGetTickCount() - message_end) >= 0) {
+        message_shown = false;
+    }
+    const Request& layer = message_shown ? message : base;
+    frame.setLine(0, layer.line1);
+    frame.setLine(1, layer.line2);
+    if (!frame.dirty()) {
+        return;
+    }
+    stats.bytes += frame.flush();
+    stats.frames++;
+
+    // Serial Simulation
+    if (print_to_serial) {
+        Serial.printf("[LCD] %-20s | %-20s%s", layer.line1, layer.line2, layer.serial_return_carriage ? "\r" : "\n");
+    }
+}
+
+void renderTask(void* parameter) {
+    Request request;
+    TickType_t last_frame = xTaskGetTickCount();
+    while (true) {
+        // Sleep until a request arrives or the shown message expires
+        TickType_t wait = portMAX_DELAY;
+        if (message_shown) {
+            int32_t left = (int32_t)(message_end - xTaskGetTickCount());
+            wait = left > 0 ? left : 0;
+        }
+        if (xQueueReceive(queue, &request, wait) == pdTRUE) {
+            apply(request);
+            // Frame rate cap: whatever arrives until the next frame slot joins this frame
+            TickType_t since = xTaskGetTickCount() - last_frame;
+            if (since < frame_period) {
+                vTaskDelay(frame_period - since);
+            }
+            while (xQueueReceive(queue, &request, 0) == pdTRUE) {
+                apply(request);
+            }
+        }
+        render();
+        last_frame = xTaskGetTickCount();
+    }
+}
+
 void init() {
-    Wire.begin(); 
-    Wire.setTimeOut(10); 
+    Wire.begin();
+    Wire.setTimeOut(10);
 
     if (print_to_serial) {
         Serial.println("[LCD] Initializing Display (Hardware)...");
     }
-    
-    lcd.init();
+
+    lcd.init(); // Also clears the panel
     lcd.backlight();
     lcd.createChar(0, clockChar);
-    
-    lcd.setCursor(0, 0);
-    lcd.print("Booting System..");
-    
+    frame.blank();
+
+    frame.setLine(0, "Booting System..");
+    frame.flush();
+
     if (print_to_serial) {
         Serial.println("[LCD] Booting System...");
     }
+
+    queue = xQueueCreate(queue_length, sizeof(Request));
+    if (queue == NULL) {
+        Serial.println("[LCD] Error creating render queue!");
+        return;
+    }
+    // Core 0: loop() runs on core 1, so bus waits never take its time
+    BaseType_t created = xTaskCreatePinnedToCore(renderTask, "LCD_Task", 3072, NULL, 1, &taskHandle, 0);
+    if (created != pdPASS) {
+        Serial.println("[LCD] Error creating display task!");
+    }
+}
+
+/**
+ * @brief Queues a request without waiting; identical base-layer updates are skipped.
+ */
+void post(const Request& request) {
+    bool is_base = request.kind != Kind::Message;
+    if (is_base && memcmp(&request, &last_base, sizeof(Request)) == 0) {
+        stats.coalesced++;
+        return;
+    }
+    if (queue == NULL || xQueueSend(queue, &request, 0) != pdTRUE) {
+        stats.dropped++;
+        return;
+    }
+    stats.requests++;
+    if (is_base) {
+        last_base = request;
+    }
+}
+
+Request makeRequest(Kind kind, const char* line1, const char* line2, bool serial_return_carriage) {
+    Request request;
+    memset(&request, 0, sizeof(request)); // Padding too: post() compares whole requests
+    request.kind = kind;
+    request.serial_return_carriage = serial_return_carriage;
+    copyLine(request.line1, line1);
+    copyLine(request.line2, line2);
+    return request;
 }
 
 void printStatus(String line1, String line2, bool serial_return_carriage = false) {
-    // Hardware
-    lcd.clear();
-    lcd.setCursor(0, 0);
-    lcd.print(line1);
-    lcd.setCursor(0, 1);
-    lcd.print(line2);
+    post(makeRequest(Kind::Status, line1.c_str(), line2.c_str(), serial_return_carriage));
+}
 
-    // Serial Simulation
-    if (print_to_serial) {
-        Serial.printf("[LCD] %-20s | %-20s%s", line1.c_str(), line2.c_str(), serial_return_carriage ? "\r" : "\n");
-    }
+/**
+ * @brief Countdown to an event on the base layer; posting it every tick is cheap.
+ */
+void showCountdown(const String& name, int year, int days, int hours, int minutes, int seconds) {
+    Request request = makeRequest(Kind::Countdown, name.c_str(), "", true);
+    request.year = year;
+    request.days = days;
+    request.hours = hours;
+    request.minutes = minutes;
+    request.seconds = seconds;
+    post(request);
 }
 
-// --- Helper: Show a message and lock the UI for X seconds ---
+// --- Helper: Show a message over the status/countdown for X ms ---
 void showMessage(String line1, String line2, int duration_ms, bool serial_return_carriage = true) {
-    lcd::printStatus(line1, line2, serial_return_carriage);
-    // Set the future time when the UI is allowed to update again
-    ui_message_unlock_time = millis() + duration_ms;
+    Request request = makeRequest(Kind::Message, line1.c_str(), line2.c_str(), serial_return_carriage);
+    request.duration_ms = duration_ms;
+    post(request);
+    message_until_millis = millis() + duration_ms;
+}
+
+/**
+ * @brief A message that messageActive() ignores: progress over the countdown while scans go on.
+ */
+void showProgress(const char* line1, const char* line2, uint32_t duration_ms) {
+    Request request = makeRequest(Kind::Message, line1, line2, true);
+    request.duration_ms = duration_ms;
+    post(request);
+}
+
+/**
+ * @brief True while the last message is on screen (e.g. to ignore repeated scans).
+ */
+bool messageActive() {
+    return (long)(millis() - message_until_millis) < 0;
 }
 
 } // namespace lcd
-#endif // LCD_HPP
\ No newline at end of file
+#endif // LCD_HPP
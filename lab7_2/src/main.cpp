@@ -15,33 +15,20 @@ void setup() {
     rfid::init();
     event_manager::init();
 
-    // 2. Connect to network
+    // 2. Connect to network (sta keeps retrying in the background if this times out)
     lcd::printStatus("Connecting to WiFi", sta::ssid);
     if (!sta::connect_to_wifi()) {
-        lcd::printStatus("WiFi conn. failed", "Check Credentials");
-        while(1) delay(1000);
+        lcd::printStatus("WiFi conn. failed", "Retrying...");
     }
 
-    // 3. Initialize NTP (sync time)
+    // 3. Initialize NTP: syncs in the background; event_manager waits for the clock
     lcd::printStatus("Syncing Time by NTP", ntp::server);
     ntp::init();
-    
-    // Blocking wait for time sync (crucial for accurate countdowns)
-    while (!ntp::isTimeSet()) { 
-        Serial.print("."); 
-        delay(500); 
-    }
-    
-    Serial.println("\n[MAIN] Time synchronized.");
-    struct tm current_tm = ntp::getCurrentTime();
-    Serial.printf("[MAIN] Current Local Time: %04d-%02d-%02d %02d:%02d:%02d\n", 
-                    current_tm.tm_year + 1900, current_tm.tm_mon + 1, current_tm.tm_mday,
-                    current_tm.tm_hour, current_tm.tm_min, current_tm.tm_sec);
 
     // 4. Initialize OTA
     ota::init();
 
-    lcd::printStatus("System is ready", "Scan some tags!");
+    if (ntp::isTimeSet()) lcd::printStatus("System is ready", "Scan some tags!");
 }
 
 void loop() {
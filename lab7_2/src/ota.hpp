@@ -5,6 +5,10 @@
 #include <ESPAsyncWebServer.h>
 #include <ElegantOTA.h>
 #include "sta.hpp"
+#include "events.hpp"
+#include "delta_ota.hpp"
+#include "update_progress.hpp"
+#include "timesync.hpp"
 
 namespace ota {
 
@@ -23,19 +27,54 @@ void init() {
         request->redirect("/update");
     });
 
-    // 3. Start ElegantOTA
+    // 3. Event calendar: GET /events, POST /events, POST /events/delete
+    events::attach(server);
+
+    // 4. Clock quality (lib/timesync)
+    server.on("/time", HTTP_GET, [](AsyncWebServerRequest *request) {
+        timesync::Quality q = timesync::quality();
+        timesync::ClientStats stats = timesync::clientStats();
+        char json[320];
+        snprintf(json, sizeof(json),
+                 "{\"state\":\"%s\",\"utc\":%ld,\"error_us\":%lld,\"offset_us\":%lld,\"jitter_us\":%lld,"
+                 "\"delay_us\":%lld,\"drift_ppm\":%.3f,\"since_sync_s\":%lld,\"samples\":%u,\"steps\":%u,"
+                 "\"spikes\":%u,\"sent\":%u,\"replies\":%u,\"timeouts\":%u}",
+                 timesync::stateName(q.state), (long)time(NULL), (long long)q.error_us, (long long)q.offset_us,
+                 (long long)q.jitter_us, (long long)q.delay_us, q.drift_ppm,
+                 (long long)(q.since_sync_us < 0 ? -1 : q.since_sync_us / 1000000), (unsigned)q.samples,
+                 (unsigned)q.steps, (unsigned)q.spikes, (unsigned)stats.sent, (unsigned)stats.replies,
+                 (unsigned)stats.timeouts);
+        request->send(200, "application/json", json);
+    });
+
+    // 5. Delta and compressed images from tools/otadiff: POST /delta
+    delta_ota::attach(server);
+
+    // 6. Start ElegantOTA; its uploads report progress like /delta's
     ElegantOTA.begin(&server);
+    ElegantOTA.onStart([]() { update_progress::start("OTA", 0); });
+    ElegantOTA.onProgress([](size_t current, size_t total) {
+        update_progress::expected = total;
+        update_progress::advance(current, current);
+    });
+    ElegantOTA.onEnd([](bool success) { update_progress::end(success, success ? "" : "see /update"); });
     
-    // 4. Start Server
+    // 7. Start Server
     server.begin();
     
     Serial.println("[OTA] Server Ready.");
     Serial.println("      1. Test: http://" + sta::get_ip() + "/hello");
     Serial.println("      2. OTA:  http://" + sta::get_ip() + "/update");
+    Serial.println("      3. Events: http://" + sta::get_ip() + "/events");
+    Serial.println("      4. Time: http://" + sta::get_ip() + "/time");
+    Serial.println("      5. Delta: curl -F file=@patch.dlt http://" + sta::get_ip() + "/delta");
 }
 
 void run() {
     ElegantOTA.loop();
+    delta_ota::run();
+    // Progress on the LCD and Serial; the uploads run in the web server's task and OTA_Task
+    update_progress::report();
 }
 
 } // namespace ota
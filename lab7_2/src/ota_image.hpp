@@ -0,0 +1,464 @@
+#ifndef OTA_IMAGE_HPP
+#define OTA_IMAGE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "delta_patch.hpp"
+
+#ifdef ARDUINO
+#include "mbedtls/sha256.h"
+#endif
+
+/**
+ * Receiving, writing and checking a firmware image for delta_ota.hpp, free of
+ * Arduino calls like delta_patch.hpp, so tools/otadiff signs images and runs
+ * the device's receiver on a simulated flash with the same code.
+ *
+ * An upload is a delta patch (or compressed image) and, optionally, a Trailer:
+ *
+ *   patch | magic "SIG1", image_size, SHA-256(new image), HMAC-SHA256(key, digest)
+ *
+ * The Receiver keeps the last sizeof(Trailer) bytes back (they may be the
+ * trailer), feeds the rest to the patcher and hashes the new image as it goes
+ * to flash. Before the image may boot, the digest must match the trailer, the
+ * HMAC the device's key (when it has one) and the flash, read back, the digest.
+ *
+ * The SectorWriter programs whole 4 KB sectors from one buffer and erases
+ * ahead in 64 KB blocks where the image covers the block: a block erase costs
+ * three to five sector erases, not sixteen, but stalls the flash (and both
+ * cores) for longer at a time. The first head_size bytes are
+ * written last, as Update does, so a slot that was cut off never boots.
+ */
+namespace ota_image {
+
+const uint32_t trailer_magic = 0x31474953; // "SIG1"
+const size_t digest_size = 32;
+const size_t sector_size = 4096;           // Program unit, smallest erase
+const size_t block_size = 65536;           // Largest erase
+const size_t head_size = 16;               // One flash encryption block
+
+struct Trailer {
+    uint32_t magic;
+    uint32_t image_size;
+    uint8_t digest[digest_size];  // SHA-256 of the new image
+    uint8_t mac[digest_size];     // HMAC-SHA256(key, digest); zeros when unsigned
+};
+
+enum class Error : uint8_t {
+    None,
+    Patch,      // See patchError()
+    Flash,
+    Unsigned,   // The device has a key and the upload has no trailer
+    Digest,     // The new image does not hash to the trailer's digest
+    Signature,  // The trailer was signed with another key
+    ReadBack    // The flash does not hold what was written
+};
+
+inline const char* errorName(Error error) {
+    switch (error) {
+    case Error::None: return "ok";
+    case Error::Patch: return "bad patch";
+    case Error::Flash: return "flash error";
+    case Error::Unsigned: return "not signed";
+    case Error::Digest: return "SHA-256 mismatch";
+    case Error::Signature: return "bad signature";
+    case Error::ReadBack: return "flash read-back mismatch";
+    }
+    return "?";
+}
+
+/**
+ * @brief Streaming SHA-256: the hardware unit through mbedtls on the ESP32, FIPS 180-4 code on the host.
+ */
+class Sha256 {
+public:
+#ifdef ARDUINO
+    Sha256() { mbedtls_sha256_init(&context); }
+    ~Sha256() { mbedtls_sha256_free(&context); }
+    void start() { mbedtls_sha256_starts_ret(&context, 0); }
+    void update(const uint8_t* data, size_t length) { mbedtls_sha256_update_ret(&context, data, length); }
+    void finish(uint8_t out[digest_size]) { mbedtls_sha256_finish_ret(&context, out); }
+
+private:
+    mbedtls_sha256_context context;
+#else
+    Sha256() { start(); }
+
+    void start() {
+        static const uint32_t initial[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                            0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        memcpy(state, initial, sizeof(state));
+        total = 0;
+        buffered = 0;
+    }
+
+    void update(const uint8_t* data, size_t length) {
+        total += length;
+        while (length > 0) {
+            size_t n = sizeof(block) - buffered < length ? sizeof(block) - buffered : length;
+            memcpy(block + buffered, data, n);
+            buffered += n;
+            data += n;
+            length -= n;
+            if (buffered == sizeof(block)) {
+                compress();
+                buffered = 0;
+            }
+        }
+    }
+
+    void finish(uint8_t out[digest_size]) {
+        uint64_t bits = total * 8;
+        uint8_t pad = 0x80;
+        update(&pad, 1);
+        pad = 0;
+        while (buffered != 56) update(&pad, 1);
+        uint8_t length[8];
+        for (int i = 0; i < 8; i++) length[i] = (uint8_t)(bits >> (56 - 8 * i));
+        update(length, 8);
+        for (int i = 0; i < 8; i++) {
+            for (int j = 0; j < 4; j++) out[4 * i + j] = (uint8_t)(state[i] >> (24 - 8 * j));
+        }
+    }
+
+private:
+    uint32_t state[8];
+    uint8_t block[64];
+    size_t buffered;
+    uint64_t total;
+
+    static uint32_t rotr(uint32_t x, int n) { return x >> n | x << (32 - n); }
+
+    void compress() {
+        static const uint32_t k[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+        uint32_t w[64];
+        for (int i = 0; i < 16; i++) {
+            w[i] = (uint32_t)block[4 * i] << 24 | block[4 * i + 1] << 16 | block[4 * i + 2] << 8 | block[4 * i + 3];
+        }
+        for (int i = 16; i < 64; i++) {
+            uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ w[i - 15] >> 3;
+            uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ w[i - 2] >> 10;
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; i++) {
+            uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+            uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+#endif
+};
+
+/**
+ * @brief HMAC-SHA256 (RFC 2104) of data under key.
+ */
+inline void hmacSha256(const uint8_t* key, size_t key_length, const uint8_t* data, size_t length,
+                       uint8_t out[digest_size]) {
+    uint8_t pad[64] = {};
+    Sha256 sha;
+    if (key_length > sizeof(pad)) {
+        sha.start();
+        sha.update(key, key_length);
+        sha.finish(pad);
+    } else {
+        memcpy(pad, key, key_length);
+    }
+    for (size_t i = 0; i < sizeof(pad); i++) pad[i] ^= 0x36;
+    uint8_t inner[digest_size];
+    sha.start();
+    sha.update(pad, sizeof(pad));
+    sha.update(data, length);
+    sha.finish(inner);
+    for (size_t i = 0; i < sizeof(pad); i++) pad[i] ^= 0x36 ^ 0x5c;
+    sha.start();
+    sha.update(pad, sizeof(pad));
+    sha.update(inner, sizeof(inner));
+    sha.finish(out);
+}
+
+/**
+ * @brief Compares in constant time: how long it takes says nothing about where a MAC differs.
+ */
+inline bool sameDigest(const uint8_t* a, const uint8_t* b) {
+    uint8_t difference = 0;
+    for (size_t i = 0; i < digest_size; i++) difference |= a[i] ^ b[i];
+    return difference == 0;
+}
+
+/**
+ * @brief The trailer for a new image; key "" leaves it unsigned (digest only).
+ */
+inline Trailer makeTrailer(const uint8_t* image, size_t size, const char* key) {
+    Trailer trailer = {};
+    trailer.magic = trailer_magic;
+    trailer.image_size = (uint32_t)size;
+    Sha256 sha;
+    sha.start();
+    sha.update(image, size);
+    sha.finish(trailer.digest);
+    if (key[0] != '\0') hmacSha256((const uint8_t*)key, strlen(key), trailer.digest, digest_size, trailer.mac);
+    return trailer;
+}
+
+/**
+ * @brief Writes an image into a flash slot in whole sectors and reads it back.
+ *
+ * Flash: size_t size(); bool erase(size_t offset, size_t length);
+ *        bool write(size_t offset, const uint8_t* data, size_t length);
+ *        bool read(size_t offset, uint8_t* out, size_t length);
+ */
+template <typename Flash>
+class SectorWriter {
+public:
+    explicit SectorWriter(Flash& flash) : flash(flash) {}
+
+    size_t erase_unit = block_size;  // sector_size: shorter flash stalls, longer update
+
+    struct Stats {
+        uint32_t erases;
+        uint32_t erased;      // Bytes
+        uint32_t programs;
+        uint32_t programmed;  // Bytes
+    };
+    Stats stats = {};
+
+    bool begin(size_t size) {
+        image_size = size;
+        position = 0;
+        buffered = 0;
+        erased_to = 0;
+        head_length = 0;
+        stats = {};
+        return size > 0 && size <= flash.size();
+    }
+
+    bool write(const uint8_t* data, size_t length) {
+        while (length > 0) {
+            size_t n = sector_size - buffered < length ? sector_size - buffered : length;
+            if (position + buffered + n > image_size) return false;
+            memcpy(buffer + buffered, data, n);
+            buffered += n;
+            data += n;
+            length -= n;
+            if (buffered == sector_size && !program()) return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Programs the last, partial sector.
+     */
+    bool flush() { return buffered == 0 || program(); }
+
+    /**
+     * @brief SHA-256 of the slot as it will boot: the flash, with the head still held here.
+     */
+    bool readBack(uint8_t digest[digest_size]) {
+        Sha256 sha;
+        sha.start();
+        for (size_t offset = 0; offset < image_size; offset += sector_size) {
+            size_t n = image_size - offset < sector_size ? image_size - offset : sector_size;
+            if (!flash.read(offset, buffer, n)) return false;
+            if (offset == 0) memcpy(buffer, head, head_length);
+            sha.update(buffer, n);
+        }
+        sha.finish(digest);
+        return true;
+    }
+
+    /**
+     * @brief Writes the head: from here on the slot holds a whole image.
+     */
+    bool commit() { return flash.write(0, head, head_length); }
+
+    size_t written() const { return position + buffered; }
+
+private:
+    Flash& flash;
+    uint8_t buffer[sector_size];
+    uint8_t head[head_size];
+    size_t head_length = 0;
+    size_t image_size = 0;
+    size_t position = 0;   // Programmed up to here, always sector-aligned until the last sector
+    size_t buffered = 0;
+    size_t erased_to = 0;
+
+    bool eraseTo(size_t end) {
+        size_t image_end = (image_size + sector_size - 1) / sector_size * sector_size;
+        while (erased_to < end) {
+            bool whole_block = erased_to % erase_unit == 0 && erased_to + erase_unit <= image_end;
+            size_t length = whole_block ? erase_unit : sector_size;
+            if (!flash.erase(erased_to, length)) return false;
+            stats.erases++;
+            stats.erased += length;
+            erased_to += length;
+        }
+        return true;
+    }
+
+    bool program() {
+        if (!eraseTo(position + buffered)) return false;
+        if (position == 0) {
+            head_length = buffered < head_size ? buffered : head_size;
+            memcpy(head, buffer, head_length);
+            memset(buffer, 0xFF, head_length); // Erased: the flash keeps it for commit()
+        }
+        if (!flash.write(position, buffer, buffered)) return false;
+        stats.programs++;
+        stats.programmed += buffered;
+        position += buffered;
+        buffered = 0;
+        return true;
+    }
+};
+
+/**
+ * @brief An upload, start to end: trailer split off, patched, hashed, written and checked.
+ *
+ * finish() leaves the slot whole and checked; switching the boot partition is
+ * the caller's. After a failure the head is never written and the slot never boots.
+ */
+template <typename Old, typename Flash>
+class Receiver {
+public:
+    Receiver(Old& old, Flash& flash) : writer(flash), output(*this), patcher(old, output) {}
+
+    void reset() {
+        patcher.reset();
+        sha.start();
+        tail_length = 0;
+        received = 0;
+        signed_upload = false;
+        error = Error::None;
+    }
+
+    /**
+     * @return false once the upload has failed (see failure()).
+     */
+    bool feed(const uint8_t* data, size_t length) {
+        if (error != Error::None) return false;
+        received += length;
+        if (tail_length + length <= sizeof(tail)) {
+            memcpy(tail + tail_length, data, length);
+            tail_length += length;
+            return true;
+        }
+        // Pass on all but the last sizeof(tail) bytes, the oldest first
+        size_t excess = tail_length + length - sizeof(tail);
+        size_t from_tail = excess < tail_length ? excess : tail_length;
+        if (!pass(tail, from_tail)) return false;
+        memmove(tail, tail + from_tail, tail_length - from_tail);
+        tail_length -= from_tail;
+        if (!pass(data, excess - from_tail)) return false;
+        memcpy(tail + tail_length, data + excess - from_tail, length - (excess - from_tail));
+        tail_length = sizeof(tail);
+        return true;
+    }
+
+    /**
+     * @brief After the last byte: completes the image and runs every check.
+     * @param key The device's signing key; "" accepts unsigned uploads.
+     */
+    bool finish(const char* key) {
+        if (error != Error::None) return false;
+        Trailer trailer;
+        memcpy(&trailer, tail, sizeof(trailer));
+        bool has_trailer = tail_length == sizeof(tail) && trailer.magic == trailer_magic;
+        if (!has_trailer && !pass(tail, tail_length)) return false;
+        if (!patcher.finish()) return fail(Error::Patch);
+        if (!writer.flush()) return fail(Error::Flash);
+
+        uint8_t digest[digest_size];
+        sha.finish(digest);
+        if (has_trailer) {
+            if (trailer.image_size != writer.written() || !sameDigest(digest, trailer.digest)) {
+                return fail(Error::Digest);
+            }
+            if (key[0] != '\0') {
+                uint8_t mac[digest_size];
+                hmacSha256((const uint8_t*)key, strlen(key), digest, digest_size, mac);
+                if (!sameDigest(mac, trailer.mac)) return fail(Error::Signature);
+            }
+        } else if (key[0] != '\0') {
+            return fail(Error::Unsigned);
+        }
+        signed_upload = has_trailer && key[0] != '\0';
+
+        uint8_t flashed[digest_size];
+        if (!writer.readBack(flashed)) return fail(Error::Flash);
+        if (!sameDigest(digest, flashed)) return fail(Error::ReadBack);
+        if (!writer.commit()) return fail(Error::Flash);
+        return true;
+    }
+
+    const char* failure() const { return error == Error::Patch ? delta::errorName(patcher.error) : errorName(error); }
+    delta::Error patchError() const { return patcher.error; }
+    const delta::Header& info() const { return patcher.info(); }
+    size_t bytesReceived() const { return received; }
+    size_t bytesWritten() const { return writer.written(); }
+    bool wasSigned() const { return signed_upload; }
+
+    SectorWriter<Flash> writer;
+    Error error = Error::None;
+
+private:
+    /**
+     * @brief The patcher's Sink: hashes what goes to the writer.
+     */
+    struct Output {
+        Receiver& receiver;
+        explicit Output(Receiver& receiver) : receiver(receiver) {}
+        bool begin(const delta::Header& header) { return receiver.writer.begin(header.new_size); }
+        bool write(const uint8_t* data, size_t length) {
+            receiver.sha.update(data, length);
+            return receiver.writer.write(data, length);
+        }
+    };
+
+    Output output;
+    delta::Patcher<Old, Output> patcher;
+    Sha256 sha;
+    uint8_t tail[sizeof(Trailer)];
+    size_t tail_length = 0;
+    size_t received = 0;
+    bool signed_upload = false;
+
+    bool fail(Error e) {
+        error = e;
+        return false;
+    }
+
+    bool pass(const uint8_t* data, size_t length) {
+        if (length > 0 && !patcher.feed(data, length)) return fail(Error::Patch);
+        return true;
+    }
+};
+
+} // namespace ota_image
+#endif // OTA_IMAGE_HPP
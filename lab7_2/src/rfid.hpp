@@ -4,36 +4,130 @@
 #include <Arduino.h>
 #include <SPI.h>
 #include <MFRC522.h>
+#include "tag_table.hpp"
+#include "rfid_scan.hpp"
 
+/**
+ * RFID reader service.
+ *
+ * One task owns the SPI bus and the RC522. Instead of polling
+ * PICC_IsNewCardPresent() from loop(), it runs a short REQA burst every
+ * burst_period with the antenna off in between, and sleeps until the chip's
+ * IRQ pin reports an answer (or a few ms pass). Cards that arrive or leave
+ * the field are queued as events; poll() takes them without waiting.
+ */
 namespace rfid {
 
 const uint8_t PIN_RST = 17; // Reset pin
 const uint8_t PIN_SS  = 5;  // Slave Select (SDA on module)
+const uint8_t PIN_IRQ = 16; // IRQ on module (active low)
+
+const TickType_t burst_period = pdMS_TO_TICKS(150);  // Card noticed within ~160 ms
+const TickType_t field_settle = pdMS_TO_TICKS(5);    // ISO 14443: cards answer within 5 ms of field on
+const TickType_t answer_timeout = pdMS_TO_TICKS(3);  // ATQA comes ~100 us after REQA
+const size_t queue_length = 8;
+
+struct Stats {
+    uint32_t arrived;
+    uint32_t left;
+    uint32_t dropped;    // Queue full
+};
 
 MFRC522 mfrc522(PIN_SS, PIN_RST);
+rfid_scan::Scanner<MFRC522> scanner(mfrc522);
+rfid_scan::Presence presence;
+
+QueueHandle_t queue = NULL;
+TaskHandle_t taskHandle = NULL;
+Stats stats = {};
+
+void IRAM_ATTR onIrq() {
+    if (taskHandle == NULL) return;
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(taskHandle, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+void scanTask(void* parameter) {
+    tag_table::Uid seen[rfid_scan::max_cards];
+    rfid_scan::CardEvent events[2 * rfid_scan::max_cards];
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (true) {
+        vTaskDelayUntil(&last_wake, burst_period);
+        size_t count = scanner.burst(seen, rfid_scan::max_cards,
+            [] {
+                vTaskDelay(field_settle);
+                ulTaskNotifyTake(pdTRUE, 0); // Edges from the last burst's reads
+            },
+            [] { return ulTaskNotifyTake(pdTRUE, answer_timeout) > 0; });
+
+        size_t changes = presence.update(seen, count, events);
+        for (size_t i = 0; i < changes; i++) {
+            if (xQueueSend(queue, &events[i], 0) != pdTRUE) {
+                stats.dropped++;
+                continue;
+            }
+            if (events[i].arrived) stats.arrived++;
+            else stats.left++;
+        }
+    }
+}
 
 void init() {
     Serial.println("[RFID] Initializing RC522...");
     SPI.begin(); 
     mfrc522.PCD_Init();
+    scanner.begin();
+
+    queue = xQueueCreate(queue_length, sizeof(rfid_scan::CardEvent));
+    if (queue == NULL) {
+        Serial.println("[RFID] Error creating event queue!");
+        return;
+    }
+    pinMode(PIN_IRQ, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(PIN_IRQ), onIrq, FALLING);
+    // Core 0, next to LCD_Task: SPI waits never take loop()'s time
+    BaseType_t created = xTaskCreatePinnedToCore(scanTask, "RFID_Task", 3072, NULL, 1, &taskHandle, 0);
+    if (created != pdPASS) {
+        Serial.println("[RFID] Error creating scan task!");
+    }
 }
 
-String scanCard() {
-    if (!mfrc522.PICC_IsNewCardPresent()) return "";
-    if (!mfrc522.PICC_ReadCardSerial()) return "";
+/**
+ * @brief Takes the next card event without waiting.
+ * @return false if there is none.
+ */
+bool poll(rfid_scan::CardEvent& event) {
+    return queue != NULL && xQueueReceive(queue, &event, 0) == pdTRUE;
+}
 
-    String uidRaw = "";
-    for (byte i = 0; i < mfrc522.uid.size; i++) {
-        uidRaw += String(mfrc522.uid.uidByte[i] < 0x10 ? "0" : "");
-        uidRaw += String(mfrc522.uid.uidByte[i], HEX);
+/**
+ * @brief Takes the next card that arrived at the reader; leave events are skipped.
+ * @return false if no card arrived.
+ */
+bool scanCard(tag_table::Uid& uid) {
+    rfid_scan::CardEvent event;
+    while (poll(event)) {
+        if (event.arrived) {
+            uid = event.uid;
+            return true;
+        }
     }
-    uidRaw.toUpperCase();
-
-    mfrc522.PICC_HaltA();
-    mfrc522.PCD_StopCrypto1();
+    return false;
+}
 
-    return uidRaw;
+/**
+ * @brief Uppercase hex for logs; out holds at least 2 * max_uid_length + 1 chars.
+ */
+void toHex(const tag_table::Uid& uid, char* out) {
+    static const char digits[] = "0123456789ABCDEF";
+    for (uint8_t i = 0; i < uid.size; i++) {
+        *out++ = digits[uid.bytes[i] >> 4];
+        *out++ = digits[uid.bytes[i] & 0x0F];
+    }
+    *out = '\0';
 }
 
 } // namespace rfid
-#endif // RFID_HPP
\ No newline at end of file
+#endif // RFID_HPP
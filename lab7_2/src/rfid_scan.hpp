@@ -0,0 +1,205 @@
+#ifndef RFID_SCAN_HPP
+#define RFID_SCAN_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "tag_table.hpp"
+
+/**
+ * One REQA burst on an MFRC522, and card presence tracking across bursts.
+ *
+ * Chip is the MFRC522 class (or FakeMfrc522 on a PC, see tools/rfidsim): only
+ * its register access, PICC_Select(), PICC_HaltA(), PICC_RequestA() and the
+ * antenna switch are used. No Arduino calls here; rfid.hpp adds the task,
+ * the IRQ pin and the timing.
+ *
+ * A burst sends REQA through the registers with only RxIRq routed to the IRQ
+ * pin, so the waiting task wakes only when a card answers. If one does, every
+ * card in the field is read: select one (the chip's anticollision picks it),
+ * halt it, and repeat REQA, which halted cards ignore.
+ */
+namespace rfid_scan {
+
+const size_t max_cards = 4;            // Cards tracked in the field at once
+const uint8_t missed_bursts_to_leave = 2;
+
+// MFRC522 register bits
+const uint8_t irq_inverted = 0x80;     // ComIEnReg: IRQ pin active low
+const uint8_t rx_irq = 0x20;           // ComIEnReg/ComIrqReg: a frame was received
+const uint8_t irq_push_pull = 0x80;    // DivIEnReg: drive the IRQ pin both ways
+const uint8_t clear_irqs = 0x7F;       // ComIrqReg: Set1 = 0 clears the marked bits
+const uint8_t flush_fifo = 0x80;       // FIFOLevelReg
+const uint8_t start_send_7_bits = 0x87; // BitFramingReg: StartSend, REQA is a 7-bit frame
+const uint16_t timer_reload = 200;     // TReloadReg, 25 us ticks after PCD_Init(): 5 ms instead of 25 ms
+
+struct CardEvent {
+    bool arrived;                      // false: the card left the field
+    tag_table::Uid uid;
+};
+
+template <typename Chip>
+class Scanner {
+public:
+    explicit Scanner(Chip& chip) : chip(chip) {}
+
+    /**
+     * @brief Routes only RxIRq to the IRQ pin (after PCD_Init()).
+     *
+     * Also shortens the receive timeout: anticollision answers come within
+     * 1 ms, and HLTA and the last REQA of a burst always wait it out.
+     */
+    void begin() {
+        chip.PCD_WriteRegister(Chip::TReloadRegH, timer_reload >> 8);
+        chip.PCD_WriteRegister(Chip::TReloadRegL, timer_reload & 0xFF);
+        chip.PCD_WriteRegister(Chip::ComIEnReg, irq_inverted | rx_irq);
+        chip.PCD_WriteRegister(Chip::DivIEnReg, irq_push_pull);
+        chip.PCD_WriteRegister(Chip::ComIrqReg, clear_irqs);
+        chip.PCD_AntennaOff();
+    }
+
+    void fieldOn() { chip.PCD_AntennaOn(); }
+
+    /**
+     * @brief Field off: cards lose power and start over in IDLE at the next burst.
+     */
+    void fieldOff() { chip.PCD_AntennaOff(); }
+
+    /**
+     * @brief Sends REQA and returns at once; an answer raises the IRQ pin.
+     */
+    void sendRequest() {
+        chip.PCD_WriteRegister(Chip::ComIrqReg, clear_irqs);
+        chip.PCD_WriteRegister(Chip::FIFOLevelReg, flush_fifo);
+        chip.PCD_WriteRegister(Chip::FIFODataReg, Chip::PICC_CMD_REQA);
+        chip.PCD_WriteRegister(Chip::CommandReg, Chip::PCD_Transceive);
+        chip.PCD_WriteRegister(Chip::BitFramingReg, start_send_7_bits);
+    }
+
+    /**
+     * @brief Whether a card answered the last REQA (also after a missed interrupt).
+     */
+    bool answered() { return chip.PCD_ReadRegister(Chip::ComIrqReg) & rx_irq; }
+
+    /**
+     * @brief Stops the transceive started by sendRequest().
+     */
+    void endRequest() {
+        chip.PCD_WriteRegister(Chip::CommandReg, Chip::PCD_Idle);
+        chip.PCD_WriteRegister(Chip::BitFramingReg, 0x00);
+        chip.PCD_WriteRegister(Chip::ComIrqReg, clear_irqs);
+    }
+
+    /**
+     * @brief One burst: field on, REQA, read whatever answered, field off.
+     * @param settle Waits for the cards to power up (and drops a stale interrupt).
+     * @param wait_answer Waits for the IRQ pin; true if it fired.
+     * @return The number of UIDs written to out.
+     */
+    template <typename Settle, typename WaitAnswer>
+    size_t burst(tag_table::Uid* out, size_t max, Settle settle, WaitAnswer wait_answer) {
+        bursts++;
+        fieldOn();
+        settle();
+        sendRequest();
+        bool irq = wait_answer();
+        bool card = answered();
+        endRequest();
+        size_t count = 0;
+        if (card) {
+            answers++;
+            if (!irq) missed_irqs++;
+            count = readAll(out, max);
+        }
+        fieldOff();
+        return count;
+    }
+
+    uint32_t bursts = 0;
+    uint32_t answers = 0;      // Bursts in which a card answered
+    uint32_t missed_irqs = 0;  // Answers seen in ComIrqReg without an interrupt
+
+    /**
+     * @brief Reads every card in the field after an answered REQA.
+     * @return The number of UIDs written to out.
+     */
+    size_t readAll(tag_table::Uid* out, size_t max) {
+        size_t count = 0;
+        while (count < max) {
+            if (chip.PICC_Select(&chip.uid, 0) != Chip::STATUS_OK) {
+                break;
+            }
+            out[count].size = chip.uid.size < tag_table::max_uid_length ? chip.uid.size : tag_table::max_uid_length;
+            memcpy(out[count].bytes, chip.uid.uidByte, out[count].size);
+            count++;
+            // Halted cards ignore REQA, so the next one answers the selection
+            chip.PICC_HaltA();
+            uint8_t atqa[2];
+            uint8_t size = sizeof(atqa);
+            typename Chip::StatusCode status = chip.PICC_RequestA(atqa, &size);
+            if (status != Chip::STATUS_OK && status != Chip::STATUS_COLLISION) {
+                break;
+            }
+        }
+        return count;
+    }
+
+private:
+    Chip& chip;
+};
+
+/**
+ * @brief Turns the UIDs seen per burst into arrived/left events.
+ *
+ * A card has left after missed_bursts_to_leave bursts without it, so a single
+ * failed read does not produce a leave and a second arrival.
+ */
+class Presence {
+public:
+    /**
+     * @param out Room for 2 * max_cards events.
+     * @return The number of events written.
+     */
+    size_t update(const tag_table::Uid* seen, size_t seen_count, CardEvent* out) {
+        size_t events = 0;
+        bool matched[max_cards] = {};
+        for (size_t i = 0; i < seen_count; i++) {
+            size_t j = 0;
+            while (j < count && !(cards[j] == seen[i])) j++;
+            if (j < count) {
+                matched[j] = true;
+                missed[j] = 0;
+                continue;
+            }
+            if (count < max_cards) {
+                cards[count] = seen[i];
+                missed[count] = 0;
+                matched[count] = true;
+                count++;
+                out[events++] = {true, seen[i]};
+            }
+        }
+        for (size_t j = 0; j < count;) {
+            if (!matched[j] && ++missed[j] >= missed_bursts_to_leave) {
+                out[events++] = {false, cards[j]};
+                count--;
+                cards[j] = cards[count];
+                missed[j] = missed[count];
+                matched[j] = matched[count];
+            } else {
+                j++;
+            }
+        }
+        return events;
+    }
+
+    size_t present() const { return count; }
+
+private:
+    tag_table::Uid cards[max_cards];
+    uint8_t missed[max_cards] = {};
+    size_t count = 0;
+};
+
+} // namespace rfid_scan
+#endif // RFID_SCAN_HPP
@@ -0,0 +1,158 @@
+#ifndef TAG_TABLE_HPP
+#define TAG_TABLE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * RFID tag bindings: UID -> event index.
+ *
+ * UIDs are kept as binary keys (ISO 14443 UIDs are 4, 7 or 10 bytes) in an
+ * open-addressing hash table with linear probing. A lookup hashes the UID once
+ * and usually compares one slot, however many tags are bound. Erasing shifts
+ * the following entries back instead of leaving tombstones, so lookups stay
+ * short after many rebinds. No Arduino calls: it also builds on a PC (see
+ * tools/tagbench).
+ */
+namespace tag_table {
+
+const uint8_t max_uid_length = 10;
+const uint8_t no_event = 0xFF;
+
+struct Uid {
+    uint8_t size; // 0: empty slot
+    uint8_t bytes[max_uid_length];
+
+    bool operator==(const Uid& other) const {
+        return size == other.size && memcmp(bytes, other.bytes, size) == 0;
+    }
+};
+
+/**
+ * @brief FNV-1a over the length and the UID bytes.
+ */
+uint32_t hash(const Uid& uid) {
+    uint32_t h = 2166136261u;
+    h = (h ^ uid.size) * 16777619u;
+    for (uint8_t i = 0; i < uid.size; i++) {
+        h = (h ^ uid.bytes[i]) * 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @brief CAPACITY slots (a power of two), filled to at most 3/4.
+ */
+template <size_t CAPACITY>
+class TagTable {
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+
+public:
+    static const size_t max_tags = CAPACITY / 4 * 3;
+
+    struct Slot {
+        Uid uid;
+        uint8_t event;
+    };
+
+    size_t size() const { return count; }
+
+    /**
+     * @return The bound event, or -1 for an unknown tag.
+     */
+    int find(const Uid& uid) const {
+        if (uid.size == 0) return -1;
+        for (size_t i = hash(uid) & mask;; i = (i + 1) & mask) {
+            if (slots[i].uid.size == 0) return -1;
+            if (slots[i].uid == uid) return slots[i].event;
+        }
+    }
+
+    /**
+     * @brief Binds a tag to an event, replacing an existing binding.
+     * @return false if the UID is invalid or the table is full.
+     */
+    bool bind(const Uid& uid, uint8_t event) {
+        if (uid.size == 0 || uid.size > max_uid_length) return false;
+        size_t i = hash(uid) & mask;
+        for (; slots[i].uid.size != 0; i = (i + 1) & mask) {
+            if (slots[i].uid == uid) {
+                slots[i].event = event;
+                return true;
+            }
+        }
+        if (count >= max_tags) return false;
+        memset(&slots[i], 0, sizeof(Slot));
+        slots[i].uid.size = uid.size;
+        memcpy(slots[i].uid.bytes, uid.bytes, uid.size);
+        slots[i].event = event;
+        count++;
+        return true;
+    }
+
+    /**
+     * @return false if the tag was not bound.
+     */
+    bool erase(const Uid& uid) {
+        if (uid.size == 0) return false;
+        size_t i = hash(uid) & mask;
+        while (!(slots[i].uid == uid)) {
+            if (slots[i].uid.size == 0) return false;
+            i = (i + 1) & mask;
+        }
+        // Backward shift: move up every later entry of the cluster that may live in the hole
+        for (size_t j = (i + 1) & mask; slots[j].uid.size != 0; j = (j + 1) & mask) {
+            size_t home = hash(slots[j].uid) & mask;
+            // Keep j where it is if its home lies cyclically in (i, j]
+            bool stays = i <= j ? (home > i && home <= j) : (home > i || home <= j);
+            if (!stays) {
+                slots[i] = slots[j];
+                i = j;
+            }
+        }
+        slots[i].uid.size = 0;
+        count--;
+        return true;
+    }
+
+    /**
+     * @brief Removes every tag bound to event.
+     * @return The number of tags removed.
+     */
+    size_t eraseEvent(uint8_t event) {
+        size_t removed = 0;
+        size_t pass;
+        do {
+            // A shift across the end of the array can move an entry behind the scan: scan again
+            pass = 0;
+            for (size_t i = 0; i < CAPACITY;) {
+                if (slots[i].uid.size != 0 && slots[i].event == event) {
+                    Uid uid = slots[i].uid;
+                    erase(uid); // May shift another entry into slot i: look at it again
+                    pass++;
+                } else {
+                    i++;
+                }
+            }
+            removed += pass;
+        } while (pass > 0);
+        return removed;
+    }
+
+    void clear() {
+        memset(slots, 0, sizeof(slots));
+        count = 0;
+    }
+
+    const Slot& slot(size_t i) const { return slots[i]; }
+    static size_t capacity() { return CAPACITY; }
+
+private:
+    static const size_t mask = CAPACITY - 1;
+    Slot slots[CAPACITY] = {};
+    size_t count = 0;
+};
+
+} // namespace tag_table
+#endif // TAG_TABLE_HPP
@@ -0,0 +1,225 @@
+#ifndef TAGS_HPP
+#define TAGS_HPP
+
+#include <Arduino.h>
+#include "FS.h"
+#include <LittleFS.h>
+#include "esp_rom_crc.h"
+#include "tag_table.hpp"
+#include "calendar.hpp"
+
+/**
+ * Persistent RFID tag bindings.
+ *
+ * The bindings live in a tag_table::TagTable in RAM. Every change is appended
+ * to a log on LittleFS as one fixed-size record with a CRC32, so a bind costs
+ * a 16-byte write instead of rewriting the whole set. On boot the log is
+ * replayed. A record torn by a reset fails its CRC and ends the replay. The
+ * log is compacted to one record per live binding (written to a temporary
+ * file, then renamed) when it grows well past the live set or had a torn tail.
+ */
+namespace tags {
+
+// --- Configuration ---
+const char* logPath = "/tags.log";
+const char* logTmpPath = "/tags.tmp";
+const size_t capacity = 4096;     // Slots: up to 3072 tags, 48 KB of RAM
+const size_t max_events = calendar::max_events; // Events that can own tags (index < max_events)
+const size_t compact_slack = 64;  // Compact when records > 2 * live + slack
+
+struct Record {
+    uint8_t size;                              // UID length
+    uint8_t uid[tag_table::max_uid_length];
+    uint8_t event;                             // tag_table::no_event: binding removed
+    uint32_t crc;                              // CRC32 over the fields above
+};
+
+// --- State Variables ---
+bool ready = false;
+tag_table::TagTable<capacity> table;
+uint16_t event_tags[max_events] = {};
+size_t log_records = 0;
+
+uint32_t recordCrc(const Record& record) {
+    return esp_rom_crc32_le(0, (const uint8_t*)&record, offsetof(Record, crc));
+}
+
+Record makeRecord(const tag_table::Uid& uid, uint8_t event) {
+    Record record;
+    memset(&record, 0, sizeof(record));
+    record.size = uid.size;
+    memcpy(record.uid, uid.bytes, uid.size);
+    record.event = event;
+    record.crc = recordCrc(record);
+    return record;
+}
+
+void countTag(uint8_t event, int delta) {
+    if (event < max_events) {
+        event_tags[event] += delta;
+    }
+}
+
+/**
+ * @brief Applies a binding in RAM only.
+ * @return false if the table is full.
+ */
+bool apply(const tag_table::Uid& uid, uint8_t event) {
+    int previous = table.find(uid);
+    if (event == tag_table::no_event) {
+        if (previous >= 0 && table.erase(uid)) countTag(previous, -1);
+        return true;
+    }
+    if (!table.bind(uid, event)) {
+        return false;
+    }
+    if (previous >= 0) countTag(previous, -1);
+    countTag(event, +1);
+    return true;
+}
+
+/**
+ * @brief Rewrites the log with one record per live binding.
+ */
+bool compact() {
+    File file = LittleFS.open(logTmpPath, FILE_WRITE);
+    if (!file) {
+        Serial.println("[TAGS] Failed to write compacted log.");
+        return false;
+    }
+    size_t written = 0;
+    for (size_t i = 0; i < table.capacity(); i++) {
+        const auto& slot = table.slot(i);
+        if (slot.uid.size == 0) continue;
+        Record record = makeRecord(slot.uid, slot.event);
+        if (file.write((const uint8_t*)&record, sizeof(record)) != sizeof(record)) {
+            file.close();
+            LittleFS.remove(logTmpPath);
+            Serial.println("[TAGS] Failed to write compacted log.");
+            return false;
+        }
+        written++;
+    }
+    file.close();
+    // rename() is atomic in LittleFS: the log is either the old one or the compacted one
+    LittleFS.rename(logTmpPath, logPath);
+    log_records = written;
+    return true;
+}
+
+bool append(const tag_table::Uid& uid, uint8_t event) {
+    if (!ready) {
+        return false;
+    }
+    Record record = makeRecord(uid, event);
+    File file = LittleFS.open(logPath, FILE_APPEND);
+    if (!file) {
+        Serial.println("[TAGS] Failed to open the log.");
+        return false;
+    }
+    bool ok = file.write((const uint8_t*)&record, sizeof(record)) == sizeof(record);
+    file.close();
+    if (!ok) {
+        Serial.println("[TAGS] Failed to append to the log.");
+        return false;
+    }
+    log_records++;
+    if (log_records > 2 * table.size() + compact_slack) {
+        compact();
+    }
+    return true;
+}
+
+/**
+ * @brief Mounts LittleFS and replays the log.
+ * @return false if the filesystem is unavailable (bindings then live in RAM only).
+ */
+bool init() {
+    if (!LittleFS.begin(true)) {
+        Serial.println("[TAGS] An error occurred while mounting LittleFS.");
+        return false;
+    }
+    table.clear();
+    memset(event_tags, 0, sizeof(event_tags));
+    log_records = 0;
+
+    bool torn = false;
+    File file = LittleFS.open(logPath, FILE_READ);
+    if (file) {
+        Record record;
+        while (true) {
+            size_t n = file.read((uint8_t*)&record, sizeof(record));
+            if (n == 0) break;
+            if (n != sizeof(record) || record.crc != recordCrc(record) || record.size == 0 ||
+                record.size > tag_table::max_uid_length) {
+                torn = true;
+                break;
+            }
+            tag_table::Uid uid;
+            uid.size = record.size;
+            memcpy(uid.bytes, record.uid, record.size);
+            apply(uid, record.event);
+            log_records++;
+        }
+        file.close();
+    }
+    ready = true;
+    Serial.printf("[TAGS] %u tag(s) loaded from %u record(s)%s.\n", (unsigned)table.size(), (unsigned)log_records,
+                  torn ? ", torn tail dropped" : "");
+    // Never append behind a torn record; also drop superseded records
+    if (torn || log_records > 2 * table.size() + compact_slack) {
+        compact();
+    }
+    return true;
+}
+
+/**
+ * @return The event bound to the tag, or -1.
+ */
+int find(const tag_table::Uid& uid) {
+    return table.find(uid);
+}
+
+size_t countFor(uint8_t event) {
+    return event < max_events ? event_tags[event] : 0;
+}
+
+/**
+ * @brief Binds (or rebinds) a tag and persists the change.
+ * @return false if the table is full.
+ */
+bool bind(const tag_table::Uid& uid, uint8_t event) {
+    if (table.find(uid) == event) {
+        return true;
+    }
+    if (!apply(uid, event)) {
+        Serial.println("[TAGS] Tag table full.");
+        return false;
+    }
+    append(uid, event);
+    return true;
+}
+
+void unbind(const tag_table::Uid& uid) {
+    if (table.find(uid) < 0) {
+        return;
+    }
+    apply(uid, tag_table::no_event);
+    append(uid, tag_table::no_event);
+}
+
+/**
+ * @brief Removes every tag of an event (e.g. when the event is deleted).
+ */
+void unbindEvent(uint8_t event) {
+    if (table.eraseEvent(event) == 0) {
+        return;
+    }
+    countTag(event, -(int)countFor(event));
+    if (ready) {
+        compact(); // One rewrite instead of a removal record per tag
+    }
+}
+
+} // namespace tags
+#endif // TAGS_HPP
@@ -0,0 +1,122 @@
+#ifndef UPDATE_PROGRESS_HPP
+#define UPDATE_PROGRESS_HPP
+
+#include <Arduino.h>
+#include "lcd.hpp"
+
+/**
+ * Progress of the firmware update in flight, ElegantOTA's or delta_ota's.
+ *
+ * The upload handlers (ElegantOTA's in the web server's task, delta_ota's in
+ * OTA_Task) only store counters here. report() runs in loop(): it puts the percentage and the throughput on
+ * the LCD over the countdown (without holding back scans, see lcd::showProgress)
+ * and on Serial, so the application keeps running while the image comes in.
+ */
+namespace update_progress {
+
+// --- Configuration ---
+const unsigned long lcd_interval_millis = 250;
+const unsigned long serial_interval_millis = 2000;
+const uint32_t overlay_millis = 1500;           // Outlives one interval: no flicker between frames
+const uint32_t result_millis = 4000;
+
+enum class Phase : uint8_t { Idle, Receiving, Verifying, Done, Failed };
+
+// --- State Variables (written by the upload handler) ---
+volatile Phase phase = Phase::Idle;
+const char* volatile source = "";
+const char* volatile failure = "";
+volatile uint32_t received = 0;       // Upload bytes
+volatile uint32_t expected = 0;       // Content length, 0 if unknown
+volatile uint32_t written = 0;        // Image bytes in flash
+volatile unsigned long started_millis = 0;
+volatile unsigned long ended_millis = 0;
+
+// --- Loop side ---
+Phase shown = Phase::Idle;
+unsigned long last_lcd = 0;
+unsigned long last_serial = 0;
+int last_percent = -1;
+
+void start(const char* name, uint32_t content_length) {
+    source = name;
+    failure = "";
+    received = 0;
+    written = 0;
+    expected = content_length;
+    started_millis = millis();
+    phase = Phase::Receiving;
+}
+
+void advance(uint32_t upload_bytes, uint32_t image_bytes) {
+    received = upload_bytes;
+    written = image_bytes;
+}
+
+void verifying() { phase = Phase::Verifying; }
+
+void end(bool ok, const char* why = "") {
+    failure = why;
+    ended_millis = millis();
+    phase = ok ? Phase::Done : Phase::Failed;
+}
+
+bool active() { return phase == Phase::Receiving || phase == Phase::Verifying; }
+
+/**
+ * @brief KB/s of upload so far (or over the whole upload once it has ended).
+ */
+uint32_t throughput() {
+    unsigned long until = active() ? millis() : ended_millis;
+    unsigned long elapsed = until - started_millis;
+    return elapsed > 0 ? (uint32_t)((uint64_t)received * 1000 / 1024 / elapsed) : 0;
+}
+
+void report() {
+    Phase now_phase = phase;
+    if (now_phase == Phase::Idle) return;
+    unsigned long now = millis();
+
+    if (now_phase == Phase::Done || now_phase == Phase::Failed) {
+        bool ok = now_phase == Phase::Done;
+        Serial.printf("[OTA] %s update %s: %u bytes in %lu ms (%u KB/s), %u bytes written%s%s\n", source,
+                      ok ? "done" : "failed", (unsigned)received, ended_millis - started_millis,
+                      (unsigned)throughput(), (unsigned)written, ok ? "" : ": ", ok ? "" : failure);
+        char line2[lcd::line_length + 1];
+        snprintf(line2, sizeof(line2), "%s", ok ? "Restarting..." : failure);
+        lcd::showProgress(ok ? "Update done" : "Update failed", line2, result_millis);
+        phase = Phase::Idle;
+        shown = Phase::Idle;
+        last_percent = -1;
+        return;
+    }
+
+    // Content length counts the form around the file: 99% until it is done
+    int percent = expected > 0 ? (int)((uint64_t)received * 100 / expected) : -1;
+    if (percent > 99) percent = 99;
+    bool changed = now_phase != shown || percent != last_percent;
+    bool expiring = now - last_lcd >= overlay_millis / 2;
+    if ((changed || expiring) && now - last_lcd >= lcd_interval_millis) {
+        char line1[lcd::line_length + 1], line2[lcd::line_length + 1];
+        if (now_phase == Phase::Verifying) {
+            snprintf(line1, sizeof(line1), "Update checking");
+        } else if (percent >= 0) {
+            snprintf(line1, sizeof(line1), "Update %3d%%", percent);
+        } else {
+            snprintf(line1, sizeof(line1), "Update %uK", (unsigned)(received / 1024));
+        }
+        snprintf(line2, sizeof(line2), "%uKB/s %uK", (unsigned)throughput(), (unsigned)(written / 1024));
+        lcd::showProgress(line1, line2, overlay_millis);
+        shown = now_phase;
+        last_percent = percent;
+        last_lcd = now;
+    }
+    if (now - last_serial >= serial_interval_millis) {
+        Serial.printf("[OTA] %s: %u of %u bytes, %u KB/s, %u bytes written\n", source, (unsigned)received,
+                      (unsigned)expected, (unsigned)throughput(), (unsigned)written);
+        last_serial = now;
+    }
+}
+
+} // namespace update_progress
+#endif // UPDATE_PROGRESS_HPP
@@ -0,0 +1,41 @@
+#ifndef CONNECTIVITY_CONFIG_H
+#define CONNECTIVITY_CONFIG_H
+
+/**
+ * Connection settings shared by sta.hpp and mqtt.hpp.
+ *
+ * Every value can be overridden with a build flag, e.g.
+ *   build_flags = -D WIFI_SSID=\"MyNet\" -D MQTT_HOST=\"10.0.0.2\"
+ * or in credentials.h next to this file (git-ignored, see credentials.example.h).
+ */
+#if __has_include("credentials.h")
+#include "credentials.h"
+#endif
+
+#ifndef WIFI_SSID
+#define WIFI_SSID "Home2.4"
+#endif
+#ifndef WIFI_PASSWORD
+#define WIFI_PASSWORD "DontPanic42!"
+#endif
+
+#ifndef MQTT_HOST
+#define MQTT_HOST "192.168.0.102"
+#endif
+#ifndef MQTT_PORT
+#define MQTT_PORT 1883
+#endif
+#ifndef MQTT_USER
+#define MQTT_USER "admin"
+#endif
+#ifndef MQTT_PASSWORD
+#define MQTT_PASSWORD "admin"
+#endif
+#ifndef MQTT_TX_TOPIC
+#define MQTT_TX_TOPIC "esp32/0ad3/tx"
+#endif
+#ifndef MQTT_RX_TOPIC
+#define MQTT_RX_TOPIC "esp32/0ad3/rx"
+#endif
+
+#endif // CONNECTIVITY_CONFIG_H
@@ -0,0 +1,9 @@
+// Copy to credentials.h (git-ignored) and fill in; values here override the
+// defaults in connectivity_config.h for every lab that uses this library.
+#define WIFI_SSID "MyNetwork"
+#define WIFI_PASSWORD "secret"
+#define MQTT_HOST "192.168.0.102"
+#define MQTT_USER "admin"
+#define MQTT_PASSWORD "admin"
+// lab7_2: /delta then takes only images signed with this key (tools/otadiff ... key)
+// #define OTA_SIGNING_KEY "a long random string"
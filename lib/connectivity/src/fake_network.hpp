@@ -0,0 +1,798 @@
+#ifndef FAKE_NETWORK_HPP
+#define FAKE_NETWORK_HPP
+
+/**
+ * Host-side stand-in for the Arduino, FreeRTOS, Wi-Fi and socket APIs used by
+ * sta.hpp and mqtt.hpp, so the connectivity logic can be exercised on a PC:
+ *
+ *   g++ -std=gnu++17 -I lib/connectivity/src my_scenario.cpp
+ *
+ * Time is simulated: nothing happens until fake::advance() (or delay()) moves the
+ * clock, which also fires timers and Wi-Fi events. fake::wifi scripts the access
+ * point (presence, RSSI, connect latency) and fake::broker plays an MQTT broker
+ * that records publishes, answers QoS 1 with PUBACK and can go down, stop acking,
+ * delay its PUBACKs or lose a share of the publishes and acks.
+ *
+ * Tasks that wait on an event group register a step in fake::tasks, run after
+ * every simulated millisecond. While a timer or Wi-Fi event callback runs,
+ * fake::inCallback is set, and fake::blockingInCallbacks counts the joins, RSSI
+ * reads and NVS writes made from it (on the device they would stall the timer
+ * service or the Wi-Fi event task).
+ *
+ * Only included when ARDUINO is not defined; device builds never see it.
+ */
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// --- Arduino core ---
+
+#define RTC_DATA_ATTR
+#define HEX 16
+
+namespace fake {
+uint64_t nowMicros = 0;
+uint64_t rtcBootMicros = 0;        // RTC time at boot: kept through deep sleep, 0 after a power loss
+bool inCallback = false;
+uint32_t blockingInCallbacks = 0;
+void advance(unsigned long ms);
+} // namespace fake
+
+inline unsigned long millis() { return fake::nowMicros / 1000; }
+inline unsigned long micros() { return fake::nowMicros; }
+inline void delay(unsigned long ms) { fake::advance(ms); }
+inline long random(long max) { return max > 0 ? rand() % max : 0; }
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+class String {
+public:
+    String() {}
+    String(const char* s) : s(s) {}
+    String(const std::string& s) : s(s) {}
+    String(long value, int base = 10) {
+        char buffer[24];
+        snprintf(buffer, sizeof(buffer), base == HEX ? "%lx" : "%ld", value);
+        s = buffer;
+    }
+    String& operator+=(const String& other) { s += other.s; return *this; }
+    String operator+(const String& other) const { return String(s + other.s); }
+    bool operator==(const char* other) const { return s == other; }
+    const char* c_str() const { return s.c_str(); }
+    size_t length() const { return s.size(); }
+
+private:
+    std::string s;
+};
+
+struct FakeSerial {
+    bool quiet = false; // Scenarios with many reconnects can silence the logs
+
+    void begin(unsigned long) {}
+    void flush() { fflush(stdout); }
+    int printf(const char* format, ...) {
+        if (quiet) return 0;
+        va_list args;
+        va_start(args, format);
+        int n = vprintf(format, args);
+        va_end(args);
+        return n;
+    }
+    void print(const char* s) { printf("%s", s); }
+    void println(const char* s = "") { printf("%s\n", s); }
+    void println(const String& s) { println(s.c_str()); }
+};
+
+FakeSerial Serial;
+
+class IPAddress {
+public:
+    IPAddress() {}
+    IPAddress(uint32_t address) : address(address) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+        : address(a | (b << 8) | (c << 16) | ((uint32_t)d << 24)) {}
+    operator uint32_t() const { return address; }
+
+    bool fromString(const char* s) {
+        unsigned a, b, c, d;
+        char tail;
+        if (sscanf(s, "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) != 4 || a > 255 || b > 255 || c > 255 || d > 255) {
+            return false;
+        }
+        *this = IPAddress(a, b, c, d);
+        return true;
+    }
+
+    String toString() const {
+        char buffer[16];
+        snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", address & 0xFF, (address >> 8) & 0xFF,
+                 (address >> 16) & 0xFF, address >> 24);
+        return String(buffer);
+    }
+
+private:
+    uint32_t address = 0;
+};
+
+// --- FreeRTOS (one tick per millisecond) ---
+
+typedef int32_t BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t EventBits_t;
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define BIT0 0x01
+#define BIT1 0x02
+#define BIT2 0x04
+#define BIT3 0x08
+#define portMAX_DELAY 0xFFFFFFFFU
+
+struct FakeEventGroup {
+    EventBits_t bits = 0;
+};
+typedef FakeEventGroup* EventGroupHandle_t;
+
+struct FakeTimer;
+typedef FakeTimer* TimerHandle_t;
+
+struct FakeTimer {
+    TickType_t period;
+    bool autoReload;
+    void (*callback)(TimerHandle_t);
+    bool active = false;
+    unsigned long expiryMillis = 0;
+};
+
+namespace fake {
+std::vector<FakeTimer*> timers;
+std::vector<void (*)()> tasks;
+} // namespace fake
+
+inline EventGroupHandle_t xEventGroupCreate() { return new FakeEventGroup(); }
+inline EventBits_t xEventGroupGetBits(EventGroupHandle_t group) { return group->bits; }
+inline EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) { return group->bits |= bits; }
+inline EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    EventBits_t before = group->bits;
+    group->bits &= ~bits;
+    return before;
+}
+
+/**
+ * "Blocks" by running the simulation forward until the bits are set or the timeout expires.
+ */
+inline EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clearOnExit,
+                                       BaseType_t waitForAll, TickType_t ticks) {
+    unsigned long start = millis();
+    auto satisfied = [&]() {
+        return waitForAll ? (group->bits & bits) == bits : (group->bits & bits) != 0;
+    };
+    while (!satisfied() && millis() - start < ticks) {
+        fake::advance(1);
+    }
+    EventBits_t result = group->bits;
+    if (satisfied() && clearOnExit) group->bits &= ~bits;
+    return result;
+}
+
+inline TimerHandle_t xTimerCreate(const char*, TickType_t period, UBaseType_t autoReload, void*,
+                                  void (*callback)(TimerHandle_t)) {
+    FakeTimer* timer = new FakeTimer{period, autoReload != 0, callback};
+    fake::timers.push_back(timer);
+    return timer;
+}
+
+inline BaseType_t xTimerStart(TimerHandle_t timer, TickType_t) {
+    timer->active = true;
+    timer->expiryMillis = millis() + timer->period;
+    return pdPASS;
+}
+
+inline BaseType_t xTimerStop(TimerHandle_t timer, TickType_t) {
+    timer->active = false;
+    return pdPASS;
+}
+
+// --- Preferences (NVS), kept in memory for the whole run ---
+
+namespace fake {
+std::map<std::string, std::vector<uint8_t>> nvs;
+} // namespace fake
+
+class Preferences {
+public:
+    bool begin(const char* name, bool = false) {
+        space = name;
+        return true;
+    }
+    void end() {}
+
+    size_t getBytes(const char* key, void* buffer, size_t length) {
+        auto it = fake::nvs.find(space + "/" + key);
+        if (it == fake::nvs.end() || it->second.size() > length) return 0;
+        memcpy(buffer, it->second.data(), it->second.size());
+        return it->second.size();
+    }
+
+    size_t putBytes(const char* key, const void* value, size_t length) {
+        fake::blockingInCallbacks += fake::inCallback;
+        const uint8_t* bytes = (const uint8_t*)value;
+        fake::nvs[space + "/" + key].assign(bytes, bytes + length);
+        return length;
+    }
+
+private:
+    std::string space;
+};
+
+// --- Wi-Fi ---
+
+typedef enum { WL_IDLE_STATUS, WL_CONNECTED, WL_DISCONNECTED } wl_status_t;
+typedef enum { WIFI_OFF, WIFI_STA } wifi_mode_t;
+typedef enum {
+    ARDUINO_EVENT_WIFI_STA_START,
+    ARDUINO_EVENT_WIFI_STA_CONNECTED,
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP
+} WiFiEvent_t;
+
+// wifi_err_reason_t values the fake produces
+const uint8_t WIFI_REASON_BEACON_TIMEOUT = 200;
+const uint8_t WIFI_REASON_NO_AP_FOUND = 201;
+
+typedef union {
+    struct {
+        uint8_t reason;
+    } wifi_sta_disconnected;
+} WiFiEventInfo_t;
+
+/**
+ * Scriptable station: joins when the access point is up, after a delay that depends
+ * on whether the caller supplied the right BSSID/channel (fast path) or needs a scan.
+ */
+class FakeWiFi {
+public:
+    // --- Scenario knobs ---
+    bool apUp = true;
+    int8_t rssi = -60;
+    uint8_t apBssid[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+    int32_t apChannel = 6;
+    unsigned long scanConnectMillis = 2500;  // Scan, associate, DHCP
+    unsigned long fastConnectMillis = 300;   // Known BSSID/channel, static IP
+    unsigned long dhcpMillis = 700;          // Added to the fast path without a static IP
+    uint32_t leaseSeconds = 7200;            // Handed out with every DHCP address
+    unsigned long failMillis = 3000;         // Until NO_AP_FOUND when the AP is down
+    IPAddress dhcpAddress = IPAddress(192, 168, 0, 50);
+    IPAddress gateway = IPAddress(192, 168, 0, 1);
+    uint32_t connectAttempts = 0;
+    uint32_t fastAttempts = 0;
+
+    /**
+     * @brief Takes the access point away: a connected station gets a beacon timeout.
+     */
+    void dropAp() {
+        apUp = false;
+        if (status_ == WL_CONNECTED) {
+            status_ = WL_DISCONNECTED;
+            post(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_BEACON_TIMEOUT, millis());
+        }
+    }
+
+    void restoreAp() { apUp = true; }
+
+    // --- Arduino WiFi API ---
+    void onEvent(void (*handler)(WiFiEvent_t, WiFiEventInfo_t)) { handlers.push_back(handler); }
+    bool persistent(bool) { return true; }
+    void setAutoReconnect(bool) {}
+    bool enableSTA(bool enable) { return mode(enable ? WIFI_STA : WIFI_OFF); }
+    bool mode(wifi_mode_t mode) {
+        if (mode == WIFI_OFF) disconnect();
+        return true;
+    }
+
+    bool config(IPAddress ip, IPAddress, IPAddress, IPAddress = IPAddress()) {
+        fake::blockingInCallbacks += fake::inCallback;
+        staticAddress = ip;
+        return true;
+    }
+
+    void begin(const char*, const char*, int32_t channel = 0, const uint8_t* bssid = nullptr) {
+        fake::blockingInCallbacks += fake::inCallback;
+        connectAttempts++;
+        pending.clear();
+        status_ = WL_DISCONNECTED;
+        bool fast = channel == apChannel && bssid != nullptr && memcmp(bssid, apBssid, 6) == 0;
+        if (fast) fastAttempts++;
+        if (!apUp) {
+            post(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_NO_AP_FOUND, millis() + failMillis);
+            return;
+        }
+        unsigned long latency = fast ? fastConnectMillis + ((uint32_t)staticAddress != 0 ? 0 : dhcpMillis)
+                                     : scanConnectMillis;
+        post(ARDUINO_EVENT_WIFI_STA_GOT_IP, 0, millis() + latency);
+    }
+
+    bool disconnect(bool = false) {
+        pending.clear();
+        status_ = WL_DISCONNECTED;
+        return true;
+    }
+
+    wl_status_t status() { return status_; }
+    int8_t RSSI() {
+        fake::blockingInCallbacks += fake::inCallback;
+        return status_ == WL_CONNECTED ? rssi : 0;
+    }
+    IPAddress localIP() { return status_ == WL_CONNECTED ? address : IPAddress(); }
+    IPAddress gatewayIP() { return gateway; }
+    IPAddress subnetMask() { return IPAddress(255, 255, 255, 0); }
+    IPAddress dnsIP(uint8_t = 0) { return gateway; }
+    uint8_t* BSSID() { return apBssid; }
+    int32_t channel() { return apChannel; }
+    String macAddress() { return String("02:00:00:00:00:AA"); }
+    int hostByName(const char* host, IPAddress& ip) { return ip.fromString(host) ? 1 : 0; }
+
+    /**
+     * @brief Delivers events that are due; called by fake::advance().
+     */
+    void service() {
+        while (!pending.empty() && pending.front().dueMillis <= millis()) {
+            Pending event = pending.front();
+            pending.pop_front();
+            if (event.event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+                if (!apUp) {
+                    event.event = ARDUINO_EVENT_WIFI_STA_DISCONNECTED;
+                    event.reason = WIFI_REASON_NO_AP_FOUND;
+                } else {
+                    status_ = WL_CONNECTED;
+                    address = (uint32_t)staticAddress != 0 ? staticAddress : dhcpAddress;
+                    if ((uint32_t)staticAddress == 0) lease = leaseSeconds;
+                }
+            }
+            WiFiEventInfo_t info = {};
+            info.wifi_sta_disconnected.reason = event.reason;
+            fake::inCallback = true;
+            for (auto handler : handlers) handler(event.event, info);
+            fake::inCallback = false;
+        }
+    }
+
+private:
+    struct Pending {
+        WiFiEvent_t event;
+        uint8_t reason;
+        unsigned long dueMillis;
+    };
+
+    void post(WiFiEvent_t event, uint8_t reason, unsigned long dueMillis) {
+        pending.push_back({event, reason, dueMillis});
+    }
+
+    std::vector<void (*)(WiFiEvent_t, WiFiEventInfo_t)> handlers;
+    std::deque<Pending> pending;
+    wl_status_t status_ = WL_IDLE_STATUS;
+    IPAddress staticAddress;
+    IPAddress address;
+
+public:
+    uint32_t lease = 0; // Of the last DHCP address, as lwIP's offered_t0_lease
+};
+
+FakeWiFi WiFi;
+
+// --- ESP-IDF and lwIP, for the RTC time and the DHCP lease ---
+
+inline uint64_t esp_rtc_get_time_us() { return fake::rtcBootMicros + fake::nowMicros; }
+
+struct dhcp {
+    uint32_t offered_t0_lease;
+};
+struct netif {
+    struct dhcp client;
+};
+typedef struct netif esp_netif_t;
+#define netif_dhcp_data(n) (&(n)->client)
+
+namespace fake {
+esp_netif_t staNetif;
+} // namespace fake
+
+inline esp_netif_t* esp_netif_get_handle_from_ifkey(const char*) { return &fake::staNetif; }
+inline void* esp_netif_get_netif_impl(esp_netif_t* handle) {
+    handle->client.offered_t0_lease = WiFi.lease;
+    return handle;
+}
+
+// --- MQTT broker and sockets ---
+
+#define MQTTCONNECT (1 << 4)
+#define MQTTPUBLISH (3 << 4)
+#define MQTTPUBACK (4 << 4)
+#define MQTTQOS1 (1 << 1)
+#define MQTT_KEEPALIVE 15
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char*, uint8_t*, unsigned int)> callback
+
+namespace fake {
+
+struct Message {
+    std::string topic;
+    std::string payload;
+    uint8_t qos;
+    bool duplicate;
+    unsigned long atMillis;
+};
+
+/**
+ * In-process broker. Sockets are plain integers; each one has an inbound byte
+ * queue (broker -> client) and a frame parser for what the client writes.
+ */
+class Broker {
+public:
+    // --- Scenario knobs ---
+    bool up = true;
+    bool acking = true;                   // false: QoS 1 publishes are swallowed without PUBACK
+    unsigned long connectMillis = 20;     // TCP connect latency
+    unsigned long ackDelayMillis = 0;     // Round trip: a PUBACK reaches the client this much later
+    float publishLoss = 0;                // Share of QoS 1 publishes lost on the way in
+    float ackLoss = 0;                    // Share of PUBACKs lost on the way back
+    std::vector<Message> received;
+    std::vector<std::string> subscriptions;
+    uint32_t connects = 0;                // CONNECT packets seen
+    uint32_t rejected = 0;                // Sockets dropped for publishing before CONNECT
+
+    /**
+     * @brief Drops every session, as a broker restart would.
+     */
+    void restart() {
+        for (auto& entry : sockets) entry.second.open = false;
+    }
+
+    /**
+     * @brief Queues a message for subscribers; delivered by the next client loop().
+     */
+    void inject(const std::string& topic, const std::string& payload) {
+        outbox.push_back({topic, payload, 0, false, millis()});
+    }
+
+    size_t countOn(const std::string& topic) const {
+        size_t n = 0;
+        for (const Message& m : received) n += m.topic == topic;
+        return n;
+    }
+
+    // --- Used by the fake transport / client ---
+    int open() {
+        int fd = nextFd++;
+        sockets[fd].openedMillis = millis();
+        return fd;
+    }
+
+    int poll(int fd) {
+        auto it = sockets.find(fd);
+        if (it == sockets.end() || !up || WiFi.status() != WL_CONNECTED) return -1;
+        return millis() - it->second.openedMillis >= connectMillis ? 1 : 0;
+    }
+
+    // Like an lwIP socket, an open one outlives the link: only the app or a timeout closes it
+    bool isOpen(int fd) {
+        auto it = sockets.find(fd);
+        return it != sockets.end() && it->second.open && up;
+    }
+
+    void close(int fd) { sockets.erase(fd); }
+
+    size_t write(int fd, const uint8_t* data, size_t size) {
+        if (!isOpen(fd)) return 0;
+        if (WiFi.status() != WL_CONNECTED) return size; // Sent into the void
+        Socket& socket = sockets[fd];
+        socket.frame.insert(socket.frame.end(), data, data + size);
+        parse(fd, socket);
+        return size;
+    }
+
+    std::deque<uint8_t>* inbound(int fd) {
+        auto it = sockets.find(fd);
+        return it == sockets.end() ? nullptr : &it->second.inbound;
+    }
+
+    /**
+     * @brief Hands over the PUBACKs whose round trip is over; called by fake::advance().
+     */
+    void service() {
+        while (!delayed.empty() && delayed.front().dueMillis <= millis()) {
+            auto it = sockets.find(delayed.front().fd);
+            if (it != sockets.end() && it->second.open) {
+                it->second.inbound.insert(it->second.inbound.end(), delayed.front().ack, delayed.front().ack + 4);
+            }
+            delayed.pop_front();
+        }
+    }
+
+    std::deque<Message> outbox;
+
+private:
+    struct Socket {
+        bool open = true;
+        bool session = false;          // A CONNECT came first
+        unsigned long openedMillis = 0;
+        std::vector<uint8_t> frame;   // Client bytes not yet forming a full packet
+        std::deque<uint8_t> inbound;
+    };
+
+    struct DelayedAck {
+        int fd;
+        unsigned long dueMillis;
+        uint8_t ack[4];
+    };
+
+    static bool lose(float share) { return share > 0 && rand() < share * RAND_MAX; }
+
+    // Consumes complete packets; only PUBLISH needs an answer here. Anything
+    // before CONNECT is a protocol violation and closes the socket, as on a real broker
+    void parse(int fd, Socket& socket) {
+        std::vector<uint8_t>& f = socket.frame;
+        while (f.size() >= 2) {
+            uint32_t remaining = 0;
+            size_t pos = 1;
+            uint8_t shift = 0;
+            do {
+                if (pos >= f.size()) return;
+                remaining |= (uint32_t)(f[pos] & 0x7F) << shift;
+                shift += 7;
+            } while (f[pos++] & 0x80);
+            if (f.size() < pos + remaining) return;
+
+            uint8_t header = f[0];
+            if ((header & 0xF0) == MQTTCONNECT) {
+                socket.session = true;
+                connects++;
+            } else if (!socket.session) {
+                socket.open = false;
+                rejected++;
+                f.clear();
+                return;
+            } else if ((header & 0xF0) == MQTTPUBLISH) {
+                const uint8_t* body = f.data() + pos;
+                size_t topicLength = (body[0] << 8) | body[1];
+                uint8_t qos = (header >> 1) & 0x03;
+                size_t idLength = qos > 0 ? 2 : 0;
+                Message m;
+                m.topic.assign((const char*)body + 2, topicLength);
+                m.payload.assign((const char*)body + 2 + topicLength + idLength,
+                                 remaining - 2 - topicLength - idLength);
+                m.qos = qos;
+                m.duplicate = header & 0x08;
+                m.atMillis = millis();
+                bool lost = qos > 0 && lose(publishLoss);
+                if (!lost) received.push_back(m);
+                if (qos > 0 && acking && !lost && !lose(ackLoss)) {
+                    const uint8_t* id = body + 2 + topicLength;
+                    DelayedAck ack = {fd, millis() + ackDelayMillis, {MQTTPUBACK, 0x02, id[0], id[1]}};
+                    if (ackDelayMillis == 0) {
+                        socket.inbound.insert(socket.inbound.end(), ack.ack, ack.ack + sizeof(ack.ack));
+                    } else {
+                        delayed.push_back(ack);
+                    }
+                }
+            }
+            f.erase(f.begin(), f.begin() + pos + remaining);
+        }
+    }
+
+    std::map<int, Socket> sockets;
+    std::deque<DelayedAck> delayed; // In due order: the delay is the same for all
+    int nextFd = 3;
+};
+
+Broker broker;
+
+/**
+ * Same interface as the lwIP transport in mqtt.hpp.
+ */
+namespace transport {
+inline int open(IPAddress, uint16_t) { return broker.up ? broker.open() : -1; }
+inline int poll(int fd) { return broker.poll(fd); }
+inline void adopt(int, uint16_t) {}
+inline void close(int fd) { broker.close(fd); }
+} // namespace transport
+
+/**
+ * @brief Moves the simulated clock, firing timers and Wi-Fi events along the way.
+ */
+void advance(unsigned long ms) {
+    for (unsigned long i = 0; i < ms; i++) {
+        nowMicros += 1000;
+        WiFi.service();
+        broker.service();
+        for (FakeTimer* timer : timers) {
+            if (timer->active && millis() >= timer->expiryMillis) {
+                timer->active = timer->autoReload;
+                timer->expiryMillis = millis() + timer->period;
+                inCallback = true;
+                timer->callback(timer);
+                inCallback = false;
+            }
+        }
+        for (void (*task)() : tasks) task();
+    }
+}
+
+} // namespace fake
+
+class Client {
+public:
+    virtual ~Client() {}
+    virtual int connect(IPAddress ip, uint16_t port) = 0;
+    virtual int connect(const char* host, uint16_t port) = 0;
+    virtual size_t write(uint8_t b) = 0;
+    virtual size_t write(const uint8_t* buf, size_t size) = 0;
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int read(uint8_t* buf, size_t size) = 0;
+    virtual int peek() = 0;
+    virtual void flush() = 0;
+    virtual void stop() = 0;
+    virtual uint8_t connected() = 0;
+    virtual operator bool() = 0;
+};
+
+/**
+ * Socket wrapper over the fake broker; only adopted sockets are supported,
+ * as mqtt.hpp never lets WiFiClient connect by itself.
+ */
+class WiFiClient : public Client {
+public:
+    WiFiClient() {}
+    explicit WiFiClient(int fd) : socket(fd) {}
+
+    int connect(IPAddress, uint16_t) override { return 0; }
+    int connect(const char*, uint16_t) override { return 0; }
+    int connect(IPAddress, uint16_t, int32_t) { return 0; }
+    int connect(const char*, uint16_t, int32_t) { return 0; }
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t* buf, size_t size) override { return fake::broker.write(socket, buf, size); }
+    int available() override {
+        std::deque<uint8_t>* in = fake::broker.inbound(socket);
+        return in ? in->size() : 0;
+    }
+    int read() override {
+        uint8_t b;
+        return read(&b, 1) == 1 ? b : -1;
+    }
+    int read(uint8_t* buf, size_t size) override {
+        std::deque<uint8_t>* in = fake::broker.inbound(socket);
+        size_t n = 0;
+        while (in && n < size && !in->empty()) {
+            buf[n++] = in->front();
+            in->pop_front();
+        }
+        return n;
+    }
+    int peek() override {
+        std::deque<uint8_t>* in = fake::broker.inbound(socket);
+        return in && !in->empty() ? in->front() : -1;
+    }
+    void flush() override {}
+    void stop() override {
+        if (socket >= 0) fake::broker.close(socket);
+        socket = -1;
+    }
+    uint8_t connected() override { return socket >= 0 && fake::broker.isOpen(socket); }
+    operator bool() override { return socket >= 0; }
+    int fd() const { return socket; }
+
+private:
+    int socket = -1;
+};
+
+/**
+ * PubSubClient subset used by mqtt.hpp. Like the real one it reads the inbound
+ * stream through the Client it was given, so AckTrackingClient sees the PUBACKs.
+ */
+class PubSubClient {
+public:
+    explicit PubSubClient(Client& client) : client(client) {}
+
+    void setServer(const char*, uint16_t) {}
+    void setSocketTimeout(uint16_t) {}
+    void setCallback(MQTT_CALLBACK_SIGNATURE) { this->callback = callback; }
+
+    // Like the real one: a client still in MQTT_CONNECTED over a live socket sends no CONNECT
+    bool connect(const char*, const char*, const char*) {
+        if (connected()) return true;
+        const uint8_t packet[] = {MQTTCONNECT, 0}; // Variable header and payload left out
+        rc = client.write(packet, sizeof(packet)) == sizeof(packet) ? 0 : -2; // MQTT_CONNECT_FAILED
+        return rc == 0;
+    }
+
+    bool connected() {
+        if (client.connected()) return rc == 0;
+        if (rc == 0) {
+            rc = -3; // MQTT_CONNECTION_LOST
+            client.stop();
+        }
+        return false;
+    }
+    int state() { return rc; }
+
+    void disconnect() {
+        client.stop();
+        rc = -1; // MQTT_DISCONNECTED
+    }
+
+    bool subscribe(const char* topic, uint8_t = 0) {
+        if (!connected()) return false;
+        fake::broker.subscriptions.push_back(topic);
+        return true;
+    }
+
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length, bool = false) {
+        if (!connected()) return false;
+        std::vector<uint8_t> packet = frame(topic, length);
+        packet.insert(packet.end(), payload, payload + length);
+        return client.write(packet.data(), packet.size()) == packet.size();
+    }
+
+    bool publish(const char* topic, const char* payload) {
+        return publish(topic, (const uint8_t*)payload, strlen(payload));
+    }
+
+    bool beginPublish(const char* topic, unsigned int length, bool) {
+        if (!connected()) return false;
+        std::vector<uint8_t> header = frame(topic, length);
+        return client.write(header.data(), header.size()) == header.size();
+    }
+
+    size_t write(const uint8_t* buf, size_t size) { return client.write(buf, size); }
+    int endPublish() { return 1; }
+
+    bool loop() {
+        if (!connected()) {
+            rc = -3; // MQTT_CONNECTION_LOST
+            return false;
+        }
+        uint8_t buffer[64];
+        while (client.available() > 0) {
+            client.read(buffer, sizeof(buffer));
+        }
+        while (!fake::broker.outbox.empty()) {
+            fake::Message m = fake::broker.outbox.front();
+            fake::broker.outbox.pop_front();
+            if (callback) callback(&m.topic[0], (uint8_t*)&m.payload[0], m.payload.size());
+        }
+        return true;
+    }
+
+private:
+    static std::vector<uint8_t> frame(const char* topic, unsigned int length) {
+        size_t topicLength = strlen(topic);
+        uint32_t remaining = 2 + topicLength + length;
+        std::vector<uint8_t> packet = {MQTTPUBLISH};
+        do {
+            uint8_t digit = remaining & 0x7F;
+            remaining >>= 7;
+            packet.push_back(remaining > 0 ? (digit | 0x80) : digit);
+        } while (remaining > 0);
+        packet.push_back(topicLength >> 8);
+        packet.push_back(topicLength & 0xFF);
+        packet.insert(packet.end(), topic, topic + topicLength);
+        return packet;
+    }
+
+    Client& client;
+    std::function<void(char*, uint8_t*, unsigned int)> callback;
+    int rc = -1;
+};
+
+#endif // FAKE_NETWORK_HPP
@@ -0,0 +1,651 @@
+#ifndef MQTT_HPP
+#define MQTT_HPP
+
+#ifdef ARDUINO
+#include <WiFi.h>
+#include <lwip/sockets.h>
+#include <errno.h>
+#include "PubSubClient.h"
+#else
+#include "fake_network.hpp"
+#endif
+#include "connectivity_config.h"
+#include "sta.hpp"
+
+/**
+ * MQTT client with a non-blocking reconnect state machine, an offline queue and
+ * a QoS 1 in-flight window on top of PubSubClient.
+ *
+ * Reconnects wait for the Wi-Fi link (sta::connected()) and back off with jitter;
+ * a link-up event from sta cuts the backoff short so the session comes back as
+ * soon as the network does. Sockets are opened through the transport namespace,
+ * which the host build replaces with the fake network.
+ */
+namespace mqtt {
+
+const char* brokerHost = MQTT_HOST;
+const uint16_t brokerPort = MQTT_PORT;
+const char* txTopic = MQTT_TX_TOPIC;
+const char* rxTopic = MQTT_RX_TOPIC;
+const char* user = MQTT_USER;
+const char* password = MQTT_PASSWORD;
+
+// --- Reconnect policy ---
+const unsigned long backoffBaseMillis = 500;
+const unsigned long backoffMaxMillis = 30000;
+const unsigned long tcpConnectTimeoutMillis = 3000;
+const uint16_t handshakeTimeoutSeconds = 2;
+const unsigned long keepAliveMillis = MQTT_KEEPALIVE * 1000UL;
+const unsigned long wifiRecheckMillis = 1000;
+
+// --- Offline queue ---
+const size_t offlineQueueCapacity = 32;
+const size_t maxPayloadLength = 128;
+const size_t maxTopicLength = 64;          // QoS 1 packets are built in a fixed buffer
+size_t flushPerLoop = 4;                   // Runtime-tunable via the "batch" command
+
+// --- QoS 1 pipeline ---
+const size_t inflightWindow = 8;            // Unacknowledged QoS 1 messages on the wire at once
+const unsigned long ackTimeoutMillis = 3000; // Retransmit (with DUP) when no PUBACK arrives in time
+
+enum class State {
+    Backoff,       // Waiting for the next attempt (or for WiFi)
+    TcpConnecting, // Non-blocking TCP connect in progress
+    Connected      // MQTT session established
+};
+
+struct QueuedMessage {
+    const char* topic; // Must point to a string with static lifetime
+    char payload[maxPayloadLength];
+    uint16_t length;
+    uint8_t qos;
+};
+
+struct InflightMessage {
+    QueuedMessage message;
+    uint16_t packetId; // 0 marks a free slot
+    unsigned long sentMillis;
+    bool sent;         // false: (re)transmit as soon as the session allows
+    bool sentInSession; // Written in the current session: a resend carries DUP
+    bool everSent;     // Written in any session: a resend may duplicate at the broker
+};
+
+struct PipelineStats {
+    uint32_t published;     // QoS 1 messages handed to the window
+    uint32_t acked;
+    uint32_t retransmitted; // Resends of a message already written once: potential duplicates
+};
+
+/**
+ * @brief Client decorator that watches the inbound byte stream for PUBACK packets.
+ *
+ * PubSubClient only publishes at QoS 0 and silently drops PUBACKs in loop(),
+ * so QoS 1 PUBLISH packets are written directly to the socket and their
+ * acknowledgements are picked up here while PubSubClient reads the stream.
+ */
+class AckTrackingClient : public Client {
+public:
+    typedef void (*AckCallback)(uint16_t packetId);
+
+    AckTrackingClient(WiFiClient& inner, AckCallback onAck) : inner(inner), onAck(onAck) {}
+
+    void resetParser() {
+        parseState = ParseState::Header;
+    }
+
+    int connect(IPAddress ip, uint16_t port) override { resetParser(); return inner.connect(ip, port); }
+    int connect(const char* host, uint16_t port) override { resetParser(); return inner.connect(host, port); }
+    int connect(IPAddress ip, uint16_t port, int32_t timeout) { resetParser(); return inner.connect(ip, port, timeout); }
+    int connect(const char* host, uint16_t port, int32_t timeout) { resetParser(); return inner.connect(host, port, timeout); }
+    size_t write(uint8_t b) override { return inner.write(b); }
+    size_t write(const uint8_t* buf, size_t size) override { return inner.write(buf, size); }
+    int available() override { return inner.available(); }
+    int peek() override { return inner.peek(); }
+    void flush() override { inner.flush(); }
+    void stop() override { inner.stop(); }
+    uint8_t connected() override { return inner.connected(); }
+    operator bool() override { return (bool)inner; }
+
+    int read() override {
+        int b = inner.read();
+        if (b >= 0) feed((uint8_t)b);
+        return b;
+    }
+
+    int read(uint8_t* buf, size_t size) override {
+        int n = inner.read(buf, size);
+        for (int i = 0; i < n; i++) feed(buf[i]);
+        return n;
+    }
+
+private:
+    enum class ParseState { Header, Length, Body };
+
+    WiFiClient& inner;
+    AckCallback onAck;
+    ParseState parseState = ParseState::Header;
+    uint8_t packetType = 0;
+    uint32_t remaining = 0;
+    uint8_t lengthShift = 0;
+    uint16_t ackId = 0;
+
+    // Minimal MQTT framing: fixed header, variable-length "remaining length", body
+    void feed(uint8_t b) {
+        switch (parseState) {
+        case ParseState::Header:
+            packetType = b & 0xF0;
+            remaining = 0;
+            lengthShift = 0;
+            parseState = ParseState::Length;
+            break;
+        case ParseState::Length:
+            remaining |= (uint32_t)(b & 0x7F) << lengthShift;
+            lengthShift += 7;
+            if (b & 0x80) break;
+            ackId = 0;
+            parseState = remaining > 0 ? ParseState::Body : ParseState::Header;
+            break;
+        case ParseState::Body:
+            if (packetType == MQTTPUBACK && remaining <= 2) {
+                ackId = (ackId << 8) | b;
+            }
+            if (--remaining == 0) {
+                if (packetType == MQTTPUBACK) onAck(ackId);
+                parseState = ParseState::Header;
+            }
+            break;
+        }
+    }
+};
+
+#ifdef ARDUINO
+/**
+ * Raw lwIP sockets, so the TCP connect can run without blocking the owner.
+ */
+namespace transport {
+
+/**
+ * @brief Starts a non-blocking TCP connect.
+ * @return The socket, or -1 on an immediate failure.
+ */
+int open(IPAddress ip, uint16_t port) {
+    int fd = lwip_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd < 0) {
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = (uint32_t)ip;
+    if (lwip_connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Checks a pending connect without waiting.
+ * @return 1 when established, 0 while in progress, -1 on error.
+ */
+int poll(int fd) {
+    fd_set writeSet;
+    FD_ZERO(&writeSet);
+    FD_SET(fd, &writeSet);
+    struct timeval noWait = {0, 0};
+    int res = select(fd + 1, nullptr, &writeSet, nullptr, &noWait);
+    if (res == 0) {
+        return 0;
+    }
+    int sockErr = 0;
+    socklen_t len = sizeof(sockErr);
+    if (res < 0 || getsockopt(fd, SOL_SOCKET, SO_ERROR, &sockErr, &len) < 0 || sockErr != 0) {
+        return -1;
+    }
+    return 1;
+}
+
+/**
+ * @brief Prepares a connected socket for WiFiClient: blocking, bounded send, no Nagle.
+ */
+void adopt(int fd, uint16_t sendTimeoutSeconds) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) & ~O_NONBLOCK);
+    struct timeval sendTimeout = {sendTimeoutSeconds, 0};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &sendTimeout, sizeof(sendTimeout));
+    int noDelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+}
+
+void close(int fd) {
+    ::close(fd);
+}
+
+} // namespace transport
+#else
+namespace transport = ::fake::transport;
+#endif
+
+void onPuback(uint16_t packetId);
+
+WiFiClient wifiClient;
+AckTrackingClient ackClient(wifiClient, onPuback);
+PubSubClient client(ackClient);
+
+State state = State::Backoff;
+unsigned long stateSinceMillis = 0;
+unsigned long backoffMillis = 0;
+uint8_t failedAttempts = 0;
+int pendingSocket = -1;
+volatile bool linkChanged = false; // Set from the Wi-Fi event task, handled in loop()
+bool listening = false;
+
+QueuedMessage offlineQueue[offlineQueueCapacity];
+size_t queueHead = 0;
+size_t queueCount = 0;
+uint32_t droppedMessages = 0;
+
+InflightMessage inflight[inflightWindow];
+uint16_t lastPacketId = 0;
+PipelineStats stats = {};
+
+void onLinkChange(bool) {
+    linkChanged = true;
+}
+
+void setupMqtt() {
+    if (!listening) {
+        listening = sta::onLinkChange(onLinkChange);
+    }
+    client.setServer(brokerHost, brokerPort);
+    // Bounds the CONNECT/CONNACK exchange; the TCP part is handled without blocking
+    client.setSocketTimeout(handshakeTimeoutSeconds);
+    Serial.printf("[MQTT] Server configured: %s:%d\n", brokerHost, brokerPort);
+    state = State::Backoff;
+    stateSinceMillis = millis();
+    backoffMillis = 0; // First attempt happens on the next loop()
+}
+
+void setCallback(MQTT_CALLBACK_SIGNATURE) {
+    client.setCallback(callback);
+    Serial.println("[MQTT] Callback set.");
+}
+
+bool connected() {
+    return state == State::Connected && client.connected();
+}
+
+size_t queuedCount() {
+    return queueCount;
+}
+
+// --- QoS 1 in-flight window ---
+void onPuback(uint16_t packetId) {
+    for (InflightMessage& slot : inflight) {
+        if (slot.packetId == packetId) {
+            slot.packetId = 0;
+            stats.acked++;
+            return;
+        }
+    }
+}
+
+size_t inflightCount() {
+    size_t count = 0;
+    for (const InflightMessage& slot : inflight) {
+        if (slot.packetId != 0) count++;
+    }
+    return count;
+}
+
+uint16_t nextPacketId() {
+    // Stay in the upper half so ids never collide with PubSubClient's own SUBSCRIBE ids
+    lastPacketId = (lastPacketId + 1) | 0x8000;
+    return lastPacketId;
+}
+
+/**
+ * @brief Writes a QoS 1 PUBLISH packet for an in-flight slot straight to the socket.
+ * DUP is set only if the message already went out in this session (a clean
+ * session starts without it, so the first send there is not a redelivery).
+ */
+bool transmit(InflightMessage& slot) {
+    const QueuedMessage& msg = slot.message;
+    size_t topicLength = strlen(msg.topic); // <= maxTopicLength, checked by makeMessage()
+    uint32_t remainingLength = 2 + topicLength + 2 + msg.length;
+
+    uint8_t packet[5 + 2 + maxTopicLength + 2 + maxPayloadLength];
+    size_t pos = 0;
+    packet[pos++] = MQTTPUBLISH | MQTTQOS1 | (slot.sentInSession ? 0x08 : 0x00);
+    do {
+        uint8_t digit = remainingLength & 0x7F;
+        remainingLength >>= 7;
+        packet[pos++] = remainingLength > 0 ? (digit | 0x80) : digit;
+    } while (remainingLength > 0);
+    packet[pos++] = topicLength >> 8;
+    packet[pos++] = topicLength & 0xFF;
+    memcpy(packet + pos, msg.topic, topicLength);
+    pos += topicLength;
+    packet[pos++] = slot.packetId >> 8;
+    packet[pos++] = slot.packetId & 0xFF;
+    memcpy(packet + pos, msg.payload, msg.length);
+    pos += msg.length;
+
+    slot.sent = wifiClient.write(packet, pos) == pos;
+    slot.sentMillis = millis();
+    if (slot.sent) {
+        if (slot.everSent) stats.retransmitted++;
+        slot.everSent = true;
+        slot.sentInSession = true;
+    }
+    return slot.sent;
+}
+
+/**
+ * @brief Moves a message into a free window slot and sends it.
+ * @return false if the window is full.
+ */
+bool sendQos1(const QueuedMessage& msg) {
+    for (InflightMessage& slot : inflight) {
+        if (slot.packetId == 0) {
+            slot.message = msg;
+            slot.packetId = nextPacketId();
+            slot.sentInSession = false;
+            slot.everSent = false;
+            stats.published++;
+            // A failed write is not lost: the slot is retried by serviceInflight()
+            transmit(slot);
+            return true;
+        }
+    }
+    return false;
+}
+
+void serviceInflight() {
+    unsigned long now = millis();
+    for (InflightMessage& slot : inflight) {
+        if (slot.packetId == 0) continue;
+        if (!slot.sent || now - slot.sentMillis >= ackTimeoutMillis) {
+            if (!transmit(slot)) return;
+        }
+    }
+}
+
+// --- Offline queue (ring buffer, oldest entry is dropped on overflow) ---
+bool enqueue(const QueuedMessage& msg) {
+    if (queueCount == offlineQueueCapacity) {
+        queueHead = (queueHead + 1) % offlineQueueCapacity;
+        queueCount--;
+        droppedMessages++;
+    }
+    offlineQueue[(queueHead + queueCount) % offlineQueueCapacity] = msg;
+    queueCount++;
+    return true;
+}
+
+bool sendNow(const QueuedMessage& msg) {
+    if (msg.qos == 0) {
+        return client.publish(msg.topic, (const uint8_t*)msg.payload, msg.length);
+    }
+    return sendQos1(msg);
+}
+
+void flushQueue() {
+    for (size_t sent = 0; sent < flushPerLoop && queueCount > 0; sent++) {
+        // Stops on a failed QoS 0 publish or a full window; order is preserved either way
+        if (!sendNow(offlineQueue[queueHead])) {
+            return;
+        }
+        queueHead = (queueHead + 1) % offlineQueueCapacity;
+        queueCount--;
+    }
+    if (queueCount == 0 && droppedMessages > 0) {
+        Serial.printf("[MQTT] Offline queue flushed, %u messages were dropped.\n", droppedMessages);
+        droppedMessages = 0;
+    }
+}
+
+bool makeMessage(QueuedMessage& msg, const char* topic, const char* payload, uint8_t qos) {
+    size_t length = strlen(payload);
+    if (length > maxPayloadLength) {
+        Serial.printf("[MQTT] Payload too long (%u bytes)\n", (unsigned)length);
+        return false;
+    }
+    // Rejected here, not in the window: a slot that can never be sent would block it for good
+    if (strlen(topic) > maxTopicLength) {
+        Serial.printf("[MQTT] Topic too long (%u bytes): %s\n", (unsigned)strlen(topic), topic);
+        return false;
+    }
+    msg.topic = topic;
+    memcpy(msg.payload, payload, length);
+    msg.length = length;
+    msg.qos = qos > 0 ? 1 : 0;
+    return true;
+}
+
+/**
+ * @brief Sends right away without queueing: QoS 0 goes on the wire, QoS 1 into the window.
+ * @return false if disconnected, the window is full or the backlog must go first.
+ */
+bool trySend(const char* topic, const char* payload, uint8_t qos = 0) {
+    QueuedMessage msg;
+    return connected() && queueCount == 0 && makeMessage(msg, topic, payload, qos) && sendNow(msg);
+}
+
+/**
+ * @brief Publishes immediately when possible, otherwise buffers the message.
+ * QoS 1 messages stay in the in-flight window until the broker acknowledges them.
+ * @return false only if the message was neither sent nor queued.
+ */
+bool publish(const char* topic, const char* payload, uint8_t qos = 0) {
+    QueuedMessage msg;
+    if (!makeMessage(msg, topic, payload, qos)) {
+        return false;
+    }
+    // Keep ordering: never overtake messages still waiting in the queue
+    if (connected() && queueCount == 0 && sendNow(msg)) {
+        return true;
+    }
+    return enqueue(msg);
+}
+
+// --- Reconnect state machine ---
+void closePendingSocket() {
+    if (pendingSocket >= 0) {
+        transport::close(pendingSocket);
+        pendingSocket = -1;
+    }
+}
+
+void scheduleRetry() {
+    if (failedAttempts < 16) failedAttempts++;
+    uint8_t shift = failedAttempts < 6 ? failedAttempts : 6;
+    unsigned long ceiling = backoffBaseMillis << shift;
+    if (ceiling > backoffMaxMillis) ceiling = backoffMaxMillis;
+    // Equal jitter: half fixed, half random, so a fleet doesn't reconnect in lockstep
+    backoffMillis = ceiling / 2 + random(ceiling / 2 + 1);
+    state = State::Backoff;
+    stateSinceMillis = millis();
+    Serial.printf("[MQTT] Next attempt in %lu ms (attempt %u failed, state: %d)\n",
+                  backoffMillis, failedAttempts, client.state());
+}
+
+bool startTcpConnect() {
+    IPAddress ip;
+    if (!ip.fromString(brokerHost) && !WiFi.hostByName(brokerHost, ip)) {
+        Serial.printf("[MQTT] Cannot resolve %s\n", brokerHost);
+        return false;
+    }
+    pendingSocket = transport::open(ip, brokerPort);
+    return pendingSocket >= 0;
+}
+
+bool finishHandshake() {
+    // Hand the connected socket over to WiFiClient in blocking mode with a bounded send
+    transport::adopt(pendingSocket, handshakeTimeoutSeconds);
+    wifiClient = WiFiClient(pendingSocket);
+    ackClient.resetParser();
+    pendingSocket = -1;
+
+    // Create a random client ID
+    String clientId = "ESP32Client-";
+    clientId += String(random(0xffff), HEX);
+
+    // PubSubClient skips its own TCP connect because wifiClient is already connected
+    if (!client.connect(clientId.c_str(), user, password)) {
+        wifiClient.stop();
+        return false;
+    }
+    client.subscribe(rxTopic);
+    Serial.println("[MQTT] Connected to MQTT broker.");
+    Serial.printf("[MQTT] Subscribed to topic: %s\n", rxTopic);
+    return true;
+}
+
+/**
+ * @brief Reacts to a Wi-Fi transition right away instead of waiting for timeouts.
+ */
+void handleLinkChange() {
+    if (!sta::connected()) {
+        // The socket is dead with the link; don't wait for the keep-alive to notice
+        if (state == State::TcpConnecting) {
+            closePendingSocket();
+        } else if (state == State::Connected) {
+            // Also leaves MQTT_CONNECTED, or the next connect() would skip CONNECT
+            client.disconnect();
+            Serial.println("[MQTT] WiFi lost, session dropped.");
+        }
+        state = State::Backoff;
+        stateSinceMillis = millis();
+        return;
+    }
+    if (state == State::Backoff) {
+        // A fresh link is the best moment to retry, whatever the backoff says
+        failedAttempts = 0;
+        backoffMillis = 0;
+    }
+}
+
+/**
+ * @brief Drives the connection and the PubSubClient loop; never sleeps.
+ * Call it on every iteration of the owning loop/task.
+ */
+void loop() {
+    unsigned long now = millis();
+
+    if (linkChanged) {
+        linkChanged = false;
+        handleLinkChange();
+    }
+
+    switch (state) {
+    case State::Backoff:
+        if (!sta::connected() || now - stateSinceMillis < backoffMillis) {
+            return;
+        }
+        Serial.println("[MQTT] Connecting to MQTT broker...");
+        if (!startTcpConnect()) {
+            scheduleRetry();
+            return;
+        }
+        state = State::TcpConnecting;
+        stateSinceMillis = now;
+        return;
+
+    case State::TcpConnecting: {
+        int res = transport::poll(pendingSocket);
+        if (res == 0 && now - stateSinceMillis < tcpConnectTimeoutMillis) {
+            return;
+        }
+        if (res != 1) {
+            Serial.println("[MQTT] TCP connect failed.");
+            closePendingSocket();
+            scheduleRetry();
+            return;
+        }
+        if (!finishHandshake()) {
+            Serial.printf("[MQTT] Failed to connect to MQTT broker, state: %d\n", client.state());
+            scheduleRetry();
+            return;
+        }
+        state = State::Connected;
+        stateSinceMillis = now;
+        failedAttempts = 0;
+        // The session is clean, so everything still unacknowledged is sent again, without DUP
+        for (InflightMessage& slot : inflight) {
+            slot.sent = false;
+            slot.sentInSession = false;
+        }
+        return;
+    }
+
+    case State::Connected:
+        if (!client.loop()) {
+            Serial.printf("[MQTT] Connection lost, state: %d\n", client.state());
+            wifiClient.stop();
+            scheduleRetry();
+            return;
+        }
+        serviceInflight();
+        flushQueue();
+        return;
+    }
+}
+
+// --- Event-driven scheduling ---
+
+/**
+ * @brief Socket the owner may wait on: the MQTT session, or the pending TCP connect.
+ * @return -1 when there is nothing to wait on (backoff).
+ */
+int socketFd() {
+    if (state == State::TcpConnecting) return pendingSocket;
+    if (state == State::Connected) return wifiClient.fd();
+    return -1;
+}
+
+/**
+ * @brief True while the socket must be watched for writability (connect completion).
+ */
+bool waitingForConnect() {
+    return state == State::TcpConnecting;
+}
+
+/**
+ * @brief Milliseconds until loop() has timed work to do (0: call it again right away).
+ * Together with socket activity this lets the owner sleep instead of polling.
+ */
+unsigned long nextDeadlineMillis() {
+    unsigned long now = millis();
+    unsigned long elapsed = now - stateSinceMillis;
+    if (linkChanged) {
+        return 0;
+    }
+    switch (state) {
+    case State::Backoff:
+        if (!sta::connected()) return wifiRecheckMillis;
+        return elapsed < backoffMillis ? backoffMillis - elapsed : 0;
+    case State::TcpConnecting:
+        return elapsed < tcpConnectTimeoutMillis ? tcpConnectTimeoutMillis - elapsed : 0;
+    case State::Connected:
+        break;
+    }
+    // Bytes already buffered by the client never make the socket readable again
+    if ((queueCount > 0 && inflightCount() < inflightWindow) || wifiClient.available() > 0) {
+        return 0;
+    }
+    // PubSubClient only pings from loop(); half the keep-alive keeps the session alive
+    unsigned long deadline = keepAliveMillis / 2;
+    for (const InflightMessage& slot : inflight) {
+        if (slot.packetId == 0) continue;
+        unsigned long age = now - slot.sentMillis;
+        unsigned long left = (!slot.sent || age >= ackTimeoutMillis) ? 0 : ackTimeoutMillis - age;
+        if (left < deadline) deadline = left;
+    }
+    return deadline;
+}
+
+} // namespace mqtt
+
+#endif // MQTT_HPP
\ No newline at end of file
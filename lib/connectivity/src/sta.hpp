@@ -0,0 +1,381 @@
+#ifndef STA_HPP
+#define STA_HPP
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <WiFi.h>
+#include <Preferences.h>
+#include <esp_netif.h>
+#include <esp_netif_net_stack.h>
+#include <lwip/dhcp.h>
+#include "esp32/rtc.h"
+#else
+#include "fake_network.hpp"
+#endif
+#include "connectivity_config.h"
+
+/**
+ * Wi-Fi station connection manager.
+ *
+ * The BSSID, channel and IP configuration of the last successful connection are
+ * cached in RTC memory (survives deep sleep) and NVS (survives power loss). The
+ * next connection joins that access point directly, skipping the scan, and
+ * reuses the lease as a static IP while it has not expired, skipping DHCP. If
+ * that fails fastAttempts times, a regular scan + DHCP connection follows and
+ * refreshes the cache.
+ *
+ * Progress is driven by Wi-Fi events and a retry timer: begin() returns at once,
+ * connected() can be checked at any time, onLinkChange() listeners are told about
+ * every transition, and connect_to_wifi() blocks on an event group bit for code
+ * that cannot continue without the network. While connected, RSSI is sampled
+ * periodically into linkStats().
+ *
+ * The timers and the Wi-Fi event handler only set bits: joining (WiFi.config()
+ * and WiFi.begin()), RSSI sampling and the NVS write run in STA_Task, so neither
+ * the timer service task nor the Wi-Fi event task ever waits on the driver or on
+ * flash.
+ */
+namespace sta {
+
+const char* ssid     = WIFI_SSID;
+const char* password = WIFI_PASSWORD;
+
+// --- Reconnect policy ---
+const uint8_t fastAttempts = 2;                   // Cached-AP attempts before falling back to a scan
+const unsigned long retryDelayMillis = 1000;      // Pause between attempts after a failure
+const unsigned long connectTimeoutMillis = 10000; // connect_to_wifi() limit
+const uint32_t cacheMagic = 0x57494632;           // "WIF2"
+const uint32_t leaseMarginSeconds = 60;           // A lease this close to its end is not reused
+
+// --- Link quality ---
+const unsigned long linkSampleMillis = 5000;
+const float rssiSmoothing = 0.2f;                 // EWMA weight of a new RSSI sample
+const size_t maxListeners = 4;
+
+struct ApCache {
+  uint32_t magic;
+  uint8_t bssid[6];
+  int32_t channel;
+  uint32_t ip, gateway, subnet, dns;
+  uint32_t leaseSeconds;              // 0: unknown, never reused as a static IP
+  uint64_t leaseStartMicros;          // RTC time the lease was obtained
+};
+
+struct LinkStats {
+  int8_t rssi;                        // Last sample, dBm (0 when disconnected)
+  float rssiAverage;                  // Smoothed RSSI, dBm
+  uint32_t connects;
+  uint32_t disconnects;
+  uint8_t lastDisconnectReason;       // wifi_err_reason_t of the last drop
+  unsigned long lastConnectMillis;    // Duration of the last successful connect
+  unsigned long connectedSinceMillis;
+};
+
+typedef void (*LinkCallback)(bool connected);
+
+RTC_DATA_ATTR ApCache rtcCache;
+ApCache cache = {};
+Preferences prefs;
+
+EventGroupHandle_t events = NULL;
+const EventBits_t CONNECTED_BIT = BIT0;
+const EventBits_t ATTEMPT_BIT = BIT1;   // Set by begin() and the retry timer
+const EventBits_t SAVE_BIT = BIT2;      // Set on GOT_IP: the cache is written from STA_Task
+const EventBits_t SAMPLE_BIT = BIT3;    // Set on GOT_IP and by the link timer: RSSI is read from STA_Task
+TimerHandle_t retryTimer = NULL;
+TimerHandle_t linkTimer = NULL;
+
+LinkCallback listeners[maxListeners] = {};
+LinkStats stats = {};
+
+bool started = false;
+bool stopped = false;
+bool usingCache = false;
+bool usingStaticIp = false;
+uint64_t gotIpRtcMicros = 0;
+uint8_t failedFastAttempts = 0;
+unsigned long attemptStartMillis = 0;
+unsigned long lastConnectMillis = 0; // Kept for callers logging boot-to-publish time
+
+/**
+ * @brief Registers a callback for link up/down transitions (called from the Wi-Fi event task).
+ */
+bool onLinkChange(LinkCallback callback) {
+  for (LinkCallback& slot : listeners) {
+    if (slot == NULL) {
+      slot = callback;
+      return true;
+    }
+  }
+  return false;
+}
+
+void notifyListeners(bool connected) {
+  for (LinkCallback callback : listeners) {
+    if (callback != NULL) callback(connected);
+  }
+}
+
+void loadCache() {
+  if (rtcCache.magic == cacheMagic) {
+    cache = rtcCache;
+    return;
+  }
+  prefs.begin("sta", true);
+  if (prefs.getBytes("ap", &cache, sizeof(cache)) != sizeof(cache) || cache.magic != cacheMagic) {
+    cache.magic = 0;
+  }
+  prefs.end();
+}
+
+/**
+ * @brief RTC time in microseconds: keeps counting through deep sleep and resets,
+ * starts over after a power loss.
+ */
+uint64_t rtcMicros() {
+  return esp_rtc_get_time_us();
+}
+
+/**
+ * @brief Lease time granted by the DHCP server for the current connection (0 if unknown).
+ */
+uint32_t dhcpLeaseSeconds() {
+  esp_netif_t* handle = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+  struct netif* lwip = handle != NULL ? (struct netif*)esp_netif_get_netif_impl(handle) : NULL;
+  struct dhcp* client = lwip != NULL ? netif_dhcp_data(lwip) : NULL;
+  return client != NULL ? client->offered_t0_lease : 0;
+}
+
+/**
+ * @brief Whether the cached lease can still be used as a static IP.
+ * After a power loss the RTC time is behind the lease start and the lease age
+ * is unknown, so DHCP is used.
+ */
+bool leaseValid() {
+  uint64_t now = rtcMicros();
+  if (cache.leaseSeconds <= leaseMarginSeconds || now < cache.leaseStartMicros) {
+    return false;
+  }
+  return now - cache.leaseStartMicros < (uint64_t)(cache.leaseSeconds - leaseMarginSeconds) * 1000000ULL;
+}
+
+void saveCache() {
+  ApCache fresh = {};
+  fresh.magic = cacheMagic;
+  memcpy(fresh.bssid, WiFi.BSSID(), sizeof(fresh.bssid));
+  fresh.channel = WiFi.channel();
+  fresh.ip = WiFi.localIP();
+  fresh.gateway = WiFi.gatewayIP();
+  fresh.subnet = WiFi.subnetMask();
+  fresh.dns = WiFi.dnsIP(0);
+  if (usingStaticIp) {
+    fresh.leaseSeconds = cache.leaseSeconds;
+    fresh.leaseStartMicros = cache.leaseStartMicros;
+  } else {
+    fresh.leaseSeconds = dhcpLeaseSeconds();
+    fresh.leaseStartMicros = gotIpRtcMicros;
+  }
+  rtcCache = fresh;
+  // NVS is only written when the AP or lease actually changed (a new DHCP lease does)
+  if (memcmp(&fresh, &cache, sizeof(fresh)) != 0) {
+    prefs.begin("sta", false);
+    prefs.putBytes("ap", &fresh, sizeof(fresh));
+    prefs.end();
+    cache = fresh;
+  }
+}
+
+void startAttempt() {
+  usingCache = cache.magic == cacheMagic && failedFastAttempts < fastAttempts;
+  usingStaticIp = usingCache && leaseValid();
+  attemptStartMillis = millis();
+  if (usingStaticIp) {
+    WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.subnet), IPAddress(cache.dns));
+  } else {
+    WiFi.config(IPAddress(), IPAddress(), IPAddress()); // Back to DHCP
+  }
+  if (usingCache) {
+    WiFi.begin(ssid, password, cache.channel, cache.bssid);
+  } else {
+    WiFi.begin(ssid, password);
+  }
+}
+
+void sampleLink() {
+  stats.rssi = WiFi.RSSI();
+  stats.rssiAverage = stats.rssiAverage == 0.0f
+      ? stats.rssi
+      : stats.rssiAverage + rssiSmoothing * (stats.rssi - stats.rssiAverage);
+}
+
+/**
+ * @brief The work the timers and the event handler leave to STA_Task.
+ */
+void service() {
+  EventBits_t work = xEventGroupClearBits(events, ATTEMPT_BIT | SAVE_BIT | SAMPLE_BIT);
+  // The link may have dropped again before the task got here
+  bool linkUp = xEventGroupGetBits(events) & CONNECTED_BIT;
+  if ((work & SAMPLE_BIT) && linkUp) {
+    sampleLink();
+  }
+  if ((work & SAVE_BIT) && linkUp) {
+    saveCache();
+  }
+  if ((work & ATTEMPT_BIT) && !stopped && !(xEventGroupGetBits(events) & CONNECTED_BIT)) {
+    startAttempt();
+  }
+}
+
+void staTask(void*) {
+  for (;;) {
+    xEventGroupWaitBits(events, ATTEMPT_BIT | SAVE_BIT | SAMPLE_BIT, pdFALSE, pdFALSE, portMAX_DELAY);
+    service();
+  }
+}
+
+void onRetryTimer(TimerHandle_t) {
+  if (!stopped) {
+    xEventGroupSetBits(events, ATTEMPT_BIT);
+  }
+}
+
+void onLinkTimer(TimerHandle_t) {
+  if (!stopped && (xEventGroupGetBits(events) & CONNECTED_BIT)) {
+    xEventGroupSetBits(events, SAMPLE_BIT);
+  }
+}
+
+void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+  if (stopped) {
+    return;
+  }
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      lastConnectMillis = millis() - attemptStartMillis;
+      gotIpRtcMicros = rtcMicros();
+      failedFastAttempts = 0;
+      stats.connects++;
+      stats.lastConnectMillis = lastConnectMillis;
+      stats.connectedSinceMillis = millis();
+      Serial.printf("[STA] WiFi connected in %lu ms (%s).\n", lastConnectMillis,
+                    usingStaticIp ? "cached AP, static IP" : usingCache ? "cached AP, DHCP" : "scan + DHCP");
+      Serial.printf("[STA] IP address: %s\n", WiFi.localIP().toString().c_str());
+      Serial.printf("[STA] MAC address: %s\n", WiFi.macAddress().c_str());
+      xEventGroupSetBits(events, CONNECTED_BIT | SAVE_BIT | SAMPLE_BIT);
+      xTimerStart(linkTimer, 0);
+      notifyListeners(true);
+      break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED: {
+      bool wasConnected = xEventGroupGetBits(events) & CONNECTED_BIT;
+      xEventGroupClearBits(events, CONNECTED_BIT);
+      stats.lastDisconnectReason = info.wifi_sta_disconnected.reason;
+      if (wasConnected) {
+        stats.disconnects++;
+        stats.rssi = 0;
+        xTimerStop(linkTimer, 0);
+        notifyListeners(false);
+      }
+      if (usingCache && ++failedFastAttempts >= fastAttempts) {
+        Serial.println("[STA] Cached AP unreachable, falling back to a full scan.");
+      }
+      Serial.printf("[STA] Disconnected (reason %u), retrying in %lu ms.\n",
+                    info.wifi_sta_disconnected.reason, retryDelayMillis);
+      xTimerStart(retryTimer, 0);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+/**
+ * @brief Starts connecting in the background; reconnects automatically afterwards.
+ */
+void begin() {
+  stopped = false;
+  if (started) {
+    xEventGroupSetBits(events, ATTEMPT_BIT);
+    return;
+  }
+  started = true;
+  events = xEventGroupCreate();
+  retryTimer = xTimerCreate("sta_retry", pdMS_TO_TICKS(retryDelayMillis), pdFALSE, NULL, onRetryTimer);
+  linkTimer = xTimerCreate("sta_link", pdMS_TO_TICKS(linkSampleMillis), pdTRUE, NULL, onLinkTimer);
+  WiFi.persistent(false);       // Credentials are compiled in, don't rewrite them to flash
+  WiFi.setAutoReconnect(false); // Reconnects go through the cache-aware path above
+  WiFi.enableSTA(true);         // Keeps an access point running if one was started
+  WiFi.onEvent(onWiFiEvent);
+  loadCache();
+#ifdef ARDUINO
+  xTaskCreatePinnedToCore(staTask, "STA_Task", 4096, NULL, 2, NULL, 0);
+#else
+  fake::tasks.push_back(service); // No threads on the host: run after every simulated millisecond
+#endif
+  xEventGroupSetBits(events, ATTEMPT_BIT);
+}
+
+bool connected() {
+  return events != NULL && (xEventGroupGetBits(events) & CONNECTED_BIT);
+}
+
+/**
+ * @brief Stops reconnecting and powers the radio down (e.g. before deep sleep).
+ */
+void stop() {
+  stopped = true;
+  if (retryTimer != NULL) {
+    xTimerStop(retryTimer, 0);
+    xTimerStop(linkTimer, 0);
+  }
+  WiFi.disconnect(true);
+  WiFi.mode(WIFI_OFF);
+  if (events != NULL) {
+    xEventGroupClearBits(events, CONNECTED_BIT);
+  }
+}
+
+/**
+ * @brief Starts the manager and waits (without polling) until an IP is assigned.
+ * @return false after connectTimeoutMillis; the manager keeps trying in the background.
+ */
+bool connect_to_wifi() {
+  Serial.println("[STA] Connecting to WiFi...");
+  begin();
+  EventBits_t bits = xEventGroupWaitBits(events, CONNECTED_BIT, pdFALSE, pdTRUE,
+                                         pdMS_TO_TICKS(connectTimeoutMillis));
+  if (!(bits & CONNECTED_BIT)) {
+    Serial.println("[STA] Connection timed out.");
+    return false;
+  }
+  return true;
+}
+
+LinkStats linkStats() {
+  return stats;
+}
+
+/**
+ * @brief Signal strength in percent, mapped from the last RSSI sample (-100..-50 dBm).
+ * Cheap and silent: it reads the cached sample instead of querying the driver.
+ */
+double get_signal_strength() {
+  if (!connected()) {
+    return 0.0;
+  }
+  int8_t rssi = stats.rssi;
+  if (rssi >= -50) {
+    return 100.0;
+  } else if (rssi <= -100) {
+    return 0.0;
+  }
+  // https://stackoverflow.com/a/15798024
+  return map(rssi, -100, -50, 0, 100);
+}
+
+String get_ip() {
+  return WiFi.localIP().toString();
+}
+
+} // namespace sta
+
+#endif // STA_HPP
\ No newline at end of file
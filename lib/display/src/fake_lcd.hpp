@@ -0,0 +1,131 @@
+#ifndef FAKE_LCD_HPP
+#define FAKE_LCD_HPP
+
+/**
+ * Host-side stand-in for LiquidCrystal_I2C (marcoschwartz, HD44780 behind a
+ * PCF8574 in 4-bit mode), so frame_buffer.hpp can be benchmarked on a PC.
+ *
+ * It models what the panel shows (DDRAM with the 2-line address layout, an
+ * address counter that createChar() moves into CGRAM) and what the library
+ * costs on the bus: every command or data byte is two nibbles, each one
+ * expander write plus an enable pulse (two more writes), so six I2C
+ * transactions. Bus time assumes 100 kHz and adds the library's busy waits.
+ *
+ * Only included when ARDUINO is not defined; device builds never see it.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+class LiquidCrystal_I2C {
+public:
+    // --- Bus accounting (resetCounters() zeroes them) ---
+    uint32_t commands = 0;      // Instruction bytes (setCursor, clear, ...)
+    uint32_t dataBytes = 0;     // Character bytes
+    uint32_t clears = 0;
+    uint64_t busMicros = 0;     // Estimated time the caller spent blocked
+
+    static const uint32_t transactionsPerByte = 6;
+    static const uint32_t transactionMicros = 200;  // Address + data byte at 100 kHz
+    static const uint32_t pulseMicros = 2 * 51;     // Per byte: two enable pulses
+    static const uint32_t clearMicros = 2000;       // clear() and home() busy wait
+
+    LiquidCrystal_I2C(uint8_t, uint8_t cols, uint8_t rows) : cols(cols), rows(rows) {
+        memset(ddram, ' ', sizeof(ddram));
+        memset(cgram, 0, sizeof(cgram));
+    }
+
+    uint32_t transactions() const { return (commands + dataBytes) * transactionsPerByte; }
+    void resetCounters() { commands = dataBytes = clears = 0; busMicros = 0; }
+
+    void init() { clear(); }
+    void backlight() {}
+    void noBacklight() {}
+
+    void clear() {
+        command();
+        clears++;
+        busMicros += clearMicros;
+        memset(ddram, ' ', sizeof(ddram));
+        address = 0;
+        inCgram = false;
+    }
+
+    void home() {
+        command();
+        busMicros += clearMicros;
+        address = 0;
+        inCgram = false;
+    }
+
+    void setCursor(uint8_t col, uint8_t row) {
+        static const uint8_t rowOffsets[] = {0x00, 0x40, 0x14, 0x54};
+        command();
+        if (row >= rows) row = rows - 1;
+        address = (col + rowOffsets[row]) & 0x7F;
+        inCgram = false;
+    }
+
+    void createChar(uint8_t location, uint8_t charmap[]) {
+        location &= 0x7;
+        command(); // Set CGRAM address: later data bytes go there until the next setCursor()
+        inCgram = true;
+        cgramAddress = location * 8;
+        for (int i = 0; i < 8; i++) {
+            write(charmap[i]);
+        }
+        memcpy(cgram[location], charmap, 8);
+    }
+
+    size_t write(uint8_t value) {
+        dataBytes++;
+        busMicros += transactionsPerByte * transactionMicros + pulseMicros;
+        if (inCgram) {
+            cgramAddress = (cgramAddress + 1) & 0x3F;
+            return 1;
+        }
+        if (address < sizeof(ddram)) ddram[address] = value;
+        // 2-line mode: 0x27 wraps to 0x40, 0x67 back to 0x00
+        address = address == 0x27 ? 0x40 : address == 0x67 ? 0x00 : address + 1;
+        return 1;
+    }
+
+    size_t print(const char* text) {
+        size_t n = 0;
+        while (*text) n += write((uint8_t)*text++);
+        return n;
+    }
+
+    size_t print(int value) {
+        char buffer[12];
+        snprintf(buffer, sizeof(buffer), "%d", value);
+        return print(buffer);
+    }
+
+    /**
+     * @brief The visible part of a row, raw bytes (custom characters are 0..7).
+     */
+    std::string visible(uint8_t row) const {
+        const uint8_t* start = ddram + (row & 1 ? 0x40 : 0x00) + (row >= 2 ? cols : 0);
+        return std::string((const char*)start, cols);
+    }
+
+private:
+    void command() {
+        commands++;
+        busMicros += transactionsPerByte * transactionMicros + pulseMicros;
+    }
+
+    uint8_t cols;
+    uint8_t rows;
+    uint8_t ddram[0x68];
+    uint8_t cgram[8][8];
+    uint8_t address = 0;
+    uint8_t cgramAddress = 0;
+    bool inCgram = false;
+};
+
+#endif // FAKE_LCD_HPP
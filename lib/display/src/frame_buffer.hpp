@@ -0,0 +1,133 @@
+#ifndef FRAME_BUFFER_HPP
+#define FRAME_BUFFER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef ARDUINO
+#include <LiquidCrystal_I2C.h>
+#else
+#include "fake_lcd.hpp"
+#endif
+
+namespace display {
+
+/**
+ * Shadow frame buffer for an HD44780 character display behind a PCF8574.
+ *
+ * Callers draw into the back buffer, which costs nothing on the bus. flush()
+ * compares it with what the panel is known to show and sends only the changed
+ * runs, with a setCursor() only where the address counter is not already in
+ * place. On this expander every byte is six I2C transactions, so a countdown
+ * tick goes from clear() (2 ms busy wait and a blank frame) plus ~34 bytes to
+ * one cursor move and the digits that changed.
+ *
+ * The buffer must be told when the panel changes behind its back:
+ * blank() after lcd.init()/lcd.clear(), lostCursor() after createChar(),
+ * invalidate() when the contents are unknown (the next flush() redraws all).
+ */
+template <uint8_t COLS, uint8_t ROWS>
+class FrameBuffer {
+public:
+    explicit FrameBuffer(LiquidCrystal_I2C& lcd) : lcd(lcd) {
+        memset(back, ' ', sizeof(back));
+        invalidate();
+    }
+
+    void blank() {
+        memset(front, ' ', sizeof(front));
+        known = true;
+        cursor = -1;
+    }
+
+    void invalidate() {
+        known = false;
+        cursor = -1;
+    }
+
+    void lostCursor() { cursor = -1; }
+
+    // --- Drawing (back buffer only) ---
+
+    void clear() { memset(back, ' ', sizeof(back)); }
+
+    void put(uint8_t col, uint8_t row, uint8_t ch) {
+        if (col < COLS && row < ROWS) back[row][col] = ch;
+    }
+
+    /**
+     * @brief Writes text from (col, row), clipped at the right edge.
+     * @return The column after the last character written.
+     */
+    uint8_t print(uint8_t col, uint8_t row, const char* text) {
+        if (row >= ROWS) return col;
+        while (*text && col < COLS) {
+            back[row][col++] = (uint8_t)*text++;
+        }
+        return col;
+    }
+
+    /**
+     * @brief Replaces a whole row: the text is clipped and padded with blanks.
+     */
+    void setLine(uint8_t row, const char* text) {
+        if (row >= ROWS) return;
+        uint8_t col = print(0, row, text);
+        memset(back[row] + col, ' ', COLS - col);
+    }
+
+    const uint8_t* line(uint8_t row) const { return back[row]; }
+
+    bool dirty() const { return !known || memcmp(back, front, sizeof(back)) != 0; }
+
+    /**
+     * @brief Sends the difference to the panel.
+     * @return Bytes sent (commands + characters); 0 if nothing changed.
+     */
+    size_t flush() {
+        size_t sent = 0;
+        for (uint8_t row = 0; row < ROWS; row++) {
+            uint8_t col = 0;
+            while (col < COLS) {
+                if (!changed(row, col)) {
+                    col++;
+                    continue;
+                }
+                // Rewriting one unchanged cell costs the same byte as the
+                // setCursor() that would skip it, so short gaps join the run
+                uint8_t end = col + 1;
+                while (end < COLS && (changed(row, end) || (end + 1 < COLS && changed(row, end + 1)))) {
+                    end++;
+                }
+                int16_t start = row * COLS + col;
+                if (cursor != start) {
+                    lcd.setCursor(col, row);
+                    sent++;
+                }
+                for (uint8_t i = col; i < end; i++) {
+                    lcd.write(back[row][i]);
+                    front[row][i] = back[row][i];
+                    sent++;
+                }
+                // Past the last column the counter runs into off-screen DDRAM, not the next row
+                cursor = end < COLS ? start + (end - col) : -1;
+                col = end;
+            }
+        }
+        known = true;
+        return sent;
+    }
+
+private:
+    bool changed(uint8_t row, uint8_t col) const { return !known || back[row][col] != front[row][col]; }
+
+    LiquidCrystal_I2C& lcd;
+    uint8_t back[ROWS][COLS];   // What callers drew
+    uint8_t front[ROWS][COLS];  // What the panel shows (valid when known)
+    bool known;
+    int16_t cursor;             // row * COLS + col of the address counter, -1 if unknown
+};
+
+} // namespace display
+#endif // FRAME_BUFFER_HPP
@@ -0,0 +1,351 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+/**
+ * Task execution profiler.
+ *
+ * Named scopes collect call counts, totals, maxima and a log2 latency histogram
+ * (bucket i holds durations in [2^i, 2^(i+1)) us), from which percentiles are
+ * estimated. Each scope remembers the task that registered it so the report can
+ * include its stack high-water mark. CPU load per core is derived from the
+ * idle tasks' run-time counters (configGENERATE_RUN_TIME_STATS), so the cores
+ * still sleep in WAITI while idle and the profiler does not raise the idle
+ * power it is used to measure. Without run-time stats the load is reported as
+ * unknown (-1), unless built with -D PROFILER_SPIN_IDLE=1: an idle hook then
+ * times idle spins, which keeps both cores out of WAITI (bench builds only).
+ *
+ * Build with -D PROFILER_ENABLED=0 to compile all instrumentation to no-ops.
+ * Without ARDUINO the same code builds on the host (std::chrono clock, no stack
+ * or CPU load data), so instrumented code can run in native tests.
+ */
+
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+#ifndef PROFILER_SPIN_IDLE
+#define PROFILER_SPIN_IDLE 0
+#endif
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include "esp_freertos_hooks.h"
+#else
+#include <chrono>
+#include <mutex>
+#include <string>
+#endif
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace profiler {
+
+// --- Configuration ---
+const size_t maxScopes = 8;
+const size_t histogramBuckets = 24;       // Last bucket also holds everything above ~8 s
+const uint32_t idleGapMicros = 50;        // Idle hook gaps shorter than this count as idle time
+
+struct Snapshot {
+    const char* name;
+    uint32_t count;
+    uint32_t avgMicros;
+    uint32_t maxMicros;
+    uint32_t p50Micros;
+    uint32_t p90Micros;
+    uint32_t p99Micros;
+    int32_t stackFreeBytes;               // -1 when unknown
+};
+
+#if PROFILER_ENABLED
+
+struct Scope {
+    const char* name;
+    void* task;
+    uint32_t count;
+    uint64_t totalMicros;
+    uint32_t maxMicros;
+    uint32_t buckets[histogramBuckets];
+};
+
+Scope scopes[maxScopes];
+size_t scopeCount = 0;
+
+#ifdef ARDUINO
+portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+#define PROFILER_LOCK() portENTER_CRITICAL(&profiler::lock)
+#define PROFILER_UNLOCK() portEXIT_CRITICAL(&profiler::lock)
+
+inline uint32_t nowMicros() { return micros(); }
+inline void* currentTask() { return xTaskGetCurrentTaskHandle(); }
+
+uint32_t windowStartMicros = 0;
+
+#if PROFILER_SPIN_IDLE
+// --- CPU load via idle hooks (no WAITI) ---
+volatile uint64_t idleMicros[portNUM_PROCESSORS] = {};
+volatile uint32_t lastIdleCall[portNUM_PROCESSORS] = {};
+
+bool idleHook(int core) {
+    uint32_t now = micros();
+    uint32_t gap = now - lastIdleCall[core];
+    lastIdleCall[core] = now;
+    // A short gap means the idle task spun without being preempted
+    if (gap < idleGapMicros) {
+        idleMicros[core] += gap;
+    }
+    return false; // Keep spinning (no WAITI) so idle time stays measurable
+}
+bool idleHookCore0() { return idleHook(0); }
+bool idleHookCore1() { return idleHook(1); }
+
+void init() {
+    esp_register_freertos_idle_hook_for_cpu(idleHookCore0, 0);
+    esp_register_freertos_idle_hook_for_cpu(idleHookCore1, 1);
+    windowStartMicros = micros();
+}
+
+uint64_t idleSinceReset(int core) { return idleMicros[core]; }
+
+void resetIdle() {
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        idleMicros[core] = 0;
+    }
+}
+#elif configGENERATE_RUN_TIME_STATS
+// --- CPU load via the idle tasks' run-time counters (esp_timer, us) ---
+uint32_t idleAtReset[portNUM_PROCESSORS] = {};
+
+uint32_t idleRunTime(int core) {
+    TaskStatus_t status;
+    vTaskGetInfo(xTaskGetIdleTaskHandleForCPU(core), &status, pdFALSE, eReady);
+    return status.ulRunTimeCounter;
+}
+
+void resetIdle() {
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        idleAtReset[core] = idleRunTime(core);
+    }
+}
+
+void init() {
+    resetIdle();
+    windowStartMicros = micros();
+}
+
+uint64_t idleSinceReset(int core) { return idleRunTime(core) - idleAtReset[core]; }
+#else
+void init() {}
+#endif
+
+/**
+ * @brief CPU load of a core in percent since the last report, -1 if not measured.
+ */
+float cpuLoad(int core) {
+#if PROFILER_SPIN_IDLE || configGENERATE_RUN_TIME_STATS
+    uint32_t window = micros() - windowStartMicros;
+    if (windowStartMicros == 0 || window == 0) {
+        return -1.0f;
+    }
+    float idle = (float)idleSinceReset(core) / window;
+    return idle >= 1.0f ? 0.0f : 100.0f * (1.0f - idle);
+#else
+    (void)core;
+    return -1.0f;
+#endif
+}
+
+void resetCpuLoad() {
+#if PROFILER_SPIN_IDLE || configGENERATE_RUN_TIME_STATS
+    resetIdle();
+#endif
+    windowStartMicros = micros();
+}
+
+int32_t stackFreeBytes(void* task) {
+    // On ESP32 the high-water mark is reported in bytes
+    return task ? (int32_t)uxTaskGetStackHighWaterMark((TaskHandle_t)task) : -1;
+}
+
+const int coreCount = portNUM_PROCESSORS;
+#else
+std::mutex lock;
+#define PROFILER_LOCK() profiler::lock.lock()
+#define PROFILER_UNLOCK() profiler::lock.unlock()
+
+inline uint32_t nowMicros() {
+    using namespace std::chrono;
+    return (uint32_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+inline void* currentTask() { return nullptr; }
+void init() {}
+float cpuLoad(int) { return -1.0f; }
+void resetCpuLoad() {}
+int32_t stackFreeBytes(void*) { return -1; }
+const int coreCount = 0;
+#endif
+
+/**
+ * @brief Registers a named scope owned by the calling task.
+ * @return Scope id for record()/ScopedTimer, -1 if the table is full.
+ */
+int registerScope(const char* name) {
+    PROFILER_LOCK();
+    int id = -1;
+    if (scopeCount < maxScopes) {
+        id = scopeCount++;
+        scopes[id] = {};
+        scopes[id].name = name;
+        scopes[id].task = currentTask();
+    }
+    PROFILER_UNLOCK();
+    return id;
+}
+
+inline uint8_t bucketFor(uint32_t micros) {
+    // Index of the highest set bit: 0-1 us -> 0, 2-3 us -> 1, 4-7 us -> 2, ...
+    uint8_t bucket = micros ? 31 - __builtin_clz(micros) : 0;
+    return bucket < histogramBuckets ? bucket : histogramBuckets - 1;
+}
+
+void record(int id, uint32_t elapsedMicros) {
+    if (id < 0) return;
+    Scope& s = scopes[id];
+    PROFILER_LOCK();
+    s.count++;
+    s.totalMicros += elapsedMicros;
+    if (elapsedMicros > s.maxMicros) s.maxMicros = elapsedMicros;
+    s.buckets[bucketFor(elapsedMicros)]++;
+    PROFILER_UNLOCK();
+}
+
+/**
+ * @brief Upper bound of the histogram bucket containing the given percentile.
+ */
+uint32_t percentile(const Scope& s, uint32_t percent) {
+    if (s.count == 0) return 0;
+    uint64_t target = ((uint64_t)s.count * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < histogramBuckets; i++) {
+        seen += s.buckets[i];
+        if (seen >= target) {
+            uint32_t upper = (i + 1 < 32) ? (1u << (i + 1)) - 1 : UINT32_MAX;
+            return upper < s.maxMicros ? upper : s.maxMicros;
+        }
+    }
+    return s.maxMicros;
+}
+
+/**
+ * @brief Copies the statistics of all scopes and optionally starts a new window.
+ * @return Number of snapshots written.
+ */
+size_t collect(Snapshot* out, size_t capacity, bool reset) {
+    Scope copies[maxScopes];
+    PROFILER_LOCK();
+    size_t count = scopeCount < capacity ? scopeCount : capacity;
+    for (size_t i = 0; i < count; i++) {
+        copies[i] = scopes[i];
+        if (reset) {
+            scopes[i].count = 0;
+            scopes[i].totalMicros = 0;
+            scopes[i].maxMicros = 0;
+            memset(scopes[i].buckets, 0, sizeof(scopes[i].buckets));
+        }
+    }
+    PROFILER_UNLOCK();
+
+    for (size_t i = 0; i < count; i++) {
+        const Scope& s = copies[i];
+        out[i].name = s.name;
+        out[i].count = s.count;
+        out[i].avgMicros = s.count ? (uint32_t)(s.totalMicros / s.count) : 0;
+        out[i].maxMicros = s.maxMicros;
+        out[i].p50Micros = percentile(s, 50);
+        out[i].p90Micros = percentile(s, 90);
+        out[i].p99Micros = percentile(s, 99);
+        // Stack usage is a property of the task, read outside the critical section
+        out[i].stackFreeBytes = stackFreeBytes(s.task);
+    }
+    return count;
+}
+
+/**
+ * @brief Serializes a report as JSON, suitable for MQTT or an HTTP endpoint.
+ * @return Length written (truncated to size - 1).
+ */
+size_t toJson(char* buffer, size_t size, bool reset = true) {
+    Snapshot snaps[maxScopes];
+    size_t count = collect(snaps, maxScopes, reset);
+    size_t pos = snprintf(buffer, size, "{\"scopes\": [");
+    for (size_t i = 0; i < count && pos < size; i++) {
+        const Snapshot& s = snaps[i];
+        pos += snprintf(buffer + pos, size - pos,
+                        "%s{\"name\": \"%s\", \"n\": %u, \"avg\": %u, \"max\": %u, "
+                        "\"p50\": %u, \"p90\": %u, \"p99\": %u, \"stack\": %d}",
+                        i ? ", " : "", s.name, s.count, s.avgMicros, s.maxMicros,
+                        s.p50Micros, s.p90Micros, s.p99Micros, (int)s.stackFreeBytes);
+    }
+    if (pos < size) pos += snprintf(buffer + pos, size - pos, "], \"cpu\": [");
+    for (int core = 0; core < coreCount && pos < size; core++) {
+        pos += snprintf(buffer + pos, size - pos, "%s%.1f", core ? ", " : "", cpuLoad(core));
+    }
+    if (pos < size) pos += snprintf(buffer + pos, size - pos, "]}");
+    if (reset) resetCpuLoad();
+    return pos < size ? pos : size - 1;
+}
+
+#ifdef ARDUINO
+/**
+ * @brief Prints a human-readable report to Serial.
+ */
+void printReport(bool reset = true) {
+    Snapshot snaps[maxScopes];
+    size_t count = collect(snaps, maxScopes, reset);
+    for (size_t i = 0; i < count; i++) {
+        const Snapshot& s = snaps[i];
+        Serial.printf("[PROF] %-12s n=%u avg=%u us p50<=%u p90<=%u p99<=%u max=%u us stack free=%d B\n",
+                      s.name, s.count, s.avgMicros, s.p50Micros, s.p90Micros, s.p99Micros,
+                      s.maxMicros, (int)s.stackFreeBytes);
+    }
+    for (int core = 0; core < coreCount; core++) {
+        Serial.printf("[PROF] Core %d load: %.1f%%\n", core, cpuLoad(core));
+    }
+    if (reset) resetCpuLoad();
+}
+#endif
+
+/**
+ * @brief Records the lifetime of the object into a scope.
+ */
+class ScopedTimer {
+public:
+    explicit ScopedTimer(int id) : id(id), start(nowMicros()) {}
+    ~ScopedTimer() { record(id, nowMicros() - start); }
+private:
+    int id;
+    uint32_t start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(id) profiler::ScopedTimer PROFILE_CONCAT(profileScope_, __LINE__)(id)
+
+#else // PROFILER_ENABLED
+
+inline uint32_t nowMicros() { return 0; }
+inline void init() {}
+inline int registerScope(const char*) { return -1; }
+inline void record(int, uint32_t) {}
+inline size_t collect(Snapshot*, size_t, bool) { return 0; }
+inline size_t toJson(char* buffer, size_t size, bool = true) {
+    return size ? snprintf(buffer, size, "{}") : 0;
+}
+inline void printReport(bool = true) {}
+
+#define PROFILE_SCOPE(id) ((void)(id))
+
+#endif // PROFILER_ENABLED
+
+} // namespace profiler
+
+#endif // PROFILER_HPP
\ No newline at end of file
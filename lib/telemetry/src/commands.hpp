@@ -0,0 +1,123 @@
+#ifndef COMMANDS_HPP
+#define COMMANDS_HPP
+
+#include <Arduino.h>
+
+/**
+ * Remote commands received on mqtt::rxTopic.
+ *
+ * Payload format: "<name>[=<value>]", e.g. "publish=60000" or "snapshot".
+ * The MQTT callback only parses the payload and posts it to a fixed-size queue,
+ * so client.loop() is never blocked; the task that owns the settings drains the
+ * queue with poll() and applies the commands itself.
+ */
+namespace commands {
+
+enum class Type : uint8_t {
+    SampleInterval,  // ms between sensor reads
+    PublishInterval, // max ms between published messages (heartbeat)
+    RateLimit,       // min ms between published messages
+    BatchSize,       // backlog messages sent per cycle after an outage
+    Snapshot,        // publish a fresh reading right away
+    Reboot
+};
+
+struct Command {
+    Type type;
+    uint32_t value;
+};
+
+struct Spec {
+    const char* name;
+    Type type;
+    bool hasValue;
+    uint32_t minValue;
+    uint32_t maxValue;
+};
+
+// --- Configuration ---
+const Spec specs[] = {
+    {"sample",   Type::SampleInterval,  true,  10,  60000},
+    {"publish",  Type::PublishInterval, true,  100, 3600000},
+    {"rate",     Type::RateLimit,       true,  0,   3600000},
+    {"batch",    Type::BatchSize,       true,  1,   32},
+    {"snapshot", Type::Snapshot,        false, 0,   0},
+    {"reboot",   Type::Reboot,          false, 0,   0},
+};
+const size_t queueLength = 8;
+const size_t maxCommandLength = 24;
+
+QueueHandle_t queue = NULL;
+
+bool init() {
+    queue = xQueueCreate(queueLength, sizeof(Command));
+    if (queue == NULL) {
+        Serial.println("[CMD] Error creating command queue!");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Parses "<name>[=<value>]" into a command.
+ * @return false on unknown names, missing/extra values or out-of-range values.
+ */
+bool parse(const byte* payload, unsigned int length, Command& out) {
+    if (length == 0 || length > maxCommandLength) {
+        return false;
+    }
+    char text[maxCommandLength + 1];
+    memcpy(text, payload, length);
+    text[length] = '\0';
+
+    char* value = strchr(text, '=');
+    if (value != NULL) {
+        *value++ = '\0';
+    }
+
+    for (const Spec& spec : specs) {
+        if (strcmp(text, spec.name) != 0) {
+            continue;
+        }
+        if (!spec.hasValue) {
+            out = {spec.type, 0};
+            return value == NULL;
+        }
+        if (value == NULL || *value == '\0') {
+            return false;
+        }
+        char* end;
+        unsigned long parsed = strtoul(value, &end, 10);
+        if (*end != '\0' || parsed < spec.minValue || parsed > spec.maxValue) {
+            return false;
+        }
+        out = {spec.type, (uint32_t)parsed};
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief MQTT callback: parse and enqueue, never wait.
+ */
+void onMessage(char* topic, byte* payload, unsigned int length) {
+    Command command;
+    if (!parse(payload, length, command)) {
+        Serial.printf("[CMD] Ignoring invalid command on %s: %.*s\n", topic, (int)length, (const char*)payload);
+        return;
+    }
+    if (queue == NULL || xQueueSend(queue, &command, 0) != pdTRUE) {
+        Serial.println("[CMD] Command queue full, command dropped.");
+    }
+}
+
+/**
+ * @brief Takes the next pending command, if any, without blocking.
+ */
+bool poll(Command& out) {
+    return queue != NULL && xQueueReceive(queue, &out, 0) == pdTRUE;
+}
+
+} // namespace commands
+
+#endif // COMMANDS_HPP
\ No newline at end of file
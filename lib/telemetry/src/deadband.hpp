@@ -0,0 +1,152 @@
+#ifndef DEADBAND_HPP
+#define DEADBAND_HPP
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Report-by-exception for periodic telemetry.
+ *
+ * A record of N float fields is published when any field has moved at least its
+ * deadband away from the last published value, or when nothing was published for
+ * heartbeatMillis (so consumers can tell a quiet sensor from a dead one). Publishes
+ * are never closer than minIntervalMillis; a change seen inside that window is
+ * kept pending and goes out as soon as the window closes.
+ *
+ * No Arduino dependencies: the caller passes the time, so it also runs on the host.
+ */
+namespace deadband {
+
+enum class Reason : uint8_t {
+    None,      // Nothing to publish
+    First,     // No value published yet
+    Change,    // A field left its deadband
+    Heartbeat, // Max silence reached
+    Forced     // Requested by the caller (e.g. the "snapshot" command)
+};
+
+struct Policy {
+    unsigned long heartbeatMillis;   // Max silence between publishes
+    unsigned long minIntervalMillis; // Rate limit
+};
+
+struct Stats {
+    uint32_t samples;     // Records offered
+    uint32_t published;
+    uint32_t rateLimited; // Changes delayed by the rate limit
+};
+
+inline const char* reasonName(Reason reason) {
+    switch (reason) {
+    case Reason::First: return "first";
+    case Reason::Change: return "change";
+    case Reason::Heartbeat: return "heartbeat";
+    case Reason::Forced: return "forced";
+    default: return "none";
+    }
+}
+
+template <size_t N>
+class Reporter {
+public:
+    Reporter(const float (&deadbands)[N], Policy policy) : policy(policy) {
+        for (size_t i = 0; i < N; i++) {
+            this->deadbands[i] = deadbands[i];
+        }
+    }
+
+    Policy policy; // Runtime-tunable
+
+    void setDeadband(size_t field, float deadband) {
+        if (field < N) deadbands[field] = deadband;
+    }
+
+    /**
+     * @brief Takes a new record and decides whether it should be published now.
+     * Call sent() after a successful publish of current().
+     */
+    Reason offer(const float (&values)[N], unsigned long now, bool force = false) {
+        stats_.samples++;
+        for (size_t i = 0; i < N; i++) {
+            latest[i] = values[i];
+        }
+        hasLatest = true;
+        if (hasPublished && !pendingChange && changed()) {
+            pendingChange = true;
+            if (now - publishedMillis < policy.minIntervalMillis) {
+                stats_.rateLimited++;
+            }
+        }
+        return evaluate(now, force);
+    }
+
+    /**
+     * @brief Re-evaluates the last record without a new sample (heartbeat, rate limit release).
+     */
+    Reason poll(unsigned long now, bool force = false) {
+        return hasLatest ? evaluate(now, force) : Reason::None;
+    }
+
+    void sent(unsigned long now) {
+        for (size_t i = 0; i < N; i++) {
+            published[i] = latest[i];
+        }
+        hasPublished = true;
+        pendingChange = false;
+        publishedMillis = now;
+        stats_.published++;
+    }
+
+    const float* current() const {
+        return latest;
+    }
+
+    /**
+     * @brief Milliseconds until poll() can return something other than None.
+     */
+    unsigned long nextDueMillis(unsigned long now) const {
+        if (!hasLatest) return policy.heartbeatMillis;
+        unsigned long elapsed = now - publishedMillis;
+        unsigned long due = !hasPublished ? 0 : pendingChange ? policy.minIntervalMillis : policy.heartbeatMillis;
+        return elapsed >= due ? 0 : due - elapsed;
+    }
+
+    const Stats& stats() const {
+        return stats_;
+    }
+
+private:
+    bool changed() const {
+        for (size_t i = 0; i < N; i++) {
+            // NaN on either side counts as a change, so a sensor failing or recovering is reported
+            if (isnan(latest[i]) != isnan(published[i]) || fabsf(latest[i] - published[i]) >= deadbands[i]) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Reason evaluate(unsigned long now, bool force) {
+        if (force) return Reason::Forced;
+        if (!hasPublished) return Reason::First;
+        unsigned long elapsed = now - publishedMillis;
+        if (elapsed < policy.minIntervalMillis) return Reason::None;
+        if (pendingChange) return Reason::Change;
+        if (elapsed >= policy.heartbeatMillis) return Reason::Heartbeat;
+        return Reason::None;
+    }
+
+    float deadbands[N];
+    float latest[N] = {};
+    float published[N] = {};
+    bool hasLatest = false;
+    bool hasPublished = false;
+    bool pendingChange = false;
+    unsigned long publishedMillis = 0;
+    Stats stats_ = {};
+};
+
+} // namespace deadband
+
+#endif // DEADBAND_HPP
@@ -0,0 +1,304 @@
+#ifndef FAKE_FS_HPP
+#define FAKE_FS_HPP
+
+/**
+ * Host-side stand-in for the Arduino core and LittleFS as used by spool.hpp, so
+ * the spool can be exercised on a PC:
+ *
+ *   g++ -std=gnu++17 -I lib/telemetry/src my_scenario.cpp
+ *
+ * Files live in memory (fake::files) and survive a simulated reboot. Power can be
+ * cut after a given number of written bytes (fake::cutPowerAfter()): the write in
+ * progress keeps only its first bytes, or is garbled past that point, and nothing
+ * reaches storage afterwards. Writes land on storage as they are made, which is
+ * stricter than LittleFS (it only commits on flush/close); rename() is atomic, as
+ * LittleFS guarantees.
+ *
+ * millis() is simulated and only moves with fake::advance().
+ *
+ * Only included when ARDUINO is not defined; device builds never see it.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// --- Arduino core ---
+
+namespace fake {
+unsigned long nowMillis = 0;
+inline void advance(unsigned long ms) { nowMillis += ms; }
+} // namespace fake
+
+inline unsigned long millis() { return fake::nowMillis; }
+
+class String {
+public:
+    String() {}
+    String(const char* s) : s(s) {}
+    const char* c_str() const { return s.c_str(); }
+
+private:
+    std::string s;
+};
+
+struct FakeSerial {
+    bool quiet = false;
+
+    int printf(const char* format, ...) {
+        if (quiet) return 0;
+        va_list args;
+        va_start(args, format);
+        int n = vprintf(format, args);
+        va_end(args);
+        return n;
+    }
+    void println(const char* s = "") { printf("%s\n", s); }
+};
+
+FakeSerial Serial;
+
+// --- ROM CRC (same polynomial and conventions as esp_rom_crc32_le) ---
+
+inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len) {
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+// --- Storage with power cuts ---
+
+namespace fake {
+
+enum class Cut : uint8_t {
+    Truncate, // The interrupted write keeps the bytes before the cut
+    Garble    // The interrupted write is full length, random past the cut
+};
+
+std::map<std::string, std::vector<uint8_t>> files;
+long bytesUntilCut = -1; // -1: no cut scheduled
+Cut cutMode = Cut::Truncate;
+bool powerLost = false;
+
+// Operation counters, for scenarios that measure flash traffic
+uint32_t writeCalls = 0;
+uint32_t flushCalls = 0;
+uint32_t renameCalls = 0;
+uint64_t bytesWritten = 0;
+std::vector<size_t>* writeLog = nullptr; // When set, receives the size of every write
+
+void cutPowerAfter(long bytes, Cut mode) {
+    bytesUntilCut = bytes;
+    cutMode = mode;
+    powerLost = false;
+}
+
+/**
+ * @brief Power is back: storage is kept, nothing is cut any more.
+ */
+void restorePower() {
+    bytesUntilCut = -1;
+    powerLost = false;
+}
+
+/**
+ * @brief Stores a write, or the part of it that makes it before the cut.
+ * @return Bytes the caller sees as written.
+ */
+size_t store(std::vector<uint8_t>& file, size_t pos, const uint8_t* data, size_t size) {
+    if (powerLost) return 0;
+    writeCalls++;
+    if (writeLog) writeLog->push_back(size);
+    size_t kept = size;
+    if (bytesUntilCut >= 0 && (long)size >= bytesUntilCut) {
+        kept = (size_t)bytesUntilCut;
+        powerLost = true;
+    }
+    size_t stored = powerLost && cutMode == Cut::Garble ? size : kept;
+    if (file.size() < pos + stored) file.resize(pos + stored);
+    memcpy(file.data() + pos, data, kept);
+    for (size_t i = kept; i < stored; i++) file[pos + i] = (uint8_t)rand();
+    if (bytesUntilCut >= 0) bytesUntilCut -= kept;
+    bytesWritten += kept;
+    return kept;
+}
+
+} // namespace fake
+
+// --- LittleFS ---
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+class File {
+public:
+    File() {}
+
+    operator bool() const { return (bool)handle; }
+    void close() { handle.reset(); }
+    void flush() {
+        if (handle && !fake::powerLost) fake::flushCalls++;
+    }
+
+    size_t write(const uint8_t* data, size_t size) {
+        if (!handle || handle->directory || handle->mode == 'r') return 0;
+        auto it = fake::files.find(handle->path);
+        if (it == fake::files.end()) return 0;
+        if (handle->mode == 'a') handle->pos = it->second.size();
+        size_t n = fake::store(it->second, handle->pos, data, size);
+        handle->pos += n;
+        return n;
+    }
+
+    size_t read(uint8_t* buffer, size_t size) {
+        if (!handle || handle->directory) return 0;
+        auto it = fake::files.find(handle->path);
+        if (it == fake::files.end() || handle->pos >= it->second.size()) return 0;
+        size_t n = std::min(size, it->second.size() - handle->pos);
+        memcpy(buffer, it->second.data() + handle->pos, n);
+        handle->pos += n;
+        return n;
+    }
+
+    bool seek(uint32_t pos) {
+        if (!handle || handle->directory) return false;
+        auto it = fake::files.find(handle->path);
+        if (it == fake::files.end() || pos > it->second.size()) return false;
+        handle->pos = pos;
+        return true;
+    }
+
+    size_t size() const {
+        if (!handle) return 0;
+        auto it = fake::files.find(handle->path);
+        return it == fake::files.end() ? 0 : it->second.size();
+    }
+
+    bool isDirectory() const { return handle && handle->directory; }
+    const char* name() const { return handle ? handle->name.c_str() : ""; }
+
+    /**
+     * @brief Next entry of a directory handle; the listing is taken when it is opened.
+     */
+    File openNextFile() {
+        File entry;
+        if (!handle || !handle->directory || handle->listed >= handle->entries.size()) return entry;
+        const std::string& path = handle->entries[handle->listed++];
+        entry.handle = std::make_shared<Handle>();
+        entry.handle->path = path;
+        entry.handle->name = path.substr(path.rfind('/') + 1);
+        entry.handle->mode = 'r';
+        return entry;
+    }
+
+private:
+    friend class FakeLittleFS;
+
+    struct Handle {
+        std::string path;
+        std::string name;
+        char mode = 'r';
+        size_t pos = 0;
+        bool directory = false;
+        std::vector<std::string> entries;
+        size_t listed = 0;
+    };
+
+    std::shared_ptr<Handle> handle;
+};
+
+class FakeLittleFS {
+public:
+    bool begin(bool formatOnFail = false) {
+        (void)formatOnFail;
+        return true;
+    }
+
+    bool exists(const char* path) { return fake::files.count(path) > 0 || isDirectory(path); }
+
+    bool mkdir(const char* path) {
+        if (!fake::powerLost) directories.push_back(path);
+        return !fake::powerLost;
+    }
+
+    File open(const char* path, const char* mode = FILE_READ) {
+        File file;
+        std::string p = path;
+        if (isDirectory(p)) {
+            file.handle = std::make_shared<File::Handle>();
+            file.handle->path = p;
+            file.handle->directory = true;
+            std::string prefix = p + "/";
+            for (const auto& entry : fake::files) {
+                if (entry.first.compare(0, prefix.size(), prefix) == 0 &&
+                    entry.first.find('/', prefix.size()) == std::string::npos) {
+                    file.handle->entries.push_back(entry.first);
+                }
+            }
+            return file;
+        }
+        if (mode[0] == 'r' && fake::files.count(p) == 0) return file;
+        if (mode[0] != 'r') {
+            if (fake::powerLost) return file;
+            std::vector<uint8_t>& data = fake::files[p];
+            if (mode[0] == 'w') data.clear();
+        }
+        file.handle = std::make_shared<File::Handle>();
+        file.handle->path = p;
+        file.handle->name = p.substr(p.rfind('/') + 1);
+        file.handle->mode = mode[0];
+        return file;
+    }
+
+    bool rename(const char* from, const char* to) {
+        if (fake::powerLost) return false;
+        auto it = fake::files.find(from);
+        if (it == fake::files.end()) return false;
+        fake::renameCalls++;
+        fake::files[to] = it->second;
+        fake::files.erase(from);
+        return true;
+    }
+
+    bool remove(const char* path) {
+        if (fake::powerLost) return false;
+        return fake::files.erase(path) > 0;
+    }
+
+    File open(const String& path, const char* mode = FILE_READ) { return open(path.c_str(), mode); }
+    bool remove(const String& path) { return remove(path.c_str()); }
+
+    /**
+     * @brief Wipes storage, as a fresh flash would be.
+     */
+    void format() {
+        fake::files.clear();
+        directories.clear();
+    }
+
+private:
+    bool isDirectory(const std::string& path) {
+        for (const std::string& d : directories) {
+            if (d == path) return true;
+        }
+        return false;
+    }
+
+    std::vector<std::string> directories;
+};
+
+FakeLittleFS LittleFS;
+
+#endif // FAKE_FS_HPP
@@ -0,0 +1,97 @@
+#ifndef PAYLOAD_HPP
+#define PAYLOAD_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Telemetry payload encoders shared by the firmware and the host load generator
+ * (tools/loadgen), so benchmarks exercise exactly what the devices send.
+ *
+ * DHT (lab4_2):  "temp:hum:heatIndex[:epochMillis]"
+ * MPU (lab5_2):  {"qw": w, "qx": x, "qy": y, "qz": z[, "ts": epochMillis]}
+ *
+ * The timestamped forms are the ones replayed from the spool; the services accept both.
+ * Every format function returns the snprintf length (>= size means truncated).
+ *
+ * Binary forms for high-rate fleets: a tag byte (never printable, so the services
+ * tell them from text), little-endian float32 fields, then the optional uint64
+ * capture time. Fixed sizes let the services decode a batch in one numpy call.
+ */
+namespace payload {
+
+const size_t maxDhtLength = 64;
+const size_t maxOrientationLength = 112;
+
+inline int formatDht(char* buffer, size_t size, float temperature, float humidity, float heatIndex) {
+    return snprintf(buffer, size, "%.2f:%.2f:%.2f", temperature, humidity, heatIndex);
+}
+
+inline int formatDht(char* buffer, size_t size, float temperature, float humidity, float heatIndex,
+                     uint64_t timestampMs) {
+    return snprintf(buffer, size, "%.2f:%.2f:%.2f:%llu", temperature, humidity, heatIndex,
+                    (unsigned long long)timestampMs);
+}
+
+inline int formatOrientation(char* buffer, size_t size, float w, float x, float y, float z) {
+    return snprintf(buffer, size, "{\"qw\": %.4f, \"qx\": %.4f, \"qy\": %.4f, \"qz\": %.4f}", w, x, y, z);
+}
+
+inline int formatOrientation(char* buffer, size_t size, float w, float x, float y, float z,
+                             uint64_t timestampMs) {
+    return snprintf(buffer, size, "{\"qw\": %.4f, \"qx\": %.4f, \"qy\": %.4f, \"qz\": %.4f, \"ts\": %llu}",
+                    w, x, y, z, (unsigned long long)timestampMs);
+}
+
+// --- Binary ---
+
+enum Tag : uint8_t {
+    TAG_DHT = 0xD1,              // t h hi           13 bytes
+    TAG_DHT_TS = 0xD2,           // t h hi ts        21 bytes
+    TAG_ORIENTATION = 0xD3,      // w x y z          17 bytes
+    TAG_ORIENTATION_TS = 0xD4,   // w x y z ts       25 bytes
+};
+
+const size_t maxBinaryLength = 25;
+
+// ESP32 and the hosts we run on are little-endian: fields are copied as is
+inline size_t packFields(uint8_t* buffer, uint8_t tag, const float* fields, size_t count,
+                         const uint64_t* timestampMs) {
+    buffer[0] = tag;
+    memcpy(buffer + 1, fields, count * sizeof(float));
+    size_t length = 1 + count * sizeof(float);
+    if (timestampMs != NULL) {
+        memcpy(buffer + length, timestampMs, sizeof(uint64_t));
+        length += sizeof(uint64_t);
+    }
+    return length;
+}
+
+/**
+ * @brief Binary DHT reading; buffer must hold maxBinaryLength bytes.
+ * @return Payload length.
+ */
+inline size_t packDht(uint8_t* buffer, float temperature, float humidity, float heatIndex) {
+    const float fields[3] = {temperature, humidity, heatIndex};
+    return packFields(buffer, TAG_DHT, fields, 3, NULL);
+}
+
+inline size_t packDht(uint8_t* buffer, float temperature, float humidity, float heatIndex, uint64_t timestampMs) {
+    const float fields[3] = {temperature, humidity, heatIndex};
+    return packFields(buffer, TAG_DHT_TS, fields, 3, &timestampMs);
+}
+
+inline size_t packOrientation(uint8_t* buffer, float w, float x, float y, float z) {
+    const float fields[4] = {w, x, y, z};
+    return packFields(buffer, TAG_ORIENTATION, fields, 4, NULL);
+}
+
+inline size_t packOrientation(uint8_t* buffer, float w, float x, float y, float z, uint64_t timestampMs) {
+    const float fields[4] = {w, x, y, z};
+    return packFields(buffer, TAG_ORIENTATION_TS, fields, 4, &timestampMs);
+}
+
+} // namespace payload
+
+#endif // PAYLOAD_HPP
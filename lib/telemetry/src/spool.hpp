@@ -0,0 +1,293 @@
+#ifndef SPOOL_HPP
+#define SPOOL_HPP
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include "FS.h"
+#include <LittleFS.h>
+#include "esp_rom_crc.h"
+#else
+#include "fake_fs.hpp"
+#endif
+#include <sys/time.h>
+
+/**
+ * Store-and-forward telemetry spool on LittleFS.
+ *
+ * Records are appended to numbered segment files in /spool. Every record carries
+ * its capture timestamp and a CRC32, so a record torn by a reset is detected on
+ * replay and treated as the end of its segment. After a reboot the writer always
+ * starts a fresh segment and never appends behind a possibly torn tail.
+ * The read position is kept in a small index file so that already replayed data
+ * is not sent again after a reboot.
+ */
+namespace spool {
+
+// --- Configuration ---
+const char* dirPath = "/spool";
+const char* indexPath = "/spool/index";
+const char* indexTmpPath = "/spool/index.tmp";
+const size_t segmentMaxBytes = 16 * 1024;
+const uint32_t maxSegments = 16;             // 256 KB total; the oldest segment is dropped when full
+const size_t maxPayloadLength = 128;
+const unsigned long replayIntervalMillis = 200;
+size_t replayBurst = 2;                      // Records per interval (~10 msg/s), runtime-tunable via "batch"
+const uint32_t indexSaveEvery = 16;          // Limits flash wear; up to this many records may repeat after a reset
+
+const uint16_t recordMagic = 0x5352;         // "SR"
+const uint32_t indexMagic = 0x58444953;      // "SIDX"
+
+struct RecordHeader {
+    uint16_t magic;
+    uint16_t length;
+    uint32_t crc;          // CRC32 over timestamp and payload
+    uint64_t timestampMs;  // Wall-clock capture time (ms since epoch)
+};
+
+struct Index {
+    uint32_t magic;
+    uint32_t readSegment;
+    uint32_t readOffset;
+    uint32_t crc;
+};
+
+/**
+ * @brief Receives one replayed record; return false to stop and retry it later.
+ */
+typedef bool (*ReplaySink)(uint64_t timestampMs, const char* payload, size_t length);
+
+// --- State Variables ---
+bool ready = false;
+File writeFile;
+uint32_t writeSegment = 0;
+uint32_t writeOffset = 0;
+uint32_t readSegment = 0;
+uint32_t readOffset = 0;
+uint32_t replayedSinceSave = 0;
+unsigned long lastReplayMillis = 0;
+uint32_t droppedSegments = 0;
+
+uint64_t nowMillis() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (uint64_t)tv.tv_sec * 1000ULL + tv.tv_usec / 1000;
+}
+
+String segmentPath(uint32_t segment) {
+    char path[24];
+    snprintf(path, sizeof(path), "%s/%08x.seg", dirPath, segment);
+    return String(path);
+}
+
+uint32_t recordCrc(const RecordHeader& header, const uint8_t* payload) {
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t*)&header.timestampMs, sizeof(header.timestampMs));
+    return esp_rom_crc32_le(crc, payload, header.length);
+}
+
+void saveIndex() {
+    Index index = {indexMagic, readSegment, readOffset, 0};
+    index.crc = esp_rom_crc32_le(0, (const uint8_t*)&index, offsetof(Index, crc));
+    File file = LittleFS.open(indexTmpPath, FILE_WRITE);
+    if (!file) {
+        Serial.println("[SPOOL] Failed to write index.");
+        return;
+    }
+    file.write((const uint8_t*)&index, sizeof(index));
+    file.close();
+    // rename() is atomic in LittleFS, so the index is either old or new, never torn
+    LittleFS.rename(indexTmpPath, indexPath);
+    replayedSinceSave = 0;
+}
+
+bool loadIndex() {
+    File file = LittleFS.open(indexPath, FILE_READ);
+    if (!file) {
+        return false;
+    }
+    Index index;
+    bool ok = file.read((uint8_t*)&index, sizeof(index)) == sizeof(index)
+        && index.magic == indexMagic
+        && index.crc == esp_rom_crc32_le(0, (const uint8_t*)&index, offsetof(Index, crc));
+    file.close();
+    if (ok) {
+        readSegment = index.readSegment;
+        readOffset = index.readOffset;
+    }
+    return ok;
+}
+
+bool openSegmentForAppend(uint32_t segment) {
+    if (writeFile) {
+        writeFile.close();
+    }
+    writeFile = LittleFS.open(segmentPath(segment), FILE_APPEND);
+    if (!writeFile) {
+        Serial.printf("[SPOOL] Failed to open segment %08x.\n", segment);
+        return false;
+    }
+    writeSegment = segment;
+    writeOffset = writeFile.size();
+    return true;
+}
+
+void dropOldestSegment() {
+    uint32_t oldest = readSegment;
+    LittleFS.remove(segmentPath(oldest));
+    readSegment = oldest + 1;
+    readOffset = 0;
+    droppedSegments++;
+    saveIndex();
+    Serial.printf("[SPOOL] Spool full, dropped segment %08x.\n", oldest);
+}
+
+/**
+ * @brief Mounts LittleFS and recovers the spool state.
+ * @return true on success, false if the filesystem is unavailable.
+ */
+bool init() {
+    Serial.println("[SPOOL] Initializing spool...");
+    if (!LittleFS.begin(true)) {
+        Serial.println("[SPOOL] An error occurred while mounting LittleFS.");
+        return false;
+    }
+    if (!LittleFS.exists(dirPath)) {
+        LittleFS.mkdir(dirPath);
+    }
+
+    // Find the segment range present on flash
+    bool found = false;
+    uint32_t first = 0, last = 0;
+    File dir = LittleFS.open(dirPath);
+    File entry = dir.openNextFile();
+    while (entry) {
+        uint32_t segment;
+        if (!entry.isDirectory() && sscanf(entry.name(), "%8x.seg", &segment) == 1) {
+            if (!found || segment < first) first = segment;
+            if (!found || segment > last) last = segment;
+            found = true;
+        }
+        entry = dir.openNextFile();
+    }
+
+    if (!loadIndex() || !found || readSegment < first || readSegment > last) {
+        readSegment = first;
+        readOffset = 0;
+    }
+    // Segments fully replayed before a reset may still be on flash
+    for (uint32_t segment = first; found && segment < readSegment; segment++) {
+        LittleFS.remove(segmentPath(segment));
+    }
+
+    // Never append behind a possibly torn record: start a new segment on every boot
+    if (!openSegmentForAppend(found ? last + 1 : 0)) {
+        return false;
+    }
+    ready = true;
+    saveIndex();
+    Serial.printf("[SPOOL] Ready, segments %08x..%08x, read offset %u.\n", readSegment, writeSegment, readOffset);
+    return true;
+}
+
+bool pending() {
+    return ready && (readSegment < writeSegment || readOffset < writeOffset);
+}
+
+/**
+ * @brief Appends a record stamped with the current wall-clock time.
+ */
+bool append(const char* payload, size_t length) {
+    if (!ready || length > maxPayloadLength) {
+        return false;
+    }
+    if (writeOffset + sizeof(RecordHeader) + length > segmentMaxBytes) {
+        if (!openSegmentForAppend(writeSegment + 1)) {
+            return false;
+        }
+        if (writeSegment - readSegment >= maxSegments) {
+            dropOldestSegment();
+        }
+    }
+
+    RecordHeader header = {recordMagic, (uint16_t)length, 0, nowMillis()};
+    header.crc = recordCrc(header, (const uint8_t*)payload);
+
+    size_t written = writeFile.write((const uint8_t*)&header, sizeof(header));
+    written += writeFile.write((const uint8_t*)payload, length);
+    writeFile.flush();
+    writeOffset += written;
+    return written == sizeof(header) + length;
+}
+
+/**
+ * @brief Reads the record at the read position.
+ * @return false at the end of the segment: a clean end, a torn or a corrupt record.
+ */
+bool readRecord(File& file, RecordHeader& header, char* payload) {
+    if (!file.seek(readOffset)
+        || file.read((uint8_t*)&header, sizeof(header)) != sizeof(header)
+        || header.magic != recordMagic
+        || header.length > maxPayloadLength
+        || file.read((uint8_t*)payload, header.length) != header.length
+        || header.crc != recordCrc(header, (const uint8_t*)payload)) {
+        return false;
+    }
+    payload[header.length] = '\0';
+    return true;
+}
+
+/**
+ * @brief Replays spooled records in order, rate-limited so live data keeps priority.
+ * Call it from the publishing loop while the broker is reachable.
+ * @return Number of records handed to the sink.
+ */
+size_t replay(ReplaySink sink) {
+    if (!pending() || millis() - lastReplayMillis < replayIntervalMillis) {
+        return 0;
+    }
+    lastReplayMillis = millis();
+
+    // The active segment is sealed first so reads never race the open append handle
+    if (readSegment == writeSegment && !openSegmentForAppend(writeSegment + 1)) {
+        return 0;
+    }
+
+    size_t count = 0;
+    char payload[maxPayloadLength + 1];
+    RecordHeader header;
+    File file = LittleFS.open(segmentPath(readSegment), FILE_READ);
+    while (count < replayBurst) {
+        if (!file || !readRecord(file, header, payload)) {
+            // End of this segment (or a torn tail): move on to the next one
+            file.close();
+            LittleFS.remove(segmentPath(readSegment));
+            readSegment++;
+            readOffset = 0;
+            saveIndex();
+            if (readSegment == writeSegment) {
+                break;
+            }
+            file = LittleFS.open(segmentPath(readSegment), FILE_READ);
+            continue;
+        }
+        if (!sink(header.timestampMs, payload, header.length)) {
+            break;
+        }
+        readOffset += sizeof(header) + header.length;
+        count++;
+        if (++replayedSinceSave >= indexSaveEvery) {
+            saveIndex();
+        }
+    }
+    file.close();
+    if (!pending()) {
+        saveIndex();
+        if (droppedSegments > 0) {
+            Serial.printf("[SPOOL] Replay finished, %u segments were lost to overflow.\n", droppedSegments);
+            droppedSegments = 0;
+        }
+    }
+    return count;
+}
+
+} // namespace spool
+#endif // SPOOL_HPP
\ No newline at end of file
@@ -0,0 +1,269 @@
+#ifndef DISCIPLINE_HPP
+#define DISCIPLINE_HPP
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * Software clock disciplined by SNTP samples, without Arduino dependencies.
+ *
+ * The local clock is a free-running microsecond counter (esp_timer_get_time()
+ * on the ESP32). UTC is modelled as a line over it whose slope is the measured
+ * frequency error of the crystal, fitted by least squares over the recent
+ * samples, so the clock keeps time between syncs and through outages
+ * (holdover) instead of drifting by the full crystal error.
+ *
+ * Corrections below step_threshold_us are slewed at slew_rate, so the clock
+ * never goes back and never jumps; only the first sample and larger errors
+ * step it. Every reading comes with an error bound (Quality::error_us) that
+ * grows with the time since the last sync.
+ */
+namespace timesync {
+
+const int64_t step_threshold_us = 128000;     // Larger errors step the clock, smaller ones slew
+const double slew_rate = 500e-6;              // 0.5 ms per second
+const double tolerance_unknown = 100e-6;      // Error growth while the drift is unknown (crystal spec)
+const double tolerance_known = 1e-6;          // ... once measured (temperature wander)
+const int64_t min_fit_span_us = 300000000LL;  // 5 min of samples before the drift is fitted
+const int64_t max_fit_span_us = 14400000000LL; // Samples older than 4 h no longer count
+const int64_t holdover_after_us = 2048000000LL; // No sync for this long: Holdover
+const size_t fit_samples = 8;
+
+enum class State : uint8_t {
+    Unsynced,   // No time at all
+    Restored,   // Time and drift from before the reboot, not confirmed by a server yet
+    Synced,
+    Holdover    // Synced before, running on the measured drift since
+};
+
+inline const char* stateName(State state) {
+    switch (state) {
+    case State::Unsynced: return "unsynced";
+    case State::Restored: return "restored";
+    case State::Synced: return "synced";
+    case State::Holdover: return "holdover";
+    }
+    return "?";
+}
+
+struct Sample {
+    int64_t local_us;   // Local clock at the middle of the exchange
+    int64_t offset_us;  // UTC - local clock there
+    int64_t delay_us;   // Round trip, minus the server's processing time
+};
+
+struct Quality {
+    State state;
+    int64_t error_us;       // Bound on |now() - UTC|; -1: unknown (Unsynced, Restored)
+    int64_t offset_us;      // Last server time - our time, before correcting it
+    int64_t jitter_us;      // RMS scatter of the recent samples around the fit
+    int64_t delay_us;       // Round trip of the last sample
+    double drift_ppm;       // Crystal vs UTC, positive: the local clock runs fast
+    int64_t since_sync_us;  // -1: never synced since boot
+    uint32_t samples;       // Accepted
+    uint32_t steps;
+    uint32_t spikes;        // Rejected as outliers
+};
+
+/**
+ * @brief What survives a reboot (NVS).
+ */
+struct Snapshot {
+    uint32_t magic;
+    int32_t drift_ppb;
+    int64_t utc_us;
+};
+
+const uint32_t snapshot_magic = 0x31434C4B; // "KLC1"
+
+class Discipline {
+public:
+    bool valid() const { return state != State::Unsynced; }
+
+    /**
+     * @brief UTC in microseconds for a local clock reading. Monotonic between steps.
+     */
+    int64_t now(int64_t local) const { return line(local) - pending(local); }
+
+    /**
+     * @brief Takes a sample from the server.
+     * @return false if it was rejected as an outlier.
+     */
+    bool add(const Sample& sample) {
+        int64_t server = sample.local_us + sample.offset_us;
+        last_offset = valid() ? server - now(sample.local_us) : sample.offset_us;
+        last_delay = sample.delay_us;
+        if (state == State::Unsynced || llabs(last_offset) > step_threshold_us) {
+            step(sample);
+            return true;
+        }
+        // Popcorn spike: one sample far off the line is ignored, a second one in a row is believed
+        if (count >= 3 && !spiked && llabs(last_offset) > 3 * errorBound(sample.local_us) + 1000) {
+            spiked = true;
+            spikes++;
+            return false;
+        }
+        spiked = false;
+        push(sample);
+        int64_t target = sample.local_us + fit(sample.local_us);
+        int64_t shown = now(sample.local_us);
+        base_local = sample.local_us;
+        base_utc = target;
+        slew = target - shown;
+        slew_start = sample.local_us;
+        last_sync = sample.local_us;
+        synced = true;
+        state = State::Synced;
+        samples++;
+        return true;
+    }
+
+    /**
+     * @brief Starts from a time and drift remembered across a reboot.
+     */
+    void restore(int64_t local, int64_t utc, double drift_ppm) {
+        base_local = local;
+        base_utc = utc;
+        freq = -drift_ppm * 1e-6;
+        freq_known = true;
+        slew = 0;
+        count = 0;
+        state = State::Restored;
+    }
+
+    Snapshot snapshot(int64_t local) const {
+        return {snapshot_magic, (int32_t)lround(drift() * 1000), now(local)};
+    }
+
+    /**
+     * @brief Bound on the error of now(local); -1 while unknown.
+     */
+    int64_t errorBound(int64_t local) const {
+        if (!synced) return -1;
+        double tolerance = freq_known ? tolerance_known : tolerance_unknown;
+        return last_delay / 2 + jitter + llabs(pending(local)) + (int64_t)((local - last_sync) * tolerance);
+    }
+
+    Quality quality(int64_t local) const {
+        Quality q;
+        q.state = state;
+        if (state == State::Synced && local - last_sync > holdover_after_us) q.state = State::Holdover;
+        q.error_us = errorBound(local);
+        q.offset_us = last_offset;
+        q.jitter_us = jitter;
+        q.delay_us = last_delay;
+        q.drift_ppm = drift();
+        q.since_sync_us = synced ? local - last_sync : -1;
+        q.samples = samples;
+        q.steps = steps;
+        q.spikes = spikes;
+        return q;
+    }
+
+    /**
+     * @brief Parts per million the local clock runs fast.
+     */
+    double drift() const { return -freq * 1e6; }
+
+    bool driftKnown() const { return freq_known; }
+
+    uint32_t stepCount() const { return steps; }
+
+private:
+    // UTC = base_utc + (local - base_local) * (1 + freq), minus the slew still pending
+    int64_t base_local = 0;
+    int64_t base_utc = 0;
+    double freq = 0;
+    bool freq_known = false;
+    int64_t slew = 0;        // Correction being worked off at slew_rate since slew_start
+    int64_t slew_start = 0;
+
+    Sample history[fit_samples];  // Oldest first
+    size_t count = 0;
+    State state = State::Unsynced;
+    bool synced = false;          // A server sample since boot
+    bool spiked = false;
+    int64_t last_sync = 0;
+    int64_t last_offset = 0;
+    int64_t last_delay = 0;
+    int64_t jitter = 0;
+    uint32_t samples = 0, steps = 0, spikes = 0;
+
+    int64_t line(int64_t local) const {
+        int64_t dt = local - base_local;
+        return base_utc + dt + (int64_t)llround(dt * freq);
+    }
+
+    int64_t pending(int64_t local) const {
+        if (slew == 0) return 0;
+        int64_t done = (int64_t)((local - slew_start) * slew_rate);
+        if (done >= llabs(slew)) return 0;
+        return slew > 0 ? slew - done : slew + done;
+    }
+
+    void step(const Sample& sample) {
+        base_local = sample.local_us;
+        base_utc = sample.local_us + sample.offset_us;
+        slew = 0;
+        count = 0; // Samples from before a step describe another timeline
+        push(sample);
+        jitter = 0;
+        last_sync = sample.local_us;
+        synced = true;
+        state = State::Synced;
+        samples++;
+        steps++;
+    }
+
+    void push(const Sample& sample) {
+        size_t keep = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (sample.local_us - history[i].local_us <= max_fit_span_us) history[keep++] = history[i];
+        }
+        count = keep;
+        if (count == fit_samples) {
+            for (size_t i = 1; i < count; i++) history[i - 1] = history[i];
+            count--;
+        }
+        history[count++] = sample;
+    }
+
+    /**
+     * @brief Fits the offsets, updates freq and jitter.
+     * @return The fitted offset at local.
+     */
+    int64_t fit(int64_t local) {
+        // x: seconds before local, y: offset in microseconds
+        double sx = 0, sy = 0, sxx = 0, sxy = 0;
+        for (size_t i = 0; i < count; i++) {
+            double x = (history[i].local_us - local) / 1e6, y = (double)history[i].offset_us;
+            sx += x;
+            sy += y;
+            sxx += x * x;
+            sxy += x * y;
+        }
+        double n = (double)count;
+        double span = (double)(local - history[0].local_us);
+        double variance = sxx - sx * sx / n;
+        if (count >= 3 && span >= min_fit_span_us && variance > 0) {
+            freq = (sxy - sx * sy / n) / variance * 1e-6; // Offset slope, µs per s -> fraction
+            freq_known = true;
+        }
+        // Intercept with this slope, whether fitted or kept
+        double slope = freq * 1e6;
+        double intercept = (sy - slope * sx) / n;
+        double residuals = 0;
+        for (size_t i = 0; i < count; i++) {
+            double x = (history[i].local_us - local) / 1e6;
+            double r = history[i].offset_us - (intercept + slope * x);
+            residuals += r * r;
+        }
+        jitter = count >= 2 ? (int64_t)sqrt(residuals / n) : 0;
+        return (int64_t)llround(intercept);
+    }
+};
+
+} // namespace timesync
+#endif // DISCIPLINE_HPP
@@ -0,0 +1,97 @@
+#ifndef NTP_PACKET_HPP
+#define NTP_PACKET_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * SNTP (RFC 4330) request and reply packets, without Arduino dependencies.
+ *
+ * Times are microseconds since the Unix epoch. The request's transmit timestamp
+ * is a cookie rather than a time: the server copies it into the reply's
+ * originate field, which is how a reply is matched to its request, and the
+ * client keeps its own send time.
+ */
+namespace timesync {
+
+const size_t packet_size = 48;
+const uint16_t ntp_port = 123;
+const int64_t ntp_to_unix = 2208988800LL; // Seconds from 1900 to 1970
+
+struct Reply {
+    int64_t receive_us;   // Server time when the request arrived (T2)
+    int64_t transmit_us;  // Server time when the reply left (T3)
+    uint8_t stratum;
+    bool kiss;            // Kiss-o'-Death (stratum 0): the server wants us to go away
+};
+
+inline uint32_t readBigEndian(const uint8_t* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+inline void writeBigEndian(uint8_t* p, uint32_t value) {
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+/**
+ * @brief 64-bit NTP timestamp -> Unix microseconds.
+ *
+ * Seconds with the top bit clear are taken to be in era 1 (after 2036-02-07),
+ * as RFC 4330 suggests, which covers 1968-2104.
+ */
+inline int64_t readTimestamp(const uint8_t* p) {
+    int64_t seconds = readBigEndian(p);
+    if (seconds < 0x80000000LL) seconds += 0x100000000LL;
+    uint64_t fraction = readBigEndian(p + 4);
+    return (seconds - ntp_to_unix) * 1000000 + (int64_t)((fraction * 1000000) >> 32);
+}
+
+inline void writeTimestamp(uint8_t* p, int64_t unix_us) {
+    int64_t seconds = unix_us / 1000000, micros = unix_us % 1000000;
+    if (micros < 0) {
+        micros += 1000000;
+        seconds--;
+    }
+    writeBigEndian(p, (uint32_t)(seconds + ntp_to_unix));
+    writeBigEndian(p + 4, (uint32_t)(((uint64_t)micros << 32) / 1000000));
+}
+
+/**
+ * @brief A client request (version 4, mode 3) carrying the cookie.
+ */
+inline void makeRequest(uint8_t* packet, uint64_t cookie) {
+    memset(packet, 0, packet_size);
+    packet[0] = 4 << 3 | 3;
+    for (int i = 0; i < 8; i++) packet[40 + i] = cookie >> (56 - 8 * i);
+}
+
+/**
+ * @brief Checks a reply to the request with this cookie and takes its timestamps.
+ * @return false for anything that is not a usable server reply (out.kiss tells KoD apart).
+ */
+inline bool parseReply(const uint8_t* packet, size_t length, uint64_t cookie, Reply& out) {
+    memset(&out, 0, sizeof(out));
+    if (length < packet_size) return false;
+    uint8_t leap = packet[0] >> 6, version = packet[0] >> 3 & 7, mode = packet[0] & 7;
+    if (mode != 4 || version < 3 || version > 4) return false;
+    for (int i = 0; i < 8; i++) {
+        if (packet[24 + i] != (uint8_t)(cookie >> (56 - 8 * i))) return false; // Not ours, or a stale one
+    }
+    out.stratum = packet[1];
+    if (out.stratum == 0) {
+        out.kiss = true;
+        return false;
+    }
+    if (leap == 3 || out.stratum > 15) return false; // Server not synchronized itself
+    if (readBigEndian(packet + 40) == 0 && readBigEndian(packet + 44) == 0) return false;
+    out.receive_us = readTimestamp(packet + 32);
+    out.transmit_us = readTimestamp(packet + 40);
+    return true;
+}
+
+} // namespace timesync
+#endif // NTP_PACKET_HPP
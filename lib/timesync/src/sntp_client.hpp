@@ -0,0 +1,175 @@
+#ifndef SNTP_CLIENT_HPP
+#define SNTP_CLIENT_HPP
+
+#include "ntp_packet.hpp"
+#include "discipline.hpp"
+
+/**
+ * Non-blocking SNTP client feeding a Discipline, without Arduino dependencies.
+ *
+ * run() is called often with the local clock and never waits: it sends the
+ * next request when one is due and takes a reply if one has arrived. Requests
+ * go out in bursts of burst_size; the sample with the shortest round trip of
+ * a burst is the one used, since its offset is the least skewed by queueing.
+ * The very first reply sets the clock at once.
+ *
+ * The poll interval doubles from min_poll_us up to max_poll_us while samples
+ * agree with the fitted drift and halves when they do not. A burst without a
+ * single reply backs off from retry_us, and a Kiss-o'-Death goes to the
+ * longest interval.
+ *
+ * Net is anything with
+ *   bool send(const uint8_t* data, size_t length);
+ *   int receive(uint8_t* data, size_t length);   // 0 when nothing arrived
+ * (WiFiUDP on the device, a fake server in tools/timesim).
+ */
+namespace timesync {
+
+const int64_t min_poll_us = 64000000LL;
+const int64_t max_poll_us = 1024000000LL;
+const int64_t retry_us = 4000000LL;          // First retry after a burst without replies, doubling
+const int64_t reply_timeout_us = 1500000LL;
+const int64_t burst_spacing_us = 2000000LL;
+const size_t burst_size = 4;
+
+struct ClientStats {
+    uint32_t sent;
+    uint32_t replies;
+    uint32_t timeouts;
+    uint32_t bogus;     // Not a reply to our request, or from an unsynchronized server
+    uint32_t kisses;
+    uint32_t bursts;
+};
+
+template <typename Net>
+class Client {
+public:
+    Client(Net& net, Discipline& clock) : net(net), clock(clock) {}
+
+    void run(int64_t local) {
+        if (waiting && !receive(local)) {
+            if (local - sent_at < reply_timeout_us) return;
+            waiting = false;
+            stats.timeouts++;
+        }
+        if (local < next_send) return;
+        if (sent_in_burst < burst_size && send(local)) {
+            next_send = local + burst_spacing_us;
+            return;
+        }
+        finishBurst(local);
+    }
+
+    int64_t pollInterval() const { return poll; }
+
+    /**
+     * @brief Whether a reply is awaited: it is only seen when run() is called, and the
+     * time of that call is its arrival time, so the caller polls closely meanwhile.
+     */
+    bool awaitingReply() const { return waiting; }
+
+    /**
+     * @brief Local time at which run() next has work: the reply timeout or the next request.
+     */
+    int64_t nextDue() const { return waiting ? sent_at + reply_timeout_us : next_send; }
+
+    ClientStats stats = {};
+
+private:
+    Net& net;
+    Discipline& clock;
+    int64_t poll = min_poll_us;
+    int64_t next_send = 0;
+    int64_t sent_at = 0;
+    uint64_t cookie = 0;
+    bool waiting = false;
+    size_t sent_in_burst = 0;
+    size_t burst_replies = 0;
+    Sample best = {};
+    bool have_best = false;
+    bool kissed = false;
+    uint8_t failures = 0;
+
+    bool send(int64_t local) {
+        uint8_t packet[packet_size];
+        cookie = (uint64_t)local * 0x9E3779B97F4A7C15ULL ^ ++stats.sent; // Unpredictable to an off-path spoofer
+        makeRequest(packet, cookie);
+        if (!net.send(packet, sizeof(packet))) return false; // No link: the burst ends here
+        sent_at = local;
+        waiting = true;
+        sent_in_burst++;
+        return true;
+    }
+
+    bool receive(int64_t local) {
+        uint8_t packet[packet_size];
+        int length;
+        while ((length = net.receive(packet, sizeof(packet))) > 0) {
+            Reply reply;
+            if (!parseReply(packet, (size_t)length, cookie, reply)) {
+                stats.bogus++;
+                if (reply.kiss) {
+                    stats.kisses++;
+                    kissed = true;
+                    waiting = false;
+                    sent_in_burst = burst_size; // No more requests in this burst
+                    return true;
+                }
+                continue;
+            }
+            // T1 = sent_at, T4 = local on our clock; T2, T3 on the server's
+            Sample sample;
+            sample.local_us = sent_at + (local - sent_at) / 2;
+            sample.offset_us = ((reply.receive_us - sent_at) + (reply.transmit_us - local)) / 2;
+            sample.delay_us = (local - sent_at) - (reply.transmit_us - reply.receive_us);
+            if (sample.delay_us < 0) sample.delay_us = 0;
+            waiting = false;
+            stats.replies++;
+            burst_replies++;
+            if (!clock.valid()) {
+                clock.add(sample); // First fix: no point waiting for the rest of the burst
+            } else if (!have_best || sample.delay_us < best.delay_us) {
+                best = sample;
+                have_best = true;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void finishBurst(int64_t local) {
+        bool replied = burst_replies > 0;
+        burst_replies = 0;
+        sent_in_burst = 0;
+        stats.bursts++;
+        if (kissed) {
+            kissed = false;
+            poll = max_poll_us;
+            next_send = local + poll;
+            have_best = false;
+            return;
+        }
+        if (!replied) {
+            int64_t backoff = retry_us << (failures < 8 ? failures : 8);
+            if (failures < 255) failures++;
+            next_send = local + (backoff < poll ? backoff : poll);
+            return;
+        }
+        failures = 0;
+        bool agrees = false;
+        if (have_best && clock.add(best)) {
+            Quality q = clock.quality(local);
+            agrees = clock.driftKnown() && llabs(q.offset_us) <= 4 * q.jitter_us + best.delay_us / 2;
+        }
+        have_best = false;
+        if (agrees) {
+            poll = poll * 2 < max_poll_us ? poll * 2 : max_poll_us;
+        } else {
+            poll = poll / 2 > min_poll_us ? poll / 2 : min_poll_us;
+        }
+        next_send = local + poll;
+    }
+};
+
+} // namespace timesync
+#endif // SNTP_CLIENT_HPP
@@ -0,0 +1,241 @@
+#ifndef TIMESYNC_HPP
+#define TIMESYNC_HPP
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <Preferences.h>
+#include <sys/time.h>
+#include <time.h>
+#include <atomic>
+#include "esp_timer.h"
+#include "sntp_client.hpp"
+
+/**
+ * Background time service, in place of configTzTime() and the IDF SNTP client.
+ *
+ * begin() returns at once. NTP_Task runs the SNTP client on esp_timer_get_time()
+ * and keeps the system clock (time(), gettimeofday(), localtime()) on the
+ * disciplined time: it steps it at the first fix and otherwise hands the
+ * difference to adjtime() once a second, so the clock is corrected for the
+ * crystal's drift between syncs and never goes back.
+ *
+ * The time and the measured drift go to NVS every save_interval_us. After a
+ * software reset the system clock is still running and is kept; after a power
+ * loss it restarts from the saved time (behind by the time the board was off).
+ * Either way valid() is true before the network is up, with State::Restored
+ * until the first reply.
+ *
+ * NTP_Task sleeps until its next deadline (a request, a reply timeout or the
+ * next follow, so about once a second) and only polls every few milliseconds
+ * while a reply is on its way. The clock and the client belong to the task;
+ * readers get a copy published under a short lock, and valid() reads an atomic
+ * flag without taking it.
+ */
+namespace timesync {
+
+// --- Configuration ---
+const char* prefs_namespace = "timesync";
+const uint16_t local_port = 0;                       // Any free port
+const int64_t reply_poll_us = 2000;                   // While a reply is due: its arrival time is T4
+const int64_t follow_interval_us = 1000000LL;        // System clock pulled onto the disciplined one
+const int64_t save_interval_us = 900000000LL;        // 15 min: ~100 NVS writes a day
+const time_t earliest_valid = 1577836800;            // 2020-01-01: anything before is an unset clock
+
+/**
+ * @brief The SNTP client's Net over WiFiUDP.
+ */
+class UdpNet {
+public:
+    const char* server = NULL;
+
+    /**
+     * @brief Looks the server up. Blocks on DNS, so NTP_Task calls it outside the lock.
+     */
+    bool resolve() {
+        resolved = WiFi.status() == WL_CONNECTED && WiFi.hostByName(server, address) == 1;
+        return resolved;
+    }
+
+    bool send(const uint8_t* data, size_t length) {
+        if (!resolved || WiFi.status() != WL_CONNECTED) return false;
+        if (!open) open = udp.begin(local_port);
+        return open && udp.beginPacket(address, ntp_port) && udp.write(data, length) == length && udp.endPacket();
+    }
+
+    int receive(uint8_t* data, size_t length) {
+        if (!open || udp.parsePacket() <= 0) return 0;
+        return udp.read(data, length);
+    }
+
+    bool resolved = false;
+
+private:
+    WiFiUDP udp;
+    IPAddress address;
+    bool open = false;
+};
+
+// --- State Variables ---
+UdpNet net;
+Discipline clock;                   // NTP_Task's own, never read elsewhere
+Client<UdpNet> client(net, clock);
+SemaphoreHandle_t lock = NULL;      // Guards the published copies
+Discipline published_clock;         // clock as of NTP_Task's last pass
+ClientStats published_stats = {};
+std::atomic<bool> clock_valid{false};
+TaskHandle_t taskHandle = NULL;
+Preferences prefs;
+volatile uint32_t system_steps = 0;
+
+int64_t systemMicros() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+void setSystemMicros(int64_t utc) {
+    struct timeval tv = {(time_t)(utc / 1000000), (suseconds_t)(utc % 1000000)};
+    settimeofday(&tv, NULL);
+}
+
+void save(int64_t local) {
+    Snapshot snapshot = clock.snapshot(local);
+    prefs.begin(prefs_namespace, false);
+    prefs.putBytes("clock", &snapshot, sizeof(snapshot));
+    prefs.end();
+}
+
+void restore() {
+    Snapshot snapshot = {};
+    prefs.begin(prefs_namespace, true);
+    bool saved = prefs.getBytes("clock", &snapshot, sizeof(snapshot)) == sizeof(snapshot) &&
+                 snapshot.magic == snapshot_magic;
+    prefs.end();
+    if (!saved) {
+        Serial.println("[NTP] No saved time, waiting for the server.");
+        return;
+    }
+    int64_t local = esp_timer_get_time();
+    int64_t system = systemMicros();
+    bool running = system / 1000000 >= earliest_valid; // Software reset: the RTC kept counting
+    int64_t utc = running ? system : snapshot.utc_us;
+    clock.restore(local, utc, snapshot.drift_ppb / 1000.0);
+    if (!running) setSystemMicros(utc);
+    Serial.printf("[NTP] Restored %s time, drift %.2f ppm.\n", running ? "running" : "saved", clock.drift());
+}
+
+/**
+ * @brief Moves the system clock onto the disciplined time.
+ */
+void follow(int64_t local) {
+    int64_t delta = clock.now(local) - systemMicros();
+    if (llabs(delta) > step_threshold_us) {
+        setSystemMicros(clock.now(esp_timer_get_time()));
+        system_steps++;
+        Serial.printf("[NTP] Clock stepped by %lld ms.\n", (long long)(delta / 1000));
+        return;
+    }
+    struct timeval adjustment = {(time_t)(delta / 1000000), (suseconds_t)(delta % 1000000)};
+    adjtime(&adjustment, NULL);
+}
+
+/**
+ * @brief Hands readers a copy of the clock and the client counters.
+ */
+void publish() {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    published_clock = clock;
+    published_stats = client.stats;
+    xSemaphoreGive(lock);
+    clock_valid = clock.valid();
+}
+
+void task(void* parameter) {
+    int64_t last_follow = 0, last_save = 0;
+    uint32_t steps_followed = 0, samples_logged = 0, timeouts_seen = 0;
+    for (;;) {
+        // A new address when there is none yet, or after a burst's worth of silence (pool servers come and go)
+        if (!net.resolved || client.stats.timeouts - timeouts_seen >= burst_size) {
+            timeouts_seen = client.stats.timeouts;
+            net.resolve();
+        }
+        int64_t local = esp_timer_get_time();
+        client.run(local);
+        Quality q = clock.quality(local);
+        bool stepped = clock.stepCount() != steps_followed;
+        if (clock.valid() && (stepped || local - last_follow >= follow_interval_us)) {
+            follow(local);
+            steps_followed = clock.stepCount();
+            last_follow = local;
+        }
+        bool synced = q.state == State::Synced || q.state == State::Holdover;
+        if (synced && (stepped || local - last_save >= save_interval_us)) {
+            save(local); // NVS write: no reader waits on it
+            last_save = local;
+        }
+        publish();
+
+        if (q.samples != samples_logged) {
+            samples_logged = q.samples;
+            Serial.printf("[NTP] Sample: offset %lld us, delay %lld us, drift %.2f ppm, error %lld us, poll %lld s\n",
+                          (long long)q.offset_us, (long long)q.delay_us, q.drift_ppm, (long long)q.error_us,
+                          (long long)(client.pollInterval() / 1000000));
+        }
+
+        // Sleep until the client or follow() has work
+        int64_t wake = client.awaitingReply() ? local + reply_poll_us : client.nextDue();
+        if (clock.valid() && last_follow + follow_interval_us < wake) wake = last_follow + follow_interval_us;
+        int64_t sleep_us = wake - esp_timer_get_time();
+        TickType_t ticks = sleep_us > 0 ? pdMS_TO_TICKS((sleep_us + 999) / 1000) : 0;
+        vTaskDelay(ticks > 0 ? ticks : 1);
+    }
+}
+
+/**
+ * @brief Sets the time zone, restores the saved time and starts NTP_Task. Never waits.
+ */
+void begin(const char* server, const char* zone) {
+    setenv("TZ", zone, 1);
+    tzset();
+    net.server = server;
+    lock = xSemaphoreCreateMutex();
+    restore();
+    published_clock = clock;
+    clock_valid = clock.valid();
+    BaseType_t result = xTaskCreatePinnedToCore(task, "NTP_Task", 4096, NULL, 1, &taskHandle, 0);
+    if (lock == NULL || result != pdPASS) {
+        Serial.println("[NTP] Error creating the time task!");
+    }
+}
+
+/**
+ * @brief Whether the system clock holds a time (synced, in holdover or restored).
+ */
+bool valid() { return clock_valid; }
+
+Quality quality() {
+    Quality q = {};
+    if (lock == NULL) return q;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    q = published_clock.quality(esp_timer_get_time());
+    xSemaphoreGive(lock);
+    return q;
+}
+
+ClientStats clientStats() {
+    ClientStats stats = {};
+    if (lock == NULL) return stats;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    stats = published_stats;
+    xSemaphoreGive(lock);
+    return stats;
+}
+
+/**
+ * @brief Times the system clock was stepped: a change means time() jumped.
+ */
+uint32_t steps() { return system_steps; }
+
+} // namespace timesync
+#endif // TIMESYNC_HPP
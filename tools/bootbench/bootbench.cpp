@@ -0,0 +1,164 @@
+/**
+ * bootbench.cpp
+ *
+ * Host benchmark and check for the Wi-Fi fast path of lib/connectivity
+ * (sta.hpp): boot-to-first-publish time for each kind of boot, with the
+ * cached AP and lease in the state that boot leaves them.
+ *
+ * Every boot runs in its own process (fork), so RAM starts clean; RTC memory,
+ * NVS and the RTC time are set up as the kind of boot would leave them:
+ *   cold          - no cache: scan + DHCP
+ *   deep sleep    - 10 min asleep: RTC cache, lease still valid
+ *   power cycle   - NVS cache only, RTC time starts over: lease age unknown
+ *   long sleep    - 3 h asleep: RTC cache, the 2 h lease has expired
+ *   AP away       - deep sleep, but the AP comes back only after 8 s
+ *
+ * Latencies are the fake access point's (fake_network.hpp: 2.5 s scan + DHCP,
+ * 300 ms join on a known BSSID/channel, 700 ms DHCP), not measured on a board.
+ *
+ * Check: each boot takes the path its cache allows, a lease is never reused
+ * past its end or after a power loss, NVS is only written when the lease
+ * changes, and no join, RSSI read or NVS write ever runs in a timer or Wi-Fi
+ * event callback.
+ *
+ * Build and run:
+ *   g++ -std=gnu++17 -O2 -I lib/connectivity/src tools/bootbench/bootbench.cpp -o bootbench
+ *   ./bootbench
+ */
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "mqtt.hpp"
+
+const uint64_t minuteMicros = 60ULL * 1000000;
+
+int failures = 0;
+
+void expect(bool ok, const char* what) {
+    printf("  %-62s %s\n", what, ok ? "ok" : "FAIL");
+    failures += !ok;
+}
+
+struct Boot {
+    const char* name;
+    bool rtcCache;             // RTC memory kept (deep sleep)
+    bool nvsCache;
+    uint64_t rtcBootMicros;    // RTC time at boot, after the cache was written
+    unsigned long apAwayMillis;
+};
+
+struct Result {
+    bool published;
+    unsigned long publishMillis;   // Boot to the first message at the broker
+    unsigned long wifiMillis;      // Last join attempt to GOT_IP
+    uint32_t joins;
+    bool fastJoin;                 // The successful join used the cached BSSID/channel
+    bool staticIp;
+    bool nvsWritten;
+    uint32_t blockingInCallbacks;
+    sta::ApCache cache;            // As the boot leaves it
+};
+
+/**
+ * @brief One boot, in the child: connect, publish once, wait for the cache to settle.
+ */
+Result boot(const Boot& b, const sta::ApCache& saved) {
+    Serial.quiet = true;
+    if (b.rtcCache) sta::rtcCache = saved;
+    if (b.nvsCache) fake::nvs["sta/ap"].assign((const uint8_t*)&saved, (const uint8_t*)&saved + sizeof(saved));
+    std::vector<uint8_t> nvsBefore = fake::nvs["sta/ap"];
+    fake::rtcBootMicros = b.rtcBootMicros;
+    if (b.apAwayMillis > 0) WiFi.dropAp();
+
+    sta::begin();
+    mqtt::setupMqtt();
+    mqtt::publish(mqtt::txTopic, "boot", 1);
+    Result r = {};
+    while (fake::broker.received.empty() && millis() < 60000) {
+        if (b.apAwayMillis > 0 && millis() >= b.apAwayMillis) WiFi.restoreAp();
+        mqtt::loop();
+        delay(1);
+    }
+    r.published = !fake::broker.received.empty();
+    r.publishMillis = millis();
+    r.wifiMillis = sta::lastConnectMillis;
+    delay(100); // STA_Task writes the cache after GOT_IP
+    r.joins = WiFi.connectAttempts;
+    r.fastJoin = sta::usingCache;
+    r.staticIp = sta::usingStaticIp;
+    r.nvsWritten = fake::nvs["sta/ap"] != nvsBefore;
+    r.blockingInCallbacks = fake::blockingInCallbacks;
+    r.cache = sta::rtcCache;
+    return r;
+}
+
+Result run(const Boot& b, const sta::ApCache& saved) {
+    int fds[2];
+    Result r = {};
+    if (pipe(fds) != 0) return r;
+    pid_t pid = fork();
+    if (pid == 0) {
+        r = boot(b, saved);
+        ssize_t written = write(fds[1], &r, sizeof(r));
+        _exit(written == sizeof(r) ? 0 : 1);
+    }
+    close(fds[1]);
+    if (read(fds[0], &r, sizeof(r)) != sizeof(r)) r = {};
+    close(fds[0]);
+    waitpid(pid, NULL, 0);
+    return r;
+}
+
+int main() {
+    sta::ApCache none = {};
+    Result cold = run({"cold", false, false, 0, 0}, none);
+    sta::ApCache saved = cold.cache;
+    uint64_t leaseEnd = saved.leaseStartMicros + saved.leaseSeconds * 1000000ULL;
+
+    const Boot boots[] = {
+        {"deep sleep, 10 min", true, true, saved.leaseStartMicros + 10 * minuteMicros, 0},
+        {"power cycle", false, true, 0, 0},
+        {"deep sleep, 3 h (lease over)", true, true, leaseEnd + 60 * minuteMicros, 0},
+        {"AP away for 8 s", true, true, saved.leaseStartMicros + 10 * minuteMicros, 8000},
+    };
+    Result results[4];
+    for (int i = 0; i < 4; i++) results[i] = run(boots[i], saved);
+    const Result& sleep = results[0];
+    const Result& power = results[1];
+    const Result& expired = results[2];
+    const Result& away = results[3];
+
+    printf("boot to first publish (fake AP latencies):\n");
+    printf("  %-30s %10s %10s %6s %-22s\n", "", "publish ms", "wifi ms", "joins", "path");
+    auto row = [](const char* name, const Result& r) {
+        printf("  %-30s %10lu %10lu %6u %-22s\n", name, r.publishMillis, r.wifiMillis, (unsigned)r.joins,
+               r.staticIp ? "cached AP, static IP" : r.fastJoin ? "cached AP, DHCP" : "scan + DHCP");
+    };
+    row("cold", cold);
+    for (int i = 0; i < 4; i++) row(boots[i].name, results[i]);
+
+    printf("check:\n");
+    bool published = cold.published;
+    uint32_t blocking = cold.blockingInCallbacks;
+    for (const Result& r : results) {
+        published &= r.published;
+        blocking += r.blockingInCallbacks;
+    }
+    expect(published, "every boot publishes");
+    expect(!cold.fastJoin && cold.nvsWritten && saved.leaseSeconds == WiFi.leaseSeconds,
+           "cold: scan + DHCP, the lease is cached in NVS");
+    expect(sleep.fastJoin && sleep.staticIp && !sleep.nvsWritten, "deep sleep: cached AP, static IP, no NVS write");
+    expect(power.fastJoin && !power.staticIp, "power cycle: lease age unknown, cached AP with DHCP");
+    expect(expired.fastJoin && !expired.staticIp && expired.nvsWritten &&
+               expired.cache.leaseStartMicros > saved.leaseStartMicros,
+           "expired lease: cached AP with DHCP, new lease cached");
+    expect(away.published && away.joins > sta::fastAttempts && !away.fastJoin,
+           "AP away: falls back to a scan after the cached attempts");
+    expect(sleep.publishMillis < power.publishMillis && power.publishMillis < cold.publishMillis,
+           "static IP beats DHCP, which beats a scan");
+    expect(blocking == 0, "no join, RSSI read or NVS write in a callback");
+
+    printf(failures ? "\nFAIL\n" : "\nPASS\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,261 @@
+/**
+ * calendarbench.cpp
+ *
+ * Host check and benchmark for lab7_2's event calendar (lab7_2/src/calendar.hpp).
+ *
+ * Check, rules: random events of every kind (29.02, day 31 monthly, fifth
+ * and last weekdays, dates in the past) are compared with a day-by-day search
+ * that tests each date against the rule, from random start days in 1990-2090.
+ *
+ * Check, schedule: 250 random events in a Schedule while time moves forward
+ * in random steps, now and then back, across a TZ change, with random edits
+ * in between. After every step the order and every entry must equal
+ * nextOccurrence() of every event, sorted.
+ *
+ * Benchmark: finding the next event on every display tick with 250 events,
+ * by scanning (nextOccurrence() for each event) vs Schedule::update().
+ *
+ * Build and run:
+ *   g++ -std=gnu++17 -O2 -I lab7_2/src tools/calendarbench/calendarbench.cpp -o calendarbench
+ *   ./calendarbench
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "calendar.hpp"
+
+using calendar::Event;
+using calendar::Repeat;
+
+const size_t EVENTS = calendar::max_events;
+
+std::mt19937 rng(7);
+
+Event randomEvent() {
+    Event e = {};
+    snprintf(e.name, sizeof(e.name), "Event %u", (unsigned)(rng() % 100000));
+    e.repeat = (Repeat)(1 + rng() % 5);
+    e.month = 1 + rng() % 12;
+    e.day = 1 + rng() % calendar::daysInMonth(2000, e.month);
+    if (rng() % 8 == 0) {
+        e.month = 2; // Plenty of 29.02
+        e.day = 29;
+    }
+    e.weekday = rng() % 7;
+    e.nth = rng() % 6 == 0 ? calendar::last : 1 + rng() % 5;
+    e.year = 1990 + rng() % 100;
+    switch (e.repeat) {
+    case Repeat::Once:
+        e.day = std::min<int>(e.day, calendar::daysInMonth(e.year, e.month));
+        break;
+    case Repeat::Monthly:
+        e.day = rng() % 4 == 0 ? 29 + rng() % 3 : e.day;
+        break;
+    case Repeat::NthWeekday:
+        e.month = rng() % 3 == 0 ? 0 : e.month;
+        break;
+    default:
+        break;
+    }
+    return e;
+}
+
+/**
+ * @brief Whether a date matches the rule, without any cleverness.
+ */
+bool matches(const Event& e, long day) {
+    calendar::Date d = calendar::civilFromDays(day);
+    int length = calendar::daysInMonth(d.year, d.month);
+    switch (e.repeat) {
+    case Repeat::Once:
+        return d.year == e.year && d.month == e.month && d.day == e.day;
+    case Repeat::Yearly:
+        return d.month == e.month && d.day == e.day;
+    case Repeat::Monthly:
+        return d.day == std::min<int>(e.day, length);
+    case Repeat::Weekly:
+        return calendar::weekdayOf(day) == e.weekday;
+    case Repeat::NthWeekday:
+        if (e.month != 0 && d.month != e.month) return false;
+        if (calendar::weekdayOf(day) != e.weekday) return false;
+        return e.nth == calendar::last ? d.day + 7 > length : (d.day - 1) / 7 + 1 == e.nth;
+    default:
+        return false;
+    }
+}
+
+long slowNextDate(const Event& e, long from) {
+    long years = e.repeat == Repeat::Once ? 210 : 45; // Once: up to 2089 from 1990 and back
+    for (long day = from; day < from + 366 * years; day++) {
+        if (matches(e, day)) return day;
+    }
+    return calendar::no_date;
+}
+
+bool checkRules() {
+    unsigned long mismatches = 0, checked = 0;
+    // The day arithmetic itself
+    for (long day = calendar::daysFromCivil(1900, 1, 1); day < calendar::daysFromCivil(2200, 1, 1); day++) {
+        calendar::Date d = calendar::civilFromDays(day);
+        if (calendar::daysFromCivil(d.year, d.month, d.day) != day) mismatches++;
+        checked++;
+    }
+    for (int i = 0; i < 20000; i++) {
+        Event e = randomEvent();
+        long from = calendar::daysFromCivil(1990, 1, 1) + rng() % (366 * 100);
+        long expected = slowNextDate(e, from);
+        long got = calendar::nextDate(e, from);
+        checked++;
+        if (expected != got && mismatches++ < 5) {
+            calendar::Date f = calendar::civilFromDays(from);
+            printf("  MISMATCH %s d=%u m=%u wd=%u nth=%d y=%u from %04d-%02d-%02d: expected %ld, got %ld\n",
+                   calendar::repeatName(e.repeat), e.day, e.month, e.weekday, e.nth, e.year, f.year, f.month, f.day,
+                   expected, got);
+        }
+    }
+    printf("rules:    %lu checks, %lu mismatches  %s\n", checked, mismatches, mismatches ? "FAIL" : "ok");
+    return mismatches == 0;
+}
+
+void setZone(const char* zone) {
+    setenv("TZ", zone, 1);
+    tzset();
+}
+
+struct Expected {
+    time_t at;
+    int year;
+    size_t index;
+};
+
+/**
+ * @brief The upcoming order the long way: every event's next occurrence, sorted.
+ */
+std::vector<Expected> expectedOrder(const Event* list, time_t now) {
+    std::vector<Expected> order;
+    for (size_t i = 0; i < EVENTS; i++) {
+        time_t at;
+        int year;
+        if (list[i].repeat != Repeat::Unused && calendar::nextOccurrence(list[i], now, &at, &year)) {
+            order.push_back({at, year, i});
+        }
+    }
+    std::sort(order.begin(), order.end(), [](const Expected& a, const Expected& b) {
+        return a.at != b.at ? a.at < b.at : a.index < b.index;
+    });
+    return order;
+}
+
+bool checkSchedule() {
+    static Event list[EVENTS];
+    static calendar::Schedule<EVENTS> schedule;
+    for (size_t i = 0; i < EVENTS; i++) list[i] = rng() % 10 == 0 ? Event{} : randomEvent();
+
+    setZone("CET-1CEST,M3.5.0,M10.5.0/3");
+    schedule.checkZone();
+    struct tm start = {};
+    start.tm_year = 2025 - 1900;
+    start.tm_mon = 11;
+    start.tm_mday = 30;
+    start.tm_isdst = -1;
+    time_t now = mktime(&start);
+
+    unsigned long mismatches = 0, steps = 0;
+    for (int step = 0; step < 6000; step++) {
+        int kind = rng() % 100;
+        if (kind < 70) {
+            now += 1 + rng() % 7200;             // Minutes to hours
+        } else if (kind < 90) {
+            now += 1 + rng() % (3 * 86400);      // Up to 3 days
+        } else if (kind < 95) {
+            now -= 1 + rng() % 86400;            // Clock set back
+        } else if (kind < 99) {
+            size_t index = rng() % EVENTS;       // Edit, add or remove
+            list[index] = rng() % 4 == 0 ? Event{} : randomEvent();
+            schedule.reschedule(list, index, now);
+        } else {
+            setZone(rng() % 2 ? "EST5EDT,M3.2.0,M11.1.0" : "CET-1CEST,M3.5.0,M10.5.0/3");
+            schedule.checkZone();
+        }
+        schedule.update(list, now);
+
+        std::vector<Expected> expected = expectedOrder(list, now);
+        bool ok = expected.size() == schedule.size();
+        for (size_t rank = 0; ok && rank < expected.size(); rank++) {
+            const Expected& x = expected[rank];
+            const auto& entry = schedule.entry(x.index);
+            ok = schedule.next(rank) == x.index && entry.at == x.at && entry.year == x.year && !entry.none;
+        }
+        steps++;
+        if (!ok && mismatches++ < 5) {
+            printf("  MISMATCH at step %d: %zu expected upcoming, %zu scheduled\n", step, expected.size(),
+                   schedule.size());
+        }
+    }
+    printf("schedule: %lu steps over %lu events, %lu mismatches  %s\n", steps, (unsigned long)EVENTS, mismatches,
+           mismatches ? "FAIL" : "ok");
+    return mismatches == 0;
+}
+
+template <typename F>
+double nanosPerTick(F tick, unsigned long count) {
+    auto begin = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < count; i++) tick(i);
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / count;
+}
+
+volatile long sink;
+
+int main() {
+    bool ok = checkRules();
+    ok &= checkSchedule();
+
+    // --- Benchmark: the next event on every 1 s display tick ---
+    static Event list[EVENTS];
+    for (size_t i = 0; i < EVENTS; i++) list[i] = randomEvent();
+    setZone("CET-1CEST,M3.5.0,M10.5.0/3");
+    struct tm start_tm = {};
+    start_tm.tm_year = 2026 - 1900;
+    start_tm.tm_mon = 2;
+    start_tm.tm_mday = 20;
+    start_tm.tm_isdst = -1;
+    time_t start = mktime(&start_tm);
+
+    const unsigned long scanTicks = 2000, ticks = 30 * 86400; // 30 simulated days for the schedule
+    double scanNanos = nanosPerTick([&](unsigned long i) {
+        time_t now = start + (time_t)i;
+        time_t best = 0;
+        long best_index = -1;
+        for (size_t e = 0; e < EVENTS; e++) {
+            time_t at;
+            int year;
+            if (calendar::nextOccurrence(list[e], now, &at, &year) && (best_index < 0 || at < best)) {
+                best = at;
+                best_index = e;
+            }
+        }
+        sink = best_index;
+    }, scanTicks);
+
+    static calendar::Schedule<EVENTS> schedule;
+    schedule.checkZone();
+    double scheduleNanos = nanosPerTick([&](unsigned long i) {
+        schedule.update(list, start + (time_t)i);
+        sink = schedule.size() ? (long)schedule.next(0) : -1;
+    }, ticks);
+
+    printf("\n%zu events, next upcoming event per display tick\n", EVENTS);
+    printf("  scan: nextOccurrence() of every event  %10.0f ns/tick\n", scanNanos);
+    printf("  calendar::Schedule                     %10.1f ns/tick  (%u occurrences computed in %lu days)\n",
+           scheduleNanos, schedule.recomputed, ticks / 86400);
+    printf("  -> %.0fx\n", scanNanos / scheduleNanos);
+
+    printf(ok ? "\nPASS\n" : "\nFAIL\n");
+    return ok ? 0 : 1;
+}
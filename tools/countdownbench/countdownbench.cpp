@@ -0,0 +1,279 @@
+/**
+ * countdownbench.cpp
+ *
+ * Host check and benchmark for lab7_2's countdown (lab7_2/src/countdown.hpp
+ * and the yearly events of lab7_2/src/calendar.hpp).
+ *
+ * Check: for several time zones (with and without DST, DST switching at
+ * midnight, half-hour DST) the cached path (Clock + calendar::Schedule) must
+ * show exactly what an uncached calendar::nextOccurrence() gives on every
+ * tick, for every event. Time is walked second by second around every local midnight and
+ * in coarse steps in between, over three year boundaries, and the clock is also
+ * set back a day now and then.
+ *
+ * The old per-tick code (getNextTargetTimestamp() plus localtime() for the
+ * year) is run alongside and its differences are counted, not failed: it fed
+ * the struct normalized by the first mktime() into the second one, so its
+ * DST flag came from the wrong year (one hour off near DST dates) and 29.02
+ * became 01.03 of the following year (now 29.02 only falls in leap years).
+ *
+ * Benchmark: cost of one 200 ms display tick, old path vs cached path.
+ *
+ * Build and run:
+ *   g++ -std=gnu++17 -O2 -I lab7_2/src tools/countdownbench/countdownbench.cpp -o countdownbench
+ *   ./countdownbench
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <initializer_list>
+
+#include "calendar.hpp"
+#include "countdown.hpp"
+
+struct EventDate {
+    const char* name;
+    int day;
+    int month;
+};
+
+// event_manager::events, plus dates that stress normalization and DST
+const EventDate events[] = {
+    {"New Year", 1, 1},
+    {"Semester end", 29, 12},
+    {"Winter exams", 14, 1},
+    {"My birthday", 27, 7},
+    {"Leap day", 29, 2},
+    {"DST EU", 30, 3},
+    {"DST Chile", 6, 9},
+};
+const size_t EVENT_COUNT = sizeof(events) / sizeof(events[0]);
+
+const char* zones[] = {
+    "MSK-3",                            // lab7_2's zone, no DST
+    "UTC0",
+    "CET-1CEST,M3.5.0,M10.5.0/3",       // DST at 02:00/03:00
+    "EST5EDT,M3.2.0,M11.1.0",
+    "<-04>4<-03>,M9.1.6/24,M4.1.6/24",  // Chile: DST starts at midnight, 00:00 is skipped
+    "<+1030>-10:30<+11>-11,M10.1.0,M4.1.0", // Lord Howe: 30 min DST
+};
+
+struct Shown {
+    bool reached;
+    long remaining;
+    int year;
+    bool operator!=(const Shown& other) const {
+        return reached != other.reached || remaining != other.remaining || year != other.year;
+    }
+};
+
+/**
+ * @brief The old event_manager::getNextTargetTimestamp() with time() as a parameter.
+ */
+time_t getNextTargetTimestamp(int day, int month, time_t now) {
+    struct tm* current_tm = localtime(&now);
+
+    struct tm target_tm = {};
+    target_tm.tm_hour = 0; target_tm.tm_min = 0; target_tm.tm_sec = 0;
+    target_tm.tm_isdst = -1;
+    target_tm.tm_mday = day;
+    target_tm.tm_mon  = month - 1;
+    target_tm.tm_year = current_tm->tm_year;
+
+    time_t target_ts = mktime(&target_tm);
+    if (difftime(target_ts, now) < 0) {
+        target_tm.tm_year += 1;
+        target_ts = mktime(&target_tm);
+    }
+    return target_ts;
+}
+
+/**
+ * @brief One tick of the old updateDisplay().
+ */
+Shown oldTick(const EventDate& e, time_t now) {
+    time_t target = getNextTargetTimestamp(e.day, e.month, now);
+    double diff = difftime(target, now);
+    struct tm* target_struct = localtime(&target);
+    return {diff <= 0, diff > 0 ? (long)diff : 0, target_struct->tm_year + 1900};
+}
+
+/**
+ * @brief The same tick without any caching.
+ */
+Shown uncachedTick(const EventDate& e, time_t now) {
+    calendar::Event event = {};
+    event.repeat = calendar::Repeat::Yearly;
+    event.day = e.day;
+    event.month = e.month;
+    time_t target;
+    int year;
+    calendar::nextOccurrence(event, now, &target, &year);
+    long diff = (long)(target - now);
+    return {diff <= 0, diff > 0 ? diff : 0, year};
+}
+
+/**
+ * @brief Simulated device: millis() and a wall clock that can be stepped.
+ */
+struct Device {
+    unsigned long ms = 12345;
+    time_t wall_offset = 0; // wall = wall_offset + ms / 1000 (plus the fraction)
+    calendar::Event list[EVENT_COUNT] = {};
+    calendar::Schedule<EVENT_COUNT> schedule;
+    countdown::Clock wall_clock;
+
+    Device() {
+        for (size_t i = 0; i < EVENT_COUNT; i++) {
+            strncpy(list[i].name, events[i].name, calendar::name_length);
+            list[i].repeat = calendar::Repeat::Yearly;
+            list[i].day = events[i].day;
+            list[i].month = events[i].month;
+        }
+    }
+
+    time_t wallNow() const { return wall_offset + (time_t)(ms / 1000); }
+
+    Shown tick(size_t index) {
+        if (wall_clock.needsAnchor(ms)) {
+            struct timeval wall;
+            wall.tv_sec = wallNow();
+            wall.tv_usec = (ms % 1000) * 1000;
+            wall_clock.anchor(wall, ms);
+            schedule.checkZone();
+        }
+        time_t now = wall_clock.now(ms);
+        schedule.update(list, now);
+        const auto& target = schedule.entry(index);
+        long diff = (long)(target.at - now);
+        return {diff <= 0, diff > 0 ? diff : 0, target.year};
+    }
+};
+
+void setZone(const char* zone) {
+    setenv("TZ", zone, 1);
+    tzset();
+}
+
+time_t localMidnight(int year, int month, int day) {
+    struct tm t = {};
+    t.tm_year = year - 1900;
+    t.tm_mon = month - 1;
+    t.tm_mday = day;
+    t.tm_isdst = -1;
+    return mktime(&t);
+}
+
+/**
+ * @brief Walks one zone; returns the number of mismatching ticks.
+ */
+unsigned long checkZone(Device& device, const char* zone, unsigned long& ticks, unsigned long& oldDiffers) {
+    setZone(zone);
+    unsigned long mismatches = 0;
+    time_t start = localMidnight(2025, 12, 1);
+    time_t end = localMidnight(2028, 1, 15);
+    time_t midnight = localMidnight(2025, 12, 2);
+    unsigned step = 0;
+
+    auto compare = [&](time_t now) {
+        // Advance the simulated device so that its wall clock reads 'now'. A
+        // step back (or the jump to the next zone's start) is a clock change:
+        // let a whole anchor interval pass so the device has re-read the wall clock.
+        time_t previous = device.wallNow();
+        unsigned long elapsed = now > previous ? (unsigned long)(now - previous) * 1000
+                                               : countdown::Clock::anchor_interval_millis;
+        device.ms += elapsed;
+        device.wall_offset = now - (time_t)(device.ms / 1000);
+        for (size_t i = 0; i < EVENT_COUNT; i++) {
+            Shown expected = uncachedTick(events[i], now);
+            Shown got = device.tick(i);
+            ticks++;
+            oldDiffers += oldTick(events[i], now) != expected;
+            if (expected != got) {
+                if (mismatches++ < 5) {
+                    char when[32];
+                    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S %Z", localtime(&now));
+                    printf("  MISMATCH %s %s: expected %ld s (year %d%s), got %ld s (year %d%s)\n", when,
+                           events[i].name, expected.remaining, expected.year, expected.reached ? ", reached" : "",
+                           got.remaining, got.year, got.reached ? ", reached" : "");
+                }
+            }
+        }
+    };
+
+    for (time_t now = start; now < end;) {
+        // Dense: every second from 3 s before to 3 s after each local midnight
+        if (now >= midnight - 3) {
+            for (time_t t = midnight - 3; t <= midnight + 3; t++) compare(t);
+            now = midnight + 4;
+            struct tm next;
+            localtime_r(&midnight, &next);
+            midnight = localMidnight(next.tm_year + 1900, next.tm_mon + 1, next.tm_mday + 1);
+            // Every tenth day the clock is set back by a day, as an NTP step would
+            if (++step % 10 == 0) {
+                compare(now - 86400);
+                compare(now);
+            }
+            continue;
+        }
+        compare(now);
+        now += 997; // Coarse, prime so the phase wanders
+    }
+    return mismatches;
+}
+
+template <typename F>
+double nanosPerTick(F tick, unsigned long count) {
+    auto begin = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < count; i++) tick(i);
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / count;
+}
+
+volatile long sink;
+
+int main() {
+    // --- Check ---
+    bool ok = true;
+    Device device; // One device across zones: checkZone() must notice each TZ change
+    for (const char* zone : zones) {
+        unsigned long ticks = 0;
+        unsigned long oldDiffers = 0;
+        unsigned long mismatches = checkZone(device, zone, ticks, oldDiffers);
+        printf("%-40s %8lu ticks  %-4s (old code differed on %lu)\n", zone, ticks, mismatches ? "FAIL" : "ok",
+               oldDiffers);
+        ok &= mismatches == 0;
+    }
+
+    // --- Benchmark: the 200 ms display tick over simulated days ---
+    const unsigned long count = 2000000;
+    for (const char* zone : {"MSK-3", "CET-1CEST,M3.5.0,M10.5.0/3"}) {
+        setZone(zone);
+        time_t start = localMidnight(2026, 3, 28);
+        const EventDate& e = events[0];
+
+        double oldNanos = nanosPerTick([&](unsigned long i) {
+            time_t now = time(NULL); // The old code called time() every tick
+            now = start + (time_t)(i / 5);
+            sink = oldTick(e, now).remaining;
+        }, count);
+
+        Device bench;
+        bench.wall_offset = start - (time_t)(bench.ms / 1000);
+        double newNanos = nanosPerTick([&](unsigned long) {
+            bench.ms += 200;
+            sink = bench.tick(0).remaining;
+        }, count);
+
+        printf("\n%s, %lu ticks (%.1f simulated days)\n", zone, count, count / 5.0 / 86400);
+        printf("  old  getNextTargetTimestamp+localtime  %8.1f ns/tick\n", oldNanos);
+        printf("  new  Clock + calendar::Schedule       %8.1f ns/tick  (%u target computations)\n", newNanos,
+               bench.schedule.recomputed);
+        printf("  -> %.0fx\n", oldNanos / newNanos);
+    }
+
+    printf(ok ? "\nPASS\n" : "\nFAIL\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,212 @@
+/**
+ * featurebench.cpp
+ *
+ * Host check and benchmark for lab5_2's vibration feature kernels
+ * (lab5_2/src/features.hpp).
+ *
+ * Check: the radix-2 FFT matches a direct DFT; a sine gives the right mean,
+ * RMS, peak and crest factor, and its energy lands in the right band; over
+ * broadband noise the band energies add up to RMS^2 on average; the extractor
+ * fires on a step in vibration and stays quiet on sensor noise.
+ *
+ * Benchmark: ns per call of fft(), computeAxis() and a direct DFT of the same
+ * window, and the amortized cost of Extractor::add() per sample, with the share
+ * of one core the features take at 100 Hz.
+ *
+ * Build and run:
+ *   g++ -std=gnu++17 -O2 -I lab5_2/src tools/featurebench/featurebench.cpp -o featurebench
+ *   ./featurebench
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "features.hpp"
+
+using features::windowSize;
+
+const float sample_rate_hz = 100.0f;
+
+int failures = 0;
+
+void expect(bool ok, const char* what) {
+    printf("  %-62s %s\n", what, ok ? "ok" : "FAIL");
+    failures += !ok;
+}
+
+/**
+ * @brief Reference DFT in double.
+ */
+void dft(const float* in, double* re, double* im) {
+    for (size_t k = 0; k < windowSize; k++) {
+        re[k] = im[k] = 0;
+        for (size_t n = 0; n < windowSize; n++) {
+            double angle = -2 * M_PI * k * n / windowSize;
+            re[k] += in[n] * cos(angle);
+            im[k] += in[n] * sin(angle);
+        }
+    }
+}
+
+/**
+ * @brief Rows of x,y,z like the extractor's history: a sine on x, noise on y, gravity on z.
+ */
+std::vector<float> window(float amplitude, float hz, float noise, std::mt19937& rng) {
+    std::normal_distribution<float> gauss(0, noise);
+    std::vector<float> rows(windowSize * 3);
+    for (size_t i = 0; i < windowSize; i++) {
+        rows[i * 3 + 0] = amplitude * sinf(2 * (float)M_PI * hz * i / sample_rate_hz);
+        rows[i * 3 + 1] = gauss(rng);
+        rows[i * 3 + 2] = 9.81f + gauss(rng);
+    }
+    return rows;
+}
+
+void check() {
+    printf("check:\n");
+    std::mt19937 rng(3);
+    float re[windowSize], im[windowSize];
+
+    // FFT against the direct transform
+    std::uniform_real_distribution<float> uniform(-1, 1);
+    float input[windowSize];
+    for (float& v : input) v = uniform(rng);
+    double refRe[windowSize], refIm[windowSize];
+    dft(input, refRe, refIm);
+    features::initTables();
+    for (size_t i = 0; i < windowSize; i++) {
+        re[i] = input[i];
+        im[i] = 0;
+    }
+    features::fft(re, im);
+    double worst = 0;
+    for (size_t k = 0; k < windowSize; k++) {
+        worst = std::max(worst, std::max(fabs(re[k] - refRe[k]), fabs(im[k] - refIm[k])));
+    }
+    printf("  fft vs dft: max abs difference %.2e\n", worst);
+    expect(worst < 1e-4, "fft() matches the direct DFT");
+
+    // A 2 m/s^2 sine at 20 Hz (band 1 of 0-12.5-25-37.5-50 Hz); an integer bin count keeps it exact
+    const float amplitude = 2.0f, hz = 20.3125f; // 26 cycles per window
+    std::vector<float> rows = window(amplitude, hz, 0.0f, rng);
+    features::AxisFeatures x, z;
+    features::computeAxis(&rows[0], 3, x, re, im);
+    features::computeAxis(&rows[2], 3, z, re, im);
+    float bandSum = 0;
+    size_t loudest = 0;
+    for (size_t b = 0; b < features::bandCount; b++) {
+        bandSum += x.bands[b];
+        if (x.bands[b] > x.bands[loudest]) loudest = b;
+    }
+    float expectedRms = amplitude / sqrtf(2);
+    printf("  sine %.1f Hz: rms %.3f (expected %.3f), peak %.3f, crest %.3f, band %zu holds %.1f%%\n", hz, x.rms,
+           expectedRms, x.peak, x.crest, loudest, 100 * x.bands[loudest] / bandSum);
+    expect(fabsf(x.rms - expectedRms) < 0.01f && fabsf(x.crest - sqrtf(2)) < 0.02f, "sine: RMS and crest factor");
+    expect(fabsf(z.mean - 9.81f) < 1e-3f && z.rms < 1e-3f, "gravity goes to the mean, not the RMS");
+    expect(loudest == (size_t)(hz / (sample_rate_hz / 2) * features::bandCount) && x.bands[loudest] > 0.95f * bandSum,
+           "sine: energy in the band of its frequency");
+
+    // Broadband noise: the Hann-corrected bands add up to about rms^2 (on average: one
+    // window's spectrum of noise is itself noisy)
+    const int trials = 200;
+    float ratioMin = 10, ratioMax = 0, ratioSum = 0;
+    for (int trial = 0; trial < trials; trial++) {
+        std::vector<float> noisy = window(0, 0, 1.0f, rng);
+        features::AxisFeatures y;
+        features::computeAxis(&noisy[1], 3, y, re, im);
+        float sum = 0;
+        for (float band : y.bands) sum += band;
+        float ratio = sum / (y.rms * y.rms);
+        ratioMin = std::min(ratioMin, ratio);
+        ratioMax = std::max(ratioMax, ratio);
+        ratioSum += ratio;
+    }
+    float ratioMean = ratioSum / trials;
+    printf("  noise: sum of bands / rms^2 = %.3f on average, %.2f..%.2f over %d windows\n", ratioMean, ratioMin,
+           ratioMax, trials);
+    expect(fabsf(ratioMean - 1) < 0.05f, "band energies add up to rms^2 within 5% on average");
+
+    // Extractor: quiet on sensor noise, fires on the window where vibration starts
+    features::Extractor extractor;
+    std::normal_distribution<float> sensor(0, 0.03f);
+    int fired = -1, falseAlarms = 0;
+    for (int i = 0; i < (int)windowSize * 10; i++) {
+        float shake = i >= (int)windowSize * 6 ? 1.5f * sinf(2 * (float)M_PI * 8 * i / sample_rate_hz) : 0.0f;
+        if (extractor.add(shake + sensor(rng), sensor(rng), 9.81f + sensor(rng))) {
+            const features::WindowFeatures& f = extractor.latest();
+            if (f.triggers == features::TriggerNone) continue;
+            if (f.index < 6) falseAlarms++;
+            else if (fired < 0) fired = f.index;
+        }
+    }
+    expect(falseAlarms == 0, "no trigger on sensor noise");
+    expect(fired == 6, "triggers on the first window with vibration");
+}
+
+template <typename F>
+double nanosPerCall(F f, int calls) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; i++) f(i);
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+}
+
+void bench() {
+    printf("\nbenchmark (host, -O2):\n");
+    std::mt19937 rng(5);
+    std::vector<float> rows = window(2.0f, 7.0f, 0.2f, rng);
+    float re[windowSize], im[windowSize];
+    volatile float sink = 0;
+
+    double fftNs = nanosPerCall([&](int i) {
+        for (size_t n = 0; n < windowSize; n++) {
+            re[n] = rows[n * 3];
+            im[n] = 0;
+        }
+        re[0] += i * 1e-9f;
+        features::fft(re, im);
+        sink = sink + re[1];
+    }, 200000);
+
+    double axisNs = nanosPerCall([&](int i) {
+        features::AxisFeatures out;
+        rows[0] = 0.01f * (i & 7);
+        features::computeAxis(&rows[0], 3, out, re, im);
+        sink = sink + out.bands[0];
+    }, 200000);
+
+    double dftNs = nanosPerCall([&](int i) {
+        float in[windowSize];
+        double dre[windowSize], dim[windowSize];
+        for (size_t n = 0; n < windowSize; n++) in[n] = rows[n * 3] + i * 1e-9f;
+        dft(in, dre, dim);
+        sink = sink + (float)dre[1];
+    }, 500);
+
+    features::Extractor extractor;
+    std::normal_distribution<float> noise(0, 0.2f);
+    std::vector<float> stream(windowSize * 3 * 64);
+    for (float& v : stream) v = noise(rng);
+    const int samples = 2000000;
+    double addNs = nanosPerCall([&](int i) {
+        const float* s = &stream[(i % (windowSize * 64)) * 3];
+        if (extractor.add(s[0], s[1], s[2])) sink = sink + extractor.latest().axes[0].rms;
+    }, samples);
+    (void)sink;
+
+    printf("  %-36s %12.0f ns\n", "fft() (128 points)", fftNs);
+    printf("  %-36s %12.0f ns\n", "direct DFT (128 points, double)", dftNs);
+    printf("  %-36s %12.0f ns\n", "computeAxis()", axisNs);
+    printf("  %-36s %12.0f ns\n", "window (3 axes)", axisNs * 3);
+    printf("  %-36s %12.1f ns\n", "Extractor::add() per sample", addNs);
+    printf("  features at %.0f Hz: %.4f%% of a host core\n", sample_rate_hz, addNs * sample_rate_hz / 1e7);
+}
+
+int main() {
+    check();
+    bench();
+    printf(failures ? "\nFAIL\n" : "\nPASS\n");
+    return failures ? 1 : 0;
+}
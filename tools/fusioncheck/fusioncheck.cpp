@@ -0,0 +1,289 @@
+/**
+ * fusioncheck.cpp
+ *
+ * Host accuracy check for lab5_2's Madgwick filter (lab5_2/src/fusion.hpp)
+ * against a recorded MPU6050 trace with a known attitude.
+ *
+ * The trace (trace.csv next to this file) holds 20 s at 100 Hz of raw MPU6050
+ * counts at lab5_2's ranges (+-8 g: 4096 LSB/g, +-500 dps: 65.5 LSB/dps) and the
+ * true roll/pitch/yaw in centidegrees. It is the output of "record" below: a
+ * motion script (rest, rolling, pitched while turning, a 5 Hz shake, back to
+ * level) read through a sensor model with the datasheet noise, a constant gyro
+ * bias of up to 0.6 dps per axis, a 20 mg accelerometer offset and int16
+ * quantization. It is committed so the check does not depend on the host's
+ * random numbers or libm.
+ *
+ * Check: after a 1 s settling time, roll and pitch stay within the error
+ * bounds below, and clearly beat integrating the gyro alone and taking the
+ * tilt from the accelerometer alone. Yaw is not observable without a
+ * magnetometer, so its drift is only reported.
+ *
+ * Build and run:
+ *   g++ -std=gnu++17 -O2 -I lab5_2/src tools/fusioncheck/fusioncheck.cpp -o fusioncheck
+ *   ./fusioncheck tools/fusioncheck/trace.csv
+ *   ./fusioncheck record > tools/fusioncheck/trace.csv   (regenerates the trace)
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "fusion.hpp"
+
+// --- Error bounds (degrees, roll and pitch) ---
+const double max_rms_error = 1.5;
+const double max_error_steady = 3.0; // Outside the shake
+const double max_error_shake = 6.0;  // 0.3 g of linear acceleration at 5 Hz
+const double settle_seconds = 1.0;
+
+// --- Sensor model (lab5_2: MPU6050_RANGE_8_G, MPU6050_RANGE_500_DEG, 21 Hz band) ---
+const double rate_hz = 100;
+const double duration_s = 20;
+const double accel_lsb_per_g = 4096;
+const double gyro_lsb_per_dps = 65.5;
+const double gravity = 9.80665;
+const double accel_noise_g = 0.004;       // 400 ug/sqrt(Hz) over ~21 Hz, rounded up
+const double gyro_noise_dps = 0.05;       // 0.005 dps/sqrt(Hz) over ~21 Hz, rounded up
+const double gyro_bias_dps[3] = {0.6, -0.4, 0.3};
+const double accel_bias_g[3] = {0.02, 0, 0};
+const double shake_start = 12, shake_end = 15;
+
+const double deg = M_PI / 180;
+
+struct Sample {
+    double t;
+    int16_t raw[6];   // ax, ay, az, gx, gy, gz
+    double truth[3];  // roll, pitch, yaw (radians)
+};
+
+// --- Quaternion helpers (double, for the reference) ---
+struct Q {
+    double w, x, y, z;
+};
+
+Q mul(const Q& a, const Q& b) {
+    return {a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z, a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+            a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x, a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w};
+}
+
+Q conj(const Q& q) { return {q.w, -q.x, -q.y, -q.z}; }
+
+Q fromEuler(double roll, double pitch, double yaw) {
+    Q qx = {cos(roll / 2), sin(roll / 2), 0, 0};
+    Q qy = {cos(pitch / 2), 0, sin(pitch / 2), 0};
+    Q qz = {cos(yaw / 2), 0, 0, sin(yaw / 2)};
+    return mul(qz, mul(qy, qx));
+}
+
+/**
+ * @brief v in the body frame, for a body-to-world rotation q.
+ */
+void toBody(const Q& q, const double v[3], double out[3]) {
+    Q r = mul(conj(q), mul(Q{0, v[0], v[1], v[2]}, q));
+    out[0] = r.x;
+    out[1] = r.y;
+    out[2] = r.z;
+}
+
+double smoothstep(double t, double from, double to) {
+    if (t <= from) return 0;
+    if (t >= to) return 1;
+    double x = (t - from) / (to - from);
+    return x * x * (3 - 2 * x);
+}
+
+/**
+ * @brief The motion script: attitude and world-frame linear acceleration (m/s^2).
+ */
+void motion(double t, double& roll, double& pitch, double& yaw, double accel[3]) {
+    roll = 30 * deg * sin(2 * M_PI * 0.25 * (t - 2)) * (smoothstep(t, 2, 3) - smoothstep(t, 7, 8));
+    pitch = 25 * deg * (smoothstep(t, 8, 9.5) - smoothstep(t, 15, 17));
+    yaw = 45 * deg * (t > 9.5 ? std::min(t, 15.0) - 9.5 : 0);
+    double shake = smoothstep(t, shake_start, shake_start + 0.2) - smoothstep(t, shake_end - 0.2, shake_end);
+    accel[0] = 0.3 * gravity * shake * sin(2 * M_PI * 5 * t);
+    accel[1] = 0;
+    accel[2] = 0;
+}
+
+Q attitude(double t) {
+    double roll, pitch, yaw, accel[3];
+    motion(t, roll, pitch, yaw, accel);
+    return fromEuler(roll, pitch, yaw);
+}
+
+int16_t quantize(double counts) {
+    return (int16_t)std::max(-32768.0, std::min(32767.0, std::round(counts)));
+}
+
+/**
+ * @brief Writes the trace to stdout.
+ */
+void record() {
+    std::mt19937 rng(20260319);
+    std::normal_distribution<double> accelNoise(0, accel_noise_g), gyroNoise(0, gyro_noise_dps);
+    printf("# MPU6050 trace for fusioncheck: %g Hz, +-8 g (%g LSB/g), +-500 dps (%g LSB/dps)\n", rate_hz,
+           accel_lsb_per_g, gyro_lsb_per_dps);
+    printf("# t_ms,ax,ay,az,gx,gy,gz,roll_cdeg,pitch_cdeg,yaw_cdeg\n");
+    const double h = 1e-5;
+    for (int i = 0; i < (int)(duration_s * rate_hz); i++) {
+        double t = i / rate_hz;
+        double roll, pitch, yaw, accel[3];
+        motion(t, roll, pitch, yaw, accel);
+        Q q = fromEuler(roll, pitch, yaw);
+
+        // Body rates from the attitude's derivative: omega = 2 q* dq/dt
+        Q a = attitude(t - h), b = attitude(t + h);
+        Q dq = {(b.w - a.w) / (2 * h), (b.x - a.x) / (2 * h), (b.y - a.y) / (2 * h), (b.z - a.z) / (2 * h)};
+        Q omega = mul(conj(q), dq);
+        double rates[3] = {2 * omega.x, 2 * omega.y, 2 * omega.z};
+
+        // Specific force: linear acceleration minus gravity (pointing down), in the body frame
+        double world[3] = {accel[0], accel[1], accel[2] + gravity};
+        double force[3];
+        toBody(q, world, force);
+
+        int16_t raw[6];
+        for (int k = 0; k < 3; k++) {
+            double g = force[k] / gravity + accel_bias_g[k] + accelNoise(rng);
+            raw[k] = quantize(g * accel_lsb_per_g);
+            double dps = rates[k] / deg + gyro_bias_dps[k] + gyroNoise(rng);
+            raw[3 + k] = quantize(dps * gyro_lsb_per_dps);
+        }
+        printf("%d,%d,%d,%d,%d,%d,%d,%ld,%ld,%ld\n", (int)std::lround(t * 1000), raw[0], raw[1], raw[2], raw[3], raw[4],
+               raw[5], std::lround(roll / deg * 100), std::lround(pitch / deg * 100), std::lround(yaw / deg * 100));
+    }
+}
+
+bool load(const char* path, std::vector<Sample>& samples) {
+    FILE* file = fopen(path, "r");
+    if (!file) return false;
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == '#') continue;
+        int ms, v[6];
+        long angles[3];
+        if (sscanf(line, "%d,%d,%d,%d,%d,%d,%d,%ld,%ld,%ld", &ms, &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &angles[0],
+                   &angles[1], &angles[2]) != 10) {
+            continue;
+        }
+        Sample s;
+        s.t = ms / 1000.0;
+        for (int k = 0; k < 6; k++) s.raw[k] = (int16_t)v[k];
+        for (int k = 0; k < 3; k++) s.truth[k] = angles[k] / 100.0 * deg;
+        samples.push_back(s);
+    }
+    fclose(file);
+    return !samples.empty();
+}
+
+double wrap(double angle) {
+    while (angle > M_PI) angle -= 2 * M_PI;
+    while (angle < -M_PI) angle += 2 * M_PI;
+    return angle;
+}
+
+struct Errors {
+    double sumSquares = 0;
+    size_t count = 0;
+    double steadyMax = 0;
+    double shakeMax = 0;
+
+    void add(double t, double error) {
+        error = fabs(error) / deg;
+        sumSquares += error * error;
+        count++;
+        double& max = t >= shake_start && t < shake_end + 0.5 ? shakeMax : steadyMax;
+        if (error > max) max = error;
+    }
+    double rms() const { return count ? sqrt(sumSquares / count) : 0; }
+};
+
+int failures = 0;
+
+void expect(bool ok, const char* what) {
+    printf("  %-62s %s\n", what, ok ? "ok" : "FAIL");
+    failures += !ok;
+}
+
+/**
+ * @brief Replays the trace through an estimator and scores roll and pitch.
+ * Step takes the converted sample and dt and returns roll, pitch and yaw.
+ */
+template <typename Step>
+Errors score(const std::vector<Sample>& samples, Step step, double& yawDrift) {
+    Errors errors;
+    for (size_t i = 0; i < samples.size(); i++) {
+        const Sample& s = samples[i];
+        float dt = i > 0 ? (float)(s.t - samples[i - 1].t) : (float)(1 / rate_hz);
+        // What Adafruit_MPU6050::getEvent() hands to rtos.hpp: m/s^2 and rad/s
+        float a[3], g[3];
+        for (int k = 0; k < 3; k++) {
+            a[k] = (float)(s.raw[k] / accel_lsb_per_g * gravity);
+            g[k] = (float)(s.raw[3 + k] / gyro_lsb_per_dps * deg);
+        }
+        fusion::Euler e = step(a, g, dt);
+        if (s.t < settle_seconds) continue;
+        errors.add(s.t, wrap(e.roll - s.truth[0]));
+        errors.add(s.t, wrap(e.pitch - s.truth[1]));
+        yawDrift = wrap(e.yaw - s.truth[2]) / deg;
+    }
+    return errors;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "record") == 0) {
+        record();
+        return 0;
+    }
+    const char* path = argc > 1 ? argv[1] : "tools/fusioncheck/trace.csv";
+    std::vector<Sample> samples;
+    if (!load(path, samples)) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return 2;
+    }
+
+    double madgwickYaw = 0, gyroYaw = 0, accelYaw = 0;
+    fusion::Madgwick filter;
+    Errors madgwick = score(samples, [&](const float* a, const float* g, float dt) {
+        filter.update(g[0], g[1], g[2], a[0], a[1], a[2], dt);
+        return filter.euler();
+    }, madgwickYaw);
+
+    // Gyro only: the same filter with no accelerometer correction
+    fusion::Madgwick gyroOnly(0.0f);
+    Errors gyro = score(samples, [&](const float* a, const float* g, float dt) {
+        gyroOnly.update(g[0], g[1], g[2], a[0], a[1], a[2], dt);
+        return gyroOnly.euler();
+    }, gyroYaw);
+
+    // Accelerometer only: tilt from gravity, sample by sample
+    Errors accel = score(samples, [&](const float* a, const float*, float) {
+        fusion::Madgwick tilt;
+        tilt.initFromAccel(a[0], a[1], a[2]);
+        return tilt.euler();
+    }, accelYaw);
+
+    printf("%s: %zu samples, %.1f s\n", path, samples.size(), samples.back().t);
+    printf("  %-22s %10s %12s %12s %10s\n", "roll/pitch error (deg)", "rms", "max steady", "max shake", "yaw drift");
+    printf("  %-22s %10.2f %12.2f %12.2f %10.1f\n", "gyro only", gyro.rms(), gyro.steadyMax, gyro.shakeMax, gyroYaw);
+    printf("  %-22s %10.2f %12.2f %12.2f %10s\n", "accelerometer only", accel.rms(), accel.steadyMax, accel.shakeMax,
+           "-");
+    printf("  %-22s %10.2f %12.2f %12.2f %10.1f\n", "Madgwick (beta 0.1)", madgwick.rms(), madgwick.steadyMax,
+           madgwick.shakeMax, madgwickYaw);
+
+    char what[96];
+    printf("check:\n");
+    snprintf(what, sizeof(what), "rms error under %.1f deg", max_rms_error);
+    expect(madgwick.rms() < max_rms_error, what);
+    snprintf(what, sizeof(what), "max error under %.1f deg outside the shake", max_error_steady);
+    expect(madgwick.steadyMax < max_error_steady, what);
+    snprintf(what, sizeof(what), "max error under %.1f deg through the shake", max_error_shake);
+    expect(madgwick.shakeMax < max_error_shake, what);
+    expect(madgwick.rms() < gyro.rms() / 2 && madgwick.rms() < accel.rms() / 2,
+           "beats gyro-only and accelerometer-only by 2x (rms)");
+
+    printf(failures ? "\nFAIL\n" : "\nPASS\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,191 @@
+/**
+ * lcdbench.cpp
+ *
+ * Regression benchmark for the LCD frame buffer (lib/display/src/frame_buffer.hpp).
+ * It replays what lab7_1 and lab7_2 draw over a simulated stretch of time, once
+ * the old way (clear() and rewrite both lines) and once through the frame
+ * buffer, against the host mock of LiquidCrystal_I2C (fake_lcd.hpp), and
+ * reports bytes, I2C transactions and the time the caller spends on the bus.
+ *
+ * After every frame the mock's panel contents are compared with the intended
+ * text. The run fails on a mismatch, or when the frame buffer sends more than
+ * the naive diff would: one setCursor() plus the cells for every changed run.
+ *
+ * Build and run:
+ *   g++ -std=gnu++17 -O2 -I lib/display/src tools/lcdbench/lcdbench.cpp -o lcdbench
+ *   ./lcdbench              # 10 simulated minutes
+ *   ./lcdbench 86400        # one simulated day
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "frame_buffer.hpp"
+
+const uint8_t COLS = 16;
+const uint8_t ROWS = 2;
+
+uint8_t clockChar[] = {0x1F, 0x11, 0x0A, 0x04, 0x04, 0x0A, 0x1F, 0x00};
+
+struct Frame {
+    std::string lines[ROWS];
+};
+
+std::string padded(const std::string& text) {
+    std::string out = text.substr(0, COLS);
+    out.resize(COLS, ' ');
+    return out;
+}
+
+/**
+ * @brief lab7_2 event_manager::updateDisplay(): every 200 ms, with a 1.5 s
+ * message (RFID scan) every 45 s.
+ */
+Frame eventCountdown(unsigned long ms) {
+    Frame frame;
+    unsigned remaining = 123 * 86400 + 4 * 3600 + 5 * 60 + 6 - ms / 1000;
+    if (ms % 45000 < 1500) {
+        frame.lines[0] = "Mode Switched:";
+        frame.lines[1] = (ms / 45000) % 2 ? "Winter exams" : "New Year";
+        return frame;
+    }
+    char line1[21];
+    char line2[21];
+    snprintf(line1, 20, "%-14s %d", (ms / 45000) % 2 ? "Winter exams" : "New Year", 2026);
+    snprintf(line2, 20, "in %3ud %02u:%02u:%02u", std::min(remaining / 86400, 999u), remaining % 86400 / 3600,
+             remaining % 3600 / 60, remaining % 60);
+    frame.lines[0] = line1;
+    frame.lines[1] = line2;
+    return frame;
+}
+
+/**
+ * @brief lab7_1 lcd::updateCountdown(): once a second, clock icon on the first line.
+ */
+Frame newYearCountdown(unsigned long ms) {
+    Frame frame;
+    unsigned remaining = 40 * 86400 - ms / 1000;
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "  %d in", 2026);
+    frame.lines[0] = buffer;
+    frame.lines[0][0] = '\0'; // Clock icon, custom char 0
+    snprintf(buffer, sizeof(buffer), "%3ud %02u:%02u:%02u", std::min(remaining / 86400, 999u), remaining % 86400 / 3600,
+             remaining % 3600 / 60, remaining % 60);
+    frame.lines[1] = buffer;
+    return frame;
+}
+
+struct Result {
+    unsigned long updates = 0;
+    uint32_t bytes = 0;
+    uint32_t transactions = 0;
+    uint32_t clears = 0;
+    double busMillis = 0;
+    unsigned long mismatches = 0;
+    uint32_t naiveBytes = 0; // Frame buffer runs only
+};
+
+bool shows(const LiquidCrystal_I2C& lcd, const Frame& frame) {
+    for (uint8_t row = 0; row < ROWS; row++) {
+        if (lcd.visible(row) != padded(frame.lines[row])) return false;
+    }
+    return true;
+}
+
+Result finish(LiquidCrystal_I2C& lcd, Result result) {
+    result.bytes = lcd.commands + lcd.dataBytes;
+    result.transactions = lcd.transactions();
+    result.clears = lcd.clears;
+    result.busMillis = lcd.busMicros / 1000.0;
+    return result;
+}
+
+/**
+ * @brief The old code: lab7_2's printStatus() clears and prints both lines,
+ * lab7_1's updateCountdown() reprints both lines without clearing.
+ */
+Result runDirect(Frame (*scenario)(unsigned long), bool clearFirst, unsigned long periodMs,
+                 unsigned long durationMs) {
+    LiquidCrystal_I2C lcd(0x27, COLS, ROWS);
+    lcd.init();
+    lcd.createChar(0, clockChar);
+    lcd.resetCounters();
+    Result result;
+    for (unsigned long ms = 0; ms < durationMs; ms += periodMs) {
+        Frame frame = scenario(ms);
+        if (clearFirst) lcd.clear();
+        for (uint8_t row = 0; row < ROWS; row++) {
+            lcd.setCursor(0, row);
+            // Icons are written with write(), text with print(); clipped like the panel shows it
+            for (char ch : frame.lines[row].substr(0, COLS)) lcd.write((uint8_t)ch);
+        }
+        if (!shows(lcd, frame)) result.mismatches++;
+        result.updates++;
+    }
+    return finish(lcd, result);
+}
+
+Result runFrameBuffer(Frame (*scenario)(unsigned long), unsigned long periodMs, unsigned long durationMs) {
+    LiquidCrystal_I2C lcd(0x27, COLS, ROWS);
+    display::FrameBuffer<COLS, ROWS> frameBuffer(lcd);
+    lcd.init();
+    lcd.createChar(0, clockChar);
+    frameBuffer.blank();
+    lcd.resetCounters();
+    Result result;
+    Frame previous;
+    for (unsigned long ms = 0; ms < durationMs; ms += periodMs) {
+        Frame frame = scenario(ms);
+        for (uint8_t row = 0; row < ROWS; row++) {
+            std::string before = padded(previous.lines[row]);
+            std::string after = padded(frame.lines[row]);
+            for (uint8_t col = 0; col < COLS; col++) {
+                if (before[col] == after[col]) continue;
+                bool runStart = col == 0 || before[col - 1] == after[col - 1];
+                result.naiveBytes += runStart ? 2 : 1;
+            }
+            frameBuffer.setLine(row, "");
+            for (size_t col = 0; col < frame.lines[row].size(); col++) {
+                frameBuffer.put(col, row, (uint8_t)frame.lines[row][col]);
+            }
+        }
+        frameBuffer.flush();
+        if (!shows(lcd, frame)) result.mismatches++;
+        result.updates++;
+        previous = frame;
+    }
+    return finish(lcd, result);
+}
+
+void report(const char* name, const Result& result) {
+    printf("  %-13s %8lu %10u %12u %8u %10.1f %9.2f %s\n", name, result.updates, result.bytes, result.transactions,
+           result.clears, result.busMillis, result.busMillis / result.updates,
+           result.mismatches ? "CONTENT MISMATCH" : "ok");
+}
+
+bool scenario(const char* title, Frame (*draw)(unsigned long), bool clearFirst, unsigned long periodMs,
+              unsigned long durationMs) {
+    Result direct = runDirect(draw, clearFirst, periodMs, durationMs);
+    Result buffered = runFrameBuffer(draw, periodMs, durationMs);
+    printf("%s (every %lu ms)\n", title, periodMs);
+    printf("  %-13s %8s %10s %12s %8s %10s %9s\n", "", "updates", "bytes", "transactions", "clears", "bus ms",
+           "ms/update");
+    report(clearFirst ? "clear+print" : "print", direct);
+    report("frame buffer", buffered);
+    printf("  -> %.1fx fewer transactions; %u bytes sent, naive diff budget %u\n\n",
+           (double)direct.transactions / (buffered.transactions ? buffered.transactions : 1), buffered.bytes,
+           buffered.naiveBytes);
+    return direct.mismatches == 0 && buffered.mismatches == 0 && buffered.bytes <= buffered.naiveBytes;
+}
+
+int main(int argc, char** argv) {
+    unsigned long seconds = argc > 1 ? strtoul(argv[1], nullptr, 10) : 600;
+    unsigned long durationMs = seconds * 1000;
+    bool ok = true;
+    ok &= scenario("lab7_2 event countdown", eventCountdown, true, 200, durationMs);
+    ok &= scenario("lab7_1 New Year countdown", newYearCountdown, false, 1000, durationMs);
+    printf(ok ? "PASS\n" : "FAIL\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,702 @@
+/**
+ * loadgen.cpp
+ *
+ * Fleet load generator for the telemetry format. It simulates N virtual lab4_2
+ * (DHT) and/or lab5_2 (MPU orientation) devices, each with its own MQTT connection.
+ * Payloads come from the firmware's encoders (lib/telemetry/src/payload.hpp). One
+ * subscriber listens on "esp32/+/tx" and measures end-to-end latency.
+ *
+ * The broker is either the built-in stand-in (default) or an external one (--host),
+ * e.g. mosquitto. Broker CPU is the stand-in's thread CPU time, or the external
+ * broker's process CPU from /proc when --broker-pid is given.
+ *
+ * Build and run (Linux):
+ *   g++ -std=gnu++17 -O2 -pthread -I lib/telemetry/src tools/loadgen/loadgen.cpp -o loadgen
+ *   ./loadgen --devices 200 --rate 1 --duration 20
+ *   ./loadgen --host 127.0.0.1 --broker-pid $(pidof mosquitto) --devices 1000 --rate 0.5 --qos 1 --kind mix
+ *   ./loadgen --binary --devices 500 --rate 20   # tagged binary payloads instead of text
+ *
+ * Latency is exact: a publisher's messages arrive in order, so the subscriber
+ * matches each one with the oldest outstanding send time of that device. Payloads
+ * carry the capture time like spooled readings, so the Python services'
+ * --throughput mode can measure latency too.
+ */
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "payload.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+enum class Kind { Dht, Mpu, Mix };
+
+struct Options {
+    int devices = 100;
+    double rate = 1.0;       // Messages per second per device
+    double duration = 10.0;  // Seconds of publishing
+    int qos = 0;
+    Kind kind = Kind::Dht;
+    std::string host;        // Empty: built-in broker
+    int port = 1883;
+    int brokerPid = 0;
+    int threads = 2;         // Publisher threads
+    bool binary = false;     // payload::pack* instead of the text formats
+};
+
+// --- MQTT 3.1.1 framing ---
+
+void putLength(std::string& out, size_t length) {
+    do {
+        uint8_t digit = length & 0x7F;
+        length >>= 7;
+        out.push_back(length > 0 ? (digit | 0x80) : digit);
+    } while (length > 0);
+}
+
+void putString(std::string& out, const std::string& s) {
+    out.push_back(s.size() >> 8);
+    out.push_back(s.size() & 0xFF);
+    out += s;
+}
+
+std::string connectPacket(const std::string& clientId) {
+    std::string body;
+    putString(body, "MQTT");
+    body.push_back(4);    // Protocol level 3.1.1
+    body.push_back(0x02); // Clean session
+    body.push_back(0);
+    body.push_back(60);   // Keep-alive, s
+    putString(body, clientId);
+    std::string packet(1, 0x10);
+    putLength(packet, body.size());
+    return packet + body;
+}
+
+std::string publishPacket(const std::string& topic, const char* payload, size_t length, int qos, uint16_t id) {
+    std::string body;
+    putString(body, topic);
+    if (qos > 0) {
+        body.push_back(id >> 8);
+        body.push_back(id & 0xFF);
+    }
+    body.append(payload, length);
+    std::string packet(1, 0x30 | (qos << 1));
+    putLength(packet, body.size());
+    return packet + body;
+}
+
+std::string subscribePacket(uint16_t id, const std::string& filter) {
+    std::string body;
+    body.push_back(id >> 8);
+    body.push_back(id & 0xFF);
+    putString(body, filter);
+    body.push_back(0);
+    std::string packet(1, (char)0x82);
+    putLength(packet, body.size());
+    return packet + body;
+}
+
+/**
+ * @brief Takes one complete packet off the front of buffer.
+ * @return false if more bytes are needed.
+ */
+bool takePacket(std::string& buffer, uint8_t& header, std::string& body) {
+    size_t pos = 1, length = 0;
+    int shift = 0;
+    do {
+        if (pos >= buffer.size()) return false;
+        length |= (size_t)(buffer[pos] & 0x7F) << shift;
+        shift += 7;
+    } while (buffer[pos++] & 0x80);
+    if (buffer.size() < pos + length) return false;
+    header = buffer[0];
+    body = buffer.substr(pos, length);
+    buffer.erase(0, pos + length);
+    return true;
+}
+
+bool parsePublish(uint8_t header, const std::string& body, std::string& topic, std::string& payload,
+                  uint16_t& id) {
+    if (body.size() < 2) return false;
+    size_t topicLength = ((uint8_t)body[0] << 8) | (uint8_t)body[1];
+    int qos = (header >> 1) & 0x03;
+    size_t pos = 2 + topicLength + (qos ? 2 : 0);
+    if (body.size() < pos) return false;
+    topic = body.substr(2, topicLength);
+    id = qos ? (((uint8_t)body[2 + topicLength] << 8) | (uint8_t)body[3 + topicLength]) : 0;
+    payload = body.substr(pos);
+    return true;
+}
+
+// --- Sockets ---
+
+int dial(const std::string& host, int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, host.c_str(), &addr.sin_addr);
+    if (fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        perror("connect");
+        exit(1);
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+void setNonBlocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+bool writeAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = write(fd, data.data() + sent, data.size() - sent);
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+            pollfd p = {fd, POLLOUT, 0};
+            poll(&p, 1, 100);
+            continue;
+        }
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+/**
+ * @brief Blocking read until one packet of the expected type arrives (handshakes only).
+ */
+bool expect(int fd, uint8_t type) {
+    std::string buffer, body;
+    uint8_t header;
+    char chunk[256];
+    while (true) {
+        if (takePacket(buffer, header, body)) {
+            if ((header & 0xF0) == type) return true;
+            continue;
+        }
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n <= 0) return false;
+        buffer.append(chunk, n);
+    }
+}
+
+// --- Built-in broker stand-in: QoS 0/1 in, QoS 0 fan-out, '+' and '#' filters ---
+
+bool topicMatches(const std::string& filter, const std::string& topic) {
+    size_t f = 0, t = 0;
+    while (f < filter.size()) {
+        if (filter[f] == '#') return true;
+        if (filter[f] == '+') {
+            while (t < topic.size() && topic[t] != '/') t++;
+            f++;
+            continue;
+        }
+        if (t >= topic.size() || filter[f] != topic[t]) return false;
+        f++;
+        t++;
+    }
+    return t == topic.size();
+}
+
+class Broker {
+public:
+    int listen(int port) {
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        if (bind(listener, (sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(listener, 1024) < 0) {
+            perror("broker");
+            exit(1);
+        }
+        socklen_t len = sizeof(addr);
+        getsockname(listener, (sockaddr*)&addr, &len);
+        setNonBlocking(listener);
+        return ntohs(addr.sin_port);
+    }
+
+    void run() {
+        while (!stopping) {
+            std::vector<pollfd> fds;
+            fds.push_back({listener, POLLIN, 0});
+            for (Session& s : sessions) {
+                fds.push_back({s.fd, (short)(POLLIN | (s.out.empty() ? 0 : POLLOUT)), 0});
+            }
+            if (poll(fds.data(), fds.size(), 50) <= 0) continue;
+            if (fds[0].revents & POLLIN) accept();
+            for (size_t i = 1; i < fds.size(); i++) {
+                Session& s = sessions[i - 1];
+                if (fds[i].revents & POLLIN) receive(s);
+                if (fds[i].revents & (POLLOUT | POLLHUP | POLLERR)) flush(s);
+            }
+            sessions.erase(std::remove_if(sessions.begin(), sessions.end(),
+                                          [](const Session& s) { return s.fd < 0; }), sessions.end());
+        }
+    }
+
+    std::atomic<bool> stopping{false};
+    std::atomic<uint64_t> routed{0};
+
+private:
+    struct Session {
+        int fd;
+        std::string in, out;
+        std::vector<std::string> filters;
+    };
+
+    void accept() {
+        int fd;
+        while ((fd = ::accept(listener, nullptr, nullptr)) >= 0) {
+            setNonBlocking(fd);
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            sessions.push_back({fd, "", "", {}});
+        }
+    }
+
+    void receive(Session& s) {
+        char chunk[16384];
+        ssize_t n;
+        while ((n = read(s.fd, chunk, sizeof(chunk))) > 0) {
+            s.in.append(chunk, n);
+        }
+        if (n == 0) {
+            close(s.fd);
+            s.fd = -1;
+            return;
+        }
+        uint8_t header;
+        std::string body;
+        while (takePacket(s.in, header, body)) {
+            handle(s, header, body);
+        }
+    }
+
+    void handle(Session& s, uint8_t header, const std::string& body) {
+        switch (header & 0xF0) {
+        case 0x10: // CONNECT
+            s.out += std::string("\x20\x02\x00\x00", 4);
+            break;
+        case 0x30: { // PUBLISH
+            std::string topic, payload;
+            uint16_t id;
+            if (!parsePublish(header, body, topic, payload, id)) return;
+            if ((header >> 1) & 0x03) {
+                const char ack[] = {0x40, 0x02, (char)(id >> 8), (char)(id & 0xFF)};
+                s.out.append(ack, sizeof(ack));
+            }
+            std::string forward;
+            for (Session& target : sessions) {
+                for (const std::string& filter : target.filters) {
+                    if (!topicMatches(filter, topic)) continue;
+                    if (forward.empty()) forward = publishPacket(topic, payload.data(), payload.size(), 0, 0);
+                    target.out += forward;
+                    routed++;
+                    break;
+                }
+            }
+            break;
+        }
+        case 0x80: { // SUBSCRIBE
+            size_t pos = 2;
+            std::string ack = {(char)0x90, 0, body[0], body[1]};
+            while (pos + 2 <= body.size()) {
+                size_t length = ((uint8_t)body[pos] << 8) | (uint8_t)body[pos + 1];
+                s.filters.push_back(body.substr(pos + 2, length));
+                pos += 2 + length + 1;
+                ack.push_back(0);
+            }
+            ack[1] = ack.size() - 2;
+            s.out += ack;
+            break;
+        }
+        case 0xC0: // PINGREQ
+            s.out += std::string("\xD0\x00", 2);
+            break;
+        case 0xE0: // DISCONNECT
+            close(s.fd);
+            s.fd = -1;
+            return;
+        }
+        flush(s);
+    }
+
+    void flush(Session& s) {
+        while (s.fd >= 0 && !s.out.empty()) {
+            ssize_t n = write(s.fd, s.out.data(), s.out.size());
+            if (n <= 0) {
+                if (n < 0 && errno != EAGAIN && errno != EINTR) {
+                    close(s.fd);
+                    s.fd = -1;
+                }
+                return;
+            }
+            s.out.erase(0, n);
+        }
+    }
+
+    int listener = -1;
+    std::vector<Session> sessions;
+};
+
+// --- Virtual devices ---
+
+struct Device {
+    int fd = -1;
+    Kind kind;
+    std::string topic;
+    std::string in, out;   // Unparsed acks, unsent bytes (socket buffer full)
+    uint16_t nextId = 1;
+    int inflight = 0;
+    double phase = 0;      // Seconds, spreads the fleet over one period
+    uint64_t published = 0;
+    float state[3] = {};   // DHT: temperature, humidity; MPU: quaternion x, y, z
+    std::mutex lock;       // Guards sendTimes (publisher vs subscriber thread)
+    std::deque<Clock::time_point> sendTimes;
+};
+
+struct Totals {
+    std::atomic<uint64_t> sent{0};
+    std::atomic<uint64_t> acked{0};
+    std::atomic<uint64_t> stalled{0};  // Publishes that found the socket buffer full
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> received{0};
+    std::atomic<uint64_t> decodeErrors{0};
+};
+
+uint64_t epochMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+size_t encode(Device& d, std::mt19937& rng, bool binary, char* buffer, size_t size) {
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(buffer);
+    if (d.kind == Kind::Dht) {
+        d.state[0] += 0.05f * noise(rng);
+        d.state[1] += 0.2f * noise(rng);
+        float temperature = 22.0f + d.state[0], humidity = 45.0f + d.state[1];
+        if (binary) return payload::packDht(bytes, temperature, humidity, temperature + 0.4f, epochMillis());
+        return payload::formatDht(buffer, size, temperature, humidity, temperature + 0.4f, epochMillis());
+    }
+    // Small random walk around level, renormalized like the filter output
+    for (float& c : d.state) c = c * 0.99f + 0.01f * noise(rng);
+    float norm = std::sqrt(1.0f + d.state[0] * d.state[0] + d.state[1] * d.state[1] + d.state[2] * d.state[2]);
+    float w = 1.0f / norm, x = d.state[0] / norm, y = d.state[1] / norm, z = d.state[2] / norm;
+    if (binary) return payload::packOrientation(bytes, w, x, y, z, epochMillis());
+    return payload::formatOrientation(buffer, size, w, x, y, z, epochMillis());
+}
+
+void flushDevice(Device& d) {
+    while (!d.out.empty()) {
+        ssize_t n = write(d.fd, d.out.data(), d.out.size());
+        if (n <= 0) return;
+        d.out.erase(0, n);
+    }
+}
+
+void readAcks(Device& d, Totals& totals) {
+    char chunk[512];
+    ssize_t n;
+    while ((n = read(d.fd, chunk, sizeof(chunk))) > 0) {
+        d.in.append(chunk, n);
+    }
+    uint8_t header;
+    std::string body;
+    while (takePacket(d.in, header, body)) {
+        if ((header & 0xF0) == 0x40) {
+            d.inflight--;
+            totals.acked++;
+        }
+    }
+}
+
+void publisher(std::vector<Device*> devices, const Options& options, Clock::time_point start,
+               Totals& totals, unsigned seed) {
+    std::mt19937 rng(seed);
+    char buffer[256];
+    auto end = start + std::chrono::duration<double>(options.duration);
+    double period = 1.0 / options.rate;
+    std::vector<pollfd> fds(devices.size());
+    while (Clock::now() < end) {
+        double now = std::chrono::duration<double>(Clock::now() - start).count();
+        double nextDue = period;
+        for (Device* d : devices) {
+            double due = d->phase + d->published * period;
+            if (due <= now) {
+                size_t length = encode(*d, rng, options.binary, buffer, sizeof(buffer));
+                uint16_t id = 0;
+                if (options.qos) {
+                    id = d->nextId++;
+                    if (d->nextId == 0) d->nextId = 1;
+                    d->inflight++;
+                }
+                {
+                    std::lock_guard<std::mutex> guard(d->lock);
+                    d->sendTimes.push_back(Clock::now());
+                }
+                std::string packet = publishPacket(d->topic, buffer, length, options.qos, id);
+                if (!d->out.empty()) totals.stalled++;
+                d->out += packet;
+                flushDevice(*d);
+                d->published++;
+                totals.sent++;
+                totals.bytes += length;
+                due += period;
+            }
+            nextDue = std::min(nextDue, due - now);
+        }
+        // Sleep until the next publish is due, servicing acks and backed-up sockets meanwhile
+        for (size_t i = 0; i < devices.size(); i++) {
+            fds[i] = {devices[i]->fd, (short)(POLLIN | (devices[i]->out.empty() ? 0 : POLLOUT)), 0};
+        }
+        int timeoutMs = std::max(0, (int)(nextDue * 1000));
+        if (poll(fds.data(), fds.size(), timeoutMs) > 0) {
+            for (size_t i = 0; i < devices.size(); i++) {
+                if (fds[i].revents & POLLIN) readAcks(*devices[i], totals);
+                if (fds[i].revents & POLLOUT) flushDevice(*devices[i]);
+            }
+        }
+    }
+    // Let the last writes and acks drain
+    auto drainEnd = Clock::now() + std::chrono::seconds(2);
+    for (Device* d : devices) {
+        while ((!d->out.empty() || d->inflight > 0) && Clock::now() < drainEnd) {
+            flushDevice(*d);
+            readAcks(*d, totals);
+            usleep(1000);
+        }
+    }
+}
+
+void subscriber(int fd, std::vector<Device>& fleet, Totals& totals, std::vector<uint32_t>& latencies,
+                std::atomic<bool>& stopping) {
+    std::string buffer, body, topic, data;
+    uint8_t header;
+    uint16_t id;
+    char chunk[65536];
+    while (!stopping) {
+        pollfd p = {fd, POLLIN, 0};
+        if (poll(&p, 1, 50) <= 0) continue;
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n <= 0) return;
+        buffer.append(chunk, n);
+        while (takePacket(buffer, header, body)) {
+            if ((header & 0xF0) != 0x30 || !parsePublish(header, body, topic, data, id)) continue;
+            auto arrived = Clock::now();
+            unsigned index;
+            if (sscanf(topic.c_str(), "esp32/%x/tx", &index) != 1 || index >= fleet.size()) continue;
+            Device& d = fleet[index];
+            Clock::time_point sentAt;
+            {
+                std::lock_guard<std::mutex> guard(d.lock);
+                if (d.sendTimes.empty()) continue;
+                sentAt = d.sendTimes.front();
+                d.sendTimes.pop_front();
+            }
+            latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(arrived - sentAt).count());
+            totals.received++;
+            // Same acceptance rule as the services: tag and size / right field count / the four quaternion keys
+            bool valid;
+            if (!data.empty() && (uint8_t)data[0] >= 0x80) {
+                valid = d.kind == Kind::Dht ? (uint8_t)data[0] == payload::TAG_DHT_TS && data.size() == 21
+                                            : (uint8_t)data[0] == payload::TAG_ORIENTATION_TS && data.size() == 25;
+            } else {
+                valid = d.kind == Kind::Dht ? std::count(data.begin(), data.end(), ':') == 3
+                                            : data.find("\"qz\"") != std::string::npos;
+            }
+            if (!valid) totals.decodeErrors++;
+        }
+    }
+}
+
+// --- CPU accounting ---
+
+double threadCpuSeconds(pthread_t thread) {
+    clockid_t clock;
+    timespec ts;
+    if (pthread_getcpuclockid(thread, &clock) != 0 || clock_gettime(clock, &ts) != 0) return 0;
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+double processCpuSeconds(int pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+    char line[1024];
+    size_t n = fread(line, 1, sizeof(line) - 1, f);
+    fclose(f);
+    line[n] = '\0';
+    // Fields 14 and 15 (utime, stime) follow the ")" that closes the command name
+    const char* p = strrchr(line, ')');
+    unsigned long utime = 0, stime = 0;
+    if (!p || sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2) return 0;
+    return (utime + stime) / (double)sysconf(_SC_CLK_TCK);
+}
+
+uint32_t percentile(std::vector<uint32_t>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    return sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+}
+
+void usage() {
+    puts("usage: loadgen [--devices N] [--rate MSG_PER_S] [--duration S] [--qos 0|1] [--kind dht|mpu|mix]\n"
+         "               [--host IP --port P [--broker-pid PID]] [--threads N] [--binary]");
+    exit(2);
+}
+
+Options parseOptions(int argc, char** argv) {
+    Options o;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--binary") {
+            o.binary = true;
+            continue;
+        }
+        if (i + 1 >= argc) usage();
+        const char* value = argv[++i];
+        if (arg == "--devices") o.devices = atoi(value);
+        else if (arg == "--rate") o.rate = atof(value);
+        else if (arg == "--duration") o.duration = atof(value);
+        else if (arg == "--qos") o.qos = atoi(value) ? 1 : 0;
+        else if (arg == "--host") o.host = value;
+        else if (arg == "--port") o.port = atoi(value);
+        else if (arg == "--broker-pid") o.brokerPid = atoi(value);
+        else if (arg == "--threads") o.threads = std::max(1, atoi(value));
+        else if (arg == "--kind") {
+            std::string kind = value;
+            o.kind = kind == "mpu" ? Kind::Mpu : kind == "mix" ? Kind::Mix : Kind::Dht;
+        } else usage();
+    }
+    if (o.devices < 1 || o.devices > 0xFFFF || o.rate <= 0 || o.duration <= 0) usage();
+    return o;
+}
+
+int main(int argc, char** argv) {
+    Options options = parseOptions(argc, argv);
+
+    Broker broker;
+    std::thread brokerThread;
+    std::string host = options.host;
+    int port = options.port;
+    if (host.empty()) {
+        host = "127.0.0.1";
+        port = broker.listen(0);
+        brokerThread = std::thread([&broker] { broker.run(); });
+    }
+
+    // Subscriber first, so no message of the run is missed
+    int subFd = dial(host, port);
+    // One request at a time: expect() drops whatever follows the packet it waits for
+    writeAll(subFd, connectPacket("loadgen-sub"));
+    bool connected = expect(subFd, 0x20);
+    writeAll(subFd, subscribePacket(1, "esp32/+/tx"));
+    if (!connected || !expect(subFd, 0x90)) {
+        fprintf(stderr, "Subscriber handshake failed\n");
+        return 1;
+    }
+
+    std::vector<Device> fleet(options.devices);
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> phase(0.0, 1.0 / options.rate);
+    for (int i = 0; i < options.devices; i++) {
+        Device& d = fleet[i];
+        d.kind = options.kind == Kind::Mix ? (i % 2 ? Kind::Mpu : Kind::Dht) : options.kind;
+        char topic[32];
+        snprintf(topic, sizeof(topic), "esp32/%04x/tx", i);
+        d.topic = topic;
+        d.phase = phase(rng);
+        d.fd = dial(host, port);
+        writeAll(d.fd, connectPacket("loadgen-" + std::to_string(i)));
+        if (!expect(d.fd, 0x20)) {
+            fprintf(stderr, "Device %d handshake failed\n", i);
+            return 1;
+        }
+        setNonBlocking(d.fd);
+    }
+    printf("%d devices (%s, %s) connected to %s:%d%s, %.2f msg/s each, QoS %d, %.0f s\n", options.devices,
+           options.kind == Kind::Dht ? "dht" : options.kind == Kind::Mpu ? "mpu" : "mix",
+           options.binary ? "binary" : "text", host.c_str(), port, options.host.empty() ? " (built-in broker)" : "",
+           options.rate, options.qos, options.duration);
+
+    Totals totals;
+    std::vector<uint32_t> latencies;
+    latencies.reserve(options.devices * options.rate * options.duration * 1.1);
+    std::atomic<bool> stopSubscriber{false};
+    std::thread subThread(subscriber, subFd, std::ref(fleet), std::ref(totals), std::ref(latencies),
+                          std::ref(stopSubscriber));
+
+    double cpuStart = options.host.empty() ? threadCpuSeconds(brokerThread.native_handle())
+                                           : options.brokerPid ? processCpuSeconds(options.brokerPid) : 0;
+    auto start = Clock::now();
+    std::vector<std::thread> publishers;
+    for (int t = 0; t < options.threads; t++) {
+        std::vector<Device*> share;
+        for (int i = t; i < options.devices; i += options.threads) share.push_back(&fleet[i]);
+        publishers.emplace_back(publisher, share, std::cref(options), start, std::ref(totals), 1000 + t);
+    }
+    for (std::thread& t : publishers) t.join();
+    double publishSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Wait for the fan-out to catch up (bounded)
+    auto drainEnd = Clock::now() + std::chrono::seconds(3);
+    while (totals.received < totals.sent && Clock::now() < drainEnd) usleep(10000);
+    double wallSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    double cpuEnd = options.host.empty() ? threadCpuSeconds(brokerThread.native_handle())
+                                         : options.brokerPid ? processCpuSeconds(options.brokerPid) : 0;
+    stopSubscriber = true;
+    subThread.join();
+
+    std::sort(latencies.begin(), latencies.end());
+    uint64_t sent = totals.sent, received = totals.received;
+    printf("sent       %llu msgs (%.0f msg/s, %.1f KB/s payload), stalled writes %llu\n",
+           (unsigned long long)sent, sent / publishSeconds, totals.bytes / publishSeconds / 1024,
+           (unsigned long long)totals.stalled.load());
+    if (options.qos) {
+        printf("acked      %llu (%.2f%%)\n", (unsigned long long)totals.acked.load(),
+               sent ? 100.0 * totals.acked / sent : 0.0);
+    }
+    printf("received   %llu msgs (%.0f msg/s), lost %lld, decode errors %llu\n", (unsigned long long)received,
+           received / publishSeconds, (long long)(sent - received), (unsigned long long)totals.decodeErrors.load());
+    printf("latency us p50 %u  p90 %u  p99 %u  max %u\n", percentile(latencies, 0.5), percentile(latencies, 0.9),
+           percentile(latencies, 0.99), latencies.empty() ? 0 : latencies.back());
+    if (options.host.empty() || options.brokerPid) {
+        double cpu = cpuEnd - cpuStart;
+        printf("broker CPU %.2f s (%.1f%% of one core), %.2f us per message in\n", cpu, 100.0 * cpu / wallSeconds,
+               sent ? cpu * 1e6 / sent : 0.0);
+    }
+
+    if (brokerThread.joinable()) {
+        broker.stopping = true;
+        brokerThread.join();
+    }
+    return 0;
+}
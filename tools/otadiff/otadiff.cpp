@@ -0,0 +1,945 @@
+/**
+ * otadiff.cpp
+ *
+ * Makes the delta and compressed firmware images that lab7_2 takes at POST /delta
+ * (lab7_2/src/delta_ota.hpp), applies them with the device's own patcher
+ * (lab7_2/src/delta_patch.hpp), and checks both.
+ *
+ *   otadiff diff old.bin new.bin patch.dlt [key]  delta from the running image to the new one
+ *   otadiff pack new.bin image.dlt [key]          compressed full image (any running image)
+ *   otadiff apply old.bin patch.dlt new.bin       what the device does, on the host
+ *   otadiff check [old.bin new.bin]               self-test and transfer sizes
+ *   otadiff bench [old.bin new.bin]               update time, ElegantOTA vs /delta
+ *
+ * diff and pack append the ota_image.hpp trailer: the new image's SHA-256 and,
+ * with a key, its HMAC under the key (the device's OTA_SIGNING_KEY).
+ *
+ * The delta is bsdiff's (Colin Percival, 2003): a suffix array of the old image
+ * finds long approximate matches, which become diff records (new - old, mostly
+ * zeros where only addresses moved) and extra records (new bytes). The record
+ * stream is then LZSS-compressed with the 4 KB window the device decodes with.
+ *
+ * Check: synthetic ~1 MB images (functions with literal pools and relative
+ * calls, a string table) before and after typical edits are diffed, streamed
+ * through the patcher in random TCP-sized pieces and compared byte for byte.
+ * A patch for another image and a truncated patch are refused, and a flipped
+ * bit never yields a wrong image. Signed uploads go through the device's
+ * receiver (lab7_2/src/ota_image.hpp) on a simulated flash: wrong keys,
+ * missing or foreign trailers, a cut-off upload and a bit the flash did not
+ * take all leave the slot unbootable.
+ * With two files, the diff and the unpacking for them.
+ *
+ * Bench: the same slot written the way ElegantOTA's Update does it and the way
+ * /delta does, with flash timings from the datasheet and every flash operation
+ * counted as a stall of loop() (the cache is off meanwhile).
+ *
+ * Build and run:
+ *   g++ -std=gnu++17 -O2 -I lab7_2/src tools/otadiff/otadiff.cpp -o otadiff
+ *   ./otadiff check
+ *   ./otadiff bench
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "delta_patch.hpp"
+#include "ota_image.hpp"
+
+typedef std::vector<uint8_t> Bytes;
+
+// --- Encoding ---
+
+void putVarint(Bytes& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+/**
+ * @brief LZSS as delta::Lzss decodes it: hash chains over the 4 KB window, greedy.
+ */
+Bytes lzssEncode(const Bytes& in) {
+    const size_t hash_size = 1 << 15, max_chain = 64, max_length = 1 << 16;
+    const size_t mask = delta::window_size - 1;
+    std::vector<int64_t> head(hash_size, -1), prev(delta::window_size, -1);
+    auto hash = [&](size_t i) { return (in[i] * 506832829u ^ in[i + 1] * 2654435761u ^ in[i + 2]) % hash_size; };
+    auto insert = [&](size_t i) {
+        if (i + delta::min_match > in.size()) return;
+        size_t h = hash(i);
+        prev[i & mask] = head[h];
+        head[h] = (int64_t)i;
+    };
+
+    Bytes out;
+    size_t flag_at = 0, bits = 0;
+    auto token = [&](bool match) {
+        if (bits == 0) {
+            flag_at = out.size();
+            out.push_back(0);
+        }
+        if (match) out[flag_at] |= 1 << bits;
+        bits = (bits + 1) & 7;
+    };
+
+    size_t i = 0;
+    while (i < in.size()) {
+        size_t best_length = 0, best_distance = 0;
+        if (i + delta::min_match <= in.size()) {
+            size_t limit = std::min(max_length, in.size() - i);
+            int64_t candidate = head[hash(i)];
+            for (size_t chain = 0; candidate >= 0 && i - candidate <= delta::window_size && chain < max_chain; chain++) {
+                size_t length = 0;
+                while (length < limit && in[candidate + length] == in[i + length]) length++;
+                if (length > best_length) {
+                    best_length = length;
+                    best_distance = i - candidate;
+                    if (length == limit) break;
+                }
+                int64_t next = prev[candidate & mask];
+                if (next >= candidate) break; // Slot reused by a newer position
+                candidate = next;
+            }
+        }
+        if (best_length < delta::min_match) {
+            token(false);
+            out.push_back(in[i]);
+            insert(i++);
+            continue;
+        }
+        token(true);
+        size_t distance = best_distance - 1;
+        size_t code = best_length < delta::long_match ? best_length - delta::min_match : 15;
+        out.push_back((uint8_t)distance);
+        out.push_back((uint8_t)(distance >> 8 | code << 4));
+        if (code == 15) putVarint(out, best_length - delta::long_match);
+        for (size_t k = 0; k < best_length; k++) insert(i + k);
+        i += best_length;
+    }
+    return out;
+}
+
+/**
+ * @brief Suffix array by prefix doubling; sa[0] is the empty suffix, as bsdiff expects.
+ */
+std::vector<int32_t> suffixArray(const Bytes& s) {
+    int32_t n = (int32_t)s.size();
+    std::vector<int32_t> sa(n + 1), rank(n + 1), next(n + 1);
+    for (int32_t i = 0; i < n; i++) {
+        sa[i] = i;
+        rank[i] = s[i];
+    }
+    sa[n] = n;
+    rank[n] = -1;
+    for (int32_t k = 1;; k <<= 1) {
+        auto second = [&](int32_t i) { return i + k <= n ? rank[i + k] : -1; };
+        auto less = [&](int32_t a, int32_t b) {
+            return rank[a] != rank[b] ? rank[a] < rank[b] : second(a) < second(b);
+        };
+        std::sort(sa.begin(), sa.end(), less);
+        next[sa[0]] = 0;
+        for (int32_t i = 1; i <= n; i++) next[sa[i]] = next[sa[i - 1]] + less(sa[i - 1], sa[i]);
+        rank.swap(next);
+        if (rank[sa[n]] == n) break;
+    }
+    return sa;
+}
+
+size_t matchLength(const uint8_t* a, size_t a_length, const uint8_t* b, size_t b_length) {
+    size_t i = 0;
+    while (i < a_length && i < b_length && a[i] == b[i]) i++;
+    return i;
+}
+
+/**
+ * @brief Longest match of new_data in old among sa[st..en], by binary search.
+ */
+size_t search(const std::vector<int32_t>& sa, const Bytes& old, const uint8_t* new_data, size_t new_length,
+              size_t st, size_t en, size_t& pos) {
+    while (en - st >= 2) {
+        size_t x = st + (en - st) / 2;
+        size_t n = std::min(old.size() - sa[x], new_length);
+        if (memcmp(old.data() + sa[x], new_data, n) < 0) {
+            st = x;
+        } else {
+            en = x;
+        }
+    }
+    size_t a = matchLength(old.data() + sa[st], old.size() - sa[st], new_data, new_length);
+    size_t b = matchLength(old.data() + sa[en], old.size() - sa[en], new_data, new_length);
+    pos = a > b ? sa[st] : sa[en];
+    return std::max(a, b);
+}
+
+/**
+ * @brief bsdiff's record stream from old to new.
+ */
+Bytes diffRecords(const Bytes& old, const Bytes& fresh) {
+    Bytes body;
+    auto record = [&](size_t diff_length, size_t extra_length, int64_t seek, size_t new_at, size_t old_at) {
+        putVarint(body, diff_length);
+        putVarint(body, extra_length);
+        putVarint(body, (uint64_t)((seek << 1) ^ (seek >> 63)));
+        for (size_t i = 0; i < diff_length; i++) body.push_back((uint8_t)(fresh[new_at + i] - old[old_at + i]));
+        body.insert(body.end(), fresh.begin() + new_at + diff_length, fresh.begin() + new_at + diff_length + extra_length);
+    };
+    if (old.empty()) {
+        record(0, fresh.size(), 0, 0, 0);
+        return body;
+    }
+
+    std::vector<int32_t> sa = suffixArray(old);
+    const int64_t old_size = old.size(), new_size = fresh.size();
+    int64_t scan = 0, length = 0, last_scan = 0, last_pos = 0, last_offset = 0;
+    size_t pos = 0;
+    while (scan < new_size) {
+        int64_t old_score = 0;
+        int64_t scsc = scan += length;
+        for (; scan < new_size; scan++) {
+            length = search(sa, old, fresh.data() + scan, new_size - scan, 0, old_size, pos);
+            for (; scsc < scan + length; scsc++) {
+                if (scsc + last_offset < old_size && old[scsc + last_offset] == fresh[scsc]) old_score++;
+            }
+            if ((length == old_score && length != 0) || length > old_score + 8) break;
+            if (scan + last_offset < old_size && old[scan + last_offset] == fresh[scan]) old_score--;
+        }
+        if (length == old_score && scan != new_size) continue;
+
+        // Extend the last match forwards and this one backwards, split any overlap
+        int64_t s = 0, best = 0, forward = 0;
+        for (int64_t i = 0; last_scan + i < scan && last_pos + i < old_size;) {
+            if (old[last_pos + i] == fresh[last_scan + i]) s++;
+            i++;
+            if (s * 2 - i > best * 2 - forward) {
+                best = s;
+                forward = i;
+            }
+        }
+        int64_t backward = 0;
+        if (scan < new_size) {
+            s = 0;
+            best = 0;
+            for (int64_t i = 1; scan >= last_scan + i && (int64_t)pos >= i; i++) {
+                if (old[pos - i] == fresh[scan - i]) s++;
+                if (s * 2 - i > best * 2 - backward) {
+                    best = s;
+                    backward = i;
+                }
+            }
+        }
+        if (last_scan + forward > scan - backward) {
+            int64_t overlap = (last_scan + forward) - (scan - backward);
+            s = 0;
+            best = 0;
+            int64_t split = 0;
+            for (int64_t i = 0; i < overlap; i++) {
+                if (fresh[last_scan + forward - overlap + i] == old[last_pos + forward - overlap + i]) s++;
+                if (fresh[scan - backward + i] == old[pos - backward + i]) s--;
+                if (s > best) {
+                    best = s;
+                    split = i + 1;
+                }
+            }
+            forward += split - overlap;
+            backward -= split;
+        }
+
+        int64_t extra = (scan - backward) - (last_scan + forward);
+        int64_t seek = ((int64_t)pos - backward) - (last_pos + forward);
+        record(forward, extra, seek, last_scan, last_pos);
+        last_scan = scan - backward;
+        last_pos = pos - backward;
+        last_offset = pos - scan;
+    }
+    return body;
+}
+
+Bytes makePatch(const Bytes& old, const Bytes& fresh, bool compress = true) {
+    delta::Header header = {};
+    header.magic = delta::patch_magic;
+    header.flags = compress ? delta::flag_lzss : 0;
+    header.old_size = old.size();
+    header.old_crc = delta::crc32(0, old.data(), old.size());
+    header.new_size = fresh.size();
+    header.new_crc = delta::crc32(0, fresh.data(), fresh.size());
+    Bytes body = diffRecords(old, fresh);
+    if (compress) body = lzssEncode(body);
+    Bytes patch(sizeof(header) + body.size());
+    memcpy(patch.data(), &header, sizeof(header));
+    std::copy(body.begin(), body.end(), patch.begin() + sizeof(header));
+    return patch;
+}
+
+// --- Applying, as the device does ---
+
+struct OldImage {
+    const Bytes& bytes;
+    size_t reads = 0;
+    size_t size() const { return bytes.size(); }
+    bool read(size_t offset, uint8_t* out, size_t length) {
+        if (offset + length > bytes.size()) return false;
+        memcpy(out, bytes.data() + offset, length);
+        reads++;
+        return true;
+    }
+};
+
+struct NewImage {
+    Bytes bytes;
+    size_t begun = 0, expected = 0;
+    bool begin(const delta::Header& header) {
+        begun++;
+        expected = header.new_size;
+        return true;
+    }
+    bool write(const uint8_t* data, size_t length) {
+        if (bytes.size() + length > expected) return false;
+        bytes.insert(bytes.end(), data, data + length);
+        return true;
+    }
+};
+
+typedef delta::Patcher<OldImage, NewImage> HostPatcher;
+
+std::mt19937 rng(49);
+
+/**
+ * @brief Streams the patch through the patcher in random pieces (1..1460 bytes, one TCP segment).
+ */
+bool apply(const Bytes& old, const Bytes& patch, Bytes& out, delta::Error* error = nullptr) {
+    OldImage old_image{old};
+    NewImage new_image;
+    static HostPatcher* patcher = nullptr; // Big (window): not on the stack
+    delete patcher;
+    patcher = new HostPatcher(old_image, new_image);
+    patcher->reset();
+    bool ok = true;
+    for (size_t at = 0; ok && at < patch.size();) {
+        size_t n = std::min<size_t>(1 + rng() % 1460, patch.size() - at);
+        ok = patcher->feed(patch.data() + at, n);
+        at += n;
+    }
+    ok = ok && patcher->finish();
+    if (error) *error = patcher->error;
+    out.swap(new_image.bytes);
+    return ok;
+}
+
+// --- Signing ---
+/**
+ * @brief Appends the trailer for image to patch.
+ */
+void sign(Bytes& patch, const Bytes& image, const char* key) {
+    ota_image::Trailer trailer = ota_image::makeTrailer(image.data(), image.size(), key);
+    const uint8_t* bytes = (const uint8_t*)&trailer;
+    patch.insert(patch.end(), bytes, bytes + sizeof(trailer));
+}
+
+/**
+ * @brief Takes a trailer off patch, if it has one.
+ */
+bool unsign(Bytes& patch, ota_image::Trailer& trailer) {
+    if (patch.size() < sizeof(trailer)) return false;
+    memcpy(&trailer, patch.data() + patch.size() - sizeof(trailer), sizeof(trailer));
+    if (trailer.magic != ota_image::trailer_magic) return false;
+    patch.resize(patch.size() - sizeof(trailer));
+    return true;
+}
+
+// --- Synthetic firmware ---
+
+/**
+ * A program as far as its image goes: functions (literal pool of absolute
+ * addresses, then code with relative calls) and a string table. Linking it
+ * again after an edit moves everything behind the edit, as a compiler would.
+ */
+struct Program {
+    struct Function {
+        uint32_t seed;
+        uint32_t size;
+        std::vector<uint32_t> calls;    // Function indexes, as call8 offsets
+        std::vector<uint32_t> literals; // String indexes, as l32r literals
+    };
+    std::vector<Function> functions;
+    std::vector<std::string> strings;
+};
+
+const uint32_t code_base = 0x400D0020, rodata_base = 0x3F400020;
+
+Program randomProgram(size_t functions, size_t strings) {
+    Program p;
+    for (size_t i = 0; i < strings; i++) {
+        std::string s = "[MOD" + std::to_string(i % 40) + "] ";
+        size_t words = 2 + rng() % 8;
+        for (size_t w = 0; w < words; w++) s += std::string("value state error task queue time event tag ") .substr((rng() % 8) * 6, 6);
+        p.strings.push_back(s);
+    }
+    for (size_t i = 0; i < functions; i++) {
+        Program::Function f;
+        f.seed = rng();
+        f.size = 40 + rng() % 700;
+        for (size_t c = rng() % 6; c > 0; c--) f.calls.push_back(rng() % functions);
+        for (size_t l = rng() % 4; l > 0; l--) f.literals.push_back(rng() % strings);
+        p.functions.push_back(f);
+    }
+    return p;
+}
+
+Bytes link(const Program& p) {
+    std::vector<uint32_t> function_at, string_at;
+    uint32_t at = 24;
+    for (const auto& f : p.functions) {
+        function_at.push_back(at);
+        at += (uint32_t)(4 * f.literals.size() + f.size + 3) & ~3u;
+    }
+    uint32_t rodata = at;
+    for (const auto& s : p.strings) {
+        string_at.push_back(at - rodata);
+        at += (uint32_t)s.size() + 1;
+    }
+    Bytes image(24, 0);
+    image[0] = 0xE9; // ESP image magic
+    image[1] = 3;
+    for (size_t i = 0; i < p.functions.size(); i++) {
+        const auto& f = p.functions[i];
+        for (uint32_t l : f.literals) {
+            uint32_t address = rodata_base + string_at[l];
+            for (int b = 0; b < 4; b++) image.push_back(address >> (8 * b));
+        }
+        // Code: a skewed opcode mix, a call8 (pc-relative) every so often
+        std::mt19937 code(f.seed);
+        static const uint8_t opcodes[] = {0x0C, 0x1C, 0x22, 0x32, 0x42, 0x66, 0x88, 0x91, 0xA2, 0xB8, 0xC0, 0xDD,
+                                          0xE5, 0xF0, 0x2C, 0x3D, 0x4B, 0x56, 0x67, 0x7C, 0x81, 0x9D, 0xAA, 0xBD};
+        uint32_t start = (uint32_t)image.size();
+        size_t next_call = 0;
+        while (image.size() < start + f.size) {
+            size_t pc = image.size();
+            if (next_call < f.calls.size() && code() % 12 == 0 && pc + 3 <= start + f.size) {
+                int32_t offset = ((int32_t)(code_base + function_at[f.calls[next_call++]]) -
+                                  (int32_t)((code_base + pc) & ~3u) - 4) >> 2;
+                uint32_t word = 0x25 | (uint32_t)(offset & 0x3FFFF) << 6;
+                for (int b = 0; b < 3; b++) image.push_back(word >> (8 * b));
+            } else {
+                image.push_back(opcodes[code() % (code() % 3 ? 8 : sizeof(opcodes))]);
+            }
+        }
+        while (image.size() % 4) image.push_back(0);
+    }
+    for (const auto& s : p.strings) image.insert(image.end(), s.c_str(), s.c_str() + s.size() + 1);
+    while (image.size() % 16) image.push_back(0);
+    return image;
+}
+
+// --- Simulated flash ---
+
+/**
+ * Timings for the update bench: typical figures from the GD25Q32C datasheet
+ * (the flash in most ESP32-WROOM-32 modules) and assumed rates for the rest.
+ * Every flash operation turns the cache off, which stalls both cores, loop()
+ * included; hashing and patching run in OTA_Task (delta_ota.hpp) and do not.
+ */
+const double sector_erase_ms = 50;     // 4 KB
+const double block_erase_ms = 250;     // 64 KB
+const double page_program_ms = 0.6;    // 256 B
+const double read_kb_ms = 0.2;         // 5 MB/s through esp_partition_read (assumed)
+const double hash_kb_ms = 0.2;         // SHA-256 or MD5, 5 MB/s (assumed)
+const double decode_kb_ms = 0.33;      // LZSS and patch records, 3 MB/s (assumed)
+const double link_kb_ms = 2.5;         // HTTP upload over WiFi, 400 KB/s (assumed)
+const size_t segment_size = 1436;      // One TCP segment per upload callback
+
+struct Timeline {
+    double network = 0, erase = 0, program = 0, read = 0, cpu = 0;
+    double stall_max = 0;
+    size_t long_stalls = 0;            // Over 100 ms: a missed LCD frame, a late button
+
+    double total() const { return network + erase + program + read + cpu; }
+    double stalled() const { return erase + program + read; }
+
+    void stall(double& bucket, double ms) {
+        bucket += ms;
+        stall_max = std::max(stall_max, ms);
+        long_stalls += ms > 100;
+    }
+};
+
+/**
+ * @brief An OTA slot: erase before write, bits only go 1 -> 0, every operation timed.
+ */
+struct SimFlash {
+    Bytes bytes;
+    Timeline* time = nullptr;
+    size_t corrupt_at = SIZE_MAX;   // Bit 0 of this byte does not program (a worn cell)
+    size_t violations = 0;          // Writes over unerased bytes
+
+    explicit SimFlash(size_t size) : bytes(size) {
+        std::mt19937 fill(50);
+        for (auto& b : bytes) b = fill(); // The image from two updates ago
+    }
+
+    size_t size() const { return bytes.size(); }
+
+    bool erase(size_t offset, size_t length) {
+        if (offset % ota_image::sector_size || length % ota_image::sector_size || offset + length > size()) {
+            return false;
+        }
+        std::fill(bytes.begin() + offset, bytes.begin() + offset + length, 0xFF);
+        // esp_partition_erase_range: 64 KB blocks where aligned, 4 KB sectors elsewhere
+        if (time) {
+            for (size_t at = offset; at < offset + length;) {
+                bool block = at % ota_image::block_size == 0 && offset + length - at >= ota_image::block_size;
+                time->stall(time->erase, block ? block_erase_ms : sector_erase_ms);
+                at += block ? ota_image::block_size : ota_image::sector_size;
+            }
+        }
+        return true;
+    }
+
+    bool write(size_t offset, const uint8_t* data, size_t length) {
+        if (offset + length > size()) return false;
+        for (size_t i = 0; i < length; i++) {
+            uint8_t& cell = bytes[offset + i];
+            violations += (cell & data[i]) != data[i];
+            cell &= data[i];
+            if (offset + i == corrupt_at) cell |= 1;
+        }
+        if (time) {
+            size_t pages = (offset + length + 255) / 256 - offset / 256;
+            time->stall(time->program, pages * page_program_ms);
+        }
+        return true;
+    }
+
+    bool read(size_t offset, uint8_t* out, size_t length) {
+        if (offset + length > size()) return false;
+        memcpy(out, bytes.data() + offset, length);
+        if (time) time->stall(time->read, length / 1024.0 * read_kb_ms);
+        return true;
+    }
+};
+
+/**
+ * @brief The running partition, reads timed like the slot's.
+ */
+struct RunningImage {
+    const Bytes& bytes;
+    Timeline* time = nullptr;
+    size_t size() const { return bytes.size(); }
+    bool read(size_t offset, uint8_t* out, size_t length) {
+        if (offset + length > bytes.size()) return false;
+        memcpy(out, bytes.data() + offset, length);
+        if (time) time->stall(time->read, length / 1024.0 * read_kb_ms);
+        return true;
+    }
+};
+
+typedef ota_image::Receiver<RunningImage, SimFlash> HostReceiver;
+
+const size_t slot_size = 0x140000; // The default partition table's app slots
+
+/**
+ * @brief An upload through the device's receiver, in TCP-sized pieces.
+ */
+ota_image::Error receive(const Bytes& old, const Bytes& upload, SimFlash& flash, const char* key,
+                         Timeline* time = nullptr, size_t erase_unit = ota_image::block_size) {
+    RunningImage running{old, time};
+    HostReceiver* receiver = new HostReceiver(running, flash); // Big (window, sector): not on the stack
+    receiver->writer.erase_unit = erase_unit;
+    receiver->reset();
+    bool ok = true;
+    for (size_t at = 0; ok && at < upload.size(); at += segment_size) {
+        size_t n = std::min(segment_size, upload.size() - at);
+        ok = receiver->feed(upload.data() + at, n);
+    }
+    ok = ok && receiver->finish(key);
+    ota_image::Error error = receiver->error;
+    delete receiver;
+    return ok ? ota_image::Error::None : error;
+}
+
+// --- Check ---
+
+int failures = 0;
+
+void expect(bool ok, const char* what) {
+    printf("  %-60s %s\n", what, ok ? "ok" : "FAIL");
+    failures += !ok;
+}
+
+struct Sizes {
+    size_t full, packed, patch;
+    double diff_seconds, apply_seconds;
+};
+
+Sizes measure(const char* name, const Bytes& old, const Bytes& fresh) {
+    auto begin = std::chrono::steady_clock::now();
+    Bytes patch = makePatch(old, fresh);
+    double diff_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    Bytes packed = makePatch(Bytes(), fresh);
+
+    Bytes out;
+    begin = std::chrono::steady_clock::now();
+    bool ok = apply(old, patch, out);
+    double apply_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    char what[96];
+    snprintf(what, sizeof(what), "%s: delta rebuilds the new image", name);
+    expect(ok && out == fresh, what);
+    snprintf(what, sizeof(what), "%s: compressed full image unpacks", name);
+    expect(apply(old, packed, out) && out == fresh, what);
+    return {fresh.size(), packed.size(), patch.size(), diff_seconds, apply_seconds};
+}
+
+void printSizes(const char* name, const Sizes& s) {
+    printf("  %-34s %9zu %9zu %5.1f%% %9zu %5.1f%% %7.2f s %6.0f ms\n", name, s.full, s.packed, 100.0 * s.packed / s.full,
+           s.patch, 100.0 * s.patch / s.full, s.diff_seconds, 1000 * s.apply_seconds);
+}
+
+std::string hex(const uint8_t* data, size_t length) {
+    std::string out;
+    char digit[3];
+    for (size_t i = 0; i < length; i++) {
+        snprintf(digit, sizeof(digit), "%02x", data[i]);
+        out += digit;
+    }
+    return out;
+}
+
+bool holds(const SimFlash& flash, const Bytes& image) { return std::equal(image.begin(), image.end(), flash.bytes.begin()); }
+
+// The head goes in last: a slot without it does not boot
+bool bootable(const SimFlash& flash, const Bytes& image) {
+    return std::equal(image.begin(), image.begin() + ota_image::head_size, flash.bytes.begin());
+}
+
+void checkSigned(const Bytes& old, const Bytes& fresh) {
+    uint8_t digest[ota_image::digest_size];
+    ota_image::Sha256 sha;
+    sha.update((const uint8_t*)"abc", 3);
+    sha.finish(digest);
+    expect(hex(digest, sizeof(digest)) == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+           "SHA-256 of \"abc\" (FIPS 180-2 B.1)");
+    sha.start();
+    Bytes a(1000, 'a');
+    for (int i = 0; i < 1000; i++) sha.update(a.data(), a.size());
+    sha.finish(digest);
+    expect(hex(digest, sizeof(digest)) == "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0",
+           "SHA-256 of a million \"a\" (FIPS 180-2 B.3)");
+    const char* message = "what do ya want for nothing?";
+    ota_image::hmacSha256((const uint8_t*)"Jefe", 4, (const uint8_t*)message, strlen(message), digest);
+    expect(hex(digest, sizeof(digest)) == "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843",
+           "HMAC-SHA256 (RFC 4231 case 2)");
+
+    using ota_image::Error;
+    Bytes patch = makePatch(old, fresh);
+    Bytes signed_patch = patch, unsigned_patch = patch;
+    sign(signed_patch, fresh, "key");
+    sign(unsigned_patch, fresh, "");
+    {
+        SimFlash flash(slot_size);
+        expect(receive(old, signed_patch, flash, "key") == Error::None && holds(flash, fresh) && flash.violations == 0,
+               "a signed patch is written, checked and made bootable");
+    }
+    {
+        SimFlash flash(slot_size);
+        expect(receive(old, signed_patch, flash, "other") == Error::Signature && !bootable(flash, fresh),
+               "another key's signature is refused");
+    }
+    {
+        SimFlash flash(slot_size);
+        expect(receive(old, patch, flash, "key") == Error::Unsigned && !bootable(flash, fresh),
+               "with a key, an upload without a trailer is refused");
+    }
+    {
+        SimFlash flash(slot_size);
+        expect(receive(old, unsigned_patch, flash, "key") == Error::Signature, "with a key, an unsigned trailer is refused");
+    }
+    {
+        SimFlash flash(slot_size), bare(slot_size);
+        expect(receive(old, unsigned_patch, flash, "") == Error::None && holds(flash, fresh) &&
+                   receive(old, patch, bare, "") == Error::None && holds(bare, fresh),
+               "without a key, unsigned uploads are taken");
+    }
+    {
+        SimFlash flash(slot_size);
+        Bytes tampered = signed_patch;
+        tampered[tampered.size() - 2 * ota_image::digest_size] ^= 1; // Digest, first byte
+        expect(receive(old, tampered, flash, "") == Error::Digest && !bootable(flash, fresh),
+               "a trailer for another image is refused (SHA-256)");
+    }
+    {
+        SimFlash flash(slot_size);
+        size_t at = 70000;
+        while (fresh[at] & 1) at++;
+        flash.corrupt_at = at;
+        expect(receive(old, signed_patch, flash, "key") == Error::ReadBack && !bootable(flash, fresh),
+               "a bit the flash did not take is caught on read-back");
+    }
+    {
+        SimFlash flash(slot_size);
+        Bytes truncated(signed_patch.begin(), signed_patch.end() - 200);
+        expect(receive(old, truncated, flash, "key") != Error::None && !bootable(flash, fresh),
+               "a cut-off upload leaves the slot unbootable");
+    }
+    {
+        Bytes packed = makePatch(Bytes(), fresh);
+        sign(packed, fresh, "key");
+        SimFlash sectors(slot_size), blocks(slot_size);
+        expect(receive(Bytes(), packed, sectors, "key", nullptr, ota_image::sector_size) == Error::None &&
+                   receive(Bytes(), packed, blocks, "key") == Error::None && holds(sectors, fresh) &&
+                   holds(blocks, fresh) && sectors.violations + blocks.violations == 0,
+               "4 KB and 64 KB erases write the same slot");
+    }
+}
+
+int check(const Bytes* given_old, const Bytes* given_new) {
+    printf("check:\n");
+    std::vector<std::pair<std::string, Sizes>> results;
+    if (given_old) {
+        results.push_back({"given images", measure("given images", *given_old, *given_new)});
+    } else {
+        Program base = randomProgram(2600, 1200);
+        Bytes old = link(base);
+
+        Program one = base; // A bug fix: one function rewritten
+        one.functions[1300].seed++;
+        results.push_back({"one function changed", measure("one function changed", old, link(one))});
+
+        Program feature = base; // A feature: new functions early in the image, new calls and strings
+        std::mt19937 keep = rng;
+        Program added = randomProgram(40, 30);
+        feature.functions.insert(feature.functions.begin() + 300, added.functions.begin(), added.functions.end());
+        for (auto& f : feature.functions) {
+            for (auto& c : f.calls) c = c >= 300 ? c + 40 : c;
+        }
+        for (size_t i = 0; i < 40; i++) {
+            feature.functions[300 + i].calls = {(uint32_t)(rng() % 2640)};
+            feature.functions[rng() % 2640].seed++;
+        }
+        feature.strings.insert(feature.strings.begin() + 100, added.strings.begin(), added.strings.end());
+        for (auto& f : feature.functions) {
+            for (auto& l : f.literals) l = l >= 100 ? l + 30 : l;
+        }
+        rng = keep;
+        results.push_back({"feature added (code moves)", measure("feature added", old, link(feature))});
+
+        Program version = base; // Version bump: one string
+        version.strings[0] = "[MAIN] Firmware 1.0.1";
+        results.push_back({"version string changed", measure("version string", old, link(version))});
+
+        results.push_back({"same image", measure("same image", old, old)});
+        results.push_back({"unrelated image", measure("unrelated image", old, link(randomProgram(2600, 1200)))});
+
+        // Refusals
+        Bytes fresh = link(one), out;
+        Bytes patch = makePatch(old, fresh);
+        Bytes other = old;
+        other[5000] ^= 1;
+        delta::Error error;
+        expect(!apply(other, patch, out, &error) && error == delta::Error::WrongBase && out.empty(),
+               "a patch for another image is refused before writing");
+        Bytes truncated(patch.begin(), patch.end() - 100);
+        expect(!apply(old, truncated, out), "a truncated patch fails");
+        // A flip can be harmless (another distance into a run of zeros, an unused flag bit), never wrong
+        int refused = 0, wrong = 0;
+        for (int i = 0; i < 200; i++) {
+            Bytes flipped = patch;
+            flipped[sizeof(delta::Header) + rng() % (patch.size() - sizeof(delta::Header))] ^= 1 << (rng() % 8);
+            bool ok = apply(old, flipped, out);
+            refused += !ok;
+            wrong += ok && out != fresh;
+        }
+        printf("  flipped bits: %d of 200 refused, the rest harmless\n", refused);
+        expect(wrong == 0, "a flipped bit never yields a wrong image");
+        Bytes raw = makePatch(old, fresh, false);
+        expect(apply(old, raw, out) && out == fresh, "an uncompressed patch applies too");
+
+        checkSigned(old, fresh);
+    }
+
+    printf("\npatcher RAM: %zu bytes (%zu of them the LZSS window)\n", sizeof(HostPatcher), delta::window_size);
+    printf("\ntransfer sizes\n");
+    printf("  %-34s %9s %9s %6s %9s %6s %9s %9s\n", "", "full", "packed", "", "delta", "", "diff", "apply");
+    for (const auto& r : results) printSizes(r.first.c_str(), r.second);
+
+    printf(failures ? "\nFAIL\n" : "\nPASS\n");
+    return failures ? 1 : 0;
+}
+
+// --- Bench ---
+
+/**
+ * @brief The check esp_ota_set_boot_partition() makes on both paths: the image read and hashed.
+ */
+void bootCheck(SimFlash& flash, size_t size, Timeline& time) {
+    uint8_t buffer[ota_image::sector_size];
+    for (size_t at = 0; at < size; at += sizeof(buffer)) flash.read(at, buffer, std::min(sizeof(buffer), size - at));
+    time.cpu += size / 1024.0 * hash_kb_ms;
+}
+
+/**
+ * @brief ElegantOTA's /update: the raw image into Update (4 KB erase, 4 KB writes, MD5 of the stream).
+ */
+Timeline elegantOta(const Bytes& fresh, SimFlash& flash) {
+    Timeline time;
+    flash.time = &time;
+    auto* writer = new ota_image::SectorWriter<SimFlash>(flash);
+    writer->erase_unit = ota_image::sector_size;
+    writer->begin(fresh.size());
+    for (size_t at = 0; at < fresh.size(); at += segment_size) {
+        size_t n = std::min(segment_size, fresh.size() - at);
+        time.network += n / 1024.0 * link_kb_ms;
+        time.cpu += n / 1024.0 * hash_kb_ms;
+        writer->write(fresh.data() + at, n);
+    }
+    writer->flush();
+    writer->commit();
+    delete writer;
+    bootCheck(flash, fresh.size(), time);
+    flash.time = nullptr;
+    return time;
+}
+
+/**
+ * @brief /delta: the upload patched, hashed on the way, read back and hashed again.
+ */
+Timeline deltaOta(const Bytes& old, const Bytes& upload, const Bytes& fresh, SimFlash& flash, size_t erase_unit) {
+    Timeline time;
+    flash.time = &time;
+    ota_image::Error error = receive(old, upload, flash, "key", &time, erase_unit);
+    time.network += upload.size() / 1024.0 * link_kb_ms;
+    time.cpu += fresh.size() / 1024.0 * (decode_kb_ms + 2 * hash_kb_ms);
+    bootCheck(flash, fresh.size(), time);
+    flash.time = nullptr;
+    expect(error == ota_image::Error::None && holds(flash, fresh), "  the slot holds the new image");
+    return time;
+}
+
+void printTimeline(const char* name, size_t upload, size_t image, const Timeline& t) {
+    printf("  %-30s %8zu %6.2f %6.2f %6.2f %6.2f %6.2f %7.2f s %5.0f KB/s %6.2f s %5.0f ms %4zu\n", name,
+           upload, t.network / 1000, t.erase / 1000, t.program / 1000, t.read / 1000, t.cpu / 1000,
+           t.total() / 1000, image / 1024.0 / (t.total() / 1000), t.stalled() / 1000, t.stall_max, t.long_stalls);
+}
+
+int bench(const Bytes* given_old, const Bytes* given_new) {
+    Bytes old, fresh;
+    if (given_old) {
+        old = *given_old;
+        fresh = *given_new;
+    } else {
+        Program base = randomProgram(2600, 1200);
+        old = link(base);
+        base.functions[1300].seed++; // A bug fix
+        fresh = link(base);
+    }
+    printf("bench: %zu byte image; GD25Q32C flash (sector %.0f ms, block %.0f ms, page %.1f ms), %.0f KB/s link\n",
+           fresh.size(), sector_erase_ms, block_erase_ms, page_program_ms, 1 / link_kb_ms * 1000);
+    Bytes packed = makePatch(Bytes(), fresh);
+    sign(packed, fresh, "key");
+    Bytes patch = makePatch(old, fresh);
+    sign(patch, fresh, "key");
+
+    SimFlash flash(slot_size);
+    Timeline before = elegantOta(fresh, flash);
+    expect(holds(flash, fresh), "  the slot holds the new image");
+    Timeline sectors = deltaOta(Bytes(), packed, fresh, flash, ota_image::sector_size);
+    Timeline blocks = deltaOta(Bytes(), packed, fresh, flash, ota_image::block_size);
+    Timeline patched = deltaOta(old, patch, fresh, flash, ota_image::block_size);
+
+    printf("\n  %-30s %8s %6s %6s %6s %6s %6s %9s %10s %8s %8s %4s\n", "seconds", "upload", "net", "erase", "prog",
+           "read", "cpu", "total", "image", "loop: stalled", "max", ">100");
+    printTimeline("/update, raw (before)", fresh.size(), fresh.size(), before);
+    printTimeline("/delta packed, 4 KB erases", packed.size(), fresh.size(), sectors);
+    printTimeline("/delta packed, 64 KB erases", packed.size(), fresh.size(), blocks);
+    printTimeline("/delta patch, 64 KB erases", patch.size(), fresh.size(), patched);
+    printf("\n  /delta packed vs /update: %.2fx faster, loop stalled %.0f%% as long\n", before.total() / blocks.total(),
+           100 * blocks.stalled() / before.stalled());
+    printf(failures ? "\nFAIL\n" : "\nPASS\n");
+    return failures ? 1 : 0;
+}
+
+// --- Command line ---
+
+bool readFile(const char* path, Bytes& out) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Cannot read %s\n", path);
+        return false;
+    }
+    uint8_t buffer[65536];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) out.insert(out.end(), buffer, buffer + n);
+    fclose(file);
+    return true;
+}
+
+bool writeFile(const char* path, const Bytes& data) {
+    FILE* file = fopen(path, "wb");
+    bool ok = file && fwrite(data.data(), 1, data.size(), file) == data.size();
+    if (file) fclose(file);
+    if (!ok) fprintf(stderr, "Cannot write %s\n", path);
+    return ok;
+}
+
+int usage() {
+    fprintf(stderr,
+            "usage: otadiff diff old.bin new.bin patch.dlt [key]\n"
+            "       otadiff pack new.bin image.dlt [key]\n"
+            "       otadiff apply old.bin patch.dlt new.bin\n"
+            "       otadiff check [old.bin new.bin]\n"
+            "       otadiff bench [old.bin new.bin]\n");
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) return usage();
+    std::string mode = argv[1];
+    Bytes a, b;
+    if (mode == "diff" && (argc == 5 || argc == 6)) {
+        if (!readFile(argv[2], a) || !readFile(argv[3], b)) return 1;
+        Bytes patch = makePatch(a, b);
+        sign(patch, b, argc == 6 ? argv[5] : "");
+        printf("%zu -> %zu bytes (%.1f%%)\n", b.size(), patch.size(), 100.0 * patch.size() / b.size());
+        return writeFile(argv[4], patch) ? 0 : 1;
+    }
+    if (mode == "pack" && (argc == 4 || argc == 5)) {
+        if (!readFile(argv[2], b)) return 1;
+        Bytes packed = makePatch(Bytes(), b);
+        sign(packed, b, argc == 5 ? argv[4] : "");
+        printf("%zu -> %zu bytes (%.1f%%)\n", b.size(), packed.size(), 100.0 * packed.size() / b.size());
+        return writeFile(argv[3], packed) ? 0 : 1;
+    }
+    if (mode == "apply" && argc == 5) {
+        Bytes out;
+        delta::Error error;
+        ota_image::Trailer trailer;
+        if (!readFile(argv[2], a) || !readFile(argv[3], b)) return 1;
+        bool has_trailer = unsign(b, trailer);
+        if (!apply(a, b, out, &error)) {
+            fprintf(stderr, "Patch failed: %s\n", delta::errorName(error));
+            return 1;
+        }
+        if (has_trailer) {
+            ota_image::Trailer expected = ota_image::makeTrailer(out.data(), out.size(), "");
+            if (!ota_image::sameDigest(expected.digest, trailer.digest)) {
+                fprintf(stderr, "Patch failed: %s\n", ota_image::errorName(ota_image::Error::Digest));
+                return 1;
+            }
+        }
+        return writeFile(argv[4], out) ? 0 : 1;
+    }
+    if (mode == "check" && (argc == 2 || argc == 4)) {
+        if (argc == 4 && (!readFile(argv[2], a) || !readFile(argv[3], b))) return 1;
+        return argc == 4 ? check(&a, &b) : check(nullptr, nullptr);
+    }
+    if (mode == "bench" && (argc == 2 || argc == 4)) {
+        if (argc == 4 && (!readFile(argv[2], a) || !readFile(argv[3], b))) return 1;
+        return argc == 4 ? bench(&a, &b) : bench(nullptr, nullptr);
+    }
+    return usage();
+}
@@ -0,0 +1,135 @@
+/**
+ * qos1bench.cpp
+ *
+ * Host benchmark and check for the QoS 1 pipeline of lib/connectivity
+ * (mqtt.hpp): throughput and duplicate rate of the in-flight window under
+ * injected round-trip latency and loss, against the fake broker of
+ * fake_network.hpp in simulated time.
+ *
+ * For each round trip (5, 50, 200 ms) and loss (0, 1%, 5% of the publishes
+ * and the same share of the PUBACKs), 2000 messages are offered as fast as
+ * the offline queue takes them. loop() runs every simulated millisecond.
+ *
+ * Reported: delivered messages/s, the window's bound (inflightWindow per round
+ * trip), duplicates the broker saw, the client's retransmitted counter, and the
+ * time to deliver all of them.
+ *
+ * Check: every message arrives, duplicates only come from resends (they carry
+ * DUP and stay within stats.retransmitted), and without loss the window
+ * reaches most of its bound.
+ *
+ * Build and run:
+ *   g++ -std=gnu++17 -O2 -I lib/connectivity/src tools/qos1bench/qos1bench.cpp -o qos1bench
+ *   ./qos1bench
+ */
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+#include "mqtt.hpp"
+
+const int messages = 2000;
+
+int failures = 0;
+
+void expect(bool ok, const char* what) {
+    printf("  %-62s %s\n", what, ok ? "ok" : "FAIL");
+    failures += !ok;
+}
+
+struct Result {
+    double perSecond;
+    double boundPerSecond;
+    double duplicateShare; // Broker-side copies beyond the first, per message
+    uint32_t retransmitted;
+    unsigned long millisTotal;
+    bool allDelivered;
+    bool duplicatesMarked;  // Every extra copy carried DUP
+    bool duplicatesCounted; // Extra copies <= retransmitted
+};
+
+bool settled() {
+    return mqtt::connected() && mqtt::queuedCount() == 0 && mqtt::inflightCount() == 0;
+}
+
+Result run(unsigned long roundTripMillis, float loss) {
+    fake::broker.ackDelayMillis = roundTripMillis;
+    fake::broker.publishLoss = loss;
+    fake::broker.ackLoss = loss;
+    fake::broker.received.clear();
+    mqtt::stats = {};
+
+    // makeMessage() copies the payload; only the topic has to outlive the queue
+    char payload[16];
+    int offered = 0;
+    unsigned long start = millis();
+    while (offered < messages || !settled()) {
+        // Keep a small backlog so the window is never starved
+        while (offered < messages && mqtt::queuedCount() < mqtt::flushPerLoop * 2) {
+            snprintf(payload, sizeof(payload), "m%d", offered++);
+            mqtt::publish(mqtt::txTopic, payload, 1);
+        }
+        mqtt::loop();
+        delay(1);
+        if (millis() - start > 3600000UL) break;
+    }
+
+    Result r = {};
+    r.millisTotal = millis() - start;
+    std::set<std::string> unique;
+    size_t copies = 0;
+    r.duplicatesMarked = true;
+    for (const fake::Message& m : fake::broker.received) {
+        if (m.topic != mqtt::txTopic) continue;
+        copies++;
+        if (!unique.insert(m.payload).second) r.duplicatesMarked &= m.duplicate;
+    }
+    r.allDelivered = unique.size() == (size_t)messages;
+    r.perSecond = unique.size() * 1000.0 / r.millisTotal;
+    r.boundPerSecond = mqtt::inflightWindow * 1000.0 / std::max(roundTripMillis, 1UL);
+    r.duplicateShare = (double)(copies - unique.size()) / messages;
+    r.retransmitted = mqtt::stats.retransmitted;
+    r.duplicatesCounted = copies - unique.size() <= mqtt::stats.retransmitted;
+    return r;
+}
+
+int main() {
+    Serial.quiet = true;
+    srand(1);
+    sta::connect_to_wifi();
+    mqtt::setupMqtt();
+    while (!mqtt::connected()) {
+        mqtt::loop();
+        delay(1);
+    }
+
+    const unsigned long roundTrips[] = {5, 50, 200};
+    const float losses[] = {0, 0.01f, 0.05f};
+
+    printf("QoS 1, %d messages, window %u, ack timeout %lu ms:\n", messages, (unsigned)mqtt::inflightWindow,
+           mqtt::ackTimeoutMillis);
+    printf("  %8s %6s %10s %10s %10s %10s %10s\n", "rtt ms", "loss", "msg/s", "bound", "dup %", "resent", "total s");
+    bool delivered = true, marked = true, counted = true, nearBound = true;
+    for (unsigned long rtt : roundTrips) {
+        for (float loss : losses) {
+            Result r = run(rtt, loss);
+            printf("  %8lu %5.0f%% %10.1f %10.1f %10.2f %10u %10.1f\n", rtt, loss * 100, r.perSecond,
+                   std::min(r.boundPerSecond, 1000.0 * mqtt::flushPerLoop), r.duplicateShare * 100,
+                   (unsigned)r.retransmitted, r.millisTotal / 1000.0);
+            delivered &= r.allDelivered;
+            marked &= r.duplicatesMarked;
+            counted &= r.duplicatesCounted;
+            if (loss == 0) nearBound &= r.perSecond >= 0.8 * std::min(r.boundPerSecond, 1000.0 * mqtt::flushPerLoop);
+        }
+    }
+
+    printf("check:\n");
+    expect(delivered, "every message reaches the broker");
+    expect(marked, "every duplicate at the broker carries DUP");
+    expect(counted, "duplicates never exceed stats.retransmitted");
+    expect(nearBound, "without loss the window reaches 80% of its bound");
+
+    printf(failures ? "\nFAIL\n" : "\nPASS\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,318 @@
+/**
+ * reconnectsim.cpp
+ *
+ * Host check for the MQTT reconnect path in lib/connectivity (mqtt.hpp): the
+ * real state machine runs in simulated time against the in-process broker of
+ * fake_network.hpp, which is killed and restarted under it.
+ *
+ * Scenarios:
+ *   restart  - the broker drops every session and comes straight back, once per
+ *              seed: the client notices, retries after one jittered backoff and
+ *              delivers what was published meanwhile, in order, once.
+ *   outage   - the broker is down for two minutes: attempts back off within the
+ *              equal-jitter bounds up to the 30 s cap, the offline queue keeps the
+ *              newest messages, and the session is back within one backoff.
+ *   link     - the Wi-Fi link drops while the client is deep in backoff: no
+ *              attempt is made without a link, and the link coming back cuts the
+ *              backoff short.
+ *   drop     - the Wi-Fi link drops under a live session: the first handshake
+ *              after the link is back sends a fresh CONNECT, so the session
+ *              returns without a failed attempt and delivers what was published
+ *              meanwhile.
+ *
+ * loop() is called every simulated millisecond and must never move the clock
+ * itself (it never blocks).
+ *
+ * Build and run:
+ *   g++ -std=gnu++17 -O2 -I lib/connectivity/src tools/reconnectsim/reconnectsim.cpp -o reconnectsim
+ *   ./reconnectsim
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "mqtt.hpp"
+
+using mqtt::State;
+
+struct Attempt {
+    unsigned long atMillis;      // When the attempt failed and the backoff started
+    unsigned long backoffMillis;
+    uint8_t failed;              // mqtt::failedAttempts after it
+};
+
+std::vector<Attempt> attempts;
+unsigned long attemptSeenMillis = ~0UL;
+unsigned long longestLoopMillis = 0;
+unsigned long attemptsWithoutLink = 0;
+
+int failures = 0;
+
+void expect(bool ok, const char* what) {
+    printf("  %-62s %s\n", what, ok ? "ok" : "FAIL");
+    failures += !ok;
+}
+
+/**
+ * @brief One pass of the owning task: loop(), then a millisecond of time.
+ */
+void step() {
+    unsigned long before = millis();
+    State was = mqtt::state;
+    mqtt::loop();
+    longestLoopMillis = std::max(longestLoopMillis, millis() - before);
+
+    if (was == State::Backoff && mqtt::state == State::TcpConnecting && !sta::connected()) {
+        attemptsWithoutLink++;
+    }
+    // A failed attempt restarts the backoff; a link-down transition does too, but without a link
+    if (mqtt::state == State::Backoff && mqtt::failedAttempts > 0 && sta::connected() &&
+        mqtt::stateSinceMillis != attemptSeenMillis) {
+        attemptSeenMillis = mqtt::stateSinceMillis;
+        attempts.push_back({mqtt::stateSinceMillis, mqtt::backoffMillis, mqtt::failedAttempts});
+    }
+    delay(1);
+}
+
+template <typename Done>
+bool runUntil(Done done, unsigned long limitMillis) {
+    unsigned long start = millis();
+    while (!done()) {
+        if (millis() - start >= limitMillis) return false;
+        step();
+    }
+    return true;
+}
+
+void runFor(unsigned long ms) {
+    unsigned long start = millis();
+    while (millis() - start < ms) step();
+}
+
+bool settled() {
+    return mqtt::connected() && mqtt::queuedCount() == 0 && mqtt::inflightCount() == 0;
+}
+
+/**
+ * @brief Payloads received on txTopic since the given index of broker.received.
+ */
+std::vector<std::string> deliveredSince(size_t first) {
+    std::vector<std::string> payloads;
+    for (size_t i = first; i < fake::broker.received.size(); i++) {
+        if (fake::broker.received[i].topic == mqtt::txTopic) payloads.push_back(fake::broker.received[i].payload);
+    }
+    return payloads;
+}
+
+unsigned long ceilingFor(uint8_t failed) {
+    uint8_t shift = failed < 6 ? failed : 6;
+    return std::min(mqtt::backoffBaseMillis << shift, mqtt::backoffMaxMillis);
+}
+
+/**
+ * @brief Broker restarts: reconnect after one backoff, nothing lost or doubled.
+ */
+void restart() {
+    printf("restart (broker drops all sessions, back at once), 16 seeds:\n");
+    const int seeds = 16;
+    const int messages = 5;
+    unsigned long fastest = ~0UL, slowest = 0;
+    bool inOrder = true, detected = true;
+
+    for (int seed = 1; seed <= seeds; seed++) {
+        srand(seed);
+        size_t first = fake::broker.received.size();
+        attempts.clear();
+
+        fake::broker.restart();
+        unsigned long downMillis = millis();
+        char payload[16];
+        for (int i = 0; i < messages; i++) {
+            snprintf(payload, sizeof(payload), "r%d-%d", seed, i);
+            mqtt::publish(mqtt::txTopic, payload, 1);
+            runFor(100);
+        }
+        detected &= !attempts.empty();
+        bool back = runUntil(settled, 10000);
+        unsigned long took = millis() - downMillis;
+        fastest = std::min(fastest, took);
+        slowest = std::max(slowest, took);
+
+        std::vector<std::string> got = deliveredSince(first);
+        bool ok = back && (int)got.size() == messages;
+        for (int i = 0; ok && i < messages; i++) {
+            snprintf(payload, sizeof(payload), "r%d-%d", seed, i);
+            ok = got[i] == payload;
+        }
+        inOrder &= ok;
+    }
+
+    unsigned long ceiling = ceilingFor(1) + fake::broker.connectMillis + 5;
+    printf("  back after %lu..%lu ms (one backoff: %lu..%lu ms + connect)\n", fastest, slowest, ceilingFor(1) / 2,
+           ceilingFor(1));
+    expect(detected, "the dropped session is noticed by loop()");
+    expect(slowest <= ceiling, "every reconnect comes after a single backoff");
+    expect(slowest - fastest >= ceilingFor(1) / 4, "jitter spreads the reconnects of different devices");
+    expect(inOrder, "messages published meanwhile arrive once, in order");
+}
+
+/**
+ * @brief Broker down for two minutes: bounded, growing, jittered attempts.
+ */
+void outage() {
+    printf("outage (broker down for 120 s, one QoS 1 message per second):\n");
+    const unsigned long outageMillis = 120000;
+    srand(7);
+    attempts.clear();
+    size_t first = fake::broker.received.size();
+
+    fake::broker.up = false;
+    fake::broker.restart();
+    unsigned long start = millis();
+    int published = 0;
+    char payload[16];
+    while (millis() - start < outageMillis) {
+        snprintf(payload, sizeof(payload), "o%d", published++);
+        mqtt::publish(mqtt::txTopic, payload, 1);
+        runFor(1000);
+    }
+    size_t attemptsWhileDown = attempts.size();
+    fake::broker.up = true;
+    unsigned long upMillis = millis();
+    bool back = runUntil(settled, mqtt::backoffMaxMillis + 5000);
+    unsigned long took = millis() - upMillis;
+
+    bool withinBounds = true, spacedByBackoff = true;
+    for (size_t i = 0; i < attemptsWhileDown; i++) {
+        const Attempt& a = attempts[i];
+        unsigned long ceiling = ceilingFor(a.failed);
+        withinBounds &= a.backoffMillis >= ceiling / 2 && a.backoffMillis <= ceiling;
+        if (i + 1 < attemptsWhileDown) {
+            // The next attempt fails as soon as it starts: the broker refuses the connect
+            unsigned long gap = attempts[i + 1].atMillis - a.atMillis;
+            spacedByBackoff &= gap >= a.backoffMillis && gap <= a.backoffMillis + 2;
+        }
+    }
+    bool capped = attemptsWhileDown > 0 && attempts[attemptsWhileDown - 1].backoffMillis >= mqtt::backoffMaxMillis / 2;
+
+    // The ring keeps the newest offlineQueueCapacity messages
+    std::vector<std::string> got = deliveredSince(first);
+    bool newest = got.size() == mqtt::offlineQueueCapacity;
+    for (size_t i = 0; newest && i < got.size(); i++) {
+        snprintf(payload, sizeof(payload), "o%d", published - (int)mqtt::offlineQueueCapacity + (int)i);
+        newest = got[i] == payload;
+    }
+
+    printf("  %u attempts in %lu s (a fixed %lu ms retry: %lu), back %lu ms after the broker\n",
+           (unsigned)attemptsWhileDown, outageMillis / 1000, mqtt::backoffBaseMillis,
+           outageMillis / mqtt::backoffBaseMillis, took);
+    printf("  backoffs (ms):");
+    for (size_t i = 0; i < attemptsWhileDown; i++) printf(" %lu", attempts[i].backoffMillis);
+    printf("\n");
+    expect(withinBounds, "each backoff is within [ceiling / 2, ceiling]");
+    expect(spacedByBackoff, "attempts are spaced by the backoff, not earlier");
+    expect(capped, "the backoff reaches the 30 s cap");
+    expect(attemptsWhileDown <= 12, "a two-minute outage costs at most 12 attempts");
+    expect(back && took <= mqtt::backoffMaxMillis + fake::broker.connectMillis + 5,
+           "back within one capped backoff of the broker");
+    expect(newest, "the newest 32 messages are delivered, in order, once");
+}
+
+/**
+ * @brief The link goes away during a long backoff and comes back.
+ */
+void link() {
+    printf("link (Wi-Fi drops while backed off at the cap):\n");
+    srand(11);
+    attempts.clear();
+    attemptsWithoutLink = 0;
+
+    fake::broker.up = false;
+    fake::broker.restart();
+    runFor(60000);
+    unsigned long backoffBefore = mqtt::backoffMillis;
+    fake::broker.up = true;
+
+    WiFi.dropAp();
+    runUntil([] { return !sta::connected(); }, 5000);
+    runFor(10000);
+    unsigned long attemptsDown = attemptsWithoutLink;
+    WiFi.restoreAp();
+    bool linkBack = runUntil([] { return sta::connected(); }, 30000);
+    unsigned long linkMillis = millis();
+    bool back = runUntil(settled, mqtt::backoffMaxMillis);
+    unsigned long took = millis() - linkMillis;
+
+    printf("  backoff was %lu ms; session back %lu ms after the link\n", backoffBefore, took);
+    expect(backoffBefore >= mqtt::backoffMaxMillis / 2, "the backoff had grown to the cap");
+    expect(attemptsDown == 0, "no connect attempt without a link");
+    expect(linkBack && back && took <= fake::broker.connectMillis + 5, "the link coming back skips the backoff");
+}
+
+/**
+ * @brief The link goes away under a live session and comes back.
+ */
+void drop() {
+    printf("drop (Wi-Fi drops while connected):\n");
+    const int messages = 5;
+    srand(13);
+    attempts.clear();
+    attemptsWithoutLink = 0;
+    size_t first = fake::broker.received.size();
+    uint32_t connects = fake::broker.connects;
+    uint32_t rejected = fake::broker.rejected;
+
+    bool wasUp = runUntil(settled, mqtt::backoffMaxMillis);
+    WiFi.dropAp();
+    runUntil([] { return !sta::connected(); }, 5000);
+    char payload[16];
+    for (int i = 0; i < messages; i++) {
+        snprintf(payload, sizeof(payload), "d%d", i);
+        mqtt::publish(mqtt::txTopic, payload, 1);
+        runFor(100);
+    }
+    WiFi.restoreAp();
+    bool linkBack = runUntil([] { return sta::connected(); }, 30000);
+    unsigned long linkMillis = millis();
+    bool back = runUntil(settled, mqtt::backoffMaxMillis);
+    unsigned long took = millis() - linkMillis;
+
+    std::vector<std::string> got = deliveredSince(first);
+    bool inOrder = (int)got.size() == messages;
+    for (int i = 0; inOrder && i < messages; i++) {
+        snprintf(payload, sizeof(payload), "d%d", i);
+        inOrder = got[i] == payload;
+    }
+
+    printf("  session back %lu ms after the link, %u CONNECT sent\n", took,
+           (unsigned)(fake::broker.connects - connects));
+    expect(wasUp && attemptsWithoutLink == 0, "no connect attempt without a link");
+    expect(fake::broker.connects - connects == 1 && fake::broker.rejected == rejected,
+           "the handshake after the drop sends CONNECT");
+    expect(linkBack && back && attempts.empty() && took <= fake::broker.connectMillis + 5,
+           "the session is back without a failed attempt");
+    expect(inOrder, "messages published meanwhile arrive once, in order");
+}
+
+int main() {
+    Serial.quiet = true;
+    sta::connect_to_wifi();
+    mqtt::setupMqtt();
+    bool up = runUntil(settled, 5000);
+    printf("connected: %s\n", up ? "yes" : "no");
+    if (!up) {
+        printf("\nFAIL\n");
+        return 1;
+    }
+
+    restart();
+    outage();
+    link();
+    drop();
+
+    printf("loop():\n");
+    expect(longestLoopMillis == 0, "never blocks: the clock only moves between calls");
+
+    printf(failures ? "\nFAIL\n" : "\nPASS\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,450 @@
+#ifndef FAKE_MFRC522_HPP
+#define FAKE_MFRC522_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+/**
+ * Host model of an MFRC522 and the ISO 14443A cards in its field.
+ *
+ * Register access works like the chip as far as a REQA burst needs it:
+ * FIFO, CommandReg (Idle / Transceive), BitFramingReg StartSend, ComIrqReg
+ * with Set1 semantics, ErrorReg CollErr, the timer (TReloadReg, started at the
+ * end of a transmission) and the IRQ pin (ComIEnReg & ComIrqReg). Cards answer
+ * REQA/WUPA with their ATQA and obey HLTA; the antenna switch powers them.
+ *
+ * PICC_RequestA(), PICC_IsNewCardPresent() and PICC_HaltA() run the same
+ * register sequence as the MFRC522 library, busy polling ComIrqReg included.
+ * PICC_Select() resolves anticollision on the UIDs directly (always taking
+ * the 1 branch, as the library does) and charges the library's SPI traffic.
+ *
+ * Time is simulated: every register access takes spi_transaction_us, and
+ * idle() / waitIrq() let it pass without bus traffic.
+ */
+class FakeMfrc522 {
+public:
+    enum PCD_Register : uint8_t {
+        CommandReg = 0x01 << 1,
+        ComIEnReg = 0x02 << 1,
+        DivIEnReg = 0x03 << 1,
+        ComIrqReg = 0x04 << 1,
+        DivIrqReg = 0x05 << 1,
+        ErrorReg = 0x06 << 1,
+        FIFODataReg = 0x09 << 1,
+        FIFOLevelReg = 0x0A << 1,
+        ControlReg = 0x0C << 1,
+        BitFramingReg = 0x0D << 1,
+        TxModeReg = 0x12 << 1,
+        RxModeReg = 0x13 << 1,
+        TxControlReg = 0x14 << 1,
+        ModWidthReg = 0x24 << 1,
+        TReloadRegH = 0x2C << 1,
+        TReloadRegL = 0x2D << 1,
+    };
+
+    enum PCD_Command : uint8_t { PCD_Idle = 0x00, PCD_Transceive = 0x0C };
+
+    enum PICC_Command : uint8_t { PICC_CMD_REQA = 0x26, PICC_CMD_WUPA = 0x52, PICC_CMD_HLTA = 0x50 };
+
+    enum StatusCode : uint8_t {
+        STATUS_OK,
+        STATUS_ERROR,
+        STATUS_COLLISION,
+        STATUS_TIMEOUT,
+        STATUS_NO_ROOM,
+        STATUS_INTERNAL_ERROR,
+        STATUS_INVALID,
+        STATUS_CRC_WRONG,
+        STATUS_MIFARE_NACK = 0xff
+    };
+
+    struct Uid {
+        uint8_t size;
+        uint8_t uidByte[10];
+        uint8_t sak;
+    } uid;
+
+    enum class CardState : uint8_t { Off, Idle, Ready, Active, Halt };
+
+    struct Card {
+        Uid uid;
+        uint16_t atqa;
+        CardState state;
+    };
+
+    // Bus and radio timing
+    static const uint32_t spi_transaction_us = 6;   // 2 bytes at 4 MHz plus chip select
+    static const uint32_t answer_us = 100;          // REQA sent and ATQA received
+    static const uint32_t timer_tick_us = 25;       // TPrescaler set by PCD_Init()
+
+    // --- Counters ---
+    uint64_t now_us = 0;
+    uint64_t field_us = 0;          // Time with the antenna on
+    uint64_t transactions = 0;      // SPI register accesses
+    uint32_t irq_edges = 0;         // IRQ pin assertions
+    bool notified = false;          // Set on an IRQ edge, like a task notification
+    bool irq_wired = true;          // false: the IRQ pin is not connected
+
+    // --- The field ---
+    void place(const Uid& card_uid, uint16_t atqa = 0x0004) {
+        cards.push_back({card_uid, atqa, antenna() ? CardState::Idle : CardState::Off});
+    }
+
+    void remove(const Uid& card_uid) {
+        for (size_t i = 0; i < cards.size(); i++) {
+            if (sameUid(cards[i].uid, card_uid)) {
+                cards.erase(cards.begin() + i);
+                return;
+            }
+        }
+    }
+
+    // --- Time without bus traffic ---
+    void idle(uint32_t us) { advanceTo(now_us + us); }
+
+    void idleUntil(uint64_t t) {
+        if (t > now_us) advanceTo(t);
+    }
+
+    /**
+     * @brief Sleeps until an IRQ edge or the timeout, like ulTaskNotifyTake().
+     */
+    bool waitIrq(uint32_t timeout_us) {
+        uint64_t deadline = now_us + timeout_us;
+        while (!notified && now_us < deadline) {
+            advanceTo(std::min<uint64_t>(deadline, now_us + 10));
+        }
+        bool fired = notified;
+        notified = false;
+        return fired;
+    }
+
+    bool irqAsserted() const { return irq_line; }
+
+    // --- MFRC522 library API ---
+    void PCD_Init() {
+        memset(regs, 0, sizeof(regs));
+        regs[ComIEnReg >> 1] = 0x80;
+        regs[TReloadRegH >> 1] = 0x03; // 1000 ticks: 25 ms
+        regs[TReloadRegL >> 1] = 0xE8;
+        fifo.clear();
+        irq = 0;
+        error = 0;
+        command = PCD_Idle;
+        pending_at = 0;
+        irq_line = false;
+        transactions += 12;
+        PCD_AntennaOn();
+    }
+
+    void PCD_WriteRegister(PCD_Register reg, uint8_t value) {
+        spend();
+        switch (reg) {
+        case CommandReg:
+            command = value & 0x0F;
+            if (command == PCD_Idle) pending_at = 0;
+            break;
+        case ComIrqReg:
+            if (value & 0x80) irq |= value & 0x7F;
+            else irq &= ~value & 0x7F;
+            break;
+        case FIFODataReg:
+            if (fifo.size() < 64) fifo.push_back(value);
+            break;
+        case FIFOLevelReg:
+            if (value & 0x80) fifo.clear();
+            break;
+        case BitFramingReg:
+            regs[reg >> 1] = value & 0x7F;
+            if ((value & 0x80) && command == PCD_Transceive) transmit(value & 0x07);
+            break;
+        case TxControlReg:
+            regs[reg >> 1] = value;
+            setAntenna((value & 0x03) != 0);
+            break;
+        default:
+            regs[reg >> 1] = value;
+            break;
+        }
+        updateIrq();
+    }
+
+    uint8_t PCD_ReadRegister(PCD_Register reg) {
+        spend();
+        switch (reg) {
+        case CommandReg:
+            return command;
+        case ComIrqReg:
+            return irq;
+        case ErrorReg:
+            return error;
+        case FIFOLevelReg:
+            return (uint8_t)fifo.size();
+        case FIFODataReg: {
+            if (fifo.empty()) return 0;
+            uint8_t value = fifo.front();
+            fifo.erase(fifo.begin());
+            return value;
+        }
+        case ControlReg:
+            return 0; // RxLastBits: whole bytes
+        default:
+            return regs[reg >> 1];
+        }
+    }
+
+    void PCD_AntennaOn() {
+        uint8_t value = PCD_ReadRegister(TxControlReg);
+        if ((value & 0x03) != 0x03) PCD_WriteRegister(TxControlReg, value | 0x03);
+    }
+
+    void PCD_AntennaOff() {
+        PCD_WriteRegister(TxControlReg, PCD_ReadRegister(TxControlReg) & ~0x03);
+    }
+
+    StatusCode PICC_RequestA(uint8_t* atqa, uint8_t* size) {
+        uint8_t frame = PICC_CMD_REQA;
+        return communicate(&frame, 1, 7, atqa, size);
+    }
+
+    bool PICC_IsNewCardPresent() {
+        uint8_t atqa[2];
+        uint8_t size = sizeof(atqa);
+        // The library resets the baud rates and the modulation width first
+        PCD_WriteRegister(TxModeReg, 0x00);
+        PCD_WriteRegister(RxModeReg, 0x00);
+        PCD_WriteRegister(ModWidthReg, 0x26);
+        StatusCode status = PICC_RequestA(atqa, &size);
+        return status == STATUS_OK || status == STATUS_COLLISION;
+    }
+
+    bool PICC_ReadCardSerial() { return PICC_Select(&uid) == STATUS_OK; }
+
+    /**
+     * @brief Anticollision and SELECT over every cascade level of the READY cards.
+     */
+    StatusCode PICC_Select(Uid* out, uint8_t valid_bits = 0) {
+        (void)valid_bits;
+        std::vector<Card*> candidates;
+        for (Card& card : cards) {
+            if (card.state == CardState::Ready) candidates.push_back(&card);
+        }
+        if (candidates.empty()) {
+            exchange(timerMicros()); // Nobody answers ANTICOLLISION
+            return STATUS_TIMEOUT;
+        }
+        // The bits as sent over the cascade levels: CT (0x88) marks a longer UID
+        std::vector<std::vector<uint8_t>> streams;
+        for (Card* card : candidates) streams.push_back(cascade(card->uid));
+        std::vector<size_t> alive;
+        for (size_t i = 0; i < candidates.size(); i++) alive.push_back(i);
+        for (size_t bit = 0; alive.size() > 1; bit++) {
+            size_t ones = 0;
+            for (size_t i : alive) ones += bitAt(streams[i], bit);
+            if (ones == 0 || ones == alive.size()) {
+                if (bit / 8 >= 4 * 3) break; // Identical UIDs: both answer, as real cards would
+                continue;
+            }
+            exchange(answer_us); // One more ANTICOLLISION round
+            std::vector<size_t> next;
+            for (size_t i : alive) {
+                if (bitAt(streams[i], bit)) next.push_back(i);
+            }
+            alive = next;
+        }
+        Card* selected = candidates[alive[0]];
+        size_t levels = streams[alive[0]].size() / 4;
+        for (size_t level = 0; level < levels; level++) {
+            exchange(answer_us);   // ANTICOLLISION: the UID bytes
+            spend(9);              // PCD_CalculateCRC() for SELECT
+            exchange(answer_us);   // SELECT: SAK
+        }
+        for (Card* card : candidates) {
+            card->state = card == selected ? CardState::Active : CardState::Idle;
+        }
+        *out = selected->uid;
+        out->sak = 0x08;
+        return STATUS_OK;
+    }
+
+    StatusCode PICC_HaltA() {
+        spend(9); // PCD_CalculateCRC()
+        uint8_t frame[4] = {PICC_CMD_HLTA, 0x00, 0x57, 0xCD};
+        StatusCode status = communicate(frame, sizeof(frame), 0, nullptr, nullptr);
+        // A halted card stays silent: the timeout is the success case
+        return status == STATUS_TIMEOUT ? STATUS_OK : STATUS_ERROR;
+    }
+
+    void PCD_StopCrypto1() { spend(2); } // Clears a Status2Reg bit: read, then write
+
+    const std::vector<Card>& field() const { return cards; }
+
+private:
+    uint8_t regs[64] = {};
+    std::vector<uint8_t> fifo;
+    std::vector<Card> cards;
+    uint8_t command = PCD_Idle;
+    uint8_t irq = 0;
+    uint8_t error = 0;
+    bool irq_line = false;
+
+    // What arrives at pending_at: an answer, or the timer running out
+    uint64_t pending_at = 0;
+    std::vector<uint8_t> pending_fifo;
+    uint8_t pending_irq = 0;
+    uint8_t pending_error = 0;
+
+    static bool sameUid(const Uid& a, const Uid& b) {
+        return a.size == b.size && memcmp(a.uidByte, b.uidByte, a.size) == 0;
+    }
+
+    static std::vector<uint8_t> cascade(const Uid& card_uid) {
+        std::vector<uint8_t> stream;
+        const uint8_t* bytes = card_uid.uidByte;
+        if (card_uid.size == 4) {
+            stream.assign(bytes, bytes + 4);
+        } else if (card_uid.size == 7) {
+            stream = {0x88, bytes[0], bytes[1], bytes[2], bytes[3], bytes[4], bytes[5], bytes[6]};
+        } else {
+            stream = {0x88, bytes[0], bytes[1], bytes[2], 0x88, bytes[3], bytes[4], bytes[5],
+                      bytes[6], bytes[7], bytes[8], bytes[9]};
+        }
+        return stream;
+    }
+
+    static int bitAt(const std::vector<uint8_t>& stream, size_t bit) {
+        if (bit / 8 >= stream.size()) return 0;
+        return (stream[bit / 8] >> (bit % 8)) & 1; // LSB first, as on the air
+    }
+
+    bool antenna() const { return (regs[TxControlReg >> 1] & 0x03) != 0; }
+
+    uint32_t timerMicros() const {
+        return ((regs[TReloadRegH >> 1] << 8) | regs[TReloadRegL >> 1]) * timer_tick_us;
+    }
+
+    void setAntenna(bool on) {
+        for (Card& card : cards) {
+            if (!on) card.state = CardState::Off;
+            else if (card.state == CardState::Off) card.state = CardState::Idle;
+        }
+    }
+
+    void advanceTo(uint64_t t) {
+        if (antenna()) field_us += t - now_us;
+        now_us = t;
+        if (pending_at != 0 && pending_at <= now_us) {
+            pending_at = 0;
+            fifo = pending_fifo;
+            irq |= pending_irq;
+            error |= pending_error;
+            updateIrq();
+        }
+    }
+
+    void spend(uint32_t count = 1) {
+        transactions += count;
+        advanceTo(now_us + count * spi_transaction_us);
+    }
+
+    void updateIrq() {
+        bool asserted = irq_wired && (regs[ComIEnReg >> 1] & irq & 0x7F) != 0;
+        if (asserted && !irq_line) {
+            irq_edges++;
+            notified = true;
+        }
+        irq_line = asserted;
+    }
+
+    /**
+     * @brief StartSend: the FIFO goes on the air, the cards answer (or the timer runs out).
+     */
+    void transmit(uint8_t last_bits) {
+        std::vector<uint8_t> frame = fifo;
+        fifo.clear();
+        error = 0;
+        irq |= 0x40; // TxIRq
+        pending_fifo.clear();
+        pending_irq = 0x01; // TimerIRq, unless someone answers
+        pending_error = 0;
+        pending_at = now_us + timerMicros();
+        if (!antenna() || frame.empty()) return;
+
+        bool wakeup = frame[0] == PICC_CMD_WUPA;
+        if (frame.size() == 1 && last_bits == 7 && (frame[0] == PICC_CMD_REQA || wakeup)) {
+            bool answered = false;
+            uint16_t atqa_or = 0, atqa_and = 0xFFFF;
+            for (Card& card : cards) {
+                if (card.state == CardState::Idle || (wakeup && card.state == CardState::Halt)) {
+                    card.state = CardState::Ready;
+                    atqa_or |= card.atqa;
+                    atqa_and &= card.atqa;
+                    answered = true;
+                }
+            }
+            if (answered) {
+                pending_fifo = {(uint8_t)(atqa_or & 0xFF), (uint8_t)(atqa_or >> 8)};
+                pending_irq = 0x20; // RxIRq
+                if (atqa_or != atqa_and) {
+                    pending_irq |= 0x02; // ErrIRq
+                    pending_error = 0x08; // CollErr
+                }
+                pending_at = now_us + answer_us;
+            }
+        } else if (frame[0] == PICC_CMD_HLTA) {
+            for (Card& card : cards) {
+                if (card.state == CardState::Active) card.state = CardState::Halt;
+            }
+        }
+    }
+
+    /**
+     * @brief The library's PCD_CommunicateWithPICC() for a Transceive.
+     */
+    StatusCode communicate(const uint8_t* data, uint8_t length, uint8_t last_bits, uint8_t* back,
+                           uint8_t* back_length) {
+        PCD_WriteRegister(CommandReg, PCD_Idle);
+        PCD_WriteRegister(ComIrqReg, 0x7F);
+        PCD_WriteRegister(FIFOLevelReg, 0x80);
+        for (uint8_t i = 0; i < length; i++) PCD_WriteRegister(FIFODataReg, data[i]);
+        PCD_WriteRegister(BitFramingReg, last_bits);
+        PCD_WriteRegister(CommandReg, PCD_Transceive);
+        uint8_t framing = PCD_ReadRegister(BitFramingReg);
+        PCD_WriteRegister(BitFramingReg, framing | 0x80 | last_bits);
+
+        // Busy polling, as the library does (up to 36 ms)
+        uint64_t deadline = now_us + 36000;
+        while (true) {
+            uint8_t n = PCD_ReadRegister(ComIrqReg);
+            if (n & 0x30) break;
+            if (n & 0x01) return STATUS_TIMEOUT;
+            if (now_us > deadline) return STATUS_TIMEOUT;
+        }
+        uint8_t errors = PCD_ReadRegister(ErrorReg);
+        if (errors & 0x13) return STATUS_ERROR;
+        uint8_t count = PCD_ReadRegister(FIFOLevelReg);
+        for (uint8_t i = 0; i < count; i++) {
+            uint8_t value = PCD_ReadRegister(FIFODataReg);
+            if (back && back_length && i < *back_length) back[i] = value;
+        }
+        if (back_length) *back_length = count;
+        PCD_ReadRegister(ControlReg);
+        if (errors & 0x08) return STATUS_COLLISION;
+        return STATUS_OK;
+    }
+
+    /**
+     * @brief The SPI traffic of one library exchange answered after us.
+     */
+    void exchange(uint32_t us) {
+        spend(9);
+        uint64_t answered = now_us + us;
+        while (now_us < answered) spend(); // Polling ComIrqReg
+        spend(4);
+    }
+};
+
+#endif // FAKE_MFRC522_HPP
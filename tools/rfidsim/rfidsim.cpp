@@ -0,0 +1,281 @@
+/**
+ * rfidsim.cpp
+ *
+ * Host check and benchmark for lab7_2's RFID scanning (lab7_2/src/rfid_scan.hpp)
+ * against a register model of the MFRC522 (fake_mfrc522.hpp).
+ *
+ * Check: the burst loop of rfid.hpp's RFID_Task runs in simulated time while
+ * cards are placed and removed: an empty field stays silent, a card resting on
+ * the reader arrives once and leaves once, several cards at once (colliding
+ * ATQAs, UIDs sharing a prefix, 4/7/10 bytes) are all read, a card missed for
+ * one burst does not leave, and a disconnected IRQ pin still finds cards.
+ *
+ * Benchmark: SPI traffic, time the caller is blocked, antenna duty and
+ * arrival latency, old loop() polling (PICC_IsNewCardPresent() +
+ * PICC_ReadCardSerial() every iteration) vs IRQ-driven REQA bursts.
+ *
+ * Build and run:
+ *   g++ -std=gnu++17 -O2 -I lab7_2/src tools/rfidsim/rfidsim.cpp -o rfidsim
+ *   ./rfidsim
+ */
+
+#include <cstdio>
+#include <initializer_list>
+#include <vector>
+
+#include "fake_mfrc522.hpp"
+#include "rfid_scan.hpp"
+
+using rfid_scan::CardEvent;
+
+// rfid.hpp's timing, in microseconds
+const uint32_t burst_period_us = 150000;
+const uint32_t field_settle_us = 5000;
+const uint32_t answer_timeout_us = 3000;
+
+FakeMfrc522::Uid makeUid(std::initializer_list<uint8_t> bytes) {
+    FakeMfrc522::Uid uid = {};
+    for (uint8_t b : bytes) uid.uidByte[uid.size++] = b;
+    return uid;
+}
+
+bool sameUid(const tag_table::Uid& a, const FakeMfrc522::Uid& b) {
+    return a.size == b.size && memcmp(a.bytes, b.uidByte, a.size) == 0;
+}
+
+/**
+ * @brief RFID_Task in simulated time.
+ */
+struct Reader {
+    FakeMfrc522 chip;
+    rfid_scan::Scanner<FakeMfrc522> scanner{chip};
+    rfid_scan::Presence presence;
+    std::vector<CardEvent> events;
+    uint64_t next_burst = 0;
+
+    Reader() {
+        chip.PCD_Init();
+        scanner.begin();
+        next_burst = chip.now_us + burst_period_us;
+    }
+
+    void burst() {
+        tag_table::Uid seen[rfid_scan::max_cards];
+        CardEvent changes[2 * rfid_scan::max_cards];
+        chip.idleUntil(next_burst);
+        next_burst += burst_period_us;
+        size_t count = scanner.burst(seen, rfid_scan::max_cards,
+            [&] {
+                chip.idle(field_settle_us);
+                chip.notified = false;
+            },
+            [&] { return chip.waitIrq(answer_timeout_us); });
+        size_t n = presence.update(seen, count, changes);
+        events.insert(events.end(), changes, changes + n);
+    }
+
+    void run(double seconds) {
+        uint64_t end = chip.now_us + (uint64_t)(seconds * 1e6);
+        while (next_burst <= end) burst();
+        chip.idleUntil(end);
+    }
+
+    size_t count(bool arrived) const {
+        size_t n = 0;
+        for (const CardEvent& e : events) n += e.arrived == arrived;
+        return n;
+    }
+
+    bool arrivedOnce(const FakeMfrc522::Uid& uid) const {
+        size_t n = 0;
+        for (const CardEvent& e : events) n += e.arrived && sameUid(e.uid, uid);
+        return n == 1;
+    }
+};
+
+int failures = 0;
+
+void expect(bool ok, const char* what) {
+    printf("  %-58s %s\n", what, ok ? "ok" : "FAIL");
+    failures += !ok;
+}
+
+const FakeMfrc522::Uid card_a = makeUid({0xDE, 0xAD, 0xBE, 0xEF});
+const FakeMfrc522::Uid card_b = makeUid({0xDE, 0xAD, 0xBE, 0x6F});       // Differs in one bit of the last byte
+const FakeMfrc522::Uid card_c = makeUid({0x04, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66}); // 7 bytes
+const FakeMfrc522::Uid card_d = makeUid({0x08, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09}); // 10 bytes
+
+void check() {
+    printf("check:\n");
+    {
+        Reader reader;
+        reader.run(10);
+        expect(reader.events.empty() && reader.chip.irq_edges == 0 && reader.scanner.answers == 0,
+               "empty field: no events, no interrupts");
+    }
+    {
+        Reader reader;
+        reader.run(1);
+        reader.chip.place(card_a);
+        uint64_t placed = reader.chip.now_us;
+        while (reader.events.empty()) reader.burst();
+        uint64_t latency = reader.chip.now_us - placed;
+        reader.run(5);
+        expect(reader.events.size() == 1 && reader.arrivedOnce(card_a), "one card: arrives once while it rests");
+        expect(latency < burst_period_us + 50000, "one card: noticed within one burst period");
+        reader.chip.remove(card_a);
+        reader.run(1);
+        expect(reader.count(false) == 1 && sameUid(reader.events.back().uid, card_a) && !reader.events.back().arrived,
+               "one card: leaves once");
+        expect(reader.scanner.missed_irqs == 0, "one card: every answer raised the IRQ pin");
+    }
+    {
+        Reader reader;
+        reader.chip.place(card_a, 0x0004);
+        reader.chip.place(card_b, 0x0004);
+        reader.chip.place(card_c, 0x0044); // Different ATQA: collision on the ATQA too
+        reader.chip.place(card_d, 0x0084);
+        reader.run(3);
+        expect(reader.events.size() == 4 && reader.arrivedOnce(card_a) && reader.arrivedOnce(card_b) &&
+                   reader.arrivedOnce(card_c) && reader.arrivedOnce(card_d),
+               "four cards at once: every UID arrives once");
+        reader.chip.remove(card_b);
+        reader.run(1);
+        expect(reader.events.size() == 5 && !reader.events.back().arrived && sameUid(reader.events.back().uid, card_b),
+               "four cards: removing one leaves only that one");
+        reader.chip.place(card_b);
+        reader.run(1);
+        expect(reader.events.size() == 6 && reader.events.back().arrived && sameUid(reader.events.back().uid, card_b),
+               "three cards: the one put back arrives again");
+    }
+    {
+        Reader reader;
+        reader.chip.place(card_a);
+        reader.run(1);
+        reader.chip.remove(card_a); // Off the reader for a single burst
+        reader.burst();
+        reader.chip.place(card_a);
+        reader.run(1);
+        expect(reader.events.size() == 1, "a card missed for one burst does not leave");
+    }
+    {
+        Reader reader;
+        reader.chip.irq_wired = false;
+        reader.chip.place(card_c);
+        reader.run(1);
+        expect(reader.arrivedOnce(card_c) && reader.scanner.missed_irqs > 0, "IRQ pin not connected: still found by ComIrqReg");
+    }
+}
+
+enum class Scenario { Empty, Resting, Presented };
+const char* scenario_names[] = {"empty field", "card resting on the reader", "card presented every ~0.6 s"};
+
+struct Load {
+    double spi_per_second;
+    double bus_busy;      // Fraction of the time the SPI bus is in use
+    double blocked;       // Fraction of the time the caller waits on the reader
+    double field_on;      // Fraction of the time the antenna is on
+    double latency_ms;    // Card placed -> UID read, average
+};
+
+void printLoad(const char* name, const Load& load) {
+    printf("  %-30s %9.0f %8.1f%% %8.1f%% %8.1f%% %10.1f\n", name, load.spi_per_second, 100 * load.bus_busy,
+           100 * load.blocked, 100 * load.field_on, load.latency_ms);
+}
+
+/**
+ * @brief The old loop(): processRFID() every iteration, other work ~1 ms.
+ */
+Load oldLoad(double seconds, Scenario scenario) {
+    FakeMfrc522 chip;
+    chip.PCD_Init();
+    uint64_t start = chip.now_us, blocked = 0;
+    uint64_t start_transactions = chip.transactions, start_field = chip.field_us;
+    if (scenario == Scenario::Resting) chip.place(card_a);
+    uint64_t end = start + (uint64_t)(seconds * 1e6);
+    double latency = 0;
+    int reads = 0;
+    uint64_t next_place = start + 500000;
+    uint64_t placed_at = 0;
+    bool placed = false;
+    while (chip.now_us < end) {
+        uint64_t before = chip.now_us;
+        if (scenario == Scenario::Presented && !placed && chip.now_us >= next_place) {
+            chip.place(card_b);
+            placed = true;
+            placed_at = chip.now_us;
+        }
+        if (chip.PICC_IsNewCardPresent() && chip.PICC_ReadCardSerial()) {
+            chip.PICC_HaltA();
+            chip.PCD_StopCrypto1();
+            if (placed) {
+                latency += (chip.now_us - placed_at) / 1000.0;
+                reads++;
+                chip.remove(card_b);
+                placed = false;
+                next_place = chip.now_us + 500000 + (reads * 37 % 11) * 13000;
+            }
+        }
+        blocked += chip.now_us - before;
+        chip.idle(1000);
+    }
+    double elapsed = (double)(chip.now_us - start);
+    uint64_t spi = chip.transactions - start_transactions;
+    return {spi / elapsed * 1e6, spi * FakeMfrc522::spi_transaction_us / elapsed, blocked / elapsed,
+            (chip.field_us - start_field) / elapsed, reads ? latency / reads : 0};
+}
+
+Load newLoad(double seconds, Scenario scenario) {
+    Reader reader;
+    uint64_t start = reader.chip.now_us;
+    uint64_t start_transactions = reader.chip.transactions, start_field = reader.chip.field_us;
+    if (scenario == Scenario::Resting) reader.chip.place(card_a);
+    uint64_t end = start + (uint64_t)(seconds * 1e6);
+    double latency = 0;
+    int reads = 0;
+    uint64_t next_place = start + 500000;
+    uint64_t placed_at = 0;
+    bool placed = false;
+    while (reader.next_burst <= end) {
+        // Place the card somewhere between two bursts
+        if (scenario == Scenario::Presented && !placed && reader.next_burst >= next_place) {
+            reader.chip.idleUntil(next_place);
+            reader.chip.place(card_b);
+            placed = true;
+            placed_at = reader.chip.now_us;
+        }
+        size_t before = reader.events.size();
+        reader.burst();
+        for (size_t i = before; i < reader.events.size(); i++) {
+            if (placed && reader.events[i].arrived && sameUid(reader.events[i].uid, card_b)) {
+                latency += (reader.chip.now_us - placed_at) / 1000.0;
+                reads++;
+                reader.chip.remove(card_b);
+                placed = false;
+                // Leaves after two bursts; the next one comes later, at a wandering phase
+                next_place = reader.chip.now_us + 500000 + (reads * 37 % 11) * 13000;
+            }
+        }
+    }
+    reader.chip.idleUntil(end);
+    double elapsed = (double)(reader.chip.now_us - start);
+    uint64_t spi = reader.chip.transactions - start_transactions;
+    // The task sleeps between bursts; loop() never waits on the reader
+    return {spi / elapsed * 1e6, spi * FakeMfrc522::spi_transaction_us / elapsed, 0,
+            (reader.chip.field_us - start_field) / elapsed, reads ? latency / reads : 0};
+}
+
+int main() {
+    check();
+
+    const double seconds = 60;
+    for (Scenario scenario : {Scenario::Empty, Scenario::Resting, Scenario::Presented}) {
+        printf("\n%s, %.0f simulated s\n", scenario_names[(int)scenario], seconds);
+        printf("  %-30s %9s %9s %9s %9s %10s\n", "", "SPI/s", "bus", "blocked", "field on", "latency ms");
+        printLoad("old: PICC_IsNewCardPresent", oldLoad(seconds, scenario));
+        printLoad("new: IRQ + REQA bursts", newLoad(seconds, scenario));
+    }
+
+    printf(failures ? "\nFAIL\n" : "\nPASS\n");
+    return failures ? 1 : 0;
+}
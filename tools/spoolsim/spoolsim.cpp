@@ -0,0 +1,277 @@
+/**
+ * spoolsim.cpp
+ *
+ * Host check and benchmark for the telemetry spool (lib/telemetry/src/spool.hpp)
+ * on the in-memory LittleFS of fake_fs.hpp.
+ *
+ * Check: a workload of 200 MPU-sized records (100 spooled during an outage,
+ * 100 more while the backlog replays, with the broker refusing a few bursts) is
+ * run once per power cut. The cut falls at every write boundary and inside
+ * every write (first byte, middle, last byte), once truncating the write and
+ * once garbling it. After each cut the spool reboots, drains and takes new
+ * records. No corrupt payload may come out, every record whose append
+ * returned is delivered, order is kept, at most indexSaveEvery records repeat
+ * and no segment is left behind.
+ *
+ * Benchmark: records/s of append() and replay() on the host (CRC and spool
+ * logic, storage in RAM), flash operations per record, and how long the
+ * device's default replay rate takes to drain a full spool.
+ *
+ * Build and run:
+ *   g++ -std=gnu++17 -O2 -I lib/telemetry/src tools/spoolsim/spoolsim.cpp -o spoolsim
+ *   ./spoolsim
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <set>
+#include <vector>
+
+#include "spool.hpp"
+
+const int offline_records = 100;
+const int online_records = 100;
+const int total_records = offline_records + online_records;
+
+int failures = 0;
+
+void expect(bool ok, const char* what) {
+    printf("  %-62s %s\n", what, ok ? "ok" : "FAIL");
+    failures += !ok;
+}
+
+/**
+ * @brief The payload of record id: MPU-sized, so a segment holds about 140.
+ */
+std::string payloadFor(int id) {
+    char text[spool::maxPayloadLength + 1];
+    snprintf(text, sizeof(text), "{\"id\": %d, \"qw\": 0.99%04d, \"qx\": 0.01%04d, \"qy\": -0.02%04d, \"qz\": 0.1%04d}", id,
+             id, id * 7 % 10000, id * 13 % 10000, id * 31 % 10000);
+    return text;
+}
+
+int idOf(const char* payload) {
+    int id = -1;
+    return sscanf(payload, "{\"id\": %d,", &id) == 1 ? id : -1;
+}
+
+// --- Sink (the broker) ---
+std::vector<int> delivered;
+bool corrupt = false;
+bool refusing = false;
+
+bool sink(uint64_t timestampMs, const char* payload, size_t length) {
+    (void)timestampMs;
+    if (refusing) return false;
+    int id = idOf(payload);
+    if (id < 0 || payloadFor(id) != std::string(payload, length)) corrupt = true;
+    delivered.push_back(id);
+    return true;
+}
+
+/**
+ * @brief RAM is gone: only what the spool kept in LittleFS survives.
+ */
+void reboot() {
+    spool::writeFile.close();
+    spool::ready = false;
+    spool::writeSegment = spool::writeOffset = 0;
+    spool::readSegment = spool::readOffset = 0;
+    spool::replayedSinceSave = 0;
+    spool::lastReplayMillis = 0;
+    spool::droppedSegments = 0;
+    fake::restorePower();
+    spool::init();
+}
+
+void wipe() {
+    spool::writeFile.close();
+    LittleFS.format();
+    fake::restorePower();
+    delivered.clear();
+    corrupt = false;
+    refusing = false;
+    reboot();
+}
+
+/**
+ * @brief The workload; stops where the power goes.
+ * @return Ids whose append() returned true before the cut.
+ */
+std::vector<int> workload() {
+    std::vector<int> appended;
+    for (int id = 0; id < offline_records && !fake::powerLost; id++) {
+        std::string p = payloadFor(id);
+        if (spool::append(p.c_str(), p.size())) appended.push_back(id);
+        fake::advance(50);
+    }
+    for (int tick = 0; !fake::powerLost && (tick < online_records || spool::pending()); tick++) {
+        if (tick < online_records) {
+            int id = offline_records + tick;
+            std::string p = payloadFor(id);
+            bool ok = spool::append(p.c_str(), p.size());
+            // A write cut exactly at its end is complete: the record is on flash
+            if (ok) appended.push_back(id);
+        }
+        refusing = tick >= 40 && tick < 45; // The broker goes away for a second
+        fake::advance(spool::replayIntervalMillis);
+        spool::replay(sink);
+    }
+    refusing = false;
+    return appended;
+}
+
+/**
+ * @brief After the reboot: new readings are spooled behind the old ones, then all drain.
+ */
+void recover() {
+    for (int id = total_records; id < total_records + 3; id++) {
+        std::string p = payloadFor(id);
+        spool::append(p.c_str(), p.size());
+    }
+    for (int i = 0; i < 10000 && spool::pending(); i++) {
+        fake::advance(spool::replayIntervalMillis);
+        spool::replay(sink);
+    }
+}
+
+size_t segmentsOnFlash() {
+    size_t n = 0;
+    for (const auto& entry : fake::files) n += entry.first.find(".seg") != std::string::npos;
+    return n;
+}
+
+struct Outcome {
+    bool intact = true;      // No corrupt or unknown payload
+    bool complete = true;    // Every appended record delivered
+    bool ordered = true;
+    bool recovered = true;   // Drained and took new records
+    bool tidy = true;        // Only the active segment left
+    size_t maxDuplicates = 0;
+};
+
+void judge(const std::vector<int>& appended, Outcome& out) {
+    out.intact &= !corrupt;
+    std::set<int> seen;
+    int last = -1;
+    size_t duplicates = 0;
+    for (int id : delivered) {
+        if (!seen.insert(id).second) {
+            duplicates++;
+            continue;
+        }
+        // Records spooled before the cut come out in order, then the new ones
+        out.ordered &= id > last;
+        last = id;
+    }
+    for (int id : appended) out.complete &= seen.count(id) > 0;
+    for (int id = total_records; id < total_records + 3; id++) out.recovered &= seen.count(id) > 0;
+    out.recovered &= !spool::pending();
+    out.tidy &= segmentsOnFlash() <= 1;
+    out.maxDuplicates = std::max(out.maxDuplicates, duplicates);
+}
+
+/**
+ * @brief One workload cut after the given number of bytes, then a reboot and recovery.
+ */
+void runWithCut(long cutAfter, fake::Cut mode, Outcome& out) {
+    wipe();
+    fake::cutPowerAfter(cutAfter, mode);
+    std::vector<int> appended = workload();
+    reboot();
+    recover();
+    judge(appended, out);
+}
+
+void check() {
+    printf("check:\n");
+
+    // A clean run, logging the size of every write the workload makes
+    wipe();
+    std::vector<size_t> writes;
+    fake::writeLog = &writes;
+    std::vector<int> appended = workload();
+    fake::writeLog = nullptr;
+    Outcome clean;
+    recover();
+    judge(appended, clean);
+    expect(clean.intact && clean.complete && clean.ordered && clean.recovered && clean.maxDuplicates == 0,
+           "without a cut: every record once, in order");
+
+    // Cut at the start of every write, after its first byte, in its middle and before its last byte
+    std::vector<long> cuts;
+    long offset = 0;
+    for (size_t size : writes) {
+        cuts.push_back(offset);
+        if (size > 1) cuts.push_back(offset + 1);
+        if (size > 2) cuts.push_back(offset + (long)size / 2);
+        if (size > 3) cuts.push_back(offset + (long)size - 1);
+        offset += (long)size;
+    }
+    cuts.push_back(offset);
+
+    const fake::Cut modes[] = {fake::Cut::Truncate, fake::Cut::Garble};
+    const char* names[] = {"truncated", "garbled"};
+    for (int m = 0; m < 2; m++) {
+        Outcome out;
+        for (long cut : cuts) runWithCut(cut, modes[m], out);
+        printf("  %zu cuts over %zu writes (%ld bytes), writes %s; at most %zu records repeated\n", cuts.size(),
+               writes.size(), offset, names[m], out.maxDuplicates);
+        expect(out.intact, "no corrupt record is ever replayed");
+        expect(out.complete, "every record whose append() returned is delivered");
+        expect(out.ordered, "records are delivered in order");
+        expect(out.maxDuplicates <= spool::indexSaveEvery, "at most indexSaveEvery records are sent twice");
+        expect(out.recovered, "records spooled after the reboot are delivered too");
+        expect(out.tidy, "no segment is left behind");
+    }
+}
+
+/**
+ * @brief Host records/s and flash operations per record.
+ */
+void bench() {
+    printf("\nbenchmark (host, storage in RAM):\n");
+    const int records = 20000;
+    wipe();
+    size_t replayBurst = spool::replayBurst;
+    spool::replayBurst = 32; // The "batch" command's maximum
+
+    uint32_t writeCalls = fake::writeCalls, flushCalls = fake::flushCalls, renames = fake::renameCalls;
+    uint64_t bytes = fake::bytesWritten;
+    std::string payload = payloadFor(1234);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < records; i++) spool::append(payload.c_str(), payload.size());
+    double appendSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("  append: %9.0f records/s, per record: %.2f writes, %.2f flushes, %.1f bytes\n", records / appendSeconds,
+           (double)(fake::writeCalls - writeCalls) / records, (double)(fake::flushCalls - flushCalls) / records,
+           (double)(fake::bytesWritten - bytes) / records);
+
+    // Only the newest maxSegments segments are kept
+    writeCalls = fake::writeCalls;
+    renames = fake::renameCalls;
+    delivered.clear();
+    start = std::chrono::steady_clock::now();
+    while (spool::pending()) {
+        fake::advance(spool::replayIntervalMillis);
+        spool::replay(sink);
+    }
+    double replaySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("  replay: %9.0f records/s, per record: %.3f index writes\n", delivered.size() / replaySeconds,
+           (double)(fake::renameCalls - renames) / delivered.size());
+    spool::replayBurst = replayBurst;
+
+    size_t recordBytes = sizeof(spool::RecordHeader) + payload.size();
+    size_t capacity = spool::maxSegments * (spool::segmentMaxBytes / recordBytes);
+    double perSecond = 1000.0 * spool::replayBurst / spool::replayIntervalMillis;
+    printf("  device: a full spool holds %zu such records; at the default %.0f records/s it drains in %.0f min\n",
+           capacity, perSecond, capacity / perSecond / 60);
+    expect(!corrupt && delivered.size() <= capacity && delivered.size() > 0, "the overflowed spool replays its newest records");
+}
+
+int main() {
+    Serial.quiet = true;
+    check();
+    bench();
+    printf(failures ? "\nFAIL\n" : "\nPASS\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,182 @@
+/**
+ * tagbench.cpp
+ *
+ * Host check and benchmark for lab7_2's RFID tag table (lab7_2/src/tag_table.hpp).
+ *
+ * Check: a random mix of bind / rebind / erase / eraseEvent is applied to a
+ * small table (clusters wrap around, the table runs full) and to a
+ * std::unordered_map; every result and lookup must agree.
+ *
+ * Benchmark: scan-to-event latency with 10k bound tags, the old way (hex
+ * String built by concatenation, then compared against every event's UID) vs
+ * a hash table lookup on the binary UID, for known and unknown tags.
+ *
+ * Build and run:
+ *   g++ -std=gnu++17 -O2 -I lab7_2/src tools/tagbench/tagbench.cpp -o tagbench
+ *   ./tagbench            # 10000 tags
+ *   ./tagbench 3000
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tag_table.hpp"
+
+using tag_table::Uid;
+
+const size_t CAPACITY = 16384; // Up to 12288 tags; the firmware uses 4096 slots
+
+std::mt19937 rng(42);
+
+Uid randomUid() {
+    Uid uid = {};
+    static const uint8_t sizes[] = {4, 4, 4, 7, 7, 10}; // MIFARE Classic is mostly 4 bytes
+    uid.size = sizes[rng() % 6];
+    for (uint8_t i = 0; i < uid.size; i++) uid.bytes[i] = rng();
+    return uid;
+}
+
+std::string key(const Uid& uid) { return std::string((const char*)uid.bytes, uid.size); }
+
+/**
+ * @brief The old rfid::scanCard() conversion: one concatenation per byte, then toUpperCase().
+ */
+std::string oldHex(const Uid& uid) {
+    std::string hex = "";
+    for (uint8_t i = 0; i < uid.size; i++) {
+        hex += std::string(uid.bytes[i] < 0x10 ? "0" : "");
+        char byte[3];
+        snprintf(byte, sizeof(byte), "%x", uid.bytes[i]);
+        hex += std::string(byte);
+    }
+    for (char& c : hex) c = toupper(c);
+    return hex;
+}
+
+bool check() {
+    static tag_table::TagTable<1024> table; // Small, so clusters wrap around the end
+    std::unordered_map<std::string, uint8_t> model;
+    std::vector<Uid> known;
+    unsigned long mismatches = 0;
+    size_t peak = 0;
+
+    for (int op = 0; op < 400000; op++) {
+        // First half mostly binds, so the table also runs full
+        int kind = rng() % 100;
+        if (op < 200000 && kind < 85) kind = kind % 50;
+        Uid uid = known.empty() || rng() % 3 == 0 ? randomUid() : known[rng() % known.size()];
+        if (kind < 50) {
+            uint8_t event = rng() % 8;
+            bool fits = model.count(key(uid)) || model.size() < table.max_tags;
+            if (table.bind(uid, event) != fits) mismatches++;
+            if (fits) {
+                model[key(uid)] = event;
+                known.push_back(uid);
+            }
+        } else if (kind < 85) {
+            bool present = model.erase(key(uid)) > 0;
+            if (table.erase(uid) != present) mismatches++;
+        } else if (kind < 86) {
+            uint8_t event = rng() % 8;
+            size_t expected = 0;
+            for (auto it = model.begin(); it != model.end();) {
+                if (it->second == event) {
+                    it = model.erase(it);
+                    expected++;
+                } else {
+                    ++it;
+                }
+            }
+            if (table.eraseEvent(event) != expected) mismatches++;
+        }
+        if (known.size() > 4000) known.erase(known.begin(), known.begin() + 2000);
+
+        // Lookups: a few known UIDs and one random one
+        for (int i = 0; i < 4; i++) {
+            Uid probe = i == 3 || known.empty() ? randomUid() : known[rng() % known.size()];
+            auto it = model.find(key(probe));
+            int expected = it == model.end() ? -1 : it->second;
+            if (table.find(probe) != expected) mismatches++;
+        }
+        if (table.size() != model.size()) mismatches++;
+        peak = std::max(peak, table.size());
+    }
+    printf("check: 400000 operations, peak %zu/%zu tags, %lu mismatches  %s\n", peak, table.max_tags, mismatches,
+           mismatches ? "FAIL" : "ok");
+    return mismatches == 0;
+}
+
+template <typename F>
+double nanosPerLookup(F lookup, size_t count) {
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; i++) lookup(i);
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / count;
+}
+
+volatile long sink;
+
+int main(int argc, char** argv) {
+    size_t tags = argc > 1 ? strtoul(argv[1], nullptr, 10) : 10000;
+    bool ok = check();
+
+    static tag_table::TagTable<CAPACITY> table;
+    if (tags > table.max_tags) {
+        printf("at most %zu tags\n", table.max_tags);
+        return 1;
+    }
+    std::vector<Uid> bound;
+    std::vector<std::string> oldUids; // events[i].assignedUID, one per tag
+    while (bound.size() < tags) {
+        Uid uid = randomUid();
+        if (table.find(uid) >= 0) continue;
+        table.bind(uid, bound.size() % 250);
+        bound.push_back(uid);
+        oldUids.push_back(oldHex(uid));
+    }
+    std::vector<Uid> unknown;
+    while (unknown.size() < 1000) {
+        Uid uid = randomUid();
+        if (table.find(uid) < 0) unknown.push_back(uid);
+    }
+
+    // Probe lengths (slots compared per successful lookup)
+    size_t totalProbes = 0, maxProbes = 0;
+    for (const Uid& uid : bound) {
+        size_t probes = 1;
+        for (size_t i = tag_table::hash(uid) & (CAPACITY - 1); !(table.slot(i).uid == uid); i = (i + 1) & (CAPACITY - 1)) {
+            probes++;
+        }
+        totalProbes += probes;
+        maxProbes = std::max(maxProbes, probes);
+    }
+
+    const size_t oldCount = 20000, newCount = 5000000;
+    auto oldLookup = [&](const Uid& uid) {
+        std::string hex = oldHex(uid);
+        for (size_t i = 0; i < oldUids.size(); i++) {
+            if (oldUids[i] == hex) return (long)i;
+        }
+        return -1L;
+    };
+    double oldHit = nanosPerLookup([&](size_t) { sink = oldLookup(bound[rng() % bound.size()]); }, oldCount);
+    double oldMiss = nanosPerLookup([&](size_t i) { sink = oldLookup(unknown[i % unknown.size()]); }, oldCount / 10);
+    double newHit = nanosPerLookup([&](size_t i) { sink = table.find(bound[i % bound.size()]); }, newCount);
+    double newMiss = nanosPerLookup([&](size_t i) { sink = table.find(unknown[i % unknown.size()]); }, newCount);
+
+    printf("\n%zu tags in %zu slots (load %.2f), %zu bytes, probes/hit avg %.2f max %zu\n", tags, CAPACITY,
+           (double)tags / CAPACITY, sizeof(table), (double)totalProbes / tags, maxProbes);
+    printf("  %-34s %12s %12s\n", "", "known ns", "unknown ns");
+    printf("  %-34s %12.1f %12.1f\n", "old: hex String + linear compare", oldHit, oldMiss);
+    printf("  %-34s %12.1f %12.1f\n", "new: binary UID + hash table", newHit, newMiss);
+    printf("  -> %.0fx (known), %.0fx (unknown)\n", oldHit / newHit, oldMiss / newMiss);
+
+    printf(ok ? "\nPASS\n" : "\nFAIL\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,360 @@
+/**
+ * timesim.cpp
+ *
+ * Host check and benchmark for the timesync library (lib/timesync): the SNTP
+ * client and clock discipline run in simulated time against a fake SNTP server
+ * and a drifting crystal.
+ *
+ * The crystal runs 40 ppm fast with a +-0.5 ppm daily wander (temperature).
+ * The network adds 2 ms plus exponential queueing each way, loses 3% of the
+ * packets, now and then holds one for 50-250 ms and delivers 1% twice.
+ *
+ * Check: the first fix comes within a second without blocking, the drift is
+ * measured, the error stays within its reported bound, the clock never goes
+ * back after the first fix, a day without network stays within tens of
+ * milliseconds, a reboot without network comes back with the saved time and
+ * drift, a task that sleeps until nextDue() keeps the same accuracy, and a
+ * Kiss-o'-Death slows the client down.
+ *
+ * Benchmark: error and traffic of the ESP-IDF SNTP defaults that lab7 used
+ * before (step to the server time every hour, no drift correction) vs timesync.
+ *
+ * Build and run:
+ *   g++ -std=gnu++17 -O2 -I lib/timesync/src tools/timesim/timesim.cpp -o timesim
+ *   ./timesim
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "sntp_client.hpp"
+
+using timesync::Discipline;
+using timesync::State;
+
+const int64_t second = 1000000;
+const int64_t minute = 60 * second;
+const int64_t hour = 60 * minute;
+const int64_t day = 24 * hour;
+const int64_t tick_us = 10000; // run() every 10 ms, like the device task
+
+const int64_t start_utc = 1772323200LL * second; // 2026-03-01 00:00 UTC
+
+/**
+ * @brief True time and the crystal's count of it.
+ */
+struct World {
+    double utc = (double)start_utc;
+    double local = 0;          // Local counter, starts at boot
+    double base_drift = 40e-6;
+    double wander = 0.5e-6;
+
+    double drift() const { return base_drift + wander * sin(2 * M_PI * (utc - start_utc) / day); }
+
+    void advance(int64_t us) {
+        local += us * (1 + drift());
+        utc += us;
+    }
+};
+
+std::mt19937 rng(48);
+
+/**
+ * @brief One way through the network, in microseconds.
+ */
+double oneWay() {
+    std::exponential_distribution<double> queueing(1.0 / 3000);
+    double us = 2000 + queueing(rng);
+    if (rng() % 100 < 2) us += 50000 + rng() % 200000; // Held in a buffer somewhere
+    return us;
+}
+
+/**
+ * @brief Fake SNTP server behind a lossy network, as the client's Net.
+ */
+struct FakeServer {
+    struct Pending {
+        double arrival_utc;
+        uint8_t packet[timesync::packet_size];
+    };
+
+    World& world;
+    bool link = true;       // false: send() fails (no Wi-Fi)
+    bool kiss = false;
+    int loss_percent = 3;
+    uint32_t requests = 0;
+    std::vector<Pending> pending;
+
+    explicit FakeServer(World& world) : world(world) {}
+
+    bool send(const uint8_t* data, size_t length) {
+        if (!link) return false;
+        requests++;
+        if (length != timesync::packet_size || (int)(rng() % 100) < loss_percent) return true;
+        Pending reply = {};
+        double t2 = world.utc + oneWay();
+        double t3 = t2 + 30;
+        reply.packet[0] = 4 << 3 | 4;
+        reply.packet[1] = kiss ? 0 : 2;
+        memcpy(reply.packet + 24, data + 40, 8); // Originate: the client's cookie
+        timesync::writeTimestamp(reply.packet + 32, (int64_t)t2);
+        timesync::writeTimestamp(reply.packet + 40, (int64_t)t3);
+        reply.arrival_utc = t3 + oneWay();
+        pending.push_back(reply);
+        if (rng() % 100 == 0) {
+            reply.arrival_utc += 5000 + rng() % 100000; // Duplicated
+            pending.push_back(reply);
+        }
+        return true;
+    }
+
+    int receive(uint8_t* data, size_t length) {
+        auto first = std::min_element(pending.begin(), pending.end(),
+                                      [](const Pending& a, const Pending& b) { return a.arrival_utc < b.arrival_utc; });
+        if (first == pending.end() || first->arrival_utc > world.utc) return 0;
+        size_t n = std::min(length, timesync::packet_size);
+        memcpy(data, first->packet, n);
+        pending.erase(first);
+        return (int)n;
+    }
+};
+
+/**
+ * @brief The device: NTP task with the discipline, in simulated time.
+ */
+struct Device {
+    World& world;
+    FakeServer server;
+    Discipline clock;
+    timesync::Client<FakeServer> client{server, clock};
+
+    int64_t last_shown = 0;
+    bool shown_any = false;
+    uint32_t backwards = 0;    // now() went back, outside of steps
+    uint32_t steps_seen = 0;
+    uint32_t wakeups = 0;      // sleepUntilDue() only
+
+    explicit Device(World& world) : world(world), server(world) {}
+
+    int64_t local() const { return (int64_t)world.local; }
+
+    /**
+     * @return The error of the clock after the tick, in microseconds (0 while invalid).
+     */
+    int64_t tick() {
+        world.advance(tick_us);
+        client.run(local());
+        if (!clock.valid()) return 0;
+        int64_t shown = clock.now(local());
+        if (shown_any && shown < last_shown && clock.stepCount() == steps_seen) backwards++;
+        steps_seen = clock.stepCount();
+        last_shown = shown;
+        shown_any = true;
+        return shown - (int64_t)world.utc;
+    }
+
+    /**
+     * @brief Like NTP_Task: sleep until the client is due, polling every 2 ms while a reply is awaited.
+     */
+    void sleepUntilDue() {
+        int64_t due = client.awaitingReply() ? local() + 2000 : client.nextDue();
+        world.advance(std::max<int64_t>(due - local(), 1000));
+        client.run(local());
+        wakeups++;
+    }
+};
+
+struct Run {
+    double max_error_ms = 0;
+    double p99_error_ms = 0;
+    double bound_kept = 1;   // Fraction of ticks where |error| <= reported bound
+    std::vector<double> errors;
+    unsigned long checked = 0, kept = 0;
+
+    void add(int64_t error_us, int64_t bound_us) {
+        errors.push_back(fabs(error_us / 1000.0));
+        checked++;
+        kept += bound_us >= 0 && llabs(error_us) <= bound_us;
+    }
+
+    void finish() {
+        if (errors.empty()) return;
+        std::sort(errors.begin(), errors.end());
+        max_error_ms = errors.back();
+        p99_error_ms = errors[(size_t)(errors.size() * 0.99)];
+        bound_kept = (double)kept / checked;
+    }
+};
+
+int failures = 0;
+
+void expect(bool ok, const char* what) {
+    printf("  %-62s %s\n", what, ok ? "ok" : "FAIL");
+    failures += !ok;
+}
+
+/**
+ * @brief Steady state, a day without network, and the reboots around it.
+ */
+void check(Run& steady, double& holdover_ms, uint32_t& requests_per_day) {
+    printf("check:\n");
+    World world;
+    Device device(world);
+
+    // First fix: run() only ever takes a tick, so the caller never waits on the network
+    int64_t ticks = 0;
+    while (!device.clock.valid() && ticks < 10 * second / tick_us) {
+        device.tick();
+        ticks++;
+    }
+    expect(device.clock.valid() && ticks * tick_us < second, "first fix within a second, without blocking");
+    expect(llabs(device.clock.now(device.local()) - (int64_t)world.utc) < 50000, "first fix within 50 ms");
+
+    // Learn the drift, then measure for two days
+    while (world.utc < start_utc + 6 * hour) device.tick();
+    double drift_error = fabs(device.clock.drift() - world.drift() * 1e6);
+    printf("  drift after 6 h: %.2f ppm measured, %.2f ppm true\n", device.clock.drift(), world.drift() * 1e6);
+    expect(device.clock.driftKnown() && drift_error < 0.3, "drift measured within 0.3 ppm after 6 h");
+
+    uint32_t requests_before = device.server.requests;
+    while (world.utc < start_utc + 54 * hour) {
+        int64_t error = device.tick();
+        steady.add(error, device.clock.errorBound(device.local()));
+    }
+    steady.finish();
+    requests_per_day = (device.server.requests - requests_before) / 2;
+    timesync::Quality q = device.clock.quality(device.local());
+    printf("  steady state: max %.2f ms, p99 %.2f ms, poll %lld s, jitter %lld us, %u spikes\n", steady.max_error_ms,
+           steady.p99_error_ms, (long long)(device.client.pollInterval() / second), (long long)q.jitter_us, q.spikes);
+    expect(steady.max_error_ms < 10, "steady state: error below 10 ms");
+    expect(steady.bound_kept > 0.999, "steady state: error within the reported bound");
+    expect(q.state == State::Synced && device.clock.stepCount() == 1, "steady state: synced, stepped only at the first fix");
+    expect(device.client.pollInterval() == timesync::max_poll_us, "steady state: polling at the longest interval");
+    expect(device.client.stats.bogus > 0, "duplicated replies were recognized and dropped");
+
+    // A day without network
+    device.server.link = false;
+    int64_t outage_end = (int64_t)world.utc + day;
+    bool bound_kept = true;
+    while (world.utc < outage_end) {
+        int64_t error = device.tick();
+        bound_kept &= llabs(error) <= device.clock.errorBound(device.local());
+    }
+    int64_t error = device.clock.now(device.local()) - (int64_t)world.utc;
+    holdover_ms = fabs(error / 1000.0);
+    q = device.clock.quality(device.local());
+    printf("  after 24 h without network: %.1f ms off, bound %.1f ms\n", holdover_ms, q.error_us / 1000.0);
+    expect(q.state == State::Holdover, "outage: reported as holdover");
+    expect(holdover_ms < 50, "outage: within 50 ms after a day");
+    expect(bound_kept, "outage: error within the growing bound");
+    device.server.link = true;
+    while (device.clock.quality(device.local()).state != State::Synced) device.tick();
+    for (int i = 0; i < 2 * minute / tick_us; i++) device.tick(); // Slewing off 0.5 ms per second
+    expect(llabs(device.clock.now(device.local()) - (int64_t)world.utc) < 10000 && device.clock.stepCount() == 1,
+           "outage: back within 10 ms by slewing, no step");
+    expect(device.backwards == 0, "the clock never went back");
+
+    // Power off for 10 min, back up without network: the saved time and drift
+    timesync::Snapshot saved = device.clock.snapshot(device.local());
+    world.advance(10 * minute);
+    world.local = 0;
+    Device rebooted(world);
+    rebooted.server.link = false;
+    rebooted.clock.restore(rebooted.local(), saved.utc_us, saved.drift_ppb / 1000.0);
+    for (int i = 0; i < 1000; i++) rebooted.tick();
+    q = rebooted.clock.quality(rebooted.local());
+    expect(rebooted.clock.valid() && q.state == State::Restored && q.error_us < 0,
+           "reboot without network: restored time, error unknown");
+    rebooted.server.link = true;
+    while (rebooted.clock.quality(rebooted.local()).state != State::Synced) rebooted.tick();
+    expect(llabs(rebooted.clock.now(rebooted.local()) - (int64_t)world.utc) < 50000 &&
+               rebooted.clock.stepCount() == 1,
+           "reboot: stepped by the downtime at the first reply");
+    // Drift carried over: a 6 h outage right away is still good
+    for (int i = 0; i < 3000; i++) rebooted.tick();
+    rebooted.server.link = false;
+    int64_t end = (int64_t)world.utc + 6 * hour;
+    while (world.utc < end) rebooted.tick();
+    error = rebooted.clock.now(rebooted.local()) - (int64_t)world.utc;
+    printf("  rebooted, 30 s of sync, 6 h without network: %.1f ms off\n", fabs(error / 1000.0));
+    expect(fabs(error / 1000.0) < 20, "reboot: saved drift keeps a 6 h outage within 20 ms");
+
+    // Sleeping until nextDue() instead of ticking: same fix, a handful of wakeups per poll
+    World slept;
+    Device sleeper(slept);
+    while (slept.utc < start_utc + 6 * hour) sleeper.sleepUntilDue();
+    uint32_t wakeups_before = sleeper.wakeups, polls_before = sleeper.server.requests;
+    while (slept.utc < start_utc + 12 * hour) sleeper.sleepUntilDue();
+    double per_poll = (double)(sleeper.wakeups - wakeups_before) / std::max(1u, sleeper.server.requests - polls_before);
+    int64_t slept_error = sleeper.clock.now(sleeper.local()) - (int64_t)slept.utc;
+    printf("  sleeping until due: %u wakeups in 6 h (%.1f per poll), %.2f ms off\n", sleeper.wakeups - wakeups_before,
+           per_poll, fabs(slept_error / 1000.0));
+    expect(sleeper.clock.quality(sleeper.local()).state == State::Synced && llabs(slept_error) < 10000,
+           "sleeping until nextDue(): synced within 10 ms");
+    expect(per_poll < 200, "sleeping until nextDue(): wakes only around its polls");
+
+    // Kiss-o'-Death: RATE
+    World quiet;
+    Device kissed(quiet);
+    kissed.server.kiss = true;
+    while (quiet.utc < start_utc + hour) kissed.tick();
+    expect(!kissed.clock.valid() && kissed.server.requests <= 8, "Kiss-o'-Death: not believed, polling slows down");
+}
+
+/**
+ * @brief lab7 before: configTzTime(), the IDF SNTP client stepping to the server
+ *        time every hour (CONFIG_LWIP_SNTP_UPDATE_DELAY) with no drift correction.
+ */
+void oldSntp(Run& steady, double& holdover_ms, uint32_t& backwards) {
+    World world;
+    double offset = 0; // System time - local counter
+    bool set = false;
+    double next_sync = world.utc;
+    double last_shown = 0;
+    backwards = 0;
+    while (world.utc < start_utc + 54 * hour) {
+        world.advance(tick_us);
+        if (world.utc >= next_sync) {
+            next_sync += hour;
+            if ((int)(rng() % 100) >= 3) {
+                double up = oneWay(), down = oneWay();
+                offset = world.utc + (up - down) / 2 - world.local; // Round trip compensated, stepped
+                set = true;
+            }
+        }
+        if (!set) continue;
+        double shown = world.local + offset;
+        if (shown < last_shown) backwards++;
+        last_shown = shown;
+        if (world.utc >= start_utc + 6 * hour) steady.add((int64_t)(shown - world.utc), -1);
+    }
+    steady.finish();
+    world.advance(day);
+    holdover_ms = fabs((world.local + offset - world.utc) / 1000.0);
+}
+
+int main() {
+    Run steady;
+    double holdover_ms = 0;
+    uint32_t requests_per_day = 0;
+    check(steady, holdover_ms, requests_per_day);
+
+    Run old_steady;
+    double old_holdover_ms = 0;
+    uint32_t old_backwards = 0;
+    oldSntp(old_steady, old_holdover_ms, old_backwards);
+
+    printf("\n40 ppm crystal, 2 days synced then 1 day without network\n");
+    printf("  %-30s %10s %10s %10s %12s %12s\n", "", "max ms", "p99 ms", "back jumps", "requests/day",
+           "24 h off ms");
+    printf("  %-30s %10.2f %10.2f %10u %12u %12.1f\n", "old: IDF SNTP, hourly step", old_steady.max_error_ms,
+           old_steady.p99_error_ms, old_backwards, 24u, old_holdover_ms);
+    printf("  %-30s %10.2f %10.2f %10u %12u %12.1f\n", "new: timesync", steady.max_error_ms, steady.p99_error_ms, 0u,
+           requests_per_day, holdover_ms);
+
+    printf(failures ? "\nFAIL\n" : "\nPASS\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,459 @@
+#!/usr/bin/env python3
+"""
+tsdb.py
+
+Embedded append-only time-series store for the sensor services (lab4_2 dht_service.py,
+lab5_2 mpu_service.py), so history survives restarts and can be queried later.
+
+Layout (one directory per device, one file per UTC day = time partition):
+    <root>/<device>/schema.json        field names
+    <root>/<device>/<YYYY-MM-DD>.raw   raw blocks
+    <root>/<device>/<YYYY-MM-DD>.m1    1-minute rollup blocks: count, then min/max/sum of every field
+
+A block is a header followed by one compressed stream per column. Timestamps (int64 ms)
+are stored as delta-of-delta, values (float32) as XOR with the previous value of the same
+field; both are zigzag/byte-plane shuffled and zlib-compressed, so regular sampling and slowly
+changing readings shrink to a few bytes per row, and both directions are plain numpy.
+Rows are buffered per device and partition and written as one block every block_rows rows
+or max_age seconds; a crash loses at most that buffer, and a torn block at the end of a
+file is detected (length/CRC) and skipped. Reads memory-map the partition files and only
+decompress the blocks whose time range overlaps the query.
+
+Usage:
+    python tsdb.py devices --root ~/sensor-history
+    python tsdb.py query --root ~/sensor-history --device esp32/0ad3/tx --from 2026-10-18 --to 2026-10-19
+    python tsdb.py query --root ~/sensor-history --device esp32/0ad3/tx --from 2026-10-01 --step 3600
+    python tsdb.py bench --root /tmp/tsdb-bench --devices 50 --days 30 --interval 10
+"""
+
+import argparse
+import json
+import mmap
+import os
+import shutil
+import struct
+import sys
+import time
+import zlib
+from datetime import datetime, timezone
+from urllib.parse import quote, unquote
+
+import numpy as np
+
+MAGIC = b'TSB1'
+# magic, rows, first time, last time (ms), value columns, reserved, CRC32 of the column streams
+HEADER = struct.Struct('<4sIqqHHI')
+DAY_MS = 86400000
+MINUTE_MS = 60000
+
+
+# --- Column codecs ---
+
+def _shuffle(a):
+    """Byte planes: all first bytes, then all second bytes... (zlib then sees the zero planes)."""
+    return a.view(np.uint8).reshape(-1, a.itemsize).T.tobytes()
+
+
+def _unshuffle(buf, dtype, rows):
+    return np.frombuffer(buf, np.uint8).reshape(dtype.itemsize, rows).T.copy().view(dtype).ravel()
+
+
+def encode_times(t, level):
+    """int64 ms -> [t0, d1, d2 - d1, ...], zigzag, shuffled, compressed."""
+    x = t.astype(np.int64)
+    if len(x) > 1:
+        d = np.diff(x)
+        x[1] = d[0]
+        x[2:] = np.diff(d)
+    z = ((x << 1) ^ (x >> 63)).view(np.uint64)
+    return zlib.compress(_shuffle(z), level)
+
+
+def decode_times(buf, rows):
+    z = _unshuffle(zlib.decompress(buf), np.dtype(np.uint64), rows)
+    x = ((z >> np.uint64(1)).view(np.int64)) ^ -((z & np.uint64(1)).view(np.int64))
+    x[1:] = np.cumsum(x[1:])
+    return np.cumsum(x)
+
+
+def encode_values(v, level):
+    """float32 -> XOR with the previous value, shuffled, compressed."""
+    bits = np.ascontiguousarray(v, dtype=np.float32).view(np.uint32)
+    x = bits.copy()
+    x[1:] ^= bits[:-1]
+    return zlib.compress(_shuffle(x), level)
+
+
+def decode_values(buf, rows):
+    x = _unshuffle(zlib.decompress(buf), np.dtype(np.uint32), rows)
+    return np.bitwise_xor.accumulate(x).view(np.float32)
+
+
+def encode_block(t, values, level):
+    streams = [encode_times(t, level)] + [encode_values(values[:, c], level) for c in range(values.shape[1])]
+    lengths = struct.pack(f'<{len(streams)}I', *map(len, streams))
+    body = b''.join(streams)
+    header = HEADER.pack(MAGIC, len(t), int(t[0]), int(t[-1]), values.shape[1], 0, zlib.crc32(body))
+    return header + lengths + body
+
+
+# --- Aggregation ---
+
+def aggregate(keys, count, mins, maxs, sums):
+    """Merge rows with equal keys: count/sum add up, min/max combine. Returns the same tuple, keys sorted."""
+    order = np.argsort(keys, kind='stable')
+    keys = keys[order]
+    starts = np.flatnonzero(np.r_[True, keys[1:] != keys[:-1]])
+    return (keys[starts], np.add.reduceat(count[order], starts),
+            np.minimum.reduceat(mins[order], starts), np.maximum.reduceat(maxs[order], starts),
+            np.add.reduceat(sums[order], starts))
+
+
+def minute_rollup(t, values):
+    """Raw rows -> 1-minute rollup rows (bucket start, [count, min..., max..., sum...])."""
+    ones = np.ones(len(t))
+    v = values.astype(np.float64)
+    keys, count, mins, maxs, sums = aggregate(t // MINUTE_MS * MINUTE_MS, ones, v, v, v)
+    return keys, np.column_stack([count, mins, maxs, sums]).astype(np.float32)
+
+
+# --- Store ---
+
+class TimeSeriesStore:
+    def __init__(self, root, block_rows=4096, max_age=60.0, level=3):
+        self.root = root
+        self.block_rows = block_rows
+        self.max_age = max_age
+        self.level = level
+        self.schemas = {}
+        self.heads = {}     # (device, day) -> [chunks of (t, values)], rows, first append time
+        self.index = {}     # path -> (scanned size, [(t_first, t_last, body offset, rows, crc, lengths)])
+        os.makedirs(root, exist_ok=True)
+
+    # Writing
+
+    def _device_dir(self, device):
+        return os.path.join(self.root, quote(device, safe=''))
+
+    def _schema(self, device, fields=None):
+        schema = self.schemas.get(device)
+        if schema is None:
+            path = os.path.join(self._device_dir(device), 'schema.json')
+            if os.path.exists(path):
+                with open(path) as f:
+                    schema = tuple(json.load(f)['fields'])
+            elif fields is not None:
+                os.makedirs(self._device_dir(device), exist_ok=True)
+                with open(path, 'w') as f:
+                    json.dump({'fields': list(fields)}, f)
+                schema = tuple(fields)
+            else:
+                raise KeyError(f"unknown device {device!r}")
+            self.schemas[device] = schema
+        if fields is not None and tuple(fields) != schema:
+            raise ValueError(f"{device!r} stores {schema}, not {tuple(fields)}")
+        return schema
+
+    def append(self, device, fields, t_ms, values):
+        """Buffer rows of one device; t_ms int64 epoch ms, values (n, len(fields))."""
+        if len(t_ms) == 0:
+            return
+        self._schema(device, fields)
+        t_ms = np.asarray(t_ms, dtype=np.int64)
+        values = np.asarray(values, dtype=np.float32).reshape(len(t_ms), len(fields))
+        days = t_ms // DAY_MS
+        for day in np.unique(days):
+            rows = days == day
+            key = (device, int(day))
+            head = self.heads.get(key)
+            if head is None:
+                head = self.heads[key] = [[], 0, time.monotonic()]
+            head[0].append((t_ms[rows], values[rows]))
+            head[1] += int(np.count_nonzero(rows))
+            if head[1] >= self.block_rows:
+                self._write(key)
+
+    def append_rows(self, devices, slots, times_s, values, fields):
+        """Batch from a service's Ingest: slots index `devices`, times in epoch seconds."""
+        if len(slots) == 0:
+            return
+        order = np.argsort(slots, kind='stable')
+        slots, t_ms, values = slots[order], np.round(times_s[order] * 1000.0).astype(np.int64), values[order]
+        starts = np.flatnonzero(np.r_[True, slots[1:] != slots[:-1]])
+        for rows in np.split(np.arange(len(slots)), starts[1:]):
+            self.append(devices[slots[rows[0]]], fields, t_ms[rows], values[rows])
+
+    def _path(self, device, day, tier):
+        date = datetime.fromtimestamp(day * 86400, tz=timezone.utc).strftime('%Y-%m-%d')
+        return os.path.join(self._device_dir(device), f"{date}.{tier}")
+
+    def _write(self, key):
+        chunks, rows, _ = self.heads.pop(key)
+        t = np.concatenate([c[0] for c in chunks])
+        v = np.concatenate([c[1] for c in chunks])
+        order = np.argsort(t, kind='stable')  # Replayed samples may arrive late
+        t, v = t[order], v[order]
+        device, day = key
+        for tier, (bt, bv) in (('raw', (t, v)), ('m1', minute_rollup(t, v))):
+            with open(self._path(device, day, tier), 'ab') as f:
+                for start in range(0, len(bt), self.block_rows):
+                    f.write(encode_block(bt[start:start + self.block_rows], bv[start:start + self.block_rows],
+                                         self.level))
+
+    def flush(self, max_age=None):
+        """Write buffered rows: all of them, or only buffers older than max_age seconds."""
+        now = time.monotonic()
+        for key in [k for k, head in self.heads.items() if max_age is None or now - head[2] >= max_age]:
+            self._write(key)
+
+    def flush_stale(self):
+        """Called periodically by the services: bounds what a crash can lose to max_age seconds."""
+        self.flush(self.max_age)
+
+    def close(self):
+        self.flush()
+
+    # Reading
+
+    def devices(self):
+        names = {unquote(d) for d in os.listdir(self.root)
+                 if os.path.exists(os.path.join(self.root, d, 'schema.json'))}
+        return sorted(names | {device for device, _ in self.heads})
+
+    def fields(self, device):
+        return self._schema(device)
+
+    def _blocks(self, path, mm):
+        """Block index of a partition file, extended incrementally as the file grows."""
+        scanned, blocks = self.index.get(path, (0, []))
+        offset, size = scanned, len(mm)
+        while offset + HEADER.size <= size:
+            magic, rows, first, last, columns, _, crc = HEADER.unpack_from(mm, offset)
+            lengths_at = offset + HEADER.size
+            if magic != MAGIC or lengths_at + 4 * (columns + 1) > size:
+                break
+            lengths = struct.unpack_from(f'<{columns + 1}I', mm, lengths_at)
+            body = lengths_at + 4 * (columns + 1)
+            if body + sum(lengths) > size:
+                break  # Torn write at the end of the file
+            blocks.append((first, last, body, rows, crc, lengths))
+            offset = body + sum(lengths)
+        self.index[path] = (offset, blocks)
+        return blocks
+
+    def _read(self, path, t0, t1):
+        """Rows of one partition file with t0 <= t < t1."""
+        if not os.path.exists(path) or os.path.getsize(path) == 0:
+            return []
+        out = []
+        with open(path, 'rb') as f, mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as mm:
+            view = memoryview(mm)
+            for first, last, body, rows, crc, lengths in self._blocks(path, mm):
+                if last < t0 or first >= t1:
+                    continue
+                end = body + sum(lengths)
+                if zlib.crc32(view[body:end]) != crc:
+                    print(f"[TSDB] Corrupt block in {path} at {body}, skipped", file=sys.stderr)
+                    continue
+                t = decode_times(view[body:body + lengths[0]], rows)
+                columns, pos = [], body + lengths[0]
+                for length in lengths[1:]:
+                    columns.append(decode_values(view[pos:pos + length], rows))
+                    pos += length
+                keep = (t >= t0) & (t < t1)
+                out.append((t[keep], np.column_stack(columns)[keep]))
+            view.release()
+        return out
+
+    def _collect(self, device, t0, t1, tier):
+        ncols = len(self._schema(device)) * (3 if tier == 'm1' else 1) + (1 if tier == 'm1' else 0)
+        parts = []
+        for day in range(t0 // DAY_MS, (t1 - 1) // DAY_MS + 1):
+            parts.extend(self._read(self._path(device, day, tier), t0, t1))
+            head = self.heads.get((device, day))
+            if head is not None:
+                for t, v in head[0]:
+                    if tier == 'm1':
+                        t, v = minute_rollup(t, v)
+                    keep = (t >= t0) & (t < t1)
+                    parts.append((t[keep], v[keep]))
+        if not parts:
+            return np.empty(0, np.int64), np.empty((0, ncols), np.float32)
+        t = np.concatenate([p[0] for p in parts])
+        v = np.concatenate([p[1] for p in parts])
+        if len(parts) > 1:
+            order = np.argsort(t, kind='stable')
+            t, v = t[order], v[order]
+        return t, v
+
+    def query(self, device, t0, t1):
+        """Raw rows with t0 <= t < t1 (epoch ms), time-ordered: (t int64 ms, values float32 (n, fields))."""
+        return self._collect(device, t0, t1, 'raw')
+
+    def rollup(self, device, t0, t1, step_ms):
+        """Downsampled rows: bucket start, count, min, max, mean per field (dict of arrays).
+
+        Steps that are whole minutes are served from the 1-minute tier, finer ones from raw rows.
+        """
+        nfields = len(self._schema(device))
+        if step_ms % MINUTE_MS == 0:
+            t, v = self._collect(device, t0 - t0 % MINUTE_MS, t1, 'm1')
+            count = v[:, 0].astype(np.float64)
+            mins, maxs, sums = (v[:, 1 + k * nfields:1 + (k + 1) * nfields].astype(np.float64) for k in range(3))
+        else:
+            t, v = self._collect(device, t0, t1, 'raw')
+            count, mins = np.ones(len(t)), v.astype(np.float64)
+            maxs = sums = mins
+        if len(t) == 0:
+            empty = np.empty((0, nfields))
+            return {'t': np.empty(0, np.int64), 'count': np.empty(0), 'min': empty, 'max': empty, 'mean': empty}
+        keys, count, mins, maxs, sums = aggregate(t // step_ms * step_ms, count, mins, maxs, sums)
+        return {'t': keys, 'count': count, 'min': mins, 'max': maxs, 'mean': sums / count[:, None]}
+
+    def tail(self, device, rows, days=7):
+        """The newest `rows` raw rows of a device from the last `days` partitions."""
+        now = int(time.time() * 1000)
+        parts, found = [], 0
+        for day in range(now // DAY_MS + 1, now // DAY_MS - days, -1):
+            t, v = self._collect(device, day * DAY_MS, (day + 1) * DAY_MS, 'raw')
+            if len(t):
+                parts.append((t, v))
+                found += len(t)
+                if found >= rows:
+                    break
+        if not parts:
+            return np.empty(0, np.int64), np.empty((0, len(self._schema(device))), np.float32)
+        t = np.concatenate([p[0] for p in reversed(parts)])
+        v = np.concatenate([p[1] for p in reversed(parts)])
+        return t[-rows:], v[-rows:]
+
+    def disk_bytes(self, suffix=''):
+        return sum(os.path.getsize(os.path.join(d, f)) for d, _, files in os.walk(self.root) for f in files
+                   if f.endswith(suffix))
+
+
+# --- Command line ---
+
+def parse_time(text, default):
+    if text is None:
+        return default
+    if text.lstrip('-').isdigit():
+        return int(text)
+    moment = datetime.fromisoformat(text)
+    if moment.tzinfo is None:
+        moment = moment.astimezone()
+    return int(moment.timestamp() * 1000)
+
+
+def cmd_devices(args):
+    store = TimeSeriesStore(args.root)
+    for device in store.devices():
+        print(f"{device}  {', '.join(store.fields(device))}")
+
+
+def cmd_query(args):
+    store = TimeSeriesStore(args.root)
+    now = int(time.time() * 1000)
+    t0 = parse_time(args.start, now - DAY_MS)
+    t1 = parse_time(args.end, now)
+    fields = store.fields(args.device)
+    stamp = lambda ms: datetime.fromtimestamp(ms / 1000.0).isoformat(timespec='milliseconds')
+    if args.step:
+        r = store.rollup(args.device, t0, t1, int(args.step * 1000))
+        print('time,count,' + ','.join(f"{f}_{a}" for f in fields for a in ('min', 'max', 'mean')))
+        for i, t in enumerate(r['t']):
+            cells = [f"{r[a][i, k]:.4g}" for k in range(len(fields)) for a in ('min', 'max', 'mean')]
+            print(f"{stamp(t)},{int(r['count'][i])}," + ','.join(cells))
+    else:
+        t, v = store.query(args.device, t0, t1)
+        print('time,' + ','.join(fields))
+        for i in range(len(t)):
+            print(f"{stamp(t[i])}," + ','.join(f"{x:.4g}" for x in v[i]))
+
+
+def cmd_bench(args):
+    """A month (by default) of DHT-like rows from many devices: ingest rate, size, query latency."""
+    if os.path.exists(args.root):
+        shutil.rmtree(args.root)
+    store = TimeSeriesStore(args.root, block_rows=args.block_rows)
+    fields = ('temperature', 'humidity', 'heat_index')
+    step = int(args.interval * 1000)
+    end = int(time.time() * 1000) // DAY_MS * DAY_MS
+    start = end - args.days * DAY_MS
+    per_device = (end - start) // step
+    total = per_device * args.devices
+    rng = np.random.default_rng(7)
+    devices = [f"esp32/{i:04x}/tx" for i in range(args.devices)]
+    print(f"{args.devices} devices x {args.days} days every {args.interval:g} s = {total} rows, "
+          f"block {args.block_rows} rows")
+
+    # Ingest in one-hour slices, all devices per slice (the services append per frame)
+    chunk = max(1, 3600000 // step)
+    elapsed = 0.0
+    for offset in range(0, per_device, chunk):
+        n = min(chunk, per_device - offset)
+        t = start + (offset + np.arange(n)) * step
+        daily = np.sin(2 * np.pi * (t % DAY_MS) / DAY_MS)
+        batch = []
+        for device in devices:
+            temperature = np.round(22 + 3 * daily + rng.normal(0, 0.05, n), 1)
+            humidity = np.round(45 - 8 * daily + rng.normal(0, 0.2, n), 1)
+            batch.append((device, np.column_stack([temperature, humidity, temperature + 0.4])))
+        began = time.perf_counter()
+        for device, values in batch:
+            store.append(device, fields, t, values)
+        elapsed += time.perf_counter() - began
+    began = time.perf_counter()
+    store.close()
+    elapsed += time.perf_counter() - began
+    raw, rollups = store.disk_bytes('.raw'), store.disk_bytes('.m1')
+    print(f"ingest   {total / elapsed:12.0f} rows/s   ({elapsed:.1f} s)")
+    print(f"on disk  {(raw + rollups) / 1e6:12.1f} MB       raw {raw / total:.2f} bytes/row "
+          f"(uncompressed 20), 1-minute tier {rollups / 1e6:.1f} MB")
+
+    def timed(label, fn, repeat=20):
+        times = []
+        for i in range(repeat):
+            began = time.perf_counter()
+            result = fn(i)
+            times.append(time.perf_counter() - began)
+        times.sort()
+        print(f"{label:34s} p50 {times[len(times) // 2] * 1e3:8.2f} ms   p90 "
+              f"{times[int(len(times) * 0.9)] * 1e3:8.2f} ms   {result} rows")
+
+    reader = TimeSeriesStore(args.root)  # Cold block index, as after a restart
+    pick = lambda i: devices[(i * 7919) % len(devices)]
+    timed('raw, last hour', lambda i: len(reader.query(pick(i), end - 3600000, end)[0]))
+    timed('raw, one day', lambda i: len(reader.query(pick(i), end - DAY_MS, end)[0]))
+    timed('raw, whole range', lambda i: len(reader.query(pick(i), start, end)[0]), repeat=5)
+    timed('rollup 1 h, whole range (m1 tier)', lambda i: len(reader.rollup(pick(i), start, end, 3600000)['t']))
+    timed('rollup 1 min, one day (m1 tier)', lambda i: len(reader.rollup(pick(i), end - DAY_MS, end, 60000)['t']))
+    timed('rollup 10 s, one day (raw)', lambda i: len(reader.rollup(pick(i), end - DAY_MS, end, 10000)['t']))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Sensor history store')
+    sub = parser.add_subparsers(dest='command', required=True)
+    p = sub.add_parser('devices', help='List stored devices and their fields')
+    p.add_argument('--root', required=True)
+    p.set_defaults(fn=cmd_devices)
+    p = sub.add_parser('query', help='Print raw rows or rollups as CSV')
+    p.add_argument('--root', required=True)
+    p.add_argument('--device', required=True, help='MQTT topic of the device, e.g. esp32/0ad3/tx')
+    p.add_argument('--from', dest='start', help='ISO time or epoch ms (default: 24 h ago)')
+    p.add_argument('--to', dest='end', help='ISO time or epoch ms (default: now)')
+    p.add_argument('--step', type=float, help='Rollup bucket in seconds (default: raw rows)')
+    p.set_defaults(fn=cmd_query)
+    p = sub.add_parser('bench', help='Synthetic ingest and query benchmark (deletes --root first)')
+    p.add_argument('--root', required=True)
+    p.add_argument('--devices', type=int, default=50)
+    p.add_argument('--days', type=int, default=30)
+    p.add_argument('--interval', type=float, default=10.0, help='Seconds between rows of a device')
+    p.add_argument('--block-rows', type=int, default=4096)
+    p.set_defaults(fn=cmd_bench)
+    args = parser.parse_args()
+    args.fn(args)
+
+
+if __name__ == '__main__':
+    main()